@@ -58,7 +58,9 @@ def batch_function(num_batch_threads,
                    max_batch_size,
                    batch_timeout_micros,
                    allowed_batch_sizes=None,
-                   max_enqueued_batches=10):
+                   max_enqueued_batches=10,
+                   enable_large_batch_splitting=False,
+                   request_deadline_micros=0):
   """Batches the computation done by the decorated function.
 
   So, for example, in the following code
@@ -93,6 +95,13 @@ def batch_function(num_batch_threads,
      to pad batches up to one of those sizes. The entries must increase
      monotonically, and the final entry must equal max_batch_size.
     max_enqueued_batches: The maximum depth of the batch queue. Defaults to 10.
+    enable_large_batch_splitting: If True, inputs larger than the room left in
+     the current batch are split across batches, and the outputs are
+     concatenated back together. Inputs may then be up to
+     max_enqueued_batches * max_batch_size in size. Defaults to False.
+    request_deadline_micros: If positive, the number of microseconds each input
+     may wait for and take in processing. Batches are processed before their
+     timeout when needed to meet this deadline. Defaults to 0, i.e. none.
 
   Returns:
     The decorated function will return the unbatched computation output Tensors.
@@ -119,6 +128,8 @@ def batch_function(num_batch_threads,
             batch_timeout_micros=batch_timeout_micros,
             allowed_batch_sizes=allowed_batch_sizes,
             max_enqueued_batches=max_enqueued_batches,
+            enable_large_batch_splitting=enable_large_batch_splitting,
+            request_deadline_micros=request_deadline_micros,
             shared_name=name,
             f=computation,
             in_tensors=list(args),
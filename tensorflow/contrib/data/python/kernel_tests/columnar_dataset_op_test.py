@@ -0,0 +1,116 @@
+# Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+"""Tests for `ColumnarWriter` and `ColumnarDataset`."""
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+
+import os
+
+import numpy as np
+
+from tensorflow.contrib.data.python.ops import readers
+from tensorflow.contrib.data.python.ops import writers
+from tensorflow.python.data.ops import dataset_ops
+from tensorflow.python.framework import dtypes
+from tensorflow.python.framework import errors
+from tensorflow.python.ops import math_ops
+from tensorflow.python.ops import parsing_ops
+from tensorflow.python.ops import string_ops
+from tensorflow.python.platform import test
+
+
+class ColumnarDatasetTest(test.TestCase):
+
+  def _writeFile(self, name, num_rows, rows_per_group):
+    filename = os.path.join(self.get_temp_dir(), name)
+    dataset = dataset_ops.Dataset.range(num_rows).map(lambda i: {
+        "id": i,
+        "value": math_ops.cast([i, -i], dtypes.float32),
+        "name": string_ops.as_string(i),
+    })
+    with self.test_session() as sess:
+      sess.run(writers.ColumnarWriter(filename, rows_per_group).write(dataset))
+    return filename
+
+  def _readAll(self, dataset):
+    next_element = dataset.make_one_shot_iterator().get_next()
+    batches = []
+    with self.test_session() as sess:
+      while True:
+        try:
+          batches.append(sess.run(next_element))
+        except errors.OutOfRangeError:
+          return batches
+
+  def testReadBatches(self):
+    filenames = [
+        self._writeFile("a.col", 10, 4),
+        self._writeFile("b.col", 3, 2),
+    ]
+    dataset = readers.ColumnarDataset(filenames, {
+        "id": parsing_ops.FixedLenFeature([], dtypes.int64),
+        "value": parsing_ops.FixedLenFeature([2], dtypes.float32),
+        "name": parsing_ops.FixedLenFeature([], dtypes.string),
+    }, batch_size=5)
+    self.assertEqual([None, 2], dataset.output_shapes["value"].as_list())
+
+    batches = self._readAll(dataset)
+    self.assertEqual([5, 5, 3], [len(b["id"]) for b in batches])
+    ids = np.concatenate([b["id"] for b in batches])
+    self.assertAllEqual(list(range(10)) + list(range(3)), ids)
+    for batch in batches:
+      self.assertAllEqual(
+          np.stack([batch["id"], -batch["id"]], axis=1), batch["value"])
+      self.assertAllEqual([str(i).encode() for i in batch["id"]],
+                          batch["name"])
+
+  def testReadSubsetOfColumns(self):
+    filename = self._writeFile("subset.col", 6, 4)
+    dataset = readers.ColumnarDataset(
+        filename, {"name": parsing_ops.FixedLenFeature([], dtypes.string)},
+        batch_size=4)
+    batches = self._readAll(dataset)
+    self.assertEqual(["name"], list(batches[0].keys()))
+    self.assertAllEqual([b"0", b"1", b"2", b"3"], batches[0]["name"])
+    self.assertAllEqual([b"4", b"5"], batches[1]["name"])
+
+  def testMismatchedType(self):
+    filename = self._writeFile("mismatch.col", 2, 4)
+    dataset = readers.ColumnarDataset(
+        filename, {"id": parsing_ops.FixedLenFeature([], dtypes.float32)},
+        batch_size=4)
+    next_element = dataset.make_one_shot_iterator().get_next()
+    with self.test_session() as sess:
+      with self.assertRaises(errors.InvalidArgumentError):
+        sess.run(next_element)
+
+  def testMissingColumn(self):
+    filename = self._writeFile("missing.col", 2, 4)
+    dataset = readers.ColumnarDataset(
+        filename, {"missing": parsing_ops.FixedLenFeature([], dtypes.int64)},
+        batch_size=4)
+    next_element = dataset.make_one_shot_iterator().get_next()
+    with self.test_session() as sess:
+      with self.assertRaises(errors.NotFoundError):
+        sess.run(next_element)
+
+  def testWriteRequiresDict(self):
+    with self.assertRaises(TypeError):
+      writers.ColumnarWriter("unused").write(dataset_ops.Dataset.range(3))
+
+
+if __name__ == "__main__":
+  test.main()
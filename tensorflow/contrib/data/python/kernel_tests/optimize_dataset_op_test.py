@@ -138,6 +138,31 @@ class OptimizeDatasetTest(test.TestCase, parameterized.TestCase):
       sess.run(init_op, {input_t: np.ones([1, 512, 1024, 1025], np.int32)})
       sess.run(get_next)
 
+  def testModelAutotune(self):
+    dataset = dataset_ops.Dataset.range(1000).map(
+        lambda x: x * x, num_parallel_calls=optimization.AUTOTUNE).prefetch(
+            optimization.AUTOTUNE).apply(optimization.model())
+    iterator = dataset.make_one_shot_iterator()
+    get_next = iterator.get_next()
+
+    with self.test_session() as sess:
+      for i in range(1000):
+        self.assertEqual(i * i, sess.run(get_next))
+      with self.assertRaises(errors.OutOfRangeError):
+        sess.run(get_next)
+
+  def testAutotuneWithoutModel(self):
+    dataset = dataset_ops.Dataset.range(100).map(
+        lambda x: x * x, num_parallel_calls=optimization.AUTOTUNE)
+    iterator = dataset.make_one_shot_iterator()
+    get_next = iterator.get_next()
+
+    with self.test_session() as sess:
+      for i in range(100):
+        self.assertEqual(i * i, sess.run(get_next))
+      with self.assertRaises(errors.OutOfRangeError):
+        sess.run(get_next)
+
 
 if __name__ == "__main__":
   test.main()
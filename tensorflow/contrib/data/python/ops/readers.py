@@ -37,6 +37,7 @@ from tensorflow.python.framework import ops
 from tensorflow.python.framework import tensor_shape
 from tensorflow.python.lib.io import file_io
 from tensorflow.python.ops import gen_dataset_ops
+from tensorflow.python.ops import parsing_ops as core_parsing_ops
 from tensorflow.python.platform import gfile
 from tensorflow.python.util import deprecation
 
@@ -1028,3 +1029,83 @@ class LMDBDataset(dataset_ops.Dataset):
   @property
   def output_types(self):
     return dtypes.string, dtypes.string
+
+
+class ColumnarDataset(dataset_ops.Dataset):
+  """A `Dataset` of batches of columns read from columnar files.
+
+  Columnar files are written by `tf.contrib.data.ColumnarWriter`. They store
+  the values of each column of a group of rows contiguously, so that only the
+  columns in `features` are read and decoded, and the decoded values are
+  emitted as batches without any per-row parsing.
+  """
+
+  def __init__(self, filenames, features, batch_size):
+    """Creates a `ColumnarDataset`.
+
+    For example:
+
+    ```python
+    dataset = tf.contrib.data.ColumnarDataset(
+        ["/foo/bar.col"],
+        {"age": tf.FixedLenFeature([], tf.int64),
+         "embedding": tf.FixedLenFeature([16], tf.float32)},
+        batch_size=128)
+    # Each element is a dict with an int64 "age" tensor of shape [<= 128] and
+    # a float32 "embedding" tensor of shape [<= 128, 16].
+    ```
+
+    Args:
+      filenames: A `tf.string` tensor containing one or more filenames.
+      features: A `dict` mapping column names to `FixedLenFeature` values that
+        give the type and the shape of each row of the column. Default values
+        are not supported.
+      batch_size: A `tf.int64` scalar `tf.Tensor`, representing the number of
+        rows in each batch. The last batch of the dataset may be smaller.
+
+    Raises:
+      TypeError: If `features` does not map to `FixedLenFeature` values.
+      ValueError: If a feature has a default value.
+    """
+    super(ColumnarDataset, self).__init__()
+    self._filenames = ops.convert_to_tensor(
+        filenames, dtype=dtypes.string, name="filenames")
+    self._batch_size = ops.convert_to_tensor(
+        batch_size, dtype=dtypes.int64, name="batch_size")
+    self._column_names = sorted(features)
+    for name in self._column_names:
+      feature = features[name]
+      if not isinstance(feature, core_parsing_ops.FixedLenFeature):
+        raise TypeError("Feature %s must be a `FixedLenFeature` but is %r." %
+                        (name, feature))
+      if feature.default_value is not None:
+        raise ValueError("Feature %s must not have a default value." % name)
+    self._output_types = {
+        name: dtypes.as_dtype(feature.dtype)
+        for name, feature in features.items()
+    }
+    self._output_shapes = {
+        name: tensor_shape.vector(None).concatenate(feature.shape)
+        for name, feature in features.items()
+    }
+
+  def _as_variant_tensor(self):
+    return gen_dataset_ops.columnar_dataset(
+        self._filenames,
+        ops.convert_to_tensor(
+            self._column_names, dtype=dtypes.string, name="column_names"),
+        self._batch_size,
+        output_types=nest.flatten(self.output_types),
+        output_shapes=nest.flatten(self.output_shapes))
+
+  @property
+  def output_classes(self):
+    return nest.map_structure(lambda _: ops.Tensor, self._output_types)
+
+  @property
+  def output_shapes(self):
+    return self._output_shapes
+
+  @property
+  def output_types(self):
+    return self._output_types
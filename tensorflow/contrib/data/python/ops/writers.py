@@ -56,3 +56,50 @@ class TFRecordWriter(object):
                                                     dataset.output_types))
     return gen_dataset_ops.dataset_to_tf_record(
         dataset._as_variant_tensor(), self._filename, self._compression_type)  # pylint: disable=protected-access
+
+
+class ColumnarWriter(object):
+  """Writes data to a columnar file that `ColumnarDataset` can read."""
+
+  def __init__(self, filename, rows_per_group=1024):
+    """Creates a `ColumnarWriter`.
+
+    Args:
+      filename: A `tf.string` scalar representing the file to write.
+      rows_per_group: (Optional.) A `tf.int64` scalar representing the number
+        of rows that are stored together. Larger groups make reading faster
+        but take more memory while writing and reading.
+    """
+    self._filename = ops.convert_to_tensor(
+        filename, dtypes.string, name="filename")
+    self._rows_per_group = ops.convert_to_tensor(
+        rows_per_group, dtypes.int64, name="rows_per_group")
+
+  def write(self, dataset):
+    """Returns a `tf.Operation` to write a dataset to a file.
+
+    Args:
+      dataset: a `tf.data.Dataset` whose elements are `dict`s mapping column
+        names to tensors of fixed shape. Each element is written as a row.
+
+    Returns:
+      A `tf.Operation` that, when run, writes contents of `dataset` to a file.
+    """
+    if not isinstance(dataset, dataset_ops.Dataset):
+      raise TypeError("`dataset` must be a `tf.data.Dataset` object.")
+    if (not isinstance(dataset.output_types, dict) or
+        any(not isinstance(t, dtypes.DType)
+            for t in dataset.output_types.values())):
+      raise TypeError(
+          "`dataset` must produce a `dict` of tensors whereas it produces "
+          "types {0}".format(dataset.output_types))
+    for name, shape in dataset.output_shapes.items():
+      if not shape.is_fully_defined():
+        raise ValueError(
+            "Column {0} must have a fully defined shape whereas it has shape "
+            "{1}".format(name, shape))
+    column_names = ops.convert_to_tensor(
+        sorted(dataset.output_types), dtypes.string, name="column_names")
+    return gen_dataset_ops.dataset_to_columnar_file(
+        dataset._as_variant_tensor(), self._filename, column_names,  # pylint: disable=protected-access
+        self._rows_per_group)
@@ -0,0 +1,367 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/contrib/shm/shm_memory_manager.h"
+
+#include <atomic>
+#include <climits>
+#include <cstring>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif  // defined(__linux__)
+
+#include "tensorflow/contrib/shm/shm.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/random/random.h"
+#include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/host_info.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+namespace {
+
+constexpr uint64 kMagic = 0x3130316d68735f74ULL;  // "t_shm101"
+constexpr uint64 kAlignment = 64;
+// How long a receiver has to release a slot before the sender reclaims it.
+constexpr uint64 kSlotLeaseMicros = 60 * 1000 * 1000;
+// How long a sender waits for receivers to release slots when its ring buffer
+// is full, before falling back to sending the tensor in the RPC response.
+constexpr int kMaxFullWaits = 4;
+constexpr int64 kFullWaitMicros = 500;
+
+uint64 RoundUp(uint64 n) {
+  return (n + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+#if defined(__linux__)
+// Not FUTEX_PRIVATE_FLAG: the futex word is shared with other processes.
+void FutexWait(std::atomic<uint32>* word, uint32 value, int64 timeout_micros) {
+  struct timespec timeout;
+  timeout.tv_sec = timeout_micros / 1000000;
+  timeout.tv_nsec = (timeout_micros % 1000000) * 1000;
+  syscall(SYS_futex, reinterpret_cast<uint32*>(word), FUTEX_WAIT, value,
+          &timeout, nullptr, 0);
+}
+
+void FutexWakeAll(std::atomic<uint32>* word) {
+  syscall(SYS_futex, reinterpret_cast<uint32*>(word), FUTEX_WAKE, INT_MAX,
+          nullptr, nullptr, 0);
+}
+#endif  // defined(__linux__)
+
+}  // namespace
+
+// At the start of every segment, followed by the ring buffer.
+struct SharedMemoryManager::SegmentHeader {
+  uint64 magic;
+  uint64 capacity;
+  // Incremented by the receivers every time they release a slot. The sender
+  // waits on it when the ring buffer is full, and registers in `waiters` so
+  // that receivers only make a system call to wake it up when needed.
+  std::atomic<uint32> releases;
+  std::atomic<uint32> waiters;
+
+  char* slot(uint64 offset) {
+    return reinterpret_cast<char*>(this) + RoundUp(sizeof(SegmentHeader)) +
+           offset;
+  }
+};
+
+// At the start of every slot, followed by the tensor content.
+struct SharedMemoryManager::SlotHeader {
+  // Set by the sender when it allocates the slot, and reset to 0 when the slot
+  // is released by the receiver or reclaimed by the sender, whichever happens
+  // first.
+  std::atomic<uint64> sequence;
+};
+
+static_assert(sizeof(std::atomic<uint64>) == sizeof(uint64) &&
+                  sizeof(std::atomic<uint32>) == sizeof(uint32),
+              "Shared memory atomics must not need locks");
+
+SharedMemoryManager::SharedMemoryManager(int64 capacity)
+    : capacity_(RoundUp(capacity)) {}
+
+SharedMemoryManager::~SharedMemoryManager() {
+#if defined(__linux__)
+  {
+    mutex_lock l(peers_mu_);
+    for (const auto& peer : peers_) {
+      munmap(peer.second.header, peer.second.mapped_size);
+    }
+  }
+  if (header_ != nullptr) {
+    munmap(header_, mapped_size_);
+    shm_unlink(segment_.c_str());
+  }
+#endif  // defined(__linux__)
+}
+
+Status SharedMemoryManager::Init() {
+#if defined(__linux__)
+  // Processes can only share memory if they run on the same host and see the
+  // same /dev/shm, e.g. not from different containers.
+  string boot_id;
+  struct stat shm_stat;
+  if (!ReadFileToString(Env::Default(), "/proc/sys/kernel/random/boot_id",
+                        &boot_id)
+           .ok() ||
+      stat("/dev/shm", &shm_stat) != 0) {
+    LOG(WARNING) << "Shared memory is unavailable, tensors will be sent "
+                    "through RPCs only";
+    return Status::OK();
+  }
+  str_util::StripTrailingWhitespace(&boot_id);
+  host_id_ = strings::StrCat(port::Hostname(), "/", boot_id, "/",
+                             shm_stat.st_dev, ":", shm_stat.st_ino);
+
+  segment_ = strings::StrCat("/tensorflow_shm_", getpid(), "_",
+                             strings::Hex(random::New64()));
+  const int fd = shm_open(segment_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) {
+    return errors::Internal("Failed to create shared memory segment ",
+                            segment_, ": ", strerror(errno));
+  }
+  const size_t size = RoundUp(sizeof(SegmentHeader)) + capacity_;
+  void* addr = MAP_FAILED;
+  if (ftruncate(fd, size) == 0) {
+    addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  const int error = errno;
+  close(fd);
+  if (addr == MAP_FAILED) {
+    shm_unlink(segment_.c_str());
+    return errors::Internal("Failed to map shared memory segment ", segment_,
+                            ": ", strerror(error));
+  }
+  header_ = static_cast<SegmentHeader*>(addr);
+  mapped_size_ = size;
+  header_->capacity = capacity_;
+  header_->releases.store(0);
+  header_->waiters.store(0);
+  header_->magic = kMagic;
+  VLOG(1) << "Created shared memory segment " << segment_ << " of "
+          << capacity_ << " bytes";
+#else
+  LOG(WARNING) << "Shared memory transport is only supported on Linux";
+#endif  // defined(__linux__)
+  return Status::OK();
+}
+
+void SharedMemoryManager::PeerOptions(
+    ::google::protobuf::Any* mutable_peer_options) const {
+  if (!enabled()) {
+    return;
+  }
+  SharedMemoryPeer peer;
+  peer.set_host_id(host_id_);
+  mutable_peer_options->PackFrom(peer);
+}
+
+void SharedMemoryManager::ReclaimSlots() {
+  const uint64 now = Env::Default()->NowMicros();
+  while (!slots_.empty()) {
+    const Slot& slot = slots_.front();
+    auto* slot_header =
+        reinterpret_cast<SlotHeader*>(header_->slot(slot.offset));
+    uint64 sequence = slot.sequence;
+    if (slot_header->sequence.load(std::memory_order_acquire) != 0) {
+      if (now < slot.deadline_micros) {
+        break;
+      }
+      // The receiver may still release the slot concurrently: either way, it
+      // can't be read anymore once the sequence number is reset.
+      if (slot_header->sequence.compare_exchange_strong(sequence, 0)) {
+        LOG(WARNING) << "Reclaiming a shared memory slot that wasn't released";
+      }
+    }
+    slots_.pop_front();
+  }
+  if (slots_.empty()) {
+    head_ = 0;
+  }
+}
+
+bool SharedMemoryManager::AllocateSlot(uint64 length, Slot* slot) {
+  if (slots_.empty()) {
+    if (length > capacity_) {
+      return false;
+    }
+    slot->offset = 0;
+  } else {
+    const uint64 tail = slots_.front().offset;
+    if (head_ > tail && head_ + length <= capacity_) {
+      slot->offset = head_;
+    } else if (head_ > tail && length <= tail) {
+      // Wrap around, leaving the end of the ring buffer unused.
+      slot->offset = 0;
+    } else if (head_ < tail && head_ + length <= tail) {
+      slot->offset = head_;
+    } else {
+      return false;
+    }
+  }
+  slot->length = length;
+  slot->sequence = next_sequence_++;
+  slot->deadline_micros = Env::Default()->NowMicros() + kSlotLeaseMicros;
+  head_ = slot->offset + length;
+  slots_.push_back(*slot);
+  // The slot may overlap with the content of older ones: mark it as in use
+  // right away. Receivers only learn about it once the content is written.
+  reinterpret_cast<SlotHeader*>(header_->slot(slot->offset))
+      ->sequence.store(slot->sequence, std::memory_order_relaxed);
+  return true;
+}
+
+bool SharedMemoryManager::TransportOptionsFromTensor(
+    const ::google::protobuf::Any& peer_options,
+    ::google::protobuf::Any* mutable_transport_options, const Tensor& tensor) {
+#if defined(__linux__)
+  SharedMemoryPeer peer;
+  if (!enabled() || !peer_options.UnpackTo(&peer) ||
+      peer.host_id() != host_id_) {
+    return false;
+  }
+  const StringPiece content = tensor.tensor_data();
+  const uint64 length = RoundUp(sizeof(SlotHeader) + content.size());
+  Slot slot;
+  for (int i = 0;; ++i) {
+    const uint32 releases = header_->releases.load(std::memory_order_acquire);
+    {
+      mutex_lock l(mu_);
+      ReclaimSlots();
+      if (AllocateSlot(length, &slot)) {
+        break;
+      }
+    }
+    if (i == kMaxFullWaits) {
+      VLOG(1) << "Shared memory is full, sending " << content.size()
+              << " bytes through an RPC";
+      return false;
+    }
+    header_->waiters.fetch_add(1);
+    FutexWait(&header_->releases, releases, kFullWaitMicros);
+    header_->waiters.fetch_sub(1);
+  }
+
+  memcpy(header_->slot(slot.offset) + sizeof(SlotHeader), content.data(),
+         content.size());
+  std::atomic_thread_fence(std::memory_order_release);
+
+  SharedMemoryRegion region;
+  region.set_segment(segment_);
+  region.set_offset(slot.offset);
+  region.set_size(content.size());
+  region.set_sequence(slot.sequence);
+  mutable_transport_options->PackFrom(region);
+  return true;
+#else
+  return false;
+#endif  // defined(__linux__)
+}
+
+Status SharedMemoryManager::MapPeerSegment(const string& segment,
+                                           SegmentHeader** header) {
+#if defined(__linux__)
+  mutex_lock l(peers_mu_);
+  auto it = peers_.find(segment);
+  if (it != peers_.end()) {
+    *header = it->second.header;
+    return Status::OK();
+  }
+  const int fd = shm_open(segment.c_str(), O_RDWR, 0);
+  if (fd < 0) {
+    return errors::Internal("Failed to open shared memory segment ", segment,
+                            ": ", strerror(errno));
+  }
+  struct stat segment_stat;
+  void* addr = MAP_FAILED;
+  if (fstat(fd, &segment_stat) == 0 &&
+      static_cast<uint64>(segment_stat.st_size) >=
+          RoundUp(sizeof(SegmentHeader))) {
+    addr = mmap(nullptr, segment_stat.st_size, PROT_READ | PROT_WRITE,
+                MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (addr == MAP_FAILED) {
+    return errors::Internal("Failed to map shared memory segment ", segment);
+  }
+  auto* peer_header = static_cast<SegmentHeader*>(addr);
+  if (peer_header->magic != kMagic ||
+      RoundUp(sizeof(SegmentHeader)) + peer_header->capacity >
+          static_cast<uint64>(segment_stat.st_size)) {
+    munmap(addr, segment_stat.st_size);
+    return errors::Internal("Invalid shared memory segment ", segment);
+  }
+  peers_[segment] = {peer_header, static_cast<size_t>(segment_stat.st_size)};
+  *header = peer_header;
+  return Status::OK();
+#else
+  return errors::Unimplemented("Shared memory transport is only supported on "
+                               "Linux");
+#endif  // defined(__linux__)
+}
+
+Status SharedMemoryManager::TensorFromTransportOptions(
+    Tensor* tensor, const ::google::protobuf::Any& transport_options) {
+  SharedMemoryRegion region;
+  if (!transport_options.UnpackTo(&region)) {
+    return errors::NotFound("No shared memory region found");
+  }
+  const StringPiece buffer = tensor->tensor_data();
+  if (region.size() != buffer.size()) {
+    return errors::Internal("Shared memory region of ", region.size(),
+                            " bytes for a tensor of ", buffer.size(),
+                            " bytes");
+  }
+  SegmentHeader* header;
+  TF_RETURN_IF_ERROR(MapPeerSegment(region.segment(), &header));
+  if (region.offset() + sizeof(SlotHeader) + region.size() > header->capacity) {
+    return errors::Internal("Shared memory region out of bounds");
+  }
+
+  char* data = header->slot(region.offset());
+  auto* slot_header = reinterpret_cast<SlotHeader*>(data);
+  uint64 sequence = region.sequence();
+  if (slot_header->sequence.load(std::memory_order_acquire) != sequence) {
+    return errors::DataLoss("Shared memory slot was reclaimed by the sender");
+  }
+  memcpy(const_cast<char*>(buffer.data()), data + sizeof(SlotHeader),
+         region.size());
+  // The copy is only valid if the sender didn't reclaim the slot meanwhile.
+  if (!slot_header->sequence.compare_exchange_strong(sequence, 0)) {
+    return errors::DataLoss("Shared memory slot was reclaimed by the sender");
+  }
+#if defined(__linux__)
+  header->releases.fetch_add(1, std::memory_order_release);
+  if (header->waiters.load() > 0) {
+    FutexWakeAll(&header->releases);
+  }
+#endif  // defined(__linux__)
+  return Status::OK();
+}
+
+}  // namespace tensorflow
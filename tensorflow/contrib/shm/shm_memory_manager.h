@@ -0,0 +1,124 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CONTRIB_SHM_SHM_MEMORY_MANAGER_H_
+#define TENSORFLOW_CONTRIB_SHM_SHM_MEMORY_MANAGER_H_
+
+#include <deque>
+#include <unordered_map>
+
+#include "google/protobuf/any.pb.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+class Tensor;
+
+// Handles the out-of-band transport of tensors between processes on the same
+// host.
+//
+// Every process owns a ring buffer in a POSIX shared memory segment. To send a
+// tensor to a colocated receiver, the process copies its content into a slot of
+// the ring buffer and sends the location of the slot in the RPC response
+// instead of the content. The receiver maps the segment of the sender, copies
+// the content out of the slot and releases it. When the ring buffer is full,
+// the sender waits on a futex that receivers signal when they release slots,
+// and falls back to sending the content in the RPC response if none frees up.
+//
+// Slots that aren't released within a minute, e.g. because the receiver was
+// cancelled, are reclaimed by the sender. Receivers detect reclaimed slots
+// with the sequence number of the slot.
+class SharedMemoryManager {
+ public:
+  // `capacity` is the size of the ring buffer of this process in bytes.
+  explicit SharedMemoryManager(int64 capacity);
+  ~SharedMemoryManager();
+
+  // Creates the shared memory segment of this process. If shared memory isn't
+  // available, the manager stays disabled and all tensors go through RPCs.
+  Status Init();
+
+  // Whether Init() succeeded.
+  bool enabled() const { return header_ != nullptr; }
+
+  // Encodes the information needed by the sender to decide whether this
+  // process can read tensors from its segment, for a RecvTensorRequest.
+  void PeerOptions(::google::protobuf::Any* mutable_peer_options) const;
+
+  // Copies the content of `tensor` into the ring buffer if the receiver that
+  // sent `peer_options` is on the same host, and encodes its location into
+  // `mutable_transport_options`. Returns false if the content can't be sent
+  // through shared memory and must be sent in the RPC response instead.
+  bool TransportOptionsFromTensor(
+      const ::google::protobuf::Any& peer_options,
+      ::google::protobuf::Any* mutable_transport_options,
+      const Tensor& tensor);
+
+  // Copies the content of the slot described by `transport_options` into
+  // `tensor`, which has to be allocated in host memory but not initialized,
+  // and releases the slot.
+  Status TensorFromTransportOptions(
+      Tensor* tensor, const ::google::protobuf::Any& transport_options);
+
+ private:
+  struct SegmentHeader;
+  struct SlotHeader;
+
+  // A slot of the ring buffer that hasn't been reclaimed yet.
+  struct Slot {
+    uint64 offset;
+    uint64 length;
+    uint64 sequence;
+    uint64 deadline_micros;
+  };
+
+  // Frees the oldest slots that were released or whose lease expired.
+  void ReclaimSlots() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Reserves a slot of `length` bytes, or returns false if the ring buffer is
+  // full.
+  bool AllocateSlot(uint64 length, Slot* slot) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Maps the segment of a sender, or returns the existing mapping.
+  Status MapPeerSegment(const string& segment, SegmentHeader** header);
+
+  const uint64 capacity_;
+  string host_id_;
+  string segment_;
+  SegmentHeader* header_ = nullptr;
+  size_t mapped_size_ = 0;
+
+  mutex mu_;
+  std::deque<Slot> slots_ GUARDED_BY(mu_);
+  uint64 head_ GUARDED_BY(mu_) = 0;
+  uint64 next_sequence_ GUARDED_BY(mu_) = 1;
+
+  struct PeerSegment {
+    SegmentHeader* header;
+    size_t mapped_size;
+  };
+  mutex peers_mu_;
+  std::unordered_map<string, PeerSegment> peers_ GUARDED_BY(peers_mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(SharedMemoryManager);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CONTRIB_SHM_SHM_MEMORY_MANAGER_H_
@@ -0,0 +1,107 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/contrib/shm/shm_memory_manager.h"
+
+#include "tensorflow/contrib/shm/shm.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+Tensor MakeTensor(int64 num_elements) {
+  Tensor t(DT_FLOAT, TensorShape({num_elements}));
+  test::FillFn<float>(&t, [](int i) { return i * 0.5f; });
+  return t;
+}
+
+TEST(SharedMemoryManagerTest, RoundTrip) {
+  SharedMemoryManager sender(1 << 20);
+  SharedMemoryManager receiver(1 << 20);
+  TF_ASSERT_OK(sender.Init());
+  TF_ASSERT_OK(receiver.Init());
+  if (!sender.enabled()) {
+    LOG(INFO) << "Shared memory is unavailable, skipping test";
+    return;
+  }
+
+  ::google::protobuf::Any peer_options;
+  receiver.PeerOptions(&peer_options);
+  for (int i = 0; i < 100; ++i) {
+    // Larger than the ring buffer in total, so slots must be reused.
+    const Tensor sent = MakeTensor(10000 + i);
+    ::google::protobuf::Any transport_options;
+    ASSERT_TRUE(sender.TransportOptionsFromTensor(
+        peer_options, &transport_options, sent));
+    Tensor received(DT_FLOAT, sent.shape());
+    TF_ASSERT_OK(
+        receiver.TensorFromTransportOptions(&received, transport_options));
+    test::ExpectTensorEqual<float>(sent, received);
+
+    // Slots can only be read once.
+    EXPECT_TRUE(errors::IsDataLoss(
+        receiver.TensorFromTransportOptions(&received, transport_options)));
+  }
+}
+
+TEST(SharedMemoryManagerTest, FallsBackWhenFull) {
+  SharedMemoryManager sender(64 << 10);
+  SharedMemoryManager receiver(64 << 10);
+  TF_ASSERT_OK(sender.Init());
+  TF_ASSERT_OK(receiver.Init());
+  if (!sender.enabled()) {
+    LOG(INFO) << "Shared memory is unavailable, skipping test";
+    return;
+  }
+
+  ::google::protobuf::Any peer_options;
+  receiver.PeerOptions(&peer_options);
+  const Tensor t = MakeTensor(10 << 10);
+  ::google::protobuf::Any first, second;
+  ASSERT_TRUE(sender.TransportOptionsFromTensor(peer_options, &first, t));
+  // The first slot isn't released yet, and there's no room for another one.
+  EXPECT_FALSE(sender.TransportOptionsFromTensor(peer_options, &second, t));
+  // Larger than the whole ring buffer.
+  EXPECT_FALSE(sender.TransportOptionsFromTensor(peer_options, &second,
+                                                 MakeTensor(32 << 10)));
+
+  Tensor received(DT_FLOAT, t.shape());
+  TF_ASSERT_OK(receiver.TensorFromTransportOptions(&received, first));
+  EXPECT_TRUE(sender.TransportOptionsFromTensor(peer_options, &second, t));
+}
+
+TEST(SharedMemoryManagerTest, RequiresColocatedPeer) {
+  SharedMemoryManager sender(1 << 20);
+  TF_ASSERT_OK(sender.Init());
+
+  SharedMemoryPeer peer;
+  peer.set_host_id("another_host");
+  ::google::protobuf::Any peer_options;
+  peer_options.PackFrom(peer);
+  ::google::protobuf::Any transport_options;
+  EXPECT_FALSE(sender.TransportOptionsFromTensor(
+      peer_options, &transport_options, MakeTensor(1024)));
+
+  // Receivers that can't use shared memory don't send any peer options.
+  EXPECT_FALSE(sender.TransportOptionsFromTensor(
+      ::google::protobuf::Any(), &transport_options, MakeTensor(1024)));
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -0,0 +1,138 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/contrib/shm/shm_worker.h"
+
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/dma_helper.h"
+#include "tensorflow/core/distributed_runtime/rendezvous_mgr_interface.h"
+#include "tensorflow/core/distributed_runtime/rpc/grpc_tensor_coding.h"
+#include "tensorflow/core/distributed_runtime/worker.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/tracing.h"
+
+namespace tensorflow {
+
+namespace {
+
+// Smaller tensors are cheaper to send in the RPC response.
+constexpr int64 kMinSharedMemoryBytes = 1024;
+
+}  // namespace
+
+ShmWorker::ShmWorker(WorkerEnv* worker_env,
+                     SharedMemoryManager* shared_memory_manager)
+    : GrpcWorker(worker_env),
+      shared_memory_manager_(shared_memory_manager),
+      recv_tensor_recent_request_ids_(100000) {}
+
+void ShmWorker::EncodeHostTensor(const RecvTensorRequest& request,
+                                 bool is_dead, const Tensor& val,
+                                 ::grpc::ByteBuffer* response) {
+  if (!is_dead && val.TotalBytes() >= kMinSharedMemoryBytes &&
+      DMAHelper::CanUseDMA(&val)) {
+    RecvTensorResponse proto;
+    proto.set_send_start_micros(Env::Default()->NowMicros());
+    TensorProto* tensor_proto = proto.mutable_tensor();
+    tensor_proto->set_dtype(val.dtype());
+    val.shape().AsProto(tensor_proto->mutable_tensor_shape());
+    if (shared_memory_manager_->TransportOptionsFromTensor(
+            request.transport_options(), proto.mutable_transport_options(),
+            val)) {
+      grpc::EncodeRecvTensorResponseToByteBuffer(proto, response);
+      return;
+    }
+  }
+  grpc::EncodeTensorToByteBuffer(is_dead, val, response);
+}
+
+void ShmWorker::GrpcRecvTensorAsync(CallOptions* opts,
+                                    const RecvTensorRequest* request,
+                                    ::grpc::ByteBuffer* response,
+                                    StatusCallback done) {
+  if (!request->has_transport_options() || !shared_memory_manager_->enabled()) {
+    // The receiver can't read from shared memory.
+    GrpcWorker::GrpcRecvTensorAsync(opts, request, response, std::move(done));
+    return;
+  }
+  Status s = recv_tensor_recent_request_ids_.TrackUnique(
+      request->request_id(), "RecvTensor (ShmWorker)", *request);
+  if (!s.ok()) {
+    done(s);
+    return;
+  }
+
+  const int64 step_id = request->step_id();
+  const string& key = request->rendezvous_key();
+  TRACEPRINTF("RecvTensor: %lld %s", step_id, key.c_str());
+  Rendezvous::ParsedKey parsed;
+  s = Rendezvous::ParseKey(key, &parsed);
+  Device* src_dev = nullptr;
+  if (s.ok()) {
+    s = PrepareRecvTensor(parsed, &src_dev);
+  }
+  if (!s.ok()) {
+    done(s);
+    return;
+  }
+
+  // Request the tensor associated with the rendezvous key. Any time
+  // while waiting for the tensor to be produced, up until the start
+  // of execution of the callback lambda body below, an RPC
+  // cancellation should abort the rendezvous.
+  opts->SetCancelCallback([this, step_id]() { AbortStep(step_id); });
+  env_->rendezvous_mgr->RecvLocalAsync(
+      step_id, parsed,
+      [this, opts, response, done, src_dev, request](
+          const Status& status, const Rendezvous::Args& send_args,
+          const Rendezvous::Args&, const Tensor& val, const bool is_dead) {
+        opts->ClearCancelCallback();
+        if (!status.ok()) {
+          done(status);
+          return;
+        }
+        const bool on_host = send_args.alloc_attrs.on_host();
+        if (src_dev->tensorflow_gpu_device_info() && (!on_host)) {
+          DeviceContext* send_dev_context = send_args.device_context;
+          AllocatorAttributes alloc_attrs;
+          alloc_attrs.set_gpu_compatible(true);
+          alloc_attrs.set_on_host(true);
+          Allocator* alloc = src_dev->GetAllocator(alloc_attrs);
+          Tensor* copy = new Tensor(alloc, val.dtype(), val.shape());
+          CHECK(send_dev_context)
+              << "send dev name: " << src_dev->name()
+              << " gpu_info: " << src_dev->tensorflow_gpu_device_info();
+          // "val" is on an accelerator device. Uses the device_context to
+          // fill the copy on host, which is then sent like any host tensor.
+          StatusCallback copy_ready = [this, request, response, done, copy,
+                                       is_dead](const Status& s) {
+            if (s.ok()) {
+              EncodeHostTensor(*request, is_dead, *copy, response);
+            }
+            done(s);
+            delete copy;
+          };
+          send_dev_context->CopyDeviceTensorToCPU(
+              &val, request->rendezvous_key(), src_dev, copy, copy_ready);
+        } else {
+          EncodeHostTensor(*request, is_dead, val, response);
+          done(Status::OK());
+        }
+      });
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,91 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_BASE_REDUCER_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_BASE_REDUCER_H_
+
+#include <memory>
+
+#include "tensorflow/core/common_runtime/base_collective_executor.h"
+#include "tensorflow/core/framework/collective.h"
+#include "tensorflow/core/framework/op_kernel.h"
+
+namespace tensorflow {
+
+// Base class of the implementations of collective all-reduce.  It holds
+// the state that they all need, and implements the steps they have in
+// common.
+class BaseReducer : public CollectiveImplementationInterface {
+ public:
+  ~BaseReducer() override;
+
+  // Initializes members of CollectiveContext not yet initialized, i.e. device
+  // and device_locality.  Also saves the CollectiveContext in this object.
+  Status InitializeCollectiveContext(CollectiveContext* col_ctx) override;
+
+ protected:
+  BaseReducer();
+
+  // Called when a bad status is received that implies we should terminate
+  // execution and return a bad status.
+  void StartAbort(const Status& s);
+  // Returns the status given to the first StartAbort, if any.
+  Status status();
+
+  // Copies the input to the output if they're not already the same, i.e. if
+  // we're not computing in-place on the input tensor.  Blocks until done.
+  Status CopyInputToOutput();
+
+  // Sets group_size_tensor_ to an on-device scalar holding the group size,
+  // if the final_op needs it.  Blocks until done.  REQUIRES: ca_ is set.
+  Status PrepareGroupSizeTensor();
+
+  // Waits for all currently queued events on the compute stream of a GPU
+  // device to complete.  Newly allocated temp memory buffers are not
+  // guaranteed to be valid (e.g. for RDMA write) unless we do.
+  Status WaitForAllocations();
+
+  // Runs the binary op `op` in-place on `output`, with `input` as the second
+  // operand.
+  Status ComputeBinOp(OpKernel* op, Tensor* output, Tensor* input);
+
+  CollectiveContext* col_ctx_;          // Not owned
+  const CollectiveParams* col_params_;  // Not owned
+  Tensor group_size_tensor_;
+  std::unique_ptr<CollectiveAdapter> ca_;
+
+ private:
+  // Used for executing a sub-operation, e.g. a merge_op instance, with
+  // an OpKernelContext based on the one passed into this Op.
+  class SubContext {
+   public:
+    OpKernelContext::Params sub_params_;
+    gtl::InlinedVector<TensorValue, 4> sub_inputs_;
+    gtl::InlinedVector<AllocatorAttributes, 4> sub_input_attr_;
+    gtl::InlinedVector<DeviceContext*, 4> sub_input_dc_;
+    // Used only for Binary and Unary Ops for which we require
+    // the calculation to be in-place on the first input.
+    int forward_from_ = 0;
+    OpKernelContext* sub_ctx_;
+    SubContext(OpKernelContext* ctx, OpKernelContext::Params* params,
+               OpKernel* op, Tensor* output, Tensor* input);
+    ~SubContext() { delete sub_ctx_; }
+  };
+
+  mutex status_mu_;
+  Status status_ GUARDED_BY(status_mu_);
+};
+
+}  // namespace tensorflow
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_BASE_REDUCER_H_
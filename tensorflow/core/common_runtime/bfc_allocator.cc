@@ -23,16 +23,33 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/numbers.h"
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/types.h"
 
 namespace tensorflow {
 
+namespace {
+
+// Assigns each thread a stable index into the per-thread caches of every
+// BFCAllocator.
+std::atomic<int> next_thread_cache_index(0);
+thread_local int thread_cache_index = -1;
+
+}  // namespace
+
 BFCAllocator::BFCAllocator(SubAllocator* sub_allocator, size_t total_memory,
                            bool allow_growth, const string& name)
+    : BFCAllocator(sub_allocator, total_memory, allow_growth, name,
+                   ThreadCacheOptions()) {}
+
+BFCAllocator::BFCAllocator(SubAllocator* sub_allocator, size_t total_memory,
+                           bool allow_growth, const string& name,
+                           const ThreadCacheOptions& cache_options)
     : suballocator_(sub_allocator),
       name_(name),
+      cache_options_(cache_options),
       free_chunks_list_(kInvalidChunkHandle),
       next_allocation_id_(1) {
   if (allow_growth) {
@@ -65,6 +82,17 @@ BFCAllocator::BFCAllocator(SubAllocator* sub_allocator, size_t total_memory,
       CHECK_NE(BinForSize(bin_size * 2), BinFromIndex(b));
     }
   }
+
+  if (cache_options_.max_cached_bytes > 0) {
+    CHECK_GT(cache_options_.magazine_size, 1);
+    // Inter-op and intra-op threads together are about twice the number of
+    // cores.
+    num_thread_caches_ = std::max(1, 2 * port::NumSchedulableCPUs());
+    thread_caches_.reset(new ThreadCache[num_thread_caches_]);
+    VLOG(1) << "Enabling " << num_thread_caches_
+            << " thread caches for allocations up to "
+            << strings::HumanReadableNumBytes(cache_options_.max_cached_bytes);
+  }
 }
 
 BFCAllocator::~BFCAllocator() {
@@ -180,6 +208,7 @@ BFCAllocator::ChunkHandle BFCAllocator::AllocateChunk() {
 
 void BFCAllocator::DeallocateChunk(ChunkHandle h) {
   Chunk* c = ChunkFromHandle(h);
+  c->cache_size_class = kInvalidBinNum;
   c->next = free_chunks_list_;
   free_chunks_list_ = h;
 }
@@ -247,34 +276,207 @@ void* BFCAllocator::AllocateRawInternal(size_t unused_alignment,
   // so all memory addresses are nicely byte aligned.
   size_t rounded_bytes = RoundedBytes(num_bytes);
 
+  // Small allocations are served from the calling thread's cache if
+  // possible, and otherwise rounded up to their size class so that the
+  // chunk can be cached when it is freed.
+  BinNum size_class = kInvalidBinNum;
+  if (thread_caches_ != nullptr) {
+    size_class = CacheSizeClass(rounded_bytes);
+    if (size_class != kInvalidBinNum) {
+      void* ptr = AllocateFromThreadCache(num_bytes, size_class);
+      if (ptr != nullptr) {
+        return ptr;
+      }
+      num_cache_misses_.fetch_add(1, std::memory_order_relaxed);
+      rounded_bytes = BinNumToSize(size_class);
+    }
+  }
+
   // The BFC allocator tries to find the best fit first.
   BinNum bin_num = BinNumForSize(rounded_bytes);
 
-  mutex_lock l(lock_);
-  void* ptr = FindChunkPtr(bin_num, rounded_bytes, num_bytes);
-  if (ptr != nullptr) {
-    return ptr;
-  }
-
-  // Try to extend
-  if (Extend(unused_alignment, rounded_bytes)) {
+  std::vector<CachedChunk> refill;
+  void* ptr = nullptr;
+  {
+    mutex_lock l(lock_);
     ptr = FindChunkPtr(bin_num, rounded_bytes, num_bytes);
+
+    // Try to extend
+    if (ptr == nullptr && Extend(unused_alignment, rounded_bytes)) {
+      ptr = FindChunkPtr(bin_num, rounded_bytes, num_bytes);
+    }
+
+    // Memory parked in the thread caches is still free memory: return it
+    // to the bins before giving up.
+    if (ptr == nullptr && thread_caches_ != nullptr) {
+      FlushThreadCachesLocked();
+      ptr = FindChunkPtr(bin_num, rounded_bytes, num_bytes);
+    }
+
     if (ptr != nullptr) {
-      return ptr;
+      if (size_class != kInvalidBinNum) {
+        ChunkFromHandle(region_manager_.get_handle(ptr))->cache_size_class =
+            size_class;
+        RefillLocked(size_class, &refill);
+      }
+    } else {
+      // We searched all bins for an existing free chunk to use and
+      // couldn't find one.  This means we must have run out of memory,
+      // Dump the memory log for analysis.
+      if (dump_log_on_failure) {
+        LOG(WARNING) << "Allocator (" << Name() << ") ran out of memory trying "
+                     << "to allocate "
+                     << strings::HumanReadableNumBytes(num_bytes)
+                     << ".  Current allocation summary follows.";
+        DumpMemoryLog(rounded_bytes);
+        LOG(WARNING) << RenderOccupancy();
+      }
+      return nullptr;
     }
   }
 
-  // We searched all bins for an existing free chunk to use and
-  // couldn't find one.  This means we must have run out of memory,
-  // Dump the memory log for analysis.
-  if (dump_log_on_failure) {
-    LOG(WARNING) << "Allocator (" << Name() << ") ran out of memory trying "
-                 << "to allocate " << strings::HumanReadableNumBytes(num_bytes)
-                 << ".  Current allocation summary follows.";
-    DumpMemoryLog(rounded_bytes);
-    LOG(WARNING) << RenderOccupancy();
+  if (!refill.empty()) {
+    ThreadCache* cache = CurrentThreadCache();
+    mutex_lock l(cache->mu);
+    std::vector<CachedChunk>& magazine = cache->magazines[size_class];
+    for (const CachedChunk& chunk : refill) {
+      magazine.push_back(chunk);
+      cache->bytes_cached += chunk.size;
+    }
+  }
+  return ptr;
+}
+
+BFCAllocator::BinNum BFCAllocator::CacheSizeClass(size_t rounded_bytes) {
+  BinNum size_class = BinNumForSize(rounded_bytes);
+  if (BinNumToSize(size_class) < rounded_bytes) {
+    ++size_class;
+  }
+  if (size_class >= kNumBins ||
+      BinNumToSize(size_class) > cache_options_.max_cached_bytes) {
+    return kInvalidBinNum;
+  }
+  return size_class;
+}
+
+BFCAllocator::ThreadCache* BFCAllocator::CurrentThreadCache() {
+  if (thread_cache_index < 0) {
+    thread_cache_index = next_thread_cache_index.fetch_add(1);
+  }
+  return &thread_caches_[thread_cache_index % num_thread_caches_];
+}
+
+void* BFCAllocator::AllocateFromThreadCache(size_t num_bytes,
+                                            BinNum size_class) {
+  void* ptr = nullptr;
+  {
+    ThreadCache* cache = CurrentThreadCache();
+    mutex_lock l(cache->mu);
+    std::vector<CachedChunk>& magazine = cache->magazines[size_class];
+    if (magazine.empty()) {
+      return nullptr;
+    }
+    ptr = magazine.back().ptr;
+    cache->bytes_cached -= magazine.back().size;
+    magazine.pop_back();
+  }
+  {
+    // Only this thread owns the chunk, so updating it under a shared lock
+    // is safe; the shared lock only keeps chunks_ from being resized.
+    tf_shared_lock l(lock_);
+    Chunk* chunk = ChunkFromHandle(region_manager_.get_handle(ptr));
+    DCHECK_EQ(chunk->cache_size_class, size_class);
+    chunk->requested_size = num_bytes;
+    chunk->allocation_id = next_allocation_id_.fetch_add(1);
+  }
+  num_cache_hits_.fetch_add(1, std::memory_order_relaxed);
+  return ptr;
+}
+
+bool BFCAllocator::DeallocateToThreadCache(void* ptr) {
+  CachedChunk cached;
+  BinNum size_class;
+  {
+    tf_shared_lock l(lock_);
+    BFCAllocator::ChunkHandle h = region_manager_.get_handle(ptr);
+    CHECK(h != kInvalidChunkHandle);
+    const Chunk* chunk = ChunkFromHandle(h);
+    size_class = chunk->cache_size_class;
+    if (size_class == kInvalidBinNum) {
+      return false;
+    }
+    cached = {ptr, chunk->size};
+  }
+
+  std::vector<CachedChunk> overflow;
+  {
+    ThreadCache* cache = CurrentThreadCache();
+    mutex_lock l(cache->mu);
+    std::vector<CachedChunk>& magazine = cache->magazines[size_class];
+    magazine.push_back(cached);
+    cache->bytes_cached += cached.size;
+    if (magazine.size() > static_cast<size_t>(cache_options_.magazine_size)) {
+      // Return the oldest half, which is the least likely to be warm.
+      const size_t n = magazine.size() / 2;
+      overflow.assign(magazine.begin(), magazine.begin() + n);
+      magazine.erase(magazine.begin(), magazine.begin() + n);
+      for (const CachedChunk& chunk : overflow) {
+        cache->bytes_cached -= chunk.size;
+      }
+    }
+  }
+  if (!overflow.empty()) {
+    {
+      mutex_lock l(lock_);
+      ReturnCachedChunksLocked(overflow);
+    }
+    retry_helper_.NotifyDealloc();
+  }
+  return true;
+}
+
+void BFCAllocator::RefillLocked(BinNum size_class,
+                                std::vector<CachedChunk>* chunks) {
+  const size_t class_bytes = BinNumToSize(size_class);
+  const BinNum bin_num = BinNumForSize(class_bytes);
+  for (int i = 0; i < cache_options_.magazine_size / 2; ++i) {
+    void* ptr = FindChunkPtr(bin_num, class_bytes, class_bytes);
+    if (ptr == nullptr) break;
+    Chunk* chunk = ChunkFromHandle(region_manager_.get_handle(ptr));
+    chunk->cache_size_class = size_class;
+    // FindChunkPtr counted this as a client allocation; it is counted as a
+    // cache hit when it is handed out instead.
+    --stats_.num_allocs;
+    chunks->push_back({ptr, chunk->size});
+  }
+}
+
+void BFCAllocator::ReturnCachedChunksLocked(
+    const std::vector<CachedChunk>& chunks) {
+  for (const CachedChunk& cached : chunks) {
+    BFCAllocator::ChunkHandle h = region_manager_.get_handle(cached.ptr);
+    CHECK(h != kInvalidChunkHandle);
+    ChunkFromHandle(h)->cache_size_class = kInvalidBinNum;
+    FreeAndMaybeCoalesce(h);
+  }
+}
+
+void BFCAllocator::FlushThreadCachesLocked() {
+  std::vector<CachedChunk> chunks;
+  for (int i = 0; i < num_thread_caches_; ++i) {
+    ThreadCache* cache = &thread_caches_[i];
+    mutex_lock l(cache->mu);
+    for (BinNum b = 0; b < kNumBins; ++b) {
+      chunks.insert(chunks.end(), cache->magazines[b].begin(),
+                    cache->magazines[b].end());
+      cache->magazines[b].clear();
+    }
+    cache->bytes_cached = 0;
+  }
+  if (!chunks.empty()) {
+    VLOG(1) << "Flushing " << chunks.size() << " chunks from thread caches";
+    ReturnCachedChunksLocked(chunks);
   }
-  return nullptr;
 }
 
 void* BFCAllocator::FindChunkPtr(BinNum bin_num, size_t rounded_bytes,
@@ -310,7 +512,7 @@ void* BFCAllocator::FindChunkPtr(BinNum bin_num, size_t rounded_bytes,
         chunk->requested_size = num_bytes;
         // Assign a unique id and increment the id counter, marking the
         // chunk as being in use.
-        chunk->allocation_id = next_allocation_id_++;
+        chunk->allocation_id = next_allocation_id_.fetch_add(1);
 
         // Update stats.
         ++stats_.num_allocs;
@@ -368,6 +570,13 @@ void BFCAllocator::SplitChunk(BFCAllocator::ChunkHandle h, size_t num_bytes) {
 }
 
 void BFCAllocator::DeallocateRaw(void* ptr) {
+  // Deallocations into a thread cache do not free any memory, so they do
+  // not wake up allocations waiting for memory.  Those waiters flush the
+  // caches themselves before they give up.
+  if (ptr != nullptr && thread_caches_ != nullptr &&
+      DeallocateToThreadCache(ptr)) {
+    return;
+  }
   DeallocateRawInternal(ptr);
   retry_helper_.NotifyDealloc();
 }
@@ -663,10 +872,27 @@ void BFCAllocator::DumpMemoryLog(size_t num_bytes) {
 void BFCAllocator::GetStats(AllocatorStats* stats) {
   mutex_lock l(lock_);
   *stats = stats_;
+  if (thread_caches_ != nullptr) {
+    // Chunks in the thread caches are in use from the point of view of the
+    // bins, but are free from the point of view of clients.
+    int64 bytes_in_caches = 0;
+    for (int i = 0; i < num_thread_caches_; ++i) {
+      mutex_lock cache_lock(thread_caches_[i].mu);
+      bytes_in_caches += thread_caches_[i].bytes_cached;
+    }
+    stats->num_cache_hits = num_cache_hits_.load(std::memory_order_relaxed);
+    stats->num_cache_misses =
+        num_cache_misses_.load(std::memory_order_relaxed);
+    stats->bytes_in_caches = bytes_in_caches;
+    stats->num_allocs += stats->num_cache_hits;
+    stats->bytes_in_use -= bytes_in_caches;
+  }
 }
 
 void BFCAllocator::ClearStats() {
   mutex_lock l(lock_);
+  num_cache_hits_ = 0;
+  num_cache_misses_ = 0;
   stats_.num_allocs = 0;
   stats_.max_bytes_in_use = stats_.bytes_in_use;
   stats_.max_alloc_size = 0;
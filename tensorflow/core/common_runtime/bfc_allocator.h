@@ -17,6 +17,7 @@ limitations under the License.
 #define TENSORFLOW_CORE_COMMON_RUNTIME_BFC_ALLOCATOR_H_
 
 #include <array>
+#include <atomic>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -42,11 +43,32 @@ namespace tensorflow {
 // coalescing.  One assumption we make is that the process using this
 // allocator owns pretty much all of the memory, and that nearly
 // all requests to allocate memory go through this interface.
+//
+// Optionally, small allocations can be served from per-thread caches
+// ("magazines") of free chunks, one per size class, in front of the bins.
+// Cached chunks stay in use from the point of view of the bins, so a hit
+// never touches the central free lists; magazines are refilled from and
+// returned to the central free lists in batches.
 class BFCAllocator : public VisitableAllocator {
  public:
+  struct ThreadCacheOptions {
+    // Allocations of at most this many bytes are served from per-thread
+    // caches, after rounding up to a power of two. 0 disables the caches.
+    size_t max_cached_bytes = 0;
+
+    // The maximum number of chunks a thread caches for one size class.
+    // When a magazine overflows, half of it is returned to the central
+    // free lists under a single lock acquisition; a miss refills half a
+    // magazine the same way.
+    int magazine_size = 32;
+  };
+
   // Takes ownership of sub_allocator.
   BFCAllocator(SubAllocator* sub_allocator, size_t total_memory,
                bool allow_growth, const string& name);
+  BFCAllocator(SubAllocator* sub_allocator, size_t total_memory,
+               bool allow_growth, const string& name,
+               const ThreadCacheOptions& cache_options);
   ~BFCAllocator() override;
 
   string Name() override { return name_; }
@@ -131,6 +153,11 @@ class BFCAllocator : public VisitableAllocator {
     // What bin are we in?
     BinNum bin_num = kInvalidBinNum;
 
+    // If not kInvalidBinNum, the chunk was handed out through the
+    // per-thread caches and returns to the cache for this size class
+    // when deallocated.
+    BinNum cache_size_class = kInvalidBinNum;
+
     bool in_use() const { return allocation_id != -1; }
 
     string DebugString(BFCAllocator* a,
@@ -355,7 +382,54 @@ class BFCAllocator : public VisitableAllocator {
   ChunkHandle AllocateChunk() EXCLUSIVE_LOCKS_REQUIRED(lock_);
   void DeallocateChunk(ChunkHandle h) EXCLUSIVE_LOCKS_REQUIRED(lock_);
 
-  Chunk* ChunkFromHandle(ChunkHandle h) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  Chunk* ChunkFromHandle(ChunkHandle h) SHARED_LOCKS_REQUIRED(lock_);
+
+  // A free chunk held in a per-thread cache.
+  struct CachedChunk {
+    void* ptr;
+    size_t size;
+  };
+
+  // A per-thread cache of free chunks, one magazine per size class. Threads
+  // are mapped to caches by a per-thread index, so with at least as many
+  // caches as allocating threads the lock below is uncontended.
+  //
+  // Lock ordering: lock_ < ThreadCache::mu.
+  struct ThreadCache {
+    mutex mu;
+    std::vector<CachedChunk> magazines[kNumBins] GUARDED_BY(mu);
+    int64 bytes_cached GUARDED_BY(mu) = 0;
+    // Keeps the locks of neighbouring caches on different cache lines.
+    char padding[64];
+  };
+
+  // Returns the cache size class for an allocation of 'rounded_bytes', or
+  // kInvalidBinNum if it is too large to be cached.
+  BinNum CacheSizeClass(size_t rounded_bytes);
+
+  ThreadCache* CurrentThreadCache();
+
+  // Pops a chunk of class 'size_class' from the calling thread's cache.
+  // Returns nullptr on a miss.
+  void* AllocateFromThreadCache(size_t num_bytes, BinNum size_class)
+      LOCKS_EXCLUDED(lock_);
+
+  // Pushes 'ptr' into the calling thread's cache if it was allocated
+  // through the caches. Returns false if 'ptr' must be freed centrally.
+  bool DeallocateToThreadCache(void* ptr) LOCKS_EXCLUDED(lock_);
+
+  // Takes up to half a magazine of free chunks of class 'size_class' from
+  // the bins, without extending the allocator.
+  void RefillLocked(BinNum size_class, std::vector<CachedChunk>* chunks)
+      EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Returns cached chunks to the bins, coalescing them.
+  void ReturnCachedChunksLocked(const std::vector<CachedChunk>& chunks)
+      EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Empties every thread cache into the bins. Used before reporting an
+  // out-of-memory condition.
+  void FlushThreadCachesLocked() EXCLUSIVE_LOCKS_REQUIRED(lock_);
 
   // Information about a Bin that is useful for debugging.
   struct BinDebugInfo {
@@ -426,6 +500,13 @@ class BFCAllocator : public VisitableAllocator {
   std::unique_ptr<SubAllocator> suballocator_;
   string name_;
 
+  // Per-thread caches. Empty if cache_options_.max_cached_bytes is 0.
+  const ThreadCacheOptions cache_options_;
+  int num_thread_caches_ = 0;
+  std::unique_ptr<ThreadCache[]> thread_caches_;
+  std::atomic<int64> num_cache_hits_{0};
+  std::atomic<int64> num_cache_misses_{0};
+
   // Structures mutable after construction
   mutable mutex lock_;
   RegionManager region_manager_ GUARDED_BY(lock_);
@@ -439,8 +520,9 @@ class BFCAllocator : public VisitableAllocator {
   std::vector<Visitor> region_visitors_ GUARDED_BY(lock_);
 
   // Counter containing the next unique identifier to assign to a
-  // newly-created chunk.
-  int64 next_allocation_id_ GUARDED_BY(lock_);
+  // newly-created chunk. Atomic because cache hits assign ids while
+  // holding lock_ in shared mode only.
+  std::atomic<int64> next_allocation_id_;
 
   // Stats.
   AllocatorStats stats_ GUARDED_BY(lock_);
@@ -0,0 +1,198 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/bfc_allocator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/pool_allocator.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+BFCAllocator* NewCachingAllocator(size_t max_cached_bytes,
+                                  size_t total_memory = 1 << 30) {
+  BFCAllocator::ThreadCacheOptions options;
+  options.max_cached_bytes = max_cached_bytes;
+  options.magazine_size = 8;
+  return new BFCAllocator(new BasicCPUAllocator(-1), total_memory,
+                          true /*allow_growth*/, "cpu_bfc", options);
+}
+
+TEST(BFCAllocatorTest, ThreadCacheReusesChunks) {
+  std::unique_ptr<BFCAllocator> a(NewCachingAllocator(64 << 10));
+  void* p1 = a->AllocateRaw(1, 1000);
+  ASSERT_NE(p1, nullptr);
+  EXPECT_EQ(1000, a->RequestedSize(p1));
+  // Cacheable allocations are rounded up to a power of two.
+  EXPECT_EQ(1024, a->AllocatedSize(p1));
+  const int64 id1 = a->AllocationId(p1);
+  a->DeallocateRaw(p1);
+
+  AllocatorStats stats;
+  a->GetStats(&stats);
+  EXPECT_EQ(0, stats.bytes_in_use);
+  EXPECT_GE(stats.bytes_in_caches, 1024);
+
+  // The most recently freed chunk of the same class comes back first.
+  void* p2 = a->AllocateRaw(1, 900);
+  EXPECT_EQ(p1, p2);
+  EXPECT_EQ(900, a->RequestedSize(p2));
+  EXPECT_NE(id1, a->AllocationId(p2));
+  a->GetStats(&stats);
+  EXPECT_EQ(1024, stats.bytes_in_use);
+  EXPECT_GE(stats.num_cache_hits, 1);
+  EXPECT_EQ(2, stats.num_allocs);
+  a->DeallocateRaw(p2);
+}
+
+TEST(BFCAllocatorTest, LargeAllocationsBypassCache) {
+  std::unique_ptr<BFCAllocator> a(NewCachingAllocator(4 << 10));
+  void* p = a->AllocateRaw(1, 1 << 20);
+  ASSERT_NE(p, nullptr);
+  EXPECT_EQ(1 << 20, a->AllocatedSize(p));
+  a->DeallocateRaw(p);
+  AllocatorStats stats;
+  a->GetStats(&stats);
+  EXPECT_EQ(0, stats.bytes_in_use);
+  EXPECT_EQ(0, stats.bytes_in_caches);
+  EXPECT_EQ(0, stats.num_cache_hits);
+  EXPECT_EQ(0, stats.num_cache_misses);
+}
+
+TEST(BFCAllocatorTest, OverflowReturnsChunksToBins) {
+  std::unique_ptr<BFCAllocator> a(NewCachingAllocator(64 << 10));
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 100; ++i) {
+    ptrs.push_back(a->AllocateRaw(1, 256));
+  }
+  for (void* p : ptrs) {
+    a->DeallocateRaw(p);
+  }
+  AllocatorStats stats;
+  a->GetStats(&stats);
+  EXPECT_EQ(0, stats.bytes_in_use);
+  // A magazine never holds more than magazine_size chunks.
+  EXPECT_LE(stats.bytes_in_caches, 8 * 256);
+}
+
+TEST(BFCAllocatorTest, CachedMemoryIsReclaimedWhenOutOfMemory) {
+  // 1MiB total, entirely parked in the thread caches after the frees.
+  std::unique_ptr<BFCAllocator> a(NewCachingAllocator(64 << 10, 1 << 20));
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 8; ++i) {
+    void* p = a->AllocateRaw(1, 64 << 10);
+    ASSERT_NE(p, nullptr);
+    ptrs.push_back(p);
+  }
+  for (void* p : ptrs) {
+    a->DeallocateRaw(p);
+  }
+  AllocationAttributes attr;
+  attr.no_retry_on_failure = true;
+  void* big = a->AllocateRaw(1, 900 << 10, attr);
+  EXPECT_NE(big, nullptr);
+  a->DeallocateRaw(big);
+}
+
+TEST(BFCAllocatorTest, ConcurrentAllocations) {
+  std::unique_ptr<BFCAllocator> a(NewCachingAllocator(64 << 10));
+  {
+    thread::ThreadPool pool(Env::Default(), "test", 8);
+    for (int t = 0; t < 8; ++t) {
+      pool.Schedule([&a, t]() {
+        random::PhiloxRandom philox(123, t);
+        random::SimplePhilox rand(&philox);
+        std::vector<void*> live;
+        for (int i = 0; i < 10000; ++i) {
+          if (!live.empty() && rand.Uniform(2) == 0) {
+            const int idx = rand.Uniform(live.size());
+            a->DeallocateRaw(live[idx]);
+            live[idx] = live.back();
+            live.pop_back();
+          } else {
+            const size_t bytes = 1 + rand.Uniform(128 << 10);
+            void* p = a->AllocateRaw(1, bytes);
+            CHECK(p != nullptr);
+            CHECK_GE(a->AllocatedSize(p), bytes);
+            live.push_back(p);
+          }
+        }
+        for (void* p : live) {
+          a->DeallocateRaw(p);
+        }
+      });
+    }
+  }
+  AllocatorStats stats;
+  a->GetStats(&stats);
+  EXPECT_EQ(0, stats.bytes_in_use);
+  EXPECT_GT(stats.num_cache_hits, 0);
+}
+
+static void BM_AllocationThreaded(int iters, int num_threads,
+                                  size_t max_cached_bytes) {
+  std::unique_ptr<BFCAllocator> a(NewCachingAllocator(max_cached_bytes));
+  thread::ThreadPool pool(Env::Default(), "test", num_threads);
+  std::atomic_int_fast32_t count(iters);
+  mutex done_lock;
+  condition_variable done;
+  bool done_flag = false;
+
+  for (int t = 0; t < num_threads; t++) {
+    pool.Schedule([&a, &count, &done_lock, &done, &done_flag]() {
+      void* p[16];
+      while (count.fetch_sub(1) > 0) {
+        for (int i = 0; i < 16; ++i) {
+          p[i] = a->AllocateRaw(1, 64 << (i % 8));
+        }
+        for (int i = 0; i < 16; ++i) {
+          a->DeallocateRaw(p[i]);
+        }
+      }
+      mutex_lock l(done_lock);
+      if (!done_flag) {
+        done.notify_all();
+        done_flag = true;
+      }
+    });
+  }
+  mutex_lock l(done_lock);
+  if (!done_flag) {
+    done.wait(l);
+  }
+}
+
+static void BM_AllocationThreadedUncached(int iters, int num_threads) {
+  BM_AllocationThreaded(iters, num_threads, 0);
+}
+BENCHMARK(BM_AllocationThreadedUncached)->Arg(1)->Arg(4)->Arg(16);
+
+static void BM_AllocationThreadedCached(int iters, int num_threads) {
+  BM_AllocationThreaded(iters, num_threads, 64 << 10);
+}
+BENCHMARK(BM_AllocationThreadedCached)->Arg(1)->Arg(4)->Arg(16);
+
+}  // namespace
+}  // namespace tensorflow
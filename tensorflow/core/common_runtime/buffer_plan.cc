@@ -0,0 +1,319 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/buffer_plan.h"
+
+#include <algorithm>
+
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/graph/algorithm.h"
+#include "tensorflow/core/lib/core/errors.h"
+
+namespace tensorflow {
+
+namespace {
+
+// Larger graphs are not planned, to bound the size of the reachability
+// matrix (kMaxPlannedNodes^2 bits).
+constexpr int kMaxPlannedNodes = 8192;
+
+constexpr size_t kAlignment = Allocator::kAllocatorAlignment;
+
+size_t AlignedSize(size_t size) {
+  return (size + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+// Returns true if `node` never allocates its outputs, but produces
+// constants, fed tensors or its inputs.
+bool NeverAllocatesOutputs(const Node* node) {
+  return node->IsConstant() || node->IsRecv() || node->IsIdentity() ||
+         node->IsVariable() || node->type_string() == "_Arg" ||
+         node->type_string() == "Placeholder";
+}
+
+// Returns true if `node` may keep its inputs alive beyond the step, e.g.
+// because it returns them to the caller or stores them in a resource.
+bool MayRetainInputs(const Node* node) {
+  return node->IsSend() || node->type_string() == "_Retval" ||
+         node->op_def().is_stateful();
+}
+
+// A candidate output and its consumers.
+struct Candidate {
+  int node_id;
+  int output;
+  size_t size;
+  std::vector<int> consumers;
+};
+
+}  // namespace
+
+Status BufferPlan::Create(const Graph& graph, const OutputSizeFn& output_size,
+                          std::unique_ptr<BufferPlan>* plan) {
+  plan->reset(new BufferPlan);
+  BufferPlan* p = plan->get();
+  const int num_nodes = graph.num_node_ids();
+  p->node_start_.assign(num_nodes, -1);
+  if (num_nodes > kMaxPlannedNodes) {
+    VLOG(1) << "Not planning buffers of a graph with " << num_nodes
+            << " nodes";
+    return Status::OK();
+  }
+  for (const Node* node : graph.op_nodes()) {
+    if (node->IsControlFlow()) {
+      VLOG(1) << "Not planning buffers of a graph with control flow";
+      return Status::OK();
+    }
+  }
+
+  // Collect the outputs with a known size that stay within the step.
+  std::vector<Candidate> candidates;
+  for (const Node* node : graph.op_nodes()) {
+    if (NeverAllocatesOutputs(node)) continue;
+    const int first = candidates.size();
+    for (int i = 0; i < node->num_outputs(); ++i) {
+      const DataType dtype = node->output_type(i);
+      if (IsRefType(dtype) || !DataTypeCanUseMemcpy(dtype)) continue;
+      const int64 size = output_size(node, i);
+      if (size <= 0) continue;
+      candidates.push_back({node->id(), i, AlignedSize(size), {}});
+    }
+    for (const Edge* e : node->out_edges()) {
+      if (e->IsControlEdge()) continue;
+      for (int c = first; c < candidates.size(); ++c) {
+        if (candidates[c].output == e->src_output()) {
+          candidates[c].consumers.push_back(e->dst()->id());
+        }
+      }
+    }
+    // Outputs without consumers are not planned: the executor releases them
+    // only after it has scheduled the successors of their producer.
+    for (int c = candidates.size() - 1; c >= first; --c) {
+      bool retained = candidates[c].consumers.empty();
+      for (int consumer : candidates[c].consumers) {
+        retained = retained || MayRetainInputs(graph.FindNodeId(consumer));
+      }
+      if (retained) candidates.erase(candidates.begin() + c);
+    }
+  }
+  if (candidates.empty()) return Status::OK();
+
+  // Row n of `reachable` is a bitmap of the ids of the nodes that run after
+  // node n.
+  const int words_per_row = (num_nodes + 63) / 64;
+  std::vector<uint64> reachable(static_cast<size_t>(num_nodes) *
+                                words_per_row);
+  auto row = [&reachable, words_per_row](int id) {
+    return &reachable[static_cast<size_t>(id) * words_per_row];
+  };
+  auto reaches = [&row](int from, int to) -> bool {
+    return (row(from)[to / 64] >> (to % 64)) & 1;
+  };
+  std::vector<Node*> order;
+  GetReversePostOrder(graph, &order);
+  for (auto it = order.rbegin(); it != order.rend(); ++it) {
+    uint64* bits = row((*it)->id());
+    for (const Node* out : (*it)->out_nodes()) {
+      const uint64* out_bits = row(out->id());
+      for (int w = 0; w < words_per_row; ++w) bits[w] |= out_bits[w];
+      bits[out->id() / 64] |= uint64{1} << (out->id() % 64);
+    }
+  }
+
+  // Returns true if candidate `a` is dead before candidate `b` is allocated.
+  auto dead_before = [&candidates, &reaches](int a, int b) {
+    const int producer = candidates[b].node_id;
+    for (int consumer : candidates[a].consumers) {
+      if (!reaches(consumer, producer)) return false;
+    }
+    return true;
+  };
+
+  // Place the candidates in decreasing order of size, each at the lowest
+  // offset that does not overlap a placed candidate whose lifetime may
+  // overlap its own.
+  std::vector<int> by_size(candidates.size());
+  for (int i = 0; i < by_size.size(); ++i) by_size[i] = i;
+  std::stable_sort(by_size.begin(), by_size.end(), [&candidates](int a, int b) {
+    return candidates[a].size > candidates[b].size;
+  });
+  std::vector<size_t> offsets(candidates.size());
+  std::vector<int> placed;
+  std::vector<std::pair<size_t, size_t>> conflicts;
+  for (int c : by_size) {
+    conflicts.clear();
+    for (int other : placed) {
+      if (!dead_before(c, other) && !dead_before(other, c)) {
+        conflicts.emplace_back(offsets[other], candidates[other].size);
+      }
+    }
+    std::sort(conflicts.begin(), conflicts.end());
+    size_t offset = 0;
+    for (const auto& conflict : conflicts) {
+      if (offset + candidates[c].size <= conflict.first) break;
+      offset = std::max(offset, conflict.first + conflict.second);
+    }
+    offsets[c] = offset;
+    placed.push_back(c);
+    p->arena_size_ = std::max(p->arena_size_, offset + candidates[c].size);
+  }
+
+  // Candidates are in node order, so the outputs of each node are adjacent.
+  for (int c = 0; c < candidates.size(); ++c) {
+    const Candidate& candidate = candidates[c];
+    p->buffers_.push_back(
+        {candidate.node_id, candidate.output, offsets[c], candidate.size});
+    if (p->node_start_[candidate.node_id] < 0) {
+      p->node_start_[candidate.node_id] = p->output_buffers_.size();
+      p->output_buffers_.resize(
+          p->output_buffers_.size() +
+              graph.FindNodeId(candidate.node_id)->num_outputs(),
+          -1);
+    }
+    p->output_buffers_[p->node_start_[candidate.node_id] + candidate.output] =
+        c;
+  }
+  p->overlapping_.resize(p->buffers_.size());
+  for (int a = 0; a < p->buffers_.size(); ++a) {
+    const Buffer& ba = p->buffers_[a];
+    for (int b = a + 1; b < p->buffers_.size(); ++b) {
+      const Buffer& bb = p->buffers_[b];
+      if (ba.offset < bb.offset + bb.size && bb.offset < ba.offset + ba.size) {
+        p->overlapping_[a].push_back(b);
+        p->overlapping_[b].push_back(a);
+      }
+    }
+  }
+  VLOG(1) << "Planned " << p->buffers_.size() << " buffers in an arena of "
+          << p->arena_size_ << " bytes";
+  return Status::OK();
+}
+
+int BufferPlan::BufferIndex(int node_id, int output) const {
+  const int start = node_start_[node_id];
+  return start < 0 ? -1 : output_buffers_[start + output];
+}
+
+// The allocator of one planned output.
+class PlannedArena::BufferAllocator : public Allocator {
+ public:
+  BufferAllocator(PlannedArena* arena, int index)
+      : arena_(arena), index_(index) {}
+
+  string Name() override { return "planned_buffer"; }
+
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    return arena_->Allocate(index_, alignment, num_bytes);
+  }
+
+  void DeallocateRaw(void* ptr) override { arena_->Deallocate(index_, ptr); }
+
+ private:
+  PlannedArena* const arena_;
+  const int index_;
+};
+
+PlannedArena::PlannedArena(std::shared_ptr<const BufferPlan> plan,
+                           Allocator* backing)
+    : plan_(std::move(plan)),
+      backing_(backing),
+      base_(static_cast<char*>(
+          backing_->AllocateRaw(kAlignment, plan_->arena_size()))),
+      output_allocators_(plan_->output_buffers_.size(), nullptr),
+      live_(plan_->buffers().size(), false) {
+  for (int i = 0; i < plan_->buffers().size(); ++i) {
+    allocators_.emplace_back(new BufferAllocator(this, i));
+  }
+  for (int i = 0; i < plan_->output_buffers_.size(); ++i) {
+    const int index = plan_->output_buffers_[i];
+    if (index >= 0 && base_ != nullptr) {
+      output_allocators_[i] = allocators_[index].get();
+    }
+  }
+}
+
+PlannedArena::~PlannedArena() {
+  if (base_ != nullptr) backing_->DeallocateRaw(base_);
+}
+
+void* PlannedArena::Allocate(int index, size_t alignment, size_t num_bytes) {
+  const BufferPlan::Buffer& buffer = plan_->buffers()[index];
+  {
+    mutex_lock l(mu_);
+    bool available = !live_[index] && num_bytes <= buffer.size &&
+                     kAlignment % alignment == 0;
+    for (int other : plan_->Overlapping(index)) {
+      if (!available) break;
+      available = !live_[other];
+    }
+    ++num_live_;
+    if (available) {
+      live_[index] = true;
+      return base_ + buffer.offset;
+    }
+  }
+  void* ptr = backing_->AllocateRaw(alignment, num_bytes);
+  if (ptr == nullptr) {
+    mutex_lock l(mu_);
+    --num_live_;
+  }
+  return ptr;
+}
+
+void PlannedArena::Deallocate(int index, void* ptr) {
+  const BufferPlan::Buffer& buffer = plan_->buffers()[index];
+  if (ptr != base_ + buffer.offset) {
+    backing_->DeallocateRaw(ptr);
+  }
+  bool done;
+  {
+    mutex_lock l(mu_);
+    if (ptr == base_ + buffer.offset) live_[index] = false;
+    done = --num_live_ == 0 && abandoned_;
+  }
+  if (done) delete this;
+}
+
+bool PlannedArena::Release() {
+  mutex_lock l(mu_);
+  if (num_live_ == 0) return true;
+  VLOG(1) << num_live_ << " planned allocations outlive their step";
+  abandoned_ = true;
+  return false;
+}
+
+PlannedArenaPool::~PlannedArenaPool() {
+  for (PlannedArena* arena : free_) delete arena;
+}
+
+PlannedArena* PlannedArenaPool::Acquire() {
+  {
+    mutex_lock l(mu_);
+    if (!free_.empty()) {
+      PlannedArena* arena = free_.back();
+      free_.pop_back();
+      return arena;
+    }
+  }
+  return new PlannedArena(plan_, backing_);
+}
+
+void PlannedArenaPool::Release(PlannedArena* arena) {
+  if (arena->Release()) {
+    mutex_lock l(mu_);
+    free_.push_back(arena);
+  }
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,171 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_BUFFER_PLAN_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_BUFFER_PLAN_H_
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// A static assignment of node outputs to offsets in a per-step arena.
+//
+// The plan is computed once per graph from its topology and the statically
+// known sizes of the outputs. Two outputs may share memory only if one of
+// them is dead before the other is allocated in every execution of the
+// graph, i.e. if every consumer of the first output is an ancestor of the
+// producer of the second. Offsets are assigned greedily in decreasing order
+// of size, as in TFLite's ArenaPlanner.
+//
+// Only graphs without control flow are planned, since the nodes of a loop
+// body run more than once per step.
+class BufferPlan {
+ public:
+  // Returns the size in bytes of output `index` of `node`, or -1 if it is
+  // not known statically.
+  typedef std::function<int64(const Node* node, int index)> OutputSizeFn;
+
+  struct Buffer {
+    int node_id;
+    int output;
+    size_t offset;
+    size_t size;
+  };
+
+  // Plans the outputs of the nodes of `graph` whose size is known. The plan
+  // refers to nodes by id, and is only valid for `graph`.
+  static Status Create(const Graph& graph, const OutputSizeFn& output_size,
+                       std::unique_ptr<BufferPlan>* plan);
+
+  const std::vector<Buffer>& buffers() const { return buffers_; }
+
+  // The number of bytes of the arena that backs the buffers.
+  size_t arena_size() const { return arena_size_; }
+
+  // Returns the index of the buffer of output `output` of node `node_id`, or
+  // -1 if the output is not planned.
+  int BufferIndex(int node_id, int output) const;
+
+  // Returns the indices of the buffers whose memory overlaps that of buffer
+  // `index`.
+  const std::vector<int>& Overlapping(int index) const {
+    return overlapping_[index];
+  }
+
+ private:
+  friend class PlannedArena;
+
+  BufferPlan() {}
+
+  std::vector<Buffer> buffers_;
+  size_t arena_size_ = 0;
+  // For each node id, the position in `output_buffers_` of the buffer index
+  // of its first output, or -1 if none of its outputs is planned.
+  std::vector<int> node_start_;
+  std::vector<int> output_buffers_;
+  std::vector<std::vector<int>> overlapping_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(BufferPlan);
+};
+
+// The memory of one step that executes a planned graph.
+//
+// The arena hands out one Allocator per planned output. An output is placed
+// at its planned offset unless that memory is still in use, e.g. because a
+// kernel forwarded an input buffer to an output and so extended its
+// lifetime, or because the output is larger than planned. In that case, and
+// for requests the plan cannot satisfy, the output is allocated from the
+// backing allocator instead.
+//
+// An arena is reused by a later step once all of its allocations have been
+// released. If a tensor outlives its step, the arena is abandoned and deletes
+// itself when that tensor is released.
+class PlannedArena {
+ public:
+  // Returns the allocators of the outputs of node `node_id`, indexed by
+  // output, or nullptr if no output of the node is planned. Entries are
+  // nullptr for outputs that are not planned.
+  Allocator* const* OutputAllocators(int node_id) const {
+    const int start = plan_->node_start_[node_id];
+    return start < 0 ? nullptr : &output_allocators_[start];
+  }
+
+ private:
+  friend class PlannedArenaPool;
+  class BufferAllocator;
+
+  PlannedArena(std::shared_ptr<const BufferPlan> plan, Allocator* backing);
+  ~PlannedArena();
+
+  void* Allocate(int index, size_t alignment, size_t num_bytes)
+      LOCKS_EXCLUDED(mu_);
+  void Deallocate(int index, void* ptr) LOCKS_EXCLUDED(mu_);
+
+  // Called at the end of a step. Returns true if the arena has no live
+  // allocations and may be reused; otherwise the arena deletes itself once
+  // its last allocation is released.
+  bool Release() LOCKS_EXCLUDED(mu_);
+
+  const std::shared_ptr<const BufferPlan> plan_;
+  Allocator* const backing_;  // Not owned.
+  char* const base_;
+  std::vector<std::unique_ptr<BufferAllocator>> allocators_;
+  std::vector<Allocator*> output_allocators_;
+
+  mutex mu_;
+  std::vector<bool> live_ GUARDED_BY(mu_);
+  // The number of allocations, planned or not, that were not yet released.
+  int64 num_live_ GUARDED_BY(mu_) = 0;
+  bool abandoned_ GUARDED_BY(mu_) = false;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(PlannedArena);
+};
+
+// A pool of the arenas of the steps of one executor. Thread-safe.
+class PlannedArenaPool {
+ public:
+  // Arenas allocate their memory and unplanned outputs from `backing`, which
+  // must outlive all arenas and their allocations.
+  PlannedArenaPool(std::shared_ptr<const BufferPlan> plan, Allocator* backing)
+      : plan_(std::move(plan)), backing_(backing) {}
+  ~PlannedArenaPool();
+
+  // Returns an arena for a new step.
+  PlannedArena* Acquire() LOCKS_EXCLUDED(mu_);
+
+  // Returns the arena of a finished step to the pool.
+  void Release(PlannedArena* arena) LOCKS_EXCLUDED(mu_);
+
+ private:
+  const std::shared_ptr<const BufferPlan> plan_;
+  Allocator* const backing_;
+  mutex mu_;
+  std::vector<PlannedArena*> free_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(PlannedArenaPool);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_BUFFER_PLAN_H_
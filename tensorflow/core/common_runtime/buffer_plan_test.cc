@@ -0,0 +1,165 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/buffer_plan.h"
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+constexpr size_t kSlot = Allocator::kAllocatorAlignment;
+
+// Every output has 16 bytes.
+int64 FixedSize(const Node* node, int index) { return 16; }
+
+const BufferPlan::Buffer& BufferOf(const BufferPlan& plan, const Node* node) {
+  const int index = plan.BufferIndex(node->id(), 0);
+  CHECK_GE(index, 0) << node->name();
+  return plan.buffers()[index];
+}
+
+TEST(BufferPlanTest, ChainReusesMemory) {
+  Graph g(OpRegistry::Global());
+  Node* c = test::graph::Constant(&g, Tensor(DT_FLOAT, TensorShape({4})));
+  Node* a = test::graph::Unary(&g, "Neg", c);
+  Node* b = test::graph::Unary(&g, "Neg", a);
+  Node* d = test::graph::Unary(&g, "Neg", b);
+  Node* e = test::graph::Unary(&g, "Neg", d);
+  std::unique_ptr<BufferPlan> plan;
+  TF_ASSERT_OK(BufferPlan::Create(g, FixedSize, &plan));
+
+  // The constant is not allocated, and `e` has no consumers.
+  EXPECT_EQ(3, plan->buffers().size());
+  EXPECT_EQ(-1, plan->BufferIndex(c->id(), 0));
+  EXPECT_EQ(-1, plan->BufferIndex(e->id(), 0));
+  EXPECT_EQ(2 * kSlot, plan->arena_size());
+  EXPECT_EQ(BufferOf(*plan, a).offset, BufferOf(*plan, d).offset);
+  EXPECT_NE(BufferOf(*plan, a).offset, BufferOf(*plan, b).offset);
+}
+
+TEST(BufferPlanTest, ParallelBranchesDoNotShareMemory) {
+  Graph g(OpRegistry::Global());
+  Node* c = test::graph::Constant(&g, Tensor(DT_FLOAT, TensorShape({4})));
+  Node* x = test::graph::Unary(&g, "Neg", c);
+  Node* y = test::graph::Unary(&g, "Neg", c);
+  Node* z = test::graph::Add(&g, x, y);
+  test::graph::Unary(&g, "Neg", z);
+  std::unique_ptr<BufferPlan> plan;
+  TF_ASSERT_OK(BufferPlan::Create(g, FixedSize, &plan));
+
+  EXPECT_EQ(3, plan->buffers().size());
+  EXPECT_EQ(3 * kSlot, plan->arena_size());
+  EXPECT_NE(BufferOf(*plan, x).offset, BufferOf(*plan, y).offset);
+  EXPECT_NE(BufferOf(*plan, x).offset, BufferOf(*plan, z).offset);
+  EXPECT_NE(BufferOf(*plan, y).offset, BufferOf(*plan, z).offset);
+}
+
+TEST(BufferPlanTest, UnknownSizesAreNotPlanned) {
+  Graph g(OpRegistry::Global());
+  Node* c = test::graph::Constant(&g, Tensor(DT_FLOAT, TensorShape({4})));
+  Node* a = test::graph::Unary(&g, "Neg", c);
+  test::graph::Unary(&g, "Neg", a);
+  std::unique_ptr<BufferPlan> plan;
+  TF_ASSERT_OK(BufferPlan::Create(
+      g, [](const Node* node, int index) -> int64 { return -1; }, &plan));
+  EXPECT_TRUE(plan->buffers().empty());
+  EXPECT_EQ(0, plan->arena_size());
+}
+
+TEST(BufferPlanTest, ControlFlowIsNotPlanned) {
+  Graph g(OpRegistry::Global());
+  Node* c = test::graph::Constant(&g, Tensor(DT_FLOAT, TensorShape({4})));
+  Node* pred = test::graph::Constant(&g, Tensor(DT_BOOL, TensorShape({})));
+  Node* a = test::graph::Unary(&g, "Neg", c);
+  Node* s = test::graph::Switch(&g, a, pred);
+  test::graph::Unary(&g, "Neg", s);
+  std::unique_ptr<BufferPlan> plan;
+  TF_ASSERT_OK(BufferPlan::Create(g, FixedSize, &plan));
+  EXPECT_TRUE(plan->buffers().empty());
+}
+
+TEST(PlannedArenaTest, FallsBackWhileMemoryIsInUse) {
+  Graph g(OpRegistry::Global());
+  Node* c = test::graph::Constant(&g, Tensor(DT_FLOAT, TensorShape({4})));
+  Node* a = test::graph::Unary(&g, "Neg", c);
+  Node* b = test::graph::Unary(&g, "Neg", a);
+  Node* d = test::graph::Unary(&g, "Neg", b);
+  test::graph::Unary(&g, "Neg", d);
+  std::unique_ptr<BufferPlan> plan;
+  TF_ASSERT_OK(BufferPlan::Create(g, FixedSize, &plan));
+  ASSERT_EQ(BufferOf(*plan, a).offset, BufferOf(*plan, d).offset);
+
+  PlannedArenaPool pool(std::move(plan), cpu_allocator());
+  PlannedArena* arena = pool.Acquire();
+  Allocator* a_allocator = arena->OutputAllocators(a->id())[0];
+  Allocator* d_allocator = arena->OutputAllocators(d->id())[0];
+  ASSERT_NE(nullptr, a_allocator);
+  ASSERT_NE(nullptr, d_allocator);
+
+  // `a` is still in use, e.g. because a kernel forwarded it, so `d` is
+  // allocated elsewhere.
+  void* a_ptr = a_allocator->AllocateRaw(kSlot, 16);
+  void* d_ptr = d_allocator->AllocateRaw(kSlot, 16);
+  EXPECT_NE(a_ptr, d_ptr);
+  a_allocator->DeallocateRaw(a_ptr);
+  d_allocator->DeallocateRaw(d_ptr);
+
+  // Once `a` is released, `d` takes its memory.
+  a_ptr = a_allocator->AllocateRaw(kSlot, 16);
+  a_allocator->DeallocateRaw(a_ptr);
+  d_ptr = d_allocator->AllocateRaw(kSlot, 16);
+  EXPECT_EQ(a_ptr, d_ptr);
+
+  // Larger outputs than planned are allocated elsewhere.
+  Allocator* b_allocator = arena->OutputAllocators(b->id())[0];
+  void* b_ptr = b_allocator->AllocateRaw(kSlot, 2 * kSlot);
+  EXPECT_NE(nullptr, b_ptr);
+  b_allocator->DeallocateRaw(b_ptr);
+  d_allocator->DeallocateRaw(d_ptr);
+
+  pool.Release(arena);
+  EXPECT_EQ(arena, pool.Acquire());
+  pool.Release(arena);
+}
+
+TEST(PlannedArenaTest, AllocationsMayOutliveTheStep) {
+  Graph g(OpRegistry::Global());
+  Node* c = test::graph::Constant(&g, Tensor(DT_FLOAT, TensorShape({4})));
+  Node* a = test::graph::Unary(&g, "Neg", c);
+  test::graph::Unary(&g, "Neg", a);
+  std::unique_ptr<BufferPlan> plan;
+  TF_ASSERT_OK(BufferPlan::Create(g, FixedSize, &plan));
+
+  PlannedArenaPool pool(std::move(plan), cpu_allocator());
+  PlannedArena* arena = pool.Acquire();
+  Allocator* allocator = arena->OutputAllocators(a->id())[0];
+  void* ptr = allocator->AllocateRaw(kSlot, 16);
+  pool.Release(arena);
+
+  // The abandoned arena is not reused, and is deleted with its last
+  // allocation.
+  PlannedArena* next = pool.Acquire();
+  EXPECT_NE(arena, next);
+  allocator->DeallocateRaw(ptr);
+  pool.Release(next);
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -27,6 +27,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/protobuf/config.pb.h"
 #include "tensorflow/core/util/device_name_utils.h"
 
 namespace tensorflow {
@@ -35,10 +36,23 @@ void CollectiveParamResolverLocal::InstanceRec::WaitForOutMu(mutex_lock& lock) {
   while (!out_mu_available) out_cv.wait(lock);
 }
 
+namespace {
+// Reductions of at most this many bytes are bound by latency rather than
+// bandwidth.
+constexpr int64 kDefaultRecursiveHalvingMaxBytes = 256 << 10;
+}  // namespace
+
 CollectiveParamResolverLocal::CollectiveParamResolverLocal(
-    const DeviceMgr* dev_mgr, DeviceResolverInterface* dev_resolver,
-    const string& task_name)
-    : dev_mgr_(dev_mgr), dev_resolver_(dev_resolver), task_name_(task_name) {}
+    const ConfigProto& config, const DeviceMgr* dev_mgr,
+    DeviceResolverInterface* dev_resolver, const string& task_name)
+    : dev_mgr_(dev_mgr),
+      dev_resolver_(dev_resolver),
+      task_name_(task_name),
+      recursive_halving_max_bytes_(
+          config.experimental().collective_recursive_halving_max_bytes() == 0
+              ? kDefaultRecursiveHalvingMaxBytes
+              : config.experimental()
+                    .collective_recursive_halving_max_bytes()) {}
 
 void CollectiveParamResolverLocal::CompleteGroupAsync(
     const CompleteGroupRequest* request, CompleteGroupResponse* response,
@@ -63,6 +77,8 @@ void CollectiveParamResolverLocal::CompleteGroupLocal(
       gr->group.group_key = cp->group.group_key;
       gr->group.group_size = cp->group.group_size;
       gr->group.device_type = cp->group.device_type;
+      gr->group.recursive_halving_max_bytes =
+          cp->group.recursive_halving_max_bytes;
       group_table_[gr->group.group_key].reset(gr);
       VLOG(2) << "New group_key=" << gr->group.group_key
               << " group_size=" << gr->group.group_size;
@@ -86,6 +102,19 @@ void CollectiveParamResolverLocal::CompleteGroupLocal(
             "Collective Op ", cp->name, " has group_size ",
             cp->group.group_size, " and group_key", cp->group.group_key,
             " but that group has size ", gr->group.group_size);
+      } else if (cp->group.recursive_halving_max_bytes !=
+                 gr->group.recursive_halving_max_bytes) {
+        // Tasks that disagree on this would pick different implementations
+        // of the same all-reduce.
+        status = errors::InvalidArgument(
+            "Collective Op ", cp->name, " on device ", device,
+            " has recursive_halving_max_bytes ",
+            cp->group.recursive_halving_max_bytes, " and group_key ",
+            cp->group.group_key, " but that group has ",
+            gr->group.recursive_halving_max_bytes,
+            ". ConfigProto.experimental."
+            "collective_recursive_halving_max_bytes must be the same in "
+            "every task.");
       }
     }
     if (status.ok()) {
@@ -338,6 +367,27 @@ void SortDevicesAndTasks(CollectiveParams* cp) {
   VLOG(1) << "Modified device_names on " << cp;
   SetDevPerTask(cp);
 }
+
+// Returns the name of the all-reduce implementation that suits the size of
+// the reduced tensor and the layout of the group across tasks.  The choice
+// only depends upon values that are the same for every member of the group.
+string ReductionCollectiveName(const CollectiveParams& cp) {
+  const int64 num_bytes = cp.instance.shape.num_elements() *
+                          DataTypeSize(cp.instance.data_type);
+  // Small tensors go through log2(group_size) exchanges rather than the
+  // 2 * (group_size - 1) steps of a ring.
+  if (cp.group.group_size > 2 &&
+      num_bytes <= cp.group.recursive_halving_max_bytes) {
+    return "RecursiveHalvingReduce";
+  }
+  // Large tensors spanning several tasks with several devices each are
+  // reduced within each task first, so that only one device per task moves
+  // data across tasks.
+  if (cp.group.num_tasks > 1 && cp.group.group_size > cp.group.num_tasks) {
+    return "HierarchicalReduce";
+  }
+  return "RingReduce";
+}
 }  // namespace
 
 void CollectiveParamResolverLocal::CompleteTaskIsLocal(const string& task_name,
@@ -551,6 +601,7 @@ void CollectiveParamResolverLocal::CompleteParamsAsync(
     const StatusCallback& done) {
   VLOG(1) << "CompleteParams " << device << " for " << cp << ": "
           << cp->ToString();
+  cp->group.recursive_halving_max_bytes = recursive_halving_max_bytes_;
   CompleteGroupLocal(
       device, cp,
       [this, device, cp, done](const Status& s, const GroupRec* gr) {
@@ -610,12 +661,12 @@ void CollectiveParamResolverLocal::CompleteInstanceFromInitializedIRec(
   // Populate the fields common across task, also default_rank.
   SetDefaultRank(device, cp);
   CompleteTaskIsLocal(task_name_, cp);
-  // TODO(b/113171733): we need a better way to pick the collective
-  // implementation.  The ideal way would depend upon the topology and link
-  // strength before picking a particular implementation.
+  // Every member of the group picks the implementation on its own, from
+  // values that the group resolution has made the same for all of them.
   cp->instance.impl_details.collective_name =
-      (cp->instance.type == BROADCAST_COLLECTIVE) ? "HierarchicalTreeBroadcast"
-                                                  : "RingReduce";
+      (cp->instance.type == BROADCAST_COLLECTIVE)
+          ? "HierarchicalTreeBroadcast"
+          : ReductionCollectiveName(*cp);
   CollectiveImplementationInterface* col_impl;
   Status lookup_status = CollectiveRegistry::LookupParamResolverInstance(
       cp->instance.impl_details.collective_name, &col_impl);
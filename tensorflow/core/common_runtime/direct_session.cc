@@ -19,6 +19,7 @@ limitations under the License.
 #include <string>
 #include <vector>
 
+#include "tensorflow/core/common_runtime/buffer_plan.h"
 #include "tensorflow/core/common_runtime/collective_executor_mgr.h"
 #include "tensorflow/core/common_runtime/collective_param_resolver_local.h"
 #include "tensorflow/core/common_runtime/constant_folding.h"
@@ -33,6 +34,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/optimization_registry.h"
 #include "tensorflow/core/common_runtime/process_util.h"
 #include "tensorflow/core/common_runtime/scoped_allocator_mgr.h"
+#include "tensorflow/core/common_runtime/shape_refiner.h"
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
 #include "tensorflow/core/framework/function.h"
 #include "tensorflow/core/framework/graph.pb_text.h"
@@ -40,6 +42,7 @@ limitations under the License.
 #include "tensorflow/core/framework/graph_def_util.h"
 #include "tensorflow/core/framework/log_memory.h"
 #include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/node_def_util.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/versions.pb.h"
 #include "tensorflow/core/graph/algorithm.h"
@@ -137,6 +140,60 @@ string GetRendezvousKey(const string& tensor_name,
                          frame_iter.frame_id, ":", frame_iter.iter_id);
 }
 
+// Plans the buffers of the outputs of `graph` whose shapes can be inferred
+// statically. The shapes of the tensors fed through `_Arg` nodes are taken
+// from the placeholders of `original_graph` that they replace. Leaves `plan`
+// unchanged if the shapes of `graph` cannot be inferred.
+Status PlanBuffers(const Graph& graph, const GraphDef& original_graph,
+                   const CallableOptions& callable_options,
+                   std::shared_ptr<const BufferPlan>* plan) {
+  std::unordered_map<string, const NodeDef*> original_nodes;
+  for (const NodeDef& ndef : original_graph.node()) {
+    original_nodes[ndef.name()] = &ndef;
+  }
+
+  ShapeRefiner refiner(graph.versions(), graph.op_registry());
+  std::vector<Node*> order;
+  GetReversePostOrder(graph, &order);
+  for (const Node* node : order) {
+    Status s = refiner.AddNode(node);
+    if (!s.ok()) {
+      VLOG(1) << "Not planning buffers: " << s;
+      return Status::OK();
+    }
+    if (node->type_string() != "_Arg") continue;
+    int index;
+    TF_RETURN_IF_ERROR(GetNodeAttr(node->attrs(), "index", &index));
+    if (index < 0 || index >= callable_options.feed_size()) continue;
+    const TensorId id = ParseTensorName(callable_options.feed(index));
+    auto it = original_nodes.find(std::string(id.first));
+    PartialTensorShape shape;
+    if (it == original_nodes.end() || it->second->op() != "Placeholder" ||
+        !GetNodeAttr(*it->second, "shape", &shape).ok()) {
+      continue;
+    }
+    shape_inference::InferenceContext* c = refiner.GetContext(node);
+    shape_inference::ShapeHandle handle;
+    TF_RETURN_IF_ERROR(c->MakeShapeFromPartialTensorShape(shape, &handle));
+    TF_RETURN_IF_ERROR(refiner.SetShape(node, 0, handle));
+  }
+
+  auto output_size = [&refiner](const Node* node, int index) -> int64 {
+    shape_inference::InferenceContext* c = refiner.GetContext(node);
+    if (c == nullptr || !c->FullyDefined(c->output(index))) return -1;
+    const shape_inference::ShapeHandle shape = c->output(index);
+    int64 num_elements = 1;
+    for (int d = 0; d < c->Rank(shape); ++d) {
+      num_elements *= c->Value(c->Dim(shape, d));
+    }
+    return num_elements * DataTypeSize(node->output_type(index));
+  };
+  std::unique_ptr<BufferPlan> buffer_plan;
+  TF_RETURN_IF_ERROR(BufferPlan::Create(graph, output_size, &buffer_plan));
+  plan->reset(buffer_plan.release());
+  return Status::OK();
+}
+
 }  // namespace
 
 class DirectSessionFactory : public SessionFactory {
@@ -449,7 +506,8 @@ Status DirectSession::RunInternal(int64 step_id, const RunOptions& run_options,
 
   // Create a run state and start execution.
   RunState run_state(step_id, &devices_);
-  run_state.rendez = new IntraProcessRendezvous(device_mgr_.get());
+  run_state.rendez = new IntraProcessRendezvous(
+      device_mgr_.get(), executors_and_keys->num_rendezvous_slots);
 #ifndef __ANDROID__
   // Set up for collectives if ExecutorsAndKeys declares a key.
   if (executors_and_keys->collective_graph_key !=
@@ -471,7 +529,8 @@ Status DirectSession::RunInternal(int64 step_id, const RunOptions& run_options,
       std::unique_ptr<DeviceResolverInterface> drl(
           new DeviceResolverLocal(device_mgr_.get()));
       std::unique_ptr<ParamResolverInterface> cprl(
-          new CollectiveParamResolverLocal(device_mgr_.get(), drl.get(),
+          new CollectiveParamResolverLocal(options_.config, device_mgr_.get(),
+                                           drl.get(),
                                            "/job:localhost/replica:0/task:0"));
       collective_executor_mgr_.reset(new CollectiveExecutorMgr(
           options_.config, device_mgr_.get(), std::move(drl), std::move(cprl)));
@@ -525,6 +584,15 @@ Status DirectSession::RunInternal(int64 step_id, const RunOptions& run_options,
     run_state.collector.reset(
         new StepStatsCollector(run_metadata->mutable_step_stats()));
     args.stats_collector = run_state.collector.get();
+  } else {
+    const int32 trace_sampling_period =
+        options_.config.experimental().trace_sampling_period();
+    if (trace_sampling_period > 0 &&
+        executor_step_count % trace_sampling_period == 0) {
+      run_state.sampled_collector.reset(new LightweightStepStatsCollector(
+          run_metadata->mutable_step_stats()));
+      args.stats_collector = run_state.sampled_collector.get();
+    }
   }
 
   std::unique_ptr<DeviceTracer> tracer;
@@ -635,6 +703,9 @@ Status DirectSession::RunInternal(int64 step_id, const RunOptions& run_options,
   if (run_state.collector) {
     run_state.collector->Finalize();
   }
+  if (run_state.sampled_collector) {
+    run_state.sampled_collector->Finalize();
+  }
 
   // Build and return the cost model as instructed.
   if (update_cost_model) {
@@ -803,7 +874,8 @@ Status DirectSession::PRunSetup(const std::vector<string>& input_names,
   args.step_id = step_id_counter_.fetch_add(1);
   RunState* run_state =
       new RunState(input_names, output_names, args.step_id, &devices_);
-  run_state->rendez = new IntraProcessRendezvous(device_mgr_.get());
+  run_state->rendez = new IntraProcessRendezvous(
+      device_mgr_.get(), executors_and_keys->num_rendezvous_slots);
   {
     mutex_lock l(executor_lock_);
     if (!partial_runs_
@@ -1180,6 +1252,19 @@ Status DirectSession::CreateExecutors(
       device_mgr_.get(), options_.env, graph_def_version,
       func_info->flib_def.get(), optimizer_opts, thread_pools_[0].first));
 
+  // The step rendezvous needs one slot per Send/Recv pair that the
+  // partitioner numbered.
+  for (const auto& partition : graphs) {
+    for (const Node* n : partition.second->op_nodes()) {
+      int32 slot;
+      if (IsSend(n) &&
+          GetNodeAttr(n->attrs(), "_rendezvous_slot", &slot).ok()) {
+        ek->num_rendezvous_slots =
+            std::max(ek->num_rendezvous_slots, slot + 1);
+      }
+    }
+  }
+
   GraphOptimizer optimizer(optimizer_opts);
   for (auto iter = graphs.begin(); iter != graphs.end(); ++iter) {
     const string& partition_name = iter->first;
@@ -1242,6 +1327,12 @@ Status DirectSession::CreateExecutors(
     TF_RETURN_IF_ERROR(EnsureMemoryTypes(DeviceType(device->device_type()),
                                          device->name(),
                                          partition_graph.get()));
+    if (options_.config.experimental().use_static_buffer_plan() &&
+        device->device_type() == DEVICE_CPU) {
+      TF_RETURN_IF_ERROR(
+          PlanBuffers(*partition_graph, execution_state_->original_graph_def(),
+                      callable_options, &params.buffer_plan));
+    }
     // NewLocalExecutor takes ownership of partition_graph.
     item->graph = partition_graph.get();
     item->executor = nullptr;
@@ -1488,6 +1579,7 @@ Status DirectSession::CreateGraphs(
   };
   popts.flib_def = &client_graph->graph.flib_def();
   popts.control_flow_added = false;
+  popts.assign_rendezvous_slots = true;
 
   std::unordered_map<string, GraphDef> partitions;
   TF_RETURN_IF_ERROR(Partition(popts, &client_graph->graph, &partitions));
@@ -51,6 +51,7 @@ class CostModel;
 class DebugGateway;
 class Device;
 class DirectSessionFactory;
+class LightweightStepStatsCollector;
 
 class DirectSession : public Session {
  public:
@@ -155,6 +156,10 @@ class DirectSession : public Session {
     CallableOptions callable_options;
 
     int64 collective_graph_key = BuildGraphOptions::kNoCollectiveGraphKey;
+
+    // The number of rendezvous slots assigned to the Send/Recv pairs of the
+    // partitions.
+    int num_rendezvous_slots = 0;
   };
 
   // A FunctionInfo object is created for every unique set of feeds/fetches.
@@ -183,6 +188,7 @@ class DirectSession : public Session {
     IntraProcessRendezvous* rendez = nullptr;
     std::unique_ptr<CollectiveExecutor::Handle> collective_executor;
     std::unique_ptr<StepStatsCollector> collector;
+    std::unique_ptr<LightweightStepStatsCollector> sampled_collector;
     Notification executors_done;
     std::unordered_map<string, bool> pending_inputs;   // true if fed
     std::unordered_map<string, bool> pending_outputs;  // true if fetched
@@ -209,6 +215,10 @@ class DirectSession : public Session {
     std::unique_ptr<Graph> graph;
     const DebugOptions& debug_options;
     int64 collective_graph_key = BuildGraphOptions::kNoCollectiveGraphKey;
+
+    // The number of rendezvous slots assigned to the Send/Recv pairs of the
+    // partitions.
+    int num_rendezvous_slots = 0;
   };
 
   // Initializes the base execution state given the 'graph',
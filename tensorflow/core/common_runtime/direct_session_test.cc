@@ -625,6 +625,47 @@ TEST_F(DirectSessionMinusAXTest, RunSimpleNetworkWithOpts_Callable) {
   EXPECT_EQ(run_metadata.step_stats().dev_stats_size(), 2);
 }
 
+TEST_F(DirectSessionMinusAXTest, TraceSampling) {
+  Initialize({3, 2, -1, 0});
+  SessionOptions options;
+  (*options.config.mutable_device_count())["CPU"] = 2;
+  options.config.mutable_experimental()->set_trace_sampling_period(2);
+  std::unique_ptr<Session> session(NewSession(options));
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def_));
+
+  for (int step = 0; step < 4; ++step) {
+    std::vector<Tensor> outputs;
+    RunMetadata run_metadata;
+    TF_ASSERT_OK(session->Run(RunOptions(), {}, {y_ + ":0"}, {y_neg_},
+                              &outputs, &run_metadata));
+    ASSERT_EQ(1, outputs.size());
+    EXPECT_FLOAT_EQ(5.0, outputs[0].matrix<float>()(0, 0));
+
+    if (step % 2 != 0) {
+      EXPECT_EQ(run_metadata.step_stats().dev_stats_size(), 0);
+      continue;
+    }
+    // Only the timings of the nodes are collected on sampled steps.
+    const StepStats& step_stats = run_metadata.step_stats();
+    EXPECT_EQ(step_stats.dev_stats_size(), 2);
+    bool found_y = false;
+    for (const auto& dev_stats : step_stats.dev_stats()) {
+      for (const auto& node_stats : dev_stats.node_stats()) {
+        EXPECT_GT(node_stats.all_start_micros(), 0);
+        EXPECT_LE(node_stats.op_start_rel_nanos(),
+                  node_stats.op_end_rel_nanos());
+        EXPECT_LE(node_stats.op_end_rel_nanos(),
+                  node_stats.all_end_rel_nanos());
+        EXPECT_EQ(node_stats.memory_size(), 0);
+        EXPECT_EQ(node_stats.output_size(), 0);
+        if (node_stats.node_name() == y_) found_y = true;
+      }
+    }
+    EXPECT_TRUE(found_y);
+  }
+}
+
 TEST(DirectSessionTest, KeepsStateAcrossRunsOfSession) {
   GraphDef def;
   Graph g(OpRegistry::Global());
@@ -897,6 +938,49 @@ TEST(DirectSessionTest, FetchMultipleTimes) {
   }
 }
 
+TEST(DirectSessionTest, StaticBufferPlan) {
+  Graph g(OpRegistry::Global());
+  Node* x;
+  TF_ASSERT_OK(NodeBuilder(g.NewName("x"), "Placeholder")
+                   .Attr("dtype", DT_FLOAT)
+                   .Attr("shape", TensorShape({2, 2}))
+                   .Finalize(&g, &x));
+  // Every intermediate result has a static shape, so the planner places
+  // them in the per-step arena.
+  Node* a = test::graph::Unary(&g, "Neg", x);
+  Node* b = test::graph::Unary(&g, "Square", a);
+  Node* c = test::graph::Add(&g, a, b);
+  Node* d = test::graph::Unary(&g, "Neg", c);
+  Node* y = test::graph::Add(&g, c, d);
+  Node* z = test::graph::Unary(&g, "Square", y);
+  GraphDef def;
+  test::graph::ToGraphDef(&g, &def);
+
+  SessionOptions options;
+  options.config.mutable_experimental()->set_use_static_buffer_plan(true);
+  std::unique_ptr<Session> session(NewSession(options));
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def));
+
+  for (int step = 0; step < 3; ++step) {
+    Tensor x_value(DT_FLOAT, TensorShape({2, 2}));
+    test::FillValues<float>(&x_value, {1, 2, 3, float(step)});
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(session->Run({{x->name(), x_value}},
+                              {c->name(), y->name(), z->name()}, {},
+                              &outputs));
+    ASSERT_EQ(3, outputs.size());
+    // c = x^2 - x, y = c - c = 0.
+    test::ExpectTensorEqual<float>(
+        outputs[0], test::AsTensor<float>({0, 2, 6, float(step * step - step)},
+                                          TensorShape({2, 2})));
+    test::ExpectTensorEqual<float>(
+        outputs[1], test::AsTensor<float>({0, 0, 0, 0}, TensorShape({2, 2})));
+    test::ExpectTensorEqual<float>(
+        outputs[2], test::AsTensor<float>({0, 0, 0, 0}, TensorShape({2, 2})));
+  }
+}
+
 TEST(DirectSessionTest, MultipleFeedTestSomeSyncRun) {
   GraphDef def;
   Graph g(OpRegistry::Global());
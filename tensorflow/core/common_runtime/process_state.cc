@@ -95,9 +95,21 @@ VisitableAllocator* ProcessState::GetCPUAllocator(int numa_node) {
         LOG(ERROR) << "GetCPUAllocator: " << status.error_message();
       }
       int64 cpu_mem_limit = cpu_mem_limit_in_mb * (1LL << 20);
+      // Allocations up to this size are served from per-thread caches,
+      // which removes allocator lock contention on many-core hosts.
+      int64 thread_cache_max_bytes = 0;
+      status = ReadInt64FromEnvVar("TF_CPU_BFC_THREAD_CACHE_MAX_BYTES", 0,
+                                   &thread_cache_max_bytes);
+      if (!status.ok()) {
+        LOG(ERROR) << "GetCPUAllocator: " << status.error_message();
+      }
+      BFCAllocator::ThreadCacheOptions cache_options;
+      cache_options.max_cached_bytes =
+          std::max<int64>(thread_cache_max_bytes, 0);
       allocator = new BFCAllocator(
           new BasicCPUAllocator(numa_enabled_ ? numa_node : -1), cpu_mem_limit,
-          true /*allow_growth*/, "bfc_cpu_allocator_for_gpu" /*name*/);
+          true /*allow_growth*/, "bfc_cpu_allocator_for_gpu" /*name*/,
+          cache_options);
       VLOG(2) << "Using BFCAllocator with memory limit of "
               << cpu_mem_limit_in_mb << " MB for ProcessState CPU allocator";
     } else {
@@ -0,0 +1,343 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/recursive_halving_reducer.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace {
+// Each CollectiveOp implementation is free to define its own
+// BufRendezvous key format.  This function produces the key used by
+// RecursiveHalvingReducer.  Every phase moves at most one value between
+// any ordered pair of devices, so the phase and both ends identify it.
+string RecursiveHalvingBufKey(const string& exec_key, const string& phase,
+                              int source_idx, int target_idx) {
+  return strings::StrCat(exec_key, ":", phase, ":", source_idx, ":",
+                         target_idx);
+}
+
+// Returns the largest power of 2 not greater than n.
+int FloorPowerOfTwo(int n) {
+  int p = 1;
+  while (p * 2 <= n) p *= 2;
+  return p;
+}
+
+}  // namespace
+
+RecursiveHalvingReducer::RecursiveHalvingReducer(bool hierarchical)
+    : hierarchical_(hierarchical), num_chunks_(-1), chunk_elts_(-1) {}
+
+RecursiveHalvingReducer::~RecursiveHalvingReducer() {}
+
+Status RecursiveHalvingReducer::InitializeCollectiveParams(
+    CollectiveParams* col_params) {
+  CHECK_EQ(col_params->instance.type, REDUCTION_COLLECTIVE);
+  CHECK_EQ(col_params->instance.impl_details.collective_name,
+           hierarchical_ ? "HierarchicalReduce" : "RecursiveHalvingReduce");
+  // Precondition: device_names must be sorted so that all devices in
+  // the same task are adjacent.
+  const std::vector<string>& task_names = col_params->instance.task_names;
+  int num_tasks = 1;
+  for (size_t di = 1; di < task_names.size(); ++di) {
+    if (task_names[di] != task_names[di - 1]) ++num_tasks;
+  }
+  if (num_tasks != col_params->group.num_tasks) {
+    return errors::Internal("Devices of the same task are not adjacent in ",
+                            col_params->instance.ToString());
+  }
+  return Status::OK();
+}
+
+void RecursiveHalvingReducer::Run(StatusCallback done) {
+  CHECK(col_ctx_);
+  CHECK(col_params_);
+  Status s = CopyInputToOutput();
+  if (!s.ok()) {
+    done(s);
+    return;
+  }
+  // The tensor is divided into one chunk per rank of the power of 2
+  // participants that remain after folding.
+  num_chunks_ = FloorPowerOfTwo(ExchangeParticipants().size());
+  chunk_elts_ = CollectiveAdapter::AlignedChunkElts(
+      DataTypeSize(col_ctx_->output->dtype()),
+      col_ctx_->output->NumElements(), num_chunks_);
+  AllocatorAttributes attr = col_ctx_->op_ctx->output_alloc_attr(0);
+  ca_.reset(MakeCollectiveAdapter(col_ctx_->output, num_chunks_,
+                                  col_ctx_->device->GetAllocator(attr)));
+  s = PrepareGroupSizeTensor();
+  if (s.ok()) {
+    s = RunReduction();
+  }
+  if (!s.ok()) {
+    StartAbort(s);
+  }
+  // Recover the output from the adaptor.
+  ca_->ConsumeFinalValue(col_ctx_->output);
+  done(status());
+}
+
+std::vector<int> RecursiveHalvingReducer::ExchangeParticipants() const {
+  const std::vector<string>& task_names = col_params_->instance.task_names;
+  std::vector<int> participants;
+  for (int di = 0; di < col_params_->group.group_size; ++di) {
+    if (!hierarchical_ || di == 0 || task_names[di] != task_names[di - 1]) {
+      participants.push_back(di);
+    }
+  }
+  return participants;
+}
+
+Tensor RecursiveHalvingReducer::ChunkRange(int first, int count) const {
+  const Tensor& value = ca_->Value();
+  const int64 total_elts = value.NumElements();
+  const int64 start = std::min(total_elts, first * chunk_elts_);
+  const int64 end = std::min(total_elts, (first + count) * chunk_elts_);
+  // Always take an empty slice from the front of the tensor to avoid an
+  // illegal offset check failure somewhere.
+  return (end > start) ? value.Slice(start, end) : value.Slice(0, 0);
+}
+
+Tensor RecursiveHalvingReducer::TempTensor(int64 num_elements) const {
+  AllocatorAttributes attr = col_ctx_->op_ctx->output_alloc_attr(0);
+  AllocationAttributes empty;
+  return Tensor(col_ctx_->device->GetAllocator(attr), ca_->Value().dtype(),
+                {num_elements}, empty);
+}
+
+Status RecursiveHalvingReducer::RunReduction() {
+  const std::vector<int> participants = ExchangeParticipants();
+  const int my_idx = col_params_->default_rank;
+  const std::vector<string>& task_names = col_params_->instance.task_names;
+  int leader_idx = my_idx;
+  while (hierarchical_ && leader_idx > 0 &&
+         task_names[leader_idx - 1] == task_names[my_idx]) {
+    --leader_idx;
+  }
+  Tensor value = ca_->Value();
+  if (leader_idx != my_idx) {
+    // Hand the value to the leader of the task and wait for the result.
+    TF_RETURN_IF_ERROR(SendRecv("gather", leader_idx, &value, nullptr));
+    return SendRecv("bcast", leader_idx, nullptr, &value);
+  }
+
+  std::vector<int> locals;
+  if (hierarchical_) {
+    for (int di = my_idx + 1; di < col_params_->group.group_size &&
+                              task_names[di] == task_names[my_idx];
+         ++di) {
+      locals.push_back(di);
+    }
+  }
+  if (!locals.empty()) {
+    // Receive the values of the other devices of the task all at once, then
+    // fold them into ours.
+    std::vector<Tensor> local_values(locals.size());
+    for (Tensor& local_value : local_values) {
+      local_value = TempTensor(value.NumElements());
+    }
+    TF_RETURN_IF_ERROR(WaitForAllocations());
+    BlockingCounter pending(locals.size());
+    for (size_t i = 0; i < locals.size(); ++i) {
+      DispatchRecv("gather", locals[i], &local_values[i],
+                   TransferDone(&pending));
+    }
+    pending.Wait();
+    TF_RETURN_IF_ERROR(status());
+    for (Tensor& local_value : local_values) {
+      TF_RETURN_IF_ERROR(ComputeBinOp(col_params_->merge_op.get(), &value,
+                                      &local_value));
+    }
+  }
+
+  const int rank = std::find(participants.begin(), participants.end(),
+                             my_idx) -
+                   participants.begin();
+  TF_RETURN_IF_ERROR(RunExchange(participants, rank));
+
+  if (!locals.empty()) {
+    BlockingCounter pending(locals.size());
+    for (int di : locals) {
+      DispatchSend("bcast", di, &value, TransferDone(&pending));
+    }
+    pending.Wait();
+  }
+  return status();
+}
+
+Status RecursiveHalvingReducer::RunExchange(
+    const std::vector<int>& participants, int rank) {
+  const int num_participants = participants.size();
+  const int p2 = num_chunks_;
+  const int rem = num_participants - p2;
+  Tensor value = ca_->Value();
+
+  // Fold the first 2 * rem participants pairwise so that a power of 2 remain.
+  int new_rank;
+  if (rank < 2 * rem) {
+    if (rank % 2 == 1) {
+      TF_RETURN_IF_ERROR(
+          SendRecv("fold", participants[rank - 1], &value, nullptr));
+      return SendRecv("unfold", participants[rank - 1], nullptr, &value);
+    }
+    Tensor folded = TempTensor(value.NumElements());
+    TF_RETURN_IF_ERROR(WaitForAllocations());
+    TF_RETURN_IF_ERROR(
+        SendRecv("fold", participants[rank + 1], nullptr, &folded));
+    TF_RETURN_IF_ERROR(
+        ComputeBinOp(col_params_->merge_op.get(), &value, &folded));
+    new_rank = rank / 2;
+  } else {
+    new_rank = rank - rem;
+  }
+  auto peer_idx = [&participants, rem](int peer_rank) {
+    return participants[peer_rank < rem ? 2 * peer_rank : peer_rank + rem];
+  };
+
+  // Reduce-scatter: halve the range of chunks we're responsible for at
+  // each step, until we hold the reduction of chunk new_rank.  The received
+  // halves go to disjoint parts of one temp buffer, so that a transfer never
+  // overwrites the operand of a reduction that may still be pending.
+  Tensor scratch;
+  if (p2 > 1) {
+    scratch = TempTensor((p2 - 1) * chunk_elts_);
+    TF_RETURN_IF_ERROR(WaitForAllocations());
+  }
+  int lo = 0;
+  int count = p2;
+  int64 scratch_offset = 0;
+  for (int d = p2 / 2; d >= 1; d /= 2) {
+    count /= 2;
+    const bool upper = (new_rank & d) != 0;
+    const int keep_lo = upper ? lo + count : lo;
+    Tensor send_val = ChunkRange(upper ? lo : lo + count, count);
+    Tensor keep_val = ChunkRange(keep_lo, count);
+    Tensor recv_val = scratch.Slice(
+        scratch_offset, scratch_offset + keep_val.NumElements());
+    scratch_offset += count * chunk_elts_;
+    TF_RETURN_IF_ERROR(SendRecv(strings::StrCat("rs", d),
+                                peer_idx(new_rank ^ d), &send_val, &recv_val));
+    if (keep_val.NumElements() > 0) {
+      TF_RETURN_IF_ERROR(
+          ComputeBinOp(col_params_->merge_op.get(), &keep_val, &recv_val));
+    }
+    lo = keep_lo;
+  }
+
+  Tensor final_val = ChunkRange(new_rank, 1);
+  if (col_params_->final_op && final_val.NumElements() > 0) {
+    TF_RETURN_IF_ERROR(ComputeBinOp(col_params_->final_op.get(), &final_val,
+                                    &group_size_tensor_));
+  }
+
+  // All-gather: double the range of chunks we hold at each step, by
+  // exchanging it with the adjacent range of the same size.
+  count = 1;
+  lo = new_rank;
+  for (int d = 1; d < p2; d *= 2) {
+    const int peer_lo = (new_rank & d) ? lo - count : lo + count;
+    Tensor send_val = ChunkRange(lo, count);
+    Tensor recv_val = ChunkRange(peer_lo, count);
+    TF_RETURN_IF_ERROR(SendRecv(strings::StrCat("ag", d),
+                                peer_idx(new_rank ^ d), &send_val, &recv_val));
+    lo = std::min(lo, peer_lo);
+    count *= 2;
+  }
+
+  if (rank < 2 * rem) {
+    return SendRecv("unfold", participants[rank + 1], &value, nullptr);
+  }
+  return Status::OK();
+}
+
+StatusCallback RecursiveHalvingReducer::TransferDone(
+    BlockingCounter* pending) {
+  return [this, pending](const Status& s) {
+    if (!s.ok()) {
+      StartAbort(s);
+    }
+    pending->DecrementCount();
+  };
+}
+
+Status RecursiveHalvingReducer::SendRecv(const string& phase, int peer_dev_idx,
+                                         Tensor* send_val, Tensor* recv_val) {
+  // Both ends agree on the sizes, so empty values aren't transferred at all.
+  const bool do_send = send_val && send_val->NumElements() > 0;
+  const bool do_recv = recv_val && recv_val->NumElements() > 0;
+  BlockingCounter pending((do_send ? 1 : 0) + (do_recv ? 1 : 0));
+  if (do_send) {
+    DispatchSend(phase, peer_dev_idx, send_val, TransferDone(&pending));
+  }
+  if (do_recv) {
+    DispatchRecv(phase, peer_dev_idx, recv_val, TransferDone(&pending));
+  }
+  pending.Wait();
+  return status();
+}
+
+void RecursiveHalvingReducer::DispatchSend(const string& phase,
+                                           int peer_dev_idx, Tensor* val,
+                                           const StatusCallback& done) {
+  string send_buf_key = RecursiveHalvingBufKey(
+      col_ctx_->exec_key, phase, col_params_->default_rank, peer_dev_idx);
+  VLOG(3) << "DispatchSend rank=" << col_params_->default_rank << " send key "
+          << send_buf_key << " chunk " << ca_->TBounds(*val);
+  col_ctx_->col_exec->PostToPeer(
+      col_params_->instance.device_names[peer_dev_idx],
+      col_params_->instance.task_names[peer_dev_idx], send_buf_key,
+      col_ctx_->device, col_ctx_->op_ctx->op_device_context(),
+      col_ctx_->op_ctx->output_alloc_attr(0), val, col_ctx_->device_locality,
+      done);
+}
+
+void RecursiveHalvingReducer::DispatchRecv(const string& phase,
+                                           int peer_dev_idx, Tensor* val,
+                                           const StatusCallback& done) {
+  string recv_buf_key = RecursiveHalvingBufKey(
+      col_ctx_->exec_key, phase, peer_dev_idx, col_params_->default_rank);
+  VLOG(3) << "DispatchRecv rank=" << col_params_->default_rank << " recv key "
+          << recv_buf_key << " chunk " << ca_->TBounds(*val);
+  col_ctx_->col_exec->RecvFromPeer(
+      col_params_->instance.device_names[peer_dev_idx],
+      col_params_->instance.task_names[peer_dev_idx],
+      col_params_->task.is_local[peer_dev_idx], recv_buf_key, col_ctx_->device,
+      col_ctx_->op_ctx->op_device_context(),
+      col_ctx_->op_ctx->output_alloc_attr(0), val, col_ctx_->device_locality,
+      0 /*dev_to_dev_stream_index*/, done);
+}
+
+namespace {
+class HierarchicalReducer : public RecursiveHalvingReducer {
+ public:
+  HierarchicalReducer() : RecursiveHalvingReducer(true) {}
+};
+}  // namespace
+
+REGISTER_COLLECTIVE(RecursiveHalvingReduce, RecursiveHalvingReducer);
+REGISTER_COLLECTIVE(HierarchicalReduce, HierarchicalReducer);
+
+}  // namespace tensorflow
@@ -0,0 +1,92 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_RECURSIVE_HALVING_REDUCER_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_RECURSIVE_HALVING_REDUCER_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/base_reducer.h"
+#include "tensorflow/core/framework/collective.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
+
+namespace tensorflow {
+class Device;
+
+// Recursive halving/doubling implementation of collective all-reduce.
+//
+// The participants first reduce-scatter the tensor by exchanging halves of
+// their current range with the participant whose rank differs in one bit,
+// then all-gather it by doing the same steps in reverse.  Every participant
+// sends and receives 2 * (n - 1) / n of the tensor, like in a ring, but in
+// 2 * log2(n) steps instead of 2 * (n - 1), which makes it the better choice
+// for small tensors.  When the number of participants is not a power of 2,
+// the extra participants first fold their value into a neighbor and receive
+// the result from it at the end.
+//
+// In hierarchical mode, registered as "HierarchicalReduce", only the first
+// device of each task takes part in the exchange above.  The other devices
+// of the task send their value to it beforehand and receive the result from
+// it afterwards, so that the bulk of the traffic stays within the task.
+class RecursiveHalvingReducer : public BaseReducer {
+ public:
+  RecursiveHalvingReducer() : RecursiveHalvingReducer(false) {}
+  ~RecursiveHalvingReducer() override;
+
+  // Checks that devices of the same task are adjacent in the device order,
+  // which hierarchical mode depends upon.
+  Status InitializeCollectiveParams(CollectiveParams* col_params) override;
+
+  // Begins execution of the reduction.  Must be called in a blockable thread.
+  void Run(StatusCallback done) override;
+
+ protected:
+  explicit RecursiveHalvingReducer(bool hierarchical);
+
+ private:
+  // Returns the device indices of the participants of the halving/doubling
+  // exchange, in rank order.
+  std::vector<int> ExchangeParticipants() const;
+
+  // Runs the whole algorithm on the value held by ca_.
+  Status RunReduction();
+  // Runs the halving/doubling exchange among `participants`, of which this
+  // device is the one at index `rank`.
+  Status RunExchange(const std::vector<int>& participants, int rank);
+
+  // Returns an alias of the elements of the chunks [first, first + count).
+  Tensor ChunkRange(int first, int count) const;
+  // Allocates a tensor of `num_elements` on this device.
+  Tensor TempTensor(int64 num_elements) const;
+
+  // Sends `send_val` to and receives `recv_val` from the device at index
+  // `peer_dev_idx`, concurrently, and waits for both.  Either may be null.
+  Status SendRecv(const string& phase, int peer_dev_idx, Tensor* send_val,
+                  Tensor* recv_val);
+  // Returns a callback for a transfer that is waited for with `pending`.
+  StatusCallback TransferDone(BlockingCounter* pending);
+  void DispatchSend(const string& phase, int peer_dev_idx, Tensor* val,
+                    const StatusCallback& done);
+  void DispatchRecv(const string& phase, int peer_dev_idx, Tensor* val,
+                    const StatusCallback& done);
+
+  const bool hierarchical_;
+  int64 num_chunks_;
+  int64 chunk_elts_;
+};
+
+}  // namespace tensorflow
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_RECURSIVE_HALVING_REDUCER_H_
@@ -0,0 +1,108 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/recursive_halving_reducer.h"
+
+#include <algorithm>
+#include "tensorflow/core/common_runtime/reducer_test_util.h"
+#include "tensorflow/core/framework/collective.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+
+class RecursiveHalvingReducerTest : public ReducerTest {
+ protected:
+  void InitImplDetails(int num_workers, int num_devices) override {
+    col_params_.instance.impl_details.collective_name =
+        hierarchical_ ? "HierarchicalReduce" : "RecursiveHalvingReduce";
+  }
+
+  bool hierarchical_ = false;
+};
+
+TEST_F(RecursiveHalvingReducerTest, InitializeParams) {
+  CollectiveParams cp;
+  cp.group.group_size = 4;
+  cp.group.num_tasks = 2;
+  cp.instance.type = REDUCTION_COLLECTIVE;
+  cp.instance.impl_details.collective_name = "RecursiveHalvingReduce";
+  for (int i = 0; i < 4; ++i) {
+    string task_name = strings::StrCat("/job:worker/replica:0/task:", i / 2);
+    cp.instance.task_names.push_back(task_name);
+    cp.instance.device_names.push_back(
+        strings::StrCat(task_name, "/device:CPU:", i % 2));
+  }
+  RecursiveHalvingReducer reducer;
+  TF_EXPECT_OK(reducer.InitializeCollectiveParams(&cp));
+
+  // Devices of the same task have to be adjacent.
+  std::swap(cp.instance.task_names[1], cp.instance.task_names[2]);
+  std::swap(cp.instance.device_names[1], cp.instance.device_names[2]);
+  EXPECT_FALSE(reducer.InitializeCollectiveParams(&cp).ok());
+}
+
+// The H argument selects HierarchicalReduce over RecursiveHalvingReduce.
+#define DEF_TEST(B, T, H, W, D, L, A)                                         \
+  TEST_F(RecursiveHalvingReducerTest,                                         \
+         DaTy##B##_DevTy##T##_Hier##H##_Wkr##W##_Dev##D##_Len##L##_Abrt##A) { \
+    hierarchical_ = H;                                                        \
+    RunTest(DT_##B, DEVICE_##T, W, D, L, A);                                  \
+  }
+
+#ifndef GOOGLE_CUDA
+// Success tests
+DEF_TEST(FLOAT, CPU, 0, 1, 2, 1, 0)
+DEF_TEST(FLOAT, CPU, 0, 1, 2, 1001, 0)
+DEF_TEST(FLOAT, CPU, 0, 1, 3, 16, 0)
+DEF_TEST(FLOAT, CPU, 0, 2, 4, 128, 0)
+DEF_TEST(FLOAT, CPU, 0, 3, 4, 1001, 0)
+DEF_TEST(FLOAT, CPU, 0, 2, 8, 4095, 0)
+DEF_TEST(FLOAT, CPU, 0, 7, 1, 9408, 0)
+DEF_TEST(DOUBLE, CPU, 0, 3, 2, 1001, 0)
+DEF_TEST(INT32, CPU, 0, 3, 2, 1001, 0)
+DEF_TEST(INT64, CPU, 0, 3, 2, 1001, 0)
+DEF_TEST(FLOAT, CPU, 1, 1, 4, 1001, 0)
+DEF_TEST(FLOAT, CPU, 1, 2, 4, 1, 0)
+DEF_TEST(FLOAT, CPU, 1, 2, 4, 4096, 0)
+DEF_TEST(FLOAT, CPU, 1, 3, 2, 1001, 0)
+DEF_TEST(FLOAT, CPU, 1, 5, 3, 4095, 0)
+DEF_TEST(DOUBLE, CPU, 1, 3, 2, 1001, 0)
+DEF_TEST(INT64, CPU, 1, 3, 2, 1001, 0)
+
+// Failure tests
+DEF_TEST(FLOAT, CPU, 0, 2, 4, 9408, 1)
+DEF_TEST(FLOAT, CPU, 0, 3, 2, 9408, 7)
+DEF_TEST(FLOAT, CPU, 1, 2, 4, 9408, 1)
+DEF_TEST(FLOAT, CPU, 1, 3, 2, 9408, 5)
+#endif
+
+#ifdef GOOGLE_CUDA
+// GPU tests.  So long as the device names are all in a single tasks we
+// bypass inter-worker routing code and can fake multiple GPUs with a single
+// GPU, from the perspective of the reduction logic.  So these tests
+// are all single-worker.
+DEF_TEST(FLOAT, GPU, 0, 1, 2, 1, 0)
+DEF_TEST(FLOAT, GPU, 0, 1, 3, 1001, 0)
+DEF_TEST(FLOAT, GPU, 0, 1, 8, 4096, 0)
+DEF_TEST(DOUBLE, GPU, 0, 1, 2, 1001, 0)
+DEF_TEST(INT64, GPU, 0, 1, 2, 1001, 0)
+DEF_TEST(FLOAT, GPU, 1, 1, 4, 1001, 0)
+
+// Failure tests
+DEF_TEST(FLOAT, GPU, 0, 1, 8, 9408, 2)
+#endif
+
+}  // namespace tensorflow
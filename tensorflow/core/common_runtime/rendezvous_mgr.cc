@@ -31,14 +31,45 @@ limitations under the License.
 
 namespace tensorflow {
 
-IntraProcessRendezvous::IntraProcessRendezvous(const DeviceMgr* device_mgr)
-    : device_mgr_(device_mgr), local_(NewLocalRendezvous()) {}
+IntraProcessRendezvous::SlotItem::~SlotItem() {
+  if (send_args.device_context) {
+    send_args.device_context->Unref();
+  }
+  if (recv_args.device_context) {
+    recv_args.device_context->Unref();
+  }
+}
+
+IntraProcessRendezvous::IntraProcessRendezvous(const DeviceMgr* device_mgr,
+                                               int num_slots)
+    : device_mgr_(device_mgr),
+      local_(NewLocalRendezvous()),
+      num_slots_(num_slots),
+      slots_(new std::atomic<SlotItem*>[num_slots]) {
+  for (int i = 0; i < num_slots_; ++i) {
+    slots_[i].store(nullptr, std::memory_order_relaxed);
+  }
+}
 
-IntraProcessRendezvous::~IntraProcessRendezvous() { local_->Unref(); }
+IntraProcessRendezvous::~IntraProcessRendezvous() {
+  local_->Unref();
+  for (int i = 0; i < num_slots_; ++i) {
+    SlotItem* item = slots_[i].load(std::memory_order_acquire);
+    if (item == nullptr || item == &aborted_) continue;
+    if (item->waiter) {
+      item->waiter(errors::Cancelled("IntraProcessRendezvous deleted"),
+                   Args(), item->recv_args, Tensor(), false);
+    }
+    delete item;
+  }
+}
 
 Status IntraProcessRendezvous::Send(const ParsedKey& parsed,
                                     const Rendezvous::Args& args,
                                     const Tensor& val, const bool is_dead) {
+  if (parsed.slot >= 0 && parsed.slot < num_slots_) {
+    return SendToSlot(parsed, args, val, is_dead);
+  }
   VLOG(1) << "IntraProcessRendezvous Send " << this << " " << parsed.FullKey();
   {
     mutex_lock l(mu_);
@@ -113,9 +144,41 @@ void IntraProcessRendezvous::SameWorkerRecvDone(
                      0 /*dev_to_dev_stream_index*/, std::move(done));
 }
 
+void IntraProcessRendezvous::RecvDone(const Status& status,
+                                      const Rendezvous::ParsedKey& parsed,
+                                      const Rendezvous::Args& send_args,
+                                      const Rendezvous::Args& recv_args,
+                                      const Tensor& in, bool is_dead,
+                                      DoneCallback done) {
+  // If "in" is an uninitialized tensor, do copy-construction to
+  // preserve the uninitialized state, along with data type and shape
+  // info, which is useful for debugger purposes.
+  Tensor* out = in.IsInitialized() ? new Tensor : new Tensor(in);
+
+  auto final_callback = std::bind(
+      [send_args, recv_args, out, is_dead](DoneCallback done,
+                                           // Begin unbound arguments.
+                                           const Status& s) {
+        done(s, send_args, recv_args, *out, is_dead);
+        delete out;
+      },
+      std::move(done), std::placeholders::_1);
+
+  if (status.ok() && in.IsInitialized()) {
+    SameWorkerRecvDone(parsed, send_args, recv_args, in, out,
+                       std::move(final_callback));
+  } else {
+    final_callback(status);
+  }
+}
+
 void IntraProcessRendezvous::RecvAsync(const ParsedKey& parsed,
                                        const Rendezvous::Args& recv_args,
                                        DoneCallback done) {
+  if (parsed.slot >= 0 && parsed.slot < num_slots_) {
+    RecvFromSlotAsync(parsed, recv_args, std::move(done));
+    return;
+  }
   VLOG(1) << "IntraProcessRendezvous Recv " << this << " " << parsed.FullKey();
 
   // Recv the tensor from local_.
@@ -128,34 +191,140 @@ void IntraProcessRendezvous::RecvAsync(const ParsedKey& parsed,
                          const Rendezvous::Args& send_args,
                          const Rendezvous::Args& recv_args, const Tensor& in,
                          bool is_dead) {
-            // If "in" is an uninitialized tensor, do copy-construction to
-            // preserve the uninitialized state, along with data type and shape
-            // info, which is useful for debugger purposes.
-            Tensor* out = in.IsInitialized() ? new Tensor : new Tensor(in);
-
-            auto final_callback = std::bind(
-                [send_args, recv_args, out, is_dead](DoneCallback done,
-                                                     // Begin unbound arguments.
-                                                     const Status& s) {
-                  done(s, send_args, recv_args, *out, is_dead);
-                  delete out;
-                },
-                std::move(done), std::placeholders::_1);
-
-            if (status.ok() && in.IsInitialized()) {
-              SameWorkerRecvDone(parsed, send_args, recv_args, in, out,
-                                 std::move(final_callback));
-            } else {
-              final_callback(status);
-            }
+            RecvDone(status, parsed, send_args, recv_args, in, is_dead,
+                     std::move(done));
           },
           std::move(done), std::placeholders::_1, std::placeholders::_2,
           std::placeholders::_3, std::placeholders::_4, std::placeholders::_5));
 }
 
+Status IntraProcessRendezvous::AbortStatus() {
+  mutex_lock l(mu_);
+  return status_;
+}
+
+bool IntraProcessRendezvous::TakeFromSlot(std::atomic<SlotItem*>* slot,
+                                          SlotItem* item) {
+  // Only StartAbort() can replace an item that another call put in the
+  // slot, in which case it takes ownership of the item.
+  return item != &aborted_ &&
+         slot->compare_exchange_strong(item, nullptr,
+                                       std::memory_order_acq_rel);
+}
+
+Status IntraProcessRendezvous::SendToSlot(const ParsedKey& parsed,
+                                          const Rendezvous::Args& args,
+                                          const Tensor& val,
+                                          const bool is_dead) {
+  std::atomic<SlotItem*>* slot = &slots_[parsed.slot];
+  SlotItem* current = slot->load(std::memory_order_acquire);
+  if (current == nullptr) {
+    // There is no waiter yet. Leave the value in the slot for the Recv to
+    // pick up.
+    SlotItem* item = new SlotItem;
+    item->value = val;
+    item->is_dead = is_dead;
+    item->send_args = args;
+    if (item->send_args.device_context) {
+      item->send_args.device_context->Ref();
+    }
+    if (slot->compare_exchange_strong(current, item,
+                                      std::memory_order_acq_rel)) {
+      return Status::OK();
+    }
+    // The Recv or StartAbort() got there first.
+    delete item;
+  }
+  if (!TakeFromSlot(slot, current)) {
+    return AbortStatus();
+  }
+  std::unique_ptr<SlotItem> waiter(current);
+  if (!waiter->waiter) {
+    ReturnToSlot(slot, std::move(waiter));
+    return errors::Internal("Duplicate send of ", parsed.FullKey(),
+                            " to rendezvous slot ", parsed.slot);
+  }
+  RecvDone(Status::OK(), waiter->recv_key, args, waiter->recv_args, val,
+           is_dead, std::move(waiter->waiter));
+  return Status::OK();
+}
+
+void IntraProcessRendezvous::ReturnToSlot(std::atomic<SlotItem*>* slot,
+                                          std::unique_ptr<SlotItem> sent) {
+  SlotItem* current = nullptr;
+  while (!slot->compare_exchange_strong(current, sent.get(),
+                                        std::memory_order_acq_rel)) {
+    if (!TakeFromSlot(slot, current)) {
+      // The slot was aborted, so the value is no longer needed.
+      return;
+    }
+    std::unique_ptr<SlotItem> taken(current);
+    if (taken->waiter) {
+      // The Recv arrived in the meantime.
+      RecvDone(Status::OK(), taken->recv_key, sent->send_args,
+               taken->recv_args, sent->value, sent->is_dead,
+               std::move(taken->waiter));
+      return;
+    }
+    // Another duplicate Send got in, whose value is dropped.
+    current = nullptr;
+  }
+  sent.release();
+}
+
+void IntraProcessRendezvous::RecvFromSlotAsync(
+    const ParsedKey& parsed, const Rendezvous::Args& recv_args,
+    DoneCallback done) {
+  std::atomic<SlotItem*>* slot = &slots_[parsed.slot];
+  SlotItem* current = slot->load(std::memory_order_acquire);
+  if (current == nullptr) {
+    // The value has not been sent yet. Wait for it in the slot.
+    SlotItem* item = new SlotItem;
+    item->waiter = std::move(done);
+    item->recv_key = parsed;
+    item->recv_args = recv_args;
+    if (item->recv_args.device_context) {
+      item->recv_args.device_context->Ref();
+    }
+    if (slot->compare_exchange_strong(current, item,
+                                      std::memory_order_acq_rel)) {
+      return;
+    }
+    // The Send or StartAbort() got there first.
+    done = std::move(item->waiter);
+    delete item;
+  }
+  if (!TakeFromSlot(slot, current)) {
+    done(AbortStatus(), Args(), recv_args, Tensor(), false);
+    return;
+  }
+  std::unique_ptr<SlotItem> sent(current);
+  if (sent->waiter) {
+    Status s = errors::Internal("Duplicate recv of ", parsed.FullKey(),
+                                " from rendezvous slot ", parsed.slot);
+    sent->waiter(s, Args(), sent->recv_args, Tensor(), false);
+    done(s, Args(), recv_args, Tensor(), false);
+    return;
+  }
+  RecvDone(Status::OK(), parsed, sent->send_args, recv_args, sent->value,
+           sent->is_dead, std::move(done));
+}
+
 void IntraProcessRendezvous::StartAbort(const Status& s) {
   CHECK(!s.ok());
+  {
+    mutex_lock l(mu_);
+    status_.Update(s);
+  }
   local_->StartAbort(s);
+  for (int i = 0; i < num_slots_; ++i) {
+    SlotItem* item = slots_[i].exchange(&aborted_, std::memory_order_acq_rel);
+    if (item == nullptr || item == &aborted_) continue;
+    if (item->waiter) {
+      item->waiter(s, Args(), item->recv_args, Tensor(), false);
+    }
+    delete item;
+  }
 }
 
 }  // end namespace tensorflow
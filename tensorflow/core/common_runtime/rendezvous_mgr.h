@@ -16,6 +16,8 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_COMMON_RUNTIME_RENDEZVOUS_MGR_H_
 #define TENSORFLOW_CORE_COMMON_RUNTIME_RENDEZVOUS_MGR_H_
 
+#include <atomic>
+#include <memory>
 #include <string>
 #include <unordered_map>
 
@@ -37,9 +39,15 @@ namespace tensorflow {
 // Buffering of Tensor values is delegated to a "local" Rendezvous
 // obtained from NewLocalRendezvous().  This class just adds
 // functionality to coordinate multiple process-local devices.
+//
+// Keys whose slot (see Rendezvous::ParsedKey::slot) is less than
+// "num_slots" bypass the local Rendezvous: the Send and the Recv of such
+// a key meet in a per-slot atomic handoff, without hashing the key or
+// taking a lock.
 class IntraProcessRendezvous : public Rendezvous {
  public:
-  explicit IntraProcessRendezvous(const DeviceMgr* device_mgr);
+  explicit IntraProcessRendezvous(const DeviceMgr* device_mgr,
+                                  int num_slots = 0);
 
   // Forwards to local_, where the Tensor "val" will be buffered and
   // any waiting callback stored.
@@ -64,8 +72,54 @@ class IntraProcessRendezvous : public Rendezvous {
   // Status given by StartAbort() if any.
   Status status_ GUARDED_BY(mu_);
 
+  // A value sent to a slot, or a Recv waiting on a slot.
+  struct SlotItem {
+    // Set iff this item is a waiting Recv.
+    DoneCallback waiter = nullptr;
+    // The key of the waiting Recv.
+    ParsedKey recv_key;
+    Tensor value;
+    bool is_dead = false;
+    Args send_args;
+    Args recv_args;
+
+    ~SlotItem();
+  };
+
+  // Each slot holds nullptr, the first of the Send or the Recv of its key
+  // to arrive, or &aborted_ once StartAbort() was called.
+  const int num_slots_;
+  std::unique_ptr<std::atomic<SlotItem*>[]> slots_;
+  SlotItem aborted_;
+
   ~IntraProcessRendezvous() override;
 
+  Status SendToSlot(const ParsedKey& parsed, const Rendezvous::Args& args,
+                    const Tensor& val, const bool is_dead);
+  void RecvFromSlotAsync(const ParsedKey& parsed,
+                         const Rendezvous::Args& recv_args,
+                         DoneCallback done);
+
+  // Removes `item`, which the caller found in `slot`, from it. Returns
+  // false if the slot was aborted in the meantime.
+  bool TakeFromSlot(std::atomic<SlotItem*>* slot, SlotItem* item);
+
+  // Puts `sent`, a value that a duplicate Send took from `slot`, back for
+  // the Recv of its key, or passes it to that Recv if it is already waiting.
+  void ReturnToSlot(std::atomic<SlotItem*>* slot,
+                    std::unique_ptr<SlotItem> sent);
+
+  // Returns the status given by StartAbort().
+  Status AbortStatus();
+
+  // Completes the Recv of "in" sent under the key "parsed", copying it to
+  // the device of the receiver if needed, then calls "done". If
+  // "status" is not OK, only passes it to "done".
+  void RecvDone(const Status& status, const Rendezvous::ParsedKey& parsed,
+                const Rendezvous::Args& send_args,
+                const Rendezvous::Args& recv_args, const Tensor& in,
+                bool is_dead, DoneCallback done);
+
   // Parses "key" into "parsed". If "is_src" is true, checks that the
   // rendezvous key's source is in this process. If "is_src" is false,
   // checks that the rendezvous key's destination is in this process.
@@ -0,0 +1,220 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/rendezvous_mgr.h"
+
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/notification.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+constexpr int kNumSlots = 4;
+
+// Returns the parsed key of the tensor "name" sent between two CPU devices in
+// "frame_iter", with the given slot.
+Rendezvous::ParsedKey MakeKey(const string& name, int slot,
+                              const FrameAndIter& frame_iter = {0, 0}) {
+  const string key = Rendezvous::CreateKey(
+      "/job:localhost/replica:0/task:0/device:CPU:0", 1,
+      "/job:localhost/replica:0/task:0/device:CPU:1", name, frame_iter);
+  Rendezvous::ParsedKey parsed;
+  TF_CHECK_OK(Rendezvous::ParseKey(key, &parsed));
+  parsed.slot = slot;
+  return parsed;
+}
+
+Tensor V(const string& content) {
+  Tensor tensor(DT_STRING, TensorShape({}));
+  tensor.scalar<string>()() = content;
+  return tensor;
+}
+
+string V(const Tensor& tensor) {
+  CHECK_EQ(tensor.dtype(), DT_STRING);
+  CHECK(TensorShapeUtils::IsScalar(tensor.shape()));
+  return tensor.scalar<string>()();
+}
+
+// The result of a RecvAsync.
+struct RecvResult {
+  Notification done;
+  Status status;
+  Tensor value;
+  bool is_dead = false;
+};
+
+void RecvAsync(Rendezvous* rendez, const Rendezvous::ParsedKey& key,
+               RecvResult* result) {
+  rendez->RecvAsync(key, Rendezvous::Args(),
+                    [result](const Status& s, const Rendezvous::Args&,
+                             const Rendezvous::Args&, const Tensor& v,
+                             bool is_dead) {
+                      result->status = s;
+                      result->value = v;
+                      result->is_dead = is_dead;
+                      result->done.Notify();
+                    });
+}
+
+class IntraProcessRendezvousTest : public ::testing::Test {
+ public:
+  IntraProcessRendezvousTest()
+      : rendez_(new IntraProcessRendezvous(nullptr, kNumSlots)) {}
+
+  ~IntraProcessRendezvousTest() override { rendez_->Unref(); }
+
+  IntraProcessRendezvous* rendez_;
+};
+
+TEST_F(IntraProcessRendezvousTest, SlotSendBeforeRecv) {
+  TF_ASSERT_OK(
+      rendez_->Send(MakeKey("a", 0), Rendezvous::Args(), V("hello"), false));
+  TF_ASSERT_OK(
+      rendez_->Send(MakeKey("b", 3), Rendezvous::Args(), V("world"), true));
+
+  Tensor value;
+  bool is_dead = true;
+  TF_ASSERT_OK(
+      rendez_->Recv(MakeKey("a", 0), Rendezvous::Args(), &value, &is_dead));
+  EXPECT_EQ("hello", V(value));
+  EXPECT_FALSE(is_dead);
+  TF_ASSERT_OK(
+      rendez_->Recv(MakeKey("b", 3), Rendezvous::Args(), &value, &is_dead));
+  EXPECT_EQ("world", V(value));
+  EXPECT_TRUE(is_dead);
+}
+
+TEST_F(IntraProcessRendezvousTest, SlotRecvBeforeSend) {
+  RecvResult result;
+  RecvAsync(rendez_, MakeKey("a", 1), &result);
+  EXPECT_FALSE(result.done.HasBeenNotified());
+
+  TF_ASSERT_OK(
+      rendez_->Send(MakeKey("a", 1), Rendezvous::Args(), V("hello"), false));
+  result.done.WaitForNotification();
+  TF_EXPECT_OK(result.status);
+  EXPECT_EQ("hello", V(result.value));
+  EXPECT_FALSE(result.is_dead);
+}
+
+TEST_F(IntraProcessRendezvousTest, SlotRecvBeforeSendConcurrently) {
+  for (int i = 0; i < 100; ++i) {
+    IntraProcessRendezvous* rendez = new IntraProcessRendezvous(nullptr, 1);
+    RecvResult result;
+    std::unique_ptr<Thread> sender(Env::Default()->StartThread(
+        {}, "Sender", [rendez] {
+          TF_EXPECT_OK(rendez->Send(MakeKey("a", 0), Rendezvous::Args(),
+                                    V("hello"), false));
+        }));
+    RecvAsync(rendez, MakeKey("a", 0), &result);
+    result.done.WaitForNotification();
+    TF_EXPECT_OK(result.status);
+    EXPECT_EQ("hello", V(result.value));
+    sender.reset();
+    rendez->Unref();
+  }
+}
+
+TEST_F(IntraProcessRendezvousTest, SlotAbortWithPendingRecv) {
+  RecvResult result;
+  RecvAsync(rendez_, MakeKey("a", 2), &result);
+  EXPECT_FALSE(result.done.HasBeenNotified());
+
+  rendez_->StartAbort(errors::Aborted("Step aborted"));
+  result.done.WaitForNotification();
+  EXPECT_TRUE(errors::IsAborted(result.status));
+
+  // Later calls on the slots fail too.
+  EXPECT_TRUE(errors::IsAborted(
+      rendez_->Send(MakeKey("a", 2), Rendezvous::Args(), V("hello"), false)));
+  RecvResult late_result;
+  RecvAsync(rendez_, MakeKey("b", 0), &late_result);
+  late_result.done.WaitForNotification();
+  EXPECT_TRUE(errors::IsAborted(late_result.status));
+}
+
+TEST_F(IntraProcessRendezvousTest, SlotAbortRacingSend) {
+  for (int i = 0; i < 100; ++i) {
+    IntraProcessRendezvous* rendez = new IntraProcessRendezvous(nullptr, 1);
+    std::unique_ptr<Thread> sender(
+        Env::Default()->StartThread({}, "Sender", [rendez] {
+          const Status s = rendez->Send(MakeKey("a", 0), Rendezvous::Args(),
+                                        V("hello"), false);
+          EXPECT_TRUE(s.ok() || errors::IsAborted(s)) << s;
+        }));
+    rendez->StartAbort(errors::Aborted("Step aborted"));
+    sender.reset();
+
+    // Whether or not the Send got in first, its value was dropped.
+    RecvResult result;
+    RecvAsync(rendez, MakeKey("a", 0), &result);
+    result.done.WaitForNotification();
+    EXPECT_TRUE(errors::IsAborted(result.status));
+    rendez->Unref();
+  }
+}
+
+TEST_F(IntraProcessRendezvousTest, SlotDuplicateSend) {
+  TF_ASSERT_OK(
+      rendez_->Send(MakeKey("a", 0), Rendezvous::Args(), V("first"), false));
+  EXPECT_TRUE(errors::IsInternal(
+      rendez_->Send(MakeKey("a", 0), Rendezvous::Args(), V("second"), false)));
+
+  // The value sent first is kept for the Recv.
+  Tensor value;
+  bool is_dead;
+  TF_ASSERT_OK(
+      rendez_->Recv(MakeKey("a", 0), Rendezvous::Args(), &value, &is_dead));
+  EXPECT_EQ("first", V(value));
+}
+
+TEST_F(IntraProcessRendezvousTest, KeysWithoutSlotUseTable) {
+  // Keys in loops have no slot, and keys with a slot out of range are from
+  // partitions that this rendezvous wasn't sized for.
+  const Rendezvous::ParsedKey loop_key0 = MakeKey("a", -1, {1, 0});
+  const Rendezvous::ParsedKey loop_key1 = MakeKey("a", -1, {1, 1});
+  const Rendezvous::ParsedKey out_of_range_key = MakeKey("b", kNumSlots);
+  TF_ASSERT_OK(
+      rendez_->Send(loop_key0, Rendezvous::Args(), V("iter0"), false));
+  TF_ASSERT_OK(
+      rendez_->Send(loop_key1, Rendezvous::Args(), V("iter1"), false));
+  TF_ASSERT_OK(rendez_->Send(out_of_range_key, Rendezvous::Args(),
+                             V("out_of_range"), false));
+
+  Tensor value;
+  bool is_dead;
+  TF_ASSERT_OK(rendez_->Recv(loop_key1, Rendezvous::Args(), &value, &is_dead));
+  EXPECT_EQ("iter1", V(value));
+  TF_ASSERT_OK(rendez_->Recv(loop_key0, Rendezvous::Args(), &value, &is_dead));
+  EXPECT_EQ("iter0", V(value));
+  TF_ASSERT_OK(
+      rendez_->Recv(out_of_range_key, Rendezvous::Args(), &value, &is_dead));
+  EXPECT_EQ("out_of_range", V(value));
+
+  // Aborting fails pending Recvs on the table as well.
+  RecvResult result;
+  RecvAsync(rendez_, MakeKey("c", -1, {1, 0}), &result);
+  rendez_->StartAbort(errors::Aborted("Step aborted"));
+  result.done.WaitForNotification();
+  EXPECT_TRUE(errors::IsAborted(result.status));
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -19,12 +19,10 @@ limitations under the License.
 #include <functional>
 #include <utility>
 
-#include "tensorflow/core/common_runtime/collective_rma_local.h"
 #include "tensorflow/core/common_runtime/collective_util.h"
 #include "tensorflow/core/common_runtime/copy_tensor.h"
 #include "tensorflow/core/common_runtime/device.h"
 #include "tensorflow/core/common_runtime/device_mgr.h"
-#include "tensorflow/core/common_runtime/dma_helper.h"
 #include "tensorflow/core/common_runtime/process_util.h"
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/device_base.h"
@@ -84,13 +82,9 @@ RingReducer::RingField* RingReducer::PCQueue::Dequeue() {
 }
 
 RingReducer::RingReducer()
-    : col_ctx_(nullptr),
-      col_params_(nullptr),
-      done_(nullptr),
-      group_size_(-1),
-      num_subdivs_(-1) {}
+    : done_(nullptr), group_size_(-1), num_subdivs_(-1) {}
 
-RingReducer::~RingReducer() { group_size_tensor_ready_.WaitForNotification(); }
+RingReducer::~RingReducer() {}
 
 Status RingReducer::InitializeCollectiveParams(CollectiveParams* col_params) {
   CHECK_EQ(col_params->instance.type, REDUCTION_COLLECTIVE);
@@ -174,15 +168,6 @@ Status RingReducer::InitializeCollectiveParams(CollectiveParams* col_params) {
   return Status::OK();
 }
 
-Status RingReducer::InitializeCollectiveContext(CollectiveContext* col_ctx) {
-  CHECK(col_ctx->dev_mgr);
-  col_ctx_ = col_ctx;
-  col_params_ = &col_ctx->col_params;
-  return collective_util::InitializeDeviceAndLocality(
-      col_ctx->dev_mgr, col_ctx->device_name, &col_ctx->device,
-      &col_ctx->device_locality);
-}
-
 void RingReducer::Run(StatusCallback done) {
   CHECK(col_ctx_);
   CHECK(col_params_);
@@ -214,27 +199,10 @@ void RingReducer::Run(StatusCallback done) {
 
   // Start by copying input to output if they're not already the same, i.e. if
   // we're not computing in-place on the input tensor.
-  if ((col_ctx_->input != col_ctx_->output) &&
-      (DMAHelper::base(col_ctx_->input) != DMAHelper::base(col_ctx_->output))) {
-    // We are running in a blockable thread and the callback can't block so
-    // just wait here on the copy.
-    Notification note;
-    Status status;
-    CollectiveRemoteAccessLocal::MemCpyAsync(
-        col_ctx_->op_ctx->input_device_context(0),
-        col_ctx_->op_ctx->op_device_context(), col_ctx_->device,
-        col_ctx_->device, col_ctx_->op_ctx->input_alloc_attr(0),
-        col_ctx_->op_ctx->output_alloc_attr(0), col_ctx_->input,
-        col_ctx_->output, 0 /*dev_to_dev_stream_index*/,
-        [this, &note, &status](const Status& s) {
-          status.Update(s);
-          note.Notify();
-        });
-    note.WaitForNotification();
-    if (!status.ok()) {
-      done_(status);
-      return;
-    }
+  Status s = CopyInputToOutput();
+  if (!s.ok()) {
+    done_(s);
+    return;
   }
   ContinueAfterInputCopy();
 }
@@ -265,102 +233,27 @@ void RingReducer::ContinueAfterInputCopy() {
   ca_.reset(MakeCollectiveAdapter(col_ctx_->output, group_size_ * num_subdivs_,
                                   col_ctx_->device->GetAllocator(attr)));
 
-  if (col_params_->final_op) {
-    // Create an on-device scalar value from group_size_ that may be needed
-    // later.
-    // TODO(tucker): Cache and reuse across invocations? Or maybe the scalar
-    // can be provided to the kernel in host memory?
-    Tensor group_size_val = ca_->Scalar(group_size_);
-    if (col_params_->group.device_type != "CPU") {
-      group_size_tensor_ = ca_->Scalar(col_ctx_->device->GetAllocator(
-          col_ctx_->op_ctx->input_alloc_attr(0)));
-      DeviceContext* op_dev_ctx = col_ctx_->op_ctx->op_device_context();
-      op_dev_ctx->CopyCPUTensorToDevice(&group_size_val, col_ctx_->device,
-                                        &group_size_tensor_,
-                                        [this](const Status& s) {
-                                          if (!s.ok()) {
-                                            StartAbort(s);
-                                          }
-                                          group_size_tensor_ready_.Notify();
-                                        });
-    } else {
-      group_size_tensor_ = group_size_val;
-      group_size_tensor_ready_.Notify();
-    }
-  } else {
-    // Value won't be used, so no need to initialize.
-    group_size_tensor_ready_.Notify();
+  // Create an on-device scalar value from group_size_ that may be needed
+  // later.
+  Status s = PrepareGroupSizeTensor();
+  if (!s.ok()) {
+    StartAbort(s);
+    Finish(false);
+    return;
   }
   Finish(RunAsyncParts());
 }
 
-void RingReducer::StartAbort(const Status& s) {
-  // In abort mode we stop issuing additional ProvideBuf
-  // and ConsumeBuf calls, but we need to wait for all of the
-  // outstanding callbacks to be invoked before quitting.
-  bool abort_started = false;
-  {
-    mutex_lock l(status_mu_);
-    if (status_.ok()) {
-      LOG(ERROR) << "Aborting RingReduce with " << s;
-      abort_started = true;
-      status_.Update(s);
-    }
-  }
-  // If this is the initial entry to abort mode then invoke StartAbort
-  // on the CollectiveExecutor that invoked us.  That should start
-  // cancellation on all of the outstanding CollectiveRemoteAccess
-  // actions.
-  if (abort_started) {
-    col_ctx_->col_exec->StartAbort(s);
-  }
-}
-
 void RingReducer::Finish(bool ok) {
   if (ok) {
     // Recover the output from the adaptor.
     ca_->ConsumeFinalValue(col_ctx_->output);
   }
-  Status s;
-  {
-    mutex_lock l(status_mu_);
-    s = status_;
-  }
+  Status s = status();
   rfv_.clear();  // Give up Refs on output tensor.
   done_(s);
 }
 
-RingReducer::SubContext::SubContext(OpKernelContext* ctx,
-                                    OpKernelContext::Params* params,
-                                    OpKernel* op, Tensor* output, Tensor* input)
-    : sub_params_(*params),
-      sub_inputs_({output, input}),
-      sub_input_attr_({ctx->input_alloc_attr(0), ctx->input_alloc_attr(0)}),
-      sub_input_dc_(
-          {ctx->input_device_context(0), ctx->input_device_context(0)}) {
-  sub_params_.op_kernel = op;
-  sub_params_.inputs = &sub_inputs_;
-  sub_params_.input_alloc_attrs = &sub_input_attr_;
-  sub_params_.input_device_contexts = &sub_input_dc_;
-  sub_params_.eigen_gpu_device = nullptr;
-  sub_params_.ensure_eigen_gpu_device();
-  sub_params_.forward_from_array = &forward_from_;
-  sub_ctx_ = new OpKernelContext(&sub_params_, 1);
-}
-
-Status RingReducer::ComputeBinOp(Device* device, OpKernel* op, Tensor* output,
-                                 Tensor* input) {
-  // Prepare an OpKernelContext that is identical to that of the original Op
-  // (i.e. the collective), except for the input output sizes and identities and
-  // the Op itself.
-  // TODO(tucker): Is it possible to cache and reuse these objects?  They're
-  // mostly identical inside one device execution.
-  std::unique_ptr<SubContext> sub_ctx(
-      new SubContext(col_ctx_->op_ctx, col_ctx_->op_params, op, output, input));
-  device->Compute(op, sub_ctx->sub_ctx_);
-  return sub_ctx->sub_ctx_->status();
-}
-
 // At the beginning of the algorithm initialize a RingField struct for
 // every independent field of the tensor.
 void RingReducer::InitRingField(RingField* rf, int chunk_idx, int subdiv_idx,
@@ -505,24 +398,11 @@ bool RingReducer::RunAsyncParts() {
       ready_queue.Enqueue(&rfv_[rf_index]);
     }
   }
-  const DeviceBase::GpuDeviceInfo* gpu_info =
-      col_ctx_->device->tensorflow_gpu_device_info();
-  if (gpu_info) {
-    // Wait for all currently queued events on the CPU compute stream to
-    // complete before proceeding.  The previous InitRingField calls allocated
-    // temp memory buffers that are not guaranteed to be valid (e.g. for RDMA
-    // write) unless we do.
-    Notification note;
-    Status s = gpu_info->default_context->ThenExecute(
-        col_ctx_->device, gpu_info->stream, [&note]() { note.Notify(); });
-    if (s.ok()) {
-      note.WaitForNotification();
-    } else {
-      mutex_lock l(status_mu_);
-      status_ =
-          errors::Internal("Failed to dispatch ThenExecute in RingReducer");
-      return false;
-    }
+  // The previous InitRingField calls allocated temp memory buffers.
+  Status s = WaitForAllocations();
+  if (!s.ok()) {
+    StartAbort(s);
+    return false;
   }
 
   int field_done_count = 0;
@@ -568,9 +448,8 @@ bool RingReducer::RunAsyncParts() {
           --recv_pending_count;
           if (!rf->second_pass) {
             rf->action = RF_REDUCE;
-            Status s =
-                ComputeBinOp(col_ctx_->device, col_params_->merge_op.get(),
-                             &rf->chunk, &rf->tmp_chunk);
+            Status s = ComputeBinOp(col_params_->merge_op.get(), &rf->chunk,
+                                    &rf->tmp_chunk);
             if (!s.ok()) {
               aborted = true;
               StartAbort(s);
@@ -582,10 +461,8 @@ bool RingReducer::RunAsyncParts() {
         case RF_REDUCE:
           if (!rf->second_pass && col_params_->final_op.get() && rf->is_final) {
             rf->action = RF_FINALIZE;
-            group_size_tensor_ready_.WaitForNotification();
-            Status s =
-                ComputeBinOp(col_ctx_->device, col_params_->final_op.get(),
-                             &rf->chunk, &group_size_tensor_);
+            Status s = ComputeBinOp(col_params_->final_op.get(), &rf->chunk,
+                                    &group_size_tensor_);
             if (!s.ok()) {
               aborted = true;
               StartAbort(s);
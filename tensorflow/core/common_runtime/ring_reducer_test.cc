@@ -15,198 +15,24 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/ring_reducer.h"
 
 #include <algorithm>
-#include "tensorflow/core/common_runtime/base_collective_executor.h"
-#include "tensorflow/core/common_runtime/collective_rma_local.h"
-#include "tensorflow/core/common_runtime/device.h"
-#include "tensorflow/core/common_runtime/device_mgr.h"
-#include "tensorflow/core/common_runtime/device_resolver_local.h"
-#include "tensorflow/core/common_runtime/dma_helper.h"
-#include "tensorflow/core/common_runtime/process_util.h"
-#include "tensorflow/core/common_runtime/test_collective_executor_mgr.h"
-#include "tensorflow/core/common_runtime/threadpool_device.h"
+#include "tensorflow/core/common_runtime/reducer_test_util.h"
 #include "tensorflow/core/framework/collective.h"
-#include "tensorflow/core/framework/fake_input.h"
-#include "tensorflow/core/framework/node_def.pb.h"
-#include "tensorflow/core/framework/node_def_builder.h"
-#include "tensorflow/core/framework/op_kernel.h"
-#include "tensorflow/core/framework/tensor.h"
-#include "tensorflow/core/lib/core/notification.h"
-#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/test.h"
-#include "tensorflow/core/public/session_options.h"
-#include "tensorflow/core/public/version.h"
 
 namespace tensorflow {
 
-// Wraps CollectiveRemoteAccessLocal with the ability to return an
-// error status to the N'th action.
-class FailTestRMA : public CollectiveRemoteAccessLocal {
- public:
-  FailTestRMA(const DeviceMgr* dev_mgr, DeviceResolverInterface* dev_resolver,
-              int64 step_id, int fail_after)
-      : CollectiveRemoteAccessLocal(dev_mgr, dev_resolver, step_id),
-        fail_after_(fail_after) {}
-
-  bool MaybeFail(const StatusCallback& done) {
-    bool fail_now = false;
-    {
-      mutex_lock l(mu_);
-      if (fail_after_ > 0) {
-        fail_now = (--fail_after_ == 0);
-      }
-    }
-    if (fail_now) {
-      done(errors::Internal("Deliberate failure"));
-      return true;
-    }
-    return false;
-  }
-
-  void RecvFromPeer(const string& peer_device, const string& peer_task,
-                    bool peer_is_local, const string& key, Device* to_device,
-                    DeviceContext* to_device_ctx,
-                    const AllocatorAttributes& to_alloc_attr, Tensor* to_tensor,
-                    const DeviceLocality& client_locality,
-                    int dev_to_dev_stream_index,
-                    const StatusCallback& done) override {
-    if (MaybeFail(done)) return;
-    CollectiveRemoteAccessLocal::RecvFromPeer(
-        peer_device, peer_task, peer_is_local, key, to_device, to_device_ctx,
-        to_alloc_attr, to_tensor, client_locality, dev_to_dev_stream_index,
-        done);
-  }
-
-  void PostToPeer(const string& peer_device, const string& peer_task,
-                  const string& key, Device* from_device,
-                  DeviceContext* from_device_ctx,
-                  const AllocatorAttributes& from_alloc_attr,
-                  const Tensor* from_tensor,
-                  const DeviceLocality& client_locality,
-                  const StatusCallback& done) override {
-    if (MaybeFail(done)) return;
-    CollectiveRemoteAccessLocal::PostToPeer(
-        peer_device, peer_task, key, from_device, from_device_ctx,
-        from_alloc_attr, from_tensor, client_locality, done);
-  }
-
-  mutex mu_;
-  int fail_after_ GUARDED_BY(mu_);
-};
-
-std::unique_ptr<OpKernel> GetKernel(const NodeDef& node,
-                                    const DeviceType& device_type,
-                                    DeviceBase* device) {
-  Status status;
-  std::unique_ptr<OpKernel> k = CreateOpKernel(
-      device_type, device, device->GetAllocator(AllocatorAttributes()), node,
-      TF_GRAPH_DEF_VERSION, &status);
-  if (!status.ok()) {
-    LOG(FATAL) << status;
-  }
-  return k;
-}
-
-std::unique_ptr<OpKernel> GetAdd(DataType dtype, const DeviceType& device_type,
-                                 DeviceBase* device) {
-  NodeDef node_def;
-  NodeDefBuilder builder("add_node", "Add");
-  TF_CHECK_OK(builder.Attr("T", dtype)
-                  .Input(FakeInput(dtype))
-                  .Input(FakeInput(dtype))
-                  .Finalize(&node_def));
-  return GetKernel(node_def, device_type, device);
-}
-
-std::unique_ptr<OpKernel> GetDiv(DataType dtype, const DeviceType& device_type,
-                                 DeviceBase* device) {
-  NodeDef node_def;
-  NodeDefBuilder builder("add_node", "Div");
-  TF_CHECK_OK(builder.Attr("T", dtype)
-                  .Input(FakeInput(dtype))
-                  .Input(FakeInput(dtype))
-                  .Finalize(&node_def));
-  return GetKernel(node_def, device_type, device);
-}
-
-static int64 kStepId = 123;
-
-class RingReducerTest : public ::testing::Test {
+class RingReducerTest : public ReducerTest {
  protected:
-  RingReducerTest() : device_type_(DEVICE_CPU) {}
+  RingReducerTest() : num_subdivs_(1) {}
 
-#ifdef GOOGLE_CUDA
-  void InitGPUDevices() {
-    auto device_factory = DeviceFactory::GetFactory("GPU");
-    CHECK(device_factory);
-    SessionOptions options;
-    Status s = device_factory->CreateDevices(
-        options, "/job:worker/replica:0/task:0", &gpu_devices_);
-    CHECK(s.ok());
-  }
-#endif
-
-  ~RingReducerTest() override {
-    stop_ = true;
-    for (auto i : instances_) delete i;
-    if (col_exec_) col_exec_->Unref();
-  }
-
-  void Init(int num_workers, int num_devices, DataType dtype,
-            const DeviceType& device_type, int num_subdivs, int fail_after) {
-#ifdef GOOGLE_CUDA
-    InitGPUDevices();
-#endif
-    device_type_ = device_type;
-    std::vector<Device*> local_devices;
-    SessionOptions sess_opts;
-    sess_opts.env = Env::Default();
-    Bytes mem_limit(4 << 20);
-    DeviceLocality dev_locality;
-    for (int wi = 0; wi < num_workers; ++wi) {
-      for (int di = 0; di < num_devices; ++di) {
-        if (device_type == DEVICE_CPU) {
-          string dev_name =
-              strings::StrCat("/job:worker/replica:0/task:", wi, "/cpu:", di);
-          local_devices.push_back(new ThreadPoolDevice(
-              sess_opts, dev_name, mem_limit, dev_locality, cpu_allocator()));
-        } else if (device_type == DEVICE_GPU && !gpu_devices_.empty()) {
-          int dev_idx = (wi * num_devices) + di;
-          if (dev_idx >= static_cast<int>(gpu_devices_.size())) {
-            LOG(INFO) << "dev_mgr has access to limited GPUs, reusing for more "
-                         "than one ring node.";
-          } else {
-            local_devices.push_back(gpu_devices_[dev_idx]);
-          }
-        } else {
-          LOG(FATAL) << "Unsupported device_type " << device_type;
-        }
-      }
-    }
-    if (!dev_mgr_ || device_type == DEVICE_CPU) {
-      LOG(ERROR) << "resetting dev_mgr for " << local_devices.size()
-                 << " devices: ";
-      dev_mgr_.reset(new DeviceMgr(local_devices));
-    }
-    dev_resolver_.reset(new DeviceResolverLocal(dev_mgr_.get()));
-    rma_ = new FailTestRMA(dev_mgr_.get(), dev_resolver_.get(), kStepId,
-                           fail_after);
-    col_exec_ = new BaseCollectiveExecutor(&col_exec_mgr_, rma_, kStepId,
-                                           dev_mgr_.get());
-    col_params_.name = "test_collective";
-    static const int kGroupKey = 5;
-    col_params_.group.group_key = kGroupKey;
-    col_params_.group.device_type = device_type;
-    col_params_.group.group_size = num_workers * num_devices;
-    static const int kInstanceKey = 17;
-    col_params_.instance.instance_key = kInstanceKey;
-    col_params_.instance.impl_details.subdiv_offsets.clear();
-    col_params_.instance.type = REDUCTION_COLLECTIVE;
+  void InitImplDetails(int num_workers, int num_devices) override {
     col_params_.instance.impl_details.collective_name = "RingReduce";
-    col_params_.instance.data_type = dtype;
-    col_params_.instance.impl_details.subdiv_permutations.resize(num_subdivs);
-    col_params_.subdiv_rank.resize(num_subdivs);
-    int subdiv_stride = num_devices / num_subdivs;
-    for (int sdi = 0; sdi < num_subdivs; ++sdi) {
+    col_params_.instance.impl_details.subdiv_offsets.clear();
+    col_params_.instance.impl_details.subdiv_permutations.resize(num_subdivs_);
+    col_params_.subdiv_rank.resize(num_subdivs_);
+    int subdiv_stride = num_devices / num_subdivs_;
+    for (int sdi = 0; sdi < num_subdivs_; ++sdi) {
       col_params_.instance.impl_details.subdiv_offsets.push_back(sdi *
                                                                  subdiv_stride);
       col_params_.subdiv_rank[sdi] = sdi * subdiv_stride;
@@ -228,21 +54,9 @@ class RingReducerTest : public ::testing::Test {
     for (auto d : local_ring_order) strings::StrAppend(&lro_buf, d, ", ");
     VLOG(1) << "local_ring_order " << lro_buf;
 
-    // Set up all of the fake device contexts.
     for (int wi = 0; wi < num_workers; ++wi) {
       for (int di = 0; di < num_devices; ++di) {
-        string task_name = strings::StrCat("/job:worker/replica:0/task:", wi);
-        string dev_name = strings::StrCat(task_name, "/cpu:", di);
-        if (device_type == DEVICE_GPU) {
-          dev_name =
-              strings::StrCat(task_name, "/gpu:", di % gpu_devices_.size());
-        }
-        col_params_.instance.device_names.push_back(dev_name);
-        col_params_.instance.task_names.push_back(task_name);
-        // Normally each device would set is_local to its own perspective but
-        // this test runs in a single process so is_local is always true.
-        col_params_.task.is_local.push_back(true);
-        for (int sdi = 0; sdi < num_subdivs; ++sdi) {
+        for (int sdi = 0; sdi < num_subdivs_; ++sdi) {
           int rotated_di =
               (di + col_params_.instance.impl_details.subdiv_offsets[sdi]) %
               num_devices;
@@ -251,138 +65,30 @@ class RingReducerTest : public ::testing::Test {
         }
       }
     }
-    for (int wi = 0; wi < num_workers; ++wi) {
-      for (int di = 0; di < num_devices; ++di) {
-        int rank = wi * num_devices + di;
-        instances_.push_back(new DeviceInstance(
-            rank, col_params_.instance.device_names[rank], device_type_, this));
-      }
-    }
-  }
-
-  void Reduce(int fail_after) {
-    std::atomic<int> done(0);
-    for (auto di : instances_) {
-      SchedClosure([di, &done] {
-        di->DoReduce();
-        ++done;
-      });
-      if (fail_after > 0) {
-        // Stagger the op execution starts.
-        Env::Default()->SleepForMicroseconds(100);
-      }
-    }
-    while (done < static_cast<int>(instances_.size())) {
-      if (stop_) break;
-      Env::Default()->SleepForMicroseconds(1000);
-    }
   }
 
-  template <typename T>
-  void RunTest(DataType dtype, const DeviceType& device_type, int num_workers,
-               int num_devices, int num_subdivs, int tensor_len,
-               int fail_after) {
-    Init(num_workers, num_devices, dtype, device_type, num_subdivs, fail_after);
-    std::vector<T> expected(tensor_len, 0.0);
-    for (int di = 0; di < static_cast<int>(instances_.size()); ++di) {
-      DeviceInstance* instance = instances_[di];
-      instance->InitTensor(
-          dtype, TensorShape({tensor_len}), [&expected, dtype, di](Tensor* t) {
-            for (size_t i = 0; i < t->NumElements(); ++i) {
-              // The cast is necessary to prevent clang-tidy from insisting
-              // that a faster non-open source function be substituted.
-              float value = pow(10, static_cast<double>(di)) * i;
-              if (dtype == DT_INT32 || dtype == DT_INT64) {
-                value = di * 10 + i;
-              }
-              t->flat<T>()(i) = static_cast<T>(value);
-              expected[i] += value;
-            }
-          });
-    }
-    Reduce(fail_after);
-    if (fail_after > 0) {
-      // Confirm that every device terminated with the expected error status.
-      for (int di = 0; di < static_cast<int>(instances_.size()); ++di) {
-        EXPECT_EQ("Deliberate failure",
-                  instances_[di]->status_.error_message());
-      }
-    } else {
-      // Confirm that every device computed the same correct reduction value.
-      for (int i = 0; i < tensor_len; ++i) {
-        expected[i] /= (num_workers * num_devices);
-      }
-      for (int di = 0; di < static_cast<int>(instances_.size()); ++di) {
-        TF_EXPECT_OK(instances_[di]->status_);
-        Tensor* inst = &instances_[di]->tensor_;
-        CHECK(inst);
-        Tensor actual(dtype, TensorShape({tensor_len}));
-        if (device_type_ == DEVICE_CPU) {
-          CHECK(actual.CopyFrom(*inst, inst->shape()));
-          VLOG(1) << "actual " << actual.SummarizeValue(100);
-        } else if (device_type_ == DEVICE_GPU) {
-          Notification note;
-          Device* dev = instances_[di]->device_;
-          auto* dev_info = dev->tensorflow_gpu_device_info();
-          CHECK(dev_info);
-          dev_info->default_context->CopyDeviceTensorToCPU(
-              inst, "" /*tensor_name*/, dev, &actual, [&note](const Status& s) {
-                CHECK(s.ok());
-                note.Notify();
-              });
-          note.WaitForNotification();
-        }
-
-        for (int i = 0; i < tensor_len; ++i) {
-          switch (dtype) {
-            case DT_FLOAT:
-              EXPECT_FLOAT_EQ(expected[i], actual.template flat<T>()(i))
-                  << "Mismatch at device " << di << " index " << i;
-              break;
-            case DT_DOUBLE:
-              EXPECT_DOUBLE_EQ(expected[i], actual.template flat<T>()(i))
-                  << "Mismatch at device " << di << " index " << i;
-              break;
-            case DT_INT32:
-            case DT_INT64:
-              EXPECT_EQ(expected[i], actual.template flat<T>()(i))
-                  << "Mismatch at device " << di << " index " << i;
-              break;
-            default:
-              LOG(FATAL) << "unimplemented";
-          }
+  void InitDeviceParams(CollectiveParams* cp) override {
+    // Id of this device is at rank position in first subdiv perm.
+    int my_device_id =
+        cp->instance.impl_details.subdiv_permutations[0][cp->default_rank];
+    cp->default_rank = my_device_id;
+    // Set rank for all other subdivs by finding that device_id.
+    for (int sdi = 0; sdi < num_subdivs_; ++sdi) {
+      const std::vector<int>& perm =
+          cp->instance.impl_details.subdiv_permutations[sdi];
+      for (int r = 0; r < static_cast<int>(perm.size()); ++r) {
+        if (my_device_id == perm[r]) {
+          cp->subdiv_rank[sdi] = r;
+          break;
         }
       }
     }
   }
 
-  std::unique_ptr<OpKernel> GetCollectiveReduce(const CollectiveParams& params,
-                                                Tensor* input,
-                                                const DeviceType& device_type,
-                                                DeviceBase* device) {
-    mutex_lock l(mu_);
-    NodeDef node_def;
-    NodeDefBuilder builder(
-        strings::StrCat("collective_reduce_", reduce_counter_++),
-        "CollectiveReduce");
-    TF_CHECK_OK(
-        builder.Attr("T", params.instance.data_type)
-            .Attr("merge_op", "Add")
-            .Attr("final_op", "Id")
-            .Attr("group_size", params.group.group_size)
-            .Attr("group_key", params.group.group_key)
-            .Attr("instance_key", params.instance.instance_key)
-            .Attr("subdiv_offsets", params.instance.impl_details.subdiv_offsets)
-            .Input(FakeInput(params.instance.data_type))
-            .Finalize(&node_def));
-    return GetKernel(node_def, device_type, device);
-  }
-
   void RunSubdivPermsTest(
       CollectiveParams* cp,
       const std::vector<std::vector<int>>& expected_subdiv_perms,
       const std::vector<int>& expected_subdiv_rank) {
-    col_exec_ = nullptr;
     cp->instance.impl_details.subdiv_permutations.clear();
     cp->subdiv_rank.clear();
     // Create a stub ring reducer only for testing param initialization.
@@ -391,162 +97,9 @@ class RingReducerTest : public ::testing::Test {
     EXPECT_EQ(expected_subdiv_perms,
               cp->instance.impl_details.subdiv_permutations);
     EXPECT_EQ(expected_subdiv_rank, cp->subdiv_rank);
-    reducer.group_size_tensor_ready_.Notify();  // To unblock destructor.
   }
 
-  class DeviceInstance {
-   public:
-    DeviceInstance(int rank, const string& dev_name,
-                   const DeviceType& device_type, RingReducerTest* parent)
-        : parent_(parent),
-          dev_name_(dev_name),
-          device_type_(device_type),
-          rank_(rank) {
-      TF_CHECK_OK(parent_->dev_mgr_->LookupDevice(dev_name, &device_))
-          << "Couldn't find device " << dev_name
-          << " existing devices: " << parent_->dev_mgr_->DebugString();
-      col_params_.name = parent_->col_params_.name;
-      col_params_.group.group_key = parent_->col_params_.group.group_key;
-      col_params_.group.device_type = parent_->col_params_.group.device_type;
-      col_params_.group.group_size = parent_->col_params_.group.group_size;
-      col_params_.instance = parent->col_params_.instance;
-      col_params_.task.is_local = parent_->col_params_.task.is_local;
-      col_params_.subdiv_rank = parent_->col_params_.subdiv_rank;
-
-      int num_subdivs = static_cast<int>(col_params_.subdiv_rank.size());
-      int group_size = col_params_.group.group_size;
-      CHECK_EQ(group_size,
-               static_cast<int>(col_params_.instance.device_names.size()));
-      // Id of this device is at rank position in first subdiv perm.
-      int my_device_id =
-          col_params_.instance.impl_details.subdiv_permutations[0][rank];
-      col_params_.default_rank = my_device_id;
-      // Set rank for all other subdivs by finding that device_id.
-      for (int sdi = 0; sdi < num_subdivs; ++sdi) {
-        for (int r = 0; r < static_cast<int>(col_params_.instance.impl_details
-                                                 .subdiv_permutations[sdi]
-                                                 .size());
-             ++r) {
-          if (my_device_id ==
-              col_params_.instance.impl_details.subdiv_permutations[sdi][r]) {
-            col_params_.subdiv_rank[sdi] = r;
-            break;
-          }
-        }
-      }
-    }
-
-    void InitTensor(DataType dtype, const TensorShape& shape,
-                    const std::function<void(Tensor*)>& init_f) {
-      tensor_ =
-          Tensor(device_->GetAllocator(AllocatorAttributes()), dtype, shape);
-      if (device_type_ == DEVICE_CPU) {
-        init_f(&tensor_);
-      } else if (device_type_ == DEVICE_GPU) {
-        Tensor cpu_tensor(dtype, shape);
-        init_f(&cpu_tensor);
-        auto* dev_info = device_->tensorflow_gpu_device_info();
-        CHECK(dev_info);
-        Notification note;
-        dev_info->default_context->CopyCPUTensorToDevice(
-            &cpu_tensor, device_, &tensor_, [&note](const Status& s) {
-              CHECK(s.ok());
-              note.Notify();
-            });
-        note.WaitForNotification();
-      } else {
-        LOG(FATAL) << "Unsupported device_type " << device_type_;
-      }
-    }
-
-    void DoReduce() {
-      col_params_.merge_op =
-          GetAdd(col_params_.instance.data_type, device_type_, device_);
-      col_params_.final_op =
-          GetDiv(col_params_.instance.data_type, device_type_, device_);
-
-      // Prepare an OpKernelContext.
-      OpKernelContext::Params op_params;
-      op_params.step_id = kStepId;
-      op_params.device = device_;
-      gtl::InlinedVector<TensorValue, 4> inputs;
-      inputs.push_back(TensorValue(&tensor_));
-      op_params.inputs = &inputs;
-      gtl::InlinedVector<AllocatorAttributes, 4> input_aa(
-          {AllocatorAttributes()});
-      op_params.input_alloc_attrs = &input_aa;
-      gtl::InlinedVector<DeviceContext*, 4> input_dc;
-      DeviceContext* dev_ctx = nullptr;
-      auto* dev_info = device_->tensorflow_gpu_device_info();
-      if (dev_info) {
-        dev_ctx = dev_info->default_context;
-        dev_ctx->Ref();
-      } else {
-        dev_ctx = new DeviceContext;
-      }
-      input_dc.push_back(dev_ctx);
-      op_params.input_device_contexts = &input_dc;
-      op_params.op_device_context = dev_ctx;
-      int forward_from = 0;
-      op_params.forward_from_array = &forward_from;
-      AllocatorAttributes generic_alloc_attr;
-      op_params.output_attr_array = &generic_alloc_attr;
-      std::unique_ptr<OpKernel> op = parent_->GetCollectiveReduce(
-          col_params_, &tensor_, DEVICE_CPU, device_);
-      op_params.op_kernel = op.get();
-      OpKernelContext ctx(&op_params, 1);
-
-      // We never actually execute the kernel, so we need to do the output
-      // allocation it would do, ourselves.
-      Tensor* output_tensor_ptr = nullptr;
-      TF_CHECK_OK(ctx.forward_input_or_allocate_output({0}, 0, tensor_.shape(),
-                                                       &output_tensor_ptr));
-      CHECK_EQ(output_tensor_ptr, ctx.mutable_output(0));
-
-      // Prepare a RingReducer instance.
-      string exec_key =
-          strings::StrCat(col_params_.instance.instance_key, ":0:0");
-      RingReducer reducer;
-      CollectiveContext col_ctx(parent_->col_exec_, parent_->dev_mgr_.get(),
-                                &ctx, &op_params, col_params_, exec_key,
-                                kStepId, &tensor_, &tensor_);
-      TF_CHECK_OK(reducer.InitializeCollectiveContext(&col_ctx));
-
-      // Run the all-reduce.
-      reducer.Run([this](Status s) { status_ = s; });
-      if (status_.ok()) {
-        CHECK(tensor_.CopyFrom(*ctx.mutable_output(0), tensor_.shape()));
-      }
-
-      dev_ctx->Unref();
-    }
-
-    const Tensor& tensor() { return tensor_; }
-
-    RingReducerTest* parent_;
-    string dev_name_;
-    DeviceType device_type_;
-    int rank_;
-    Tensor tensor_;
-    Device* device_;
-    CollectiveParams col_params_;
-    std::unique_ptr<CollectiveAdapter> ca_;
-    std::unique_ptr<OpKernelContext> ctx_;
-    Status status_;
-  };
-
-  bool stop_ = false;
-  DeviceType device_type_;
-  TestCollectiveExecutorMgr col_exec_mgr_;
-  CollectiveExecutor* col_exec_;
-  CollectiveRemoteAccessLocal* rma_;
-  std::unique_ptr<DeviceResolverLocal> dev_resolver_;
-  std::vector<DeviceInstance*> instances_;
-  CollectiveParams col_params_;
-  std::vector<tensorflow::Device*> gpu_devices_;
-  std::unique_ptr<tensorflow::DeviceMgr> dev_mgr_;
-  mutex mu_;
-  int32 reduce_counter_ GUARDED_BY(mu_) = 0;
+  int num_subdivs_;
 };
 
 TEST_F(RingReducerTest, InitializeParams) {
@@ -603,23 +156,8 @@ TEST_F(RingReducerTest, InitializeParams) {
 #define DEF_TEST(B, T, W, D, S, L, A)                                         \
   TEST_F(RingReducerTest,                                                     \
          DaTy##B##_DevTy##T##_Wkr##W##_Dev##D##_Sdiv##S##_Len##L##_Abrt##A) { \
-    DataType dtype = DT_##B;                                                  \
-    switch (dtype) {                                                          \
-      case DT_FLOAT: {                                                        \
-        RunTest<float>(dtype, DEVICE_##T, W, D, S, L, A);                     \
-      } break;                                                                \
-      case DT_DOUBLE: {                                                       \
-        RunTest<double>(dtype, DEVICE_##T, W, D, S, L, A);                    \
-      } break;                                                                \
-      case DT_INT32: {                                                        \
-        RunTest<int32>(dtype, DEVICE_##T, W, D, S, L, A);                     \
-      } break;                                                                \
-      case DT_INT64: {                                                        \
-        RunTest<int64>(dtype, DEVICE_##T, W, D, S, L, A);                     \
-      } break;                                                                \
-      default:                                                                \
-        LOG(FATAL) << "Unimplemented";                                        \
-    }                                                                         \
+    num_subdivs_ = S;                                                         \
+    RunTest(DT_##B, DEVICE_##T, W, D, L, A);                                  \
   }
 
 #ifndef GOOGLE_CUDA
@@ -0,0 +1,996 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// The "STATIC_SCHEDULE" executor: an executor for graphs without control
+// flow that does all of its graph analysis once, when it is created.
+//
+// The nodes are laid out in topological order with flat arrays of their
+// inputs and out edges, and each step only keeps an atomic count of pending
+// inputs per node. Since there are no frames or iterations, the per-node
+// cost of a step is a handful of array accesses. Ready nodes are run by a
+// bounded set of workers in the order of the times by which they must
+// complete, as estimated by grappler's static schedule, so that the nodes
+// on the critical path run first.
+//
+// Graphs with control flow, and graphs on devices other than CPU, are run
+// by the default executor. Select it with
+// ConfigProto.experimental.executor_type = "STATIC_SCHEDULE".
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/device_set.h"
+#include "tensorflow/core/common_runtime/executor.h"
+#include "tensorflow/core/common_runtime/executor_factory.h"
+#include "tensorflow/core/common_runtime/step_stats_collector.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/collective.h"
+#include "tensorflow/core/framework/log_memory.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/graph/algorithm.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/grappler/clusters/virtual_cluster.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/optimizers/static_schedule.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/gtl/inlined_vector.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/util/tensor_slice_reader_cache.h"
+#include "tensorflow/core/util/work_sharder.h"
+
+namespace tensorflow {
+namespace {
+
+// 1-D, 0 element tensor.
+static const Tensor* const kEmptyTensor = new Tensor;
+
+// Returns true if the static-schedule executor can run `graph` on `device`.
+bool CanScheduleStatically(const Device* device, const Graph& graph) {
+  if (device->device_type() != DEVICE_CPU ||
+      device->RequiresRecordingAccessedTensors()) {
+    return false;
+  }
+  for (const Node* n : graph.nodes()) {
+    if (n->IsControlFlow() || n->IsScopedAllocator()) return false;
+  }
+  return true;
+}
+
+class StaticScheduleExecutor : public Executor {
+ public:
+  StaticScheduleExecutor(const LocalExecutorParams& params,
+                         std::unique_ptr<const Graph> graph)
+      : params_(params), graph_(std::move(graph)) {
+    CHECK(params.create_kernel != nullptr);
+    CHECK(params.delete_kernel != nullptr);
+  }
+
+  ~StaticScheduleExecutor() override {
+    for (const NodeItem& item : nodes_) {
+      if (item.kernel != nullptr) params_.delete_kernel(item.kernel);
+    }
+  }
+
+  Status Initialize();
+
+  void RunAsync(const Args& args, DoneCallback done) override;
+
+ private:
+  friend class StaticScheduleState;
+
+  struct OutEdge {
+    int32 dst;         // Index of the consumer in nodes_.
+    int32 dst_input;   // Input of the consumer, or -1 for a control edge.
+    int32 src_output;  // Output of the producer, or -1 for a control edge.
+    bool is_last;      // Whether this is the last use of the output.
+  };
+
+  // The static information about one node, which is the same in all steps.
+  struct NodeItem {
+    const Node* node = nullptr;
+    OpKernel* kernel = nullptr;
+    bool kernel_is_async = false;
+    bool is_transfer = false;
+    bool is_initialization_op = false;
+    // The maximum intra-op parallelism of a synchronous kernel, from the
+    // "_intra_op_parallelism" attr of the node.
+    int32 intra_op_parallelism = kint32max;
+    int32 num_inputs = 0;
+    int32 num_outputs = 0;
+    // The inputs of the node are entries [input_start, input_start +
+    // num_inputs) of a step.
+    int32 input_start = 0;
+    // The out edges of the node are out_edges_[out_edge_start,
+    // out_edge_limit).
+    int32 out_edge_start = 0;
+    int32 out_edge_limit = 0;
+    // The allocator attributes and forwarding reservations of the outputs
+    // start at this index of output_attrs_ and forward_from_.
+    int32 output_start = 0;
+    // The number of in edges, data and control, excluding the one from the
+    // source node.
+    int32 num_pending = 0;
+    // Ready nodes with a lower priority value run first.
+    int64 priority = 0;
+  };
+
+  // Returns true if node `a` should run before node `b` when both are
+  // ready. Ties are broken by topological order.
+  bool RunsBefore(int32 a, int32 b) const {
+    const int64 pa = nodes_[a].priority;
+    const int64 pb = nodes_[b].priority;
+    return pa != pb ? pa < pb : a < b;
+  }
+
+  // Sets the priority of each node to the time by which it must complete,
+  // or to minus the length of the longest path from it if there is no cost
+  // estimate.
+  void ComputePriorities();
+
+  const LocalExecutorParams params_;
+  std::unique_ptr<const Graph> graph_;
+
+  // The nodes of the graph, except for the source and sink nodes, in
+  // topological order.
+  std::vector<NodeItem> nodes_;
+  std::vector<OutEdge> out_edges_;
+  std::vector<AllocatorAttributes> output_attrs_;
+  std::vector<int> forward_from_;
+  std::vector<int32> root_nodes_;
+  int32 total_inputs_ = 0;
+
+  // Owned. Present if params_.buffer_plan plans any output.
+  std::unique_ptr<PlannedArenaPool> arena_pool_;
+
+  // The maximum number of nodes of a step that run at the same time.
+  int max_workers_ = 1;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StaticScheduleExecutor);
+};
+
+Status StaticScheduleExecutor::Initialize() {
+  std::vector<Node*> order;
+  GetReversePostOrder(*graph_, &order);
+
+  std::vector<int32> index(graph_->num_node_ids(), -1);
+  for (const Node* n : order) {
+    if (n->IsSource() || n->IsSink()) continue;
+    index[n->id()] = nodes_.size();
+    nodes_.emplace_back();
+    NodeItem& item = nodes_.back();
+    item.node = n;
+    Status s = params_.create_kernel(n->def(), &item.kernel);
+    if (!s.ok()) {
+      item.kernel = nullptr;
+      s = AttachDef(s, *n);
+      LOG(ERROR) << "Executor failed to create kernel. " << s;
+      return s;
+    }
+    CHECK(item.kernel);
+    item.kernel_is_async = (item.kernel->AsAsync() != nullptr);
+    item.is_transfer = IsTransferNode(n);
+    item.is_initialization_op = n->op_def().allows_uninitialized_input();
+    const AttrValue* intra_op_parallelism =
+        n->attrs().Find("_intra_op_parallelism");
+    if (intra_op_parallelism != nullptr) {
+      item.intra_op_parallelism = intra_op_parallelism->i();
+    }
+    item.num_inputs = n->num_inputs();
+    item.num_outputs = n->num_outputs();
+    item.input_start = total_inputs_;
+    total_inputs_ += item.num_inputs;
+    item.output_start = output_attrs_.size();
+    output_attrs_.resize(output_attrs_.size() + item.num_outputs);
+    forward_from_.resize(output_attrs_.size(),
+                         OpKernelContext::Params::kNoReservation);
+
+    std::vector<int> forward_input;
+    if (GetNodeAttr(n->attrs(), "_forward_input", &forward_input).ok()) {
+      DCHECK_EQ(forward_input.size() % 2, 0);
+      for (int j = 0; j + 1 < forward_input.size(); j += 2) {
+        int* forward_from = &forward_from_[item.output_start];
+        if (forward_from[forward_input[j + 1]] ==
+            OpKernelContext::Params::kNoReservation) {
+          forward_from[forward_input[j + 1]] = forward_input[j];
+        }
+      }
+    }
+  }
+
+  const DeviceNameUtils::ParsedName& local_dev_name =
+      params_.device->parsed_name();
+  for (int32 i = 0; i < nodes_.size(); ++i) {
+    NodeItem& item = nodes_[i];
+    const Node* n = item.node;
+    for (const Edge* e : n->in_edges()) {
+      if (!e->src()->IsSource()) ++item.num_pending;
+    }
+    if (item.num_pending == 0) root_nodes_.push_back(i);
+
+    AllocatorAttributes* attrs = &output_attrs_[item.output_start];
+    std::vector<int32> last_use(item.num_outputs, -1);
+    item.out_edge_start = out_edges_.size();
+    for (const Edge* e : n->out_edges()) {
+      if (e->dst()->IsSink()) continue;
+      OutEdge out;
+      out.dst = index[e->dst()->id()];
+      out.dst_input = e->IsControlEdge() ? -1 : e->dst_input();
+      out.src_output = e->IsControlEdge() ? -1 : e->src_output();
+      out.is_last = false;
+      if (!e->IsControlEdge()) {
+        last_use[out.src_output] = out_edges_.size();
+        AllocatorAttributes attr;
+        TF_RETURN_IF_ERROR(
+            InferAllocAttr(n, e->dst(), local_dev_name, &attr));
+        if (attr.value != 0) attrs[out.src_output].Merge(attr);
+      }
+      out_edges_.push_back(out);
+    }
+    item.out_edge_limit = out_edges_.size();
+    for (int32 edge : last_use) {
+      if (edge >= 0) out_edges_[edge].is_last = true;
+    }
+
+    const MemoryTypeVector& output_memory_types =
+        item.kernel->output_memory_types();
+    for (int out = 0; out < item.num_outputs; ++out) {
+      DCHECK_LT(out, output_memory_types.size());
+      if (output_memory_types[out] == HOST_MEMORY) {
+        AllocatorAttributes h;
+        h.set_on_host(true);
+        attrs[out].Merge(h);
+      }
+    }
+  }
+
+  if (params_.buffer_plan != nullptr &&
+      !params_.buffer_plan->buffers().empty()) {
+    arena_pool_.reset(new PlannedArenaPool(
+        params_.buffer_plan,
+        params_.device->GetAllocator(AllocatorAttributes())));
+  }
+
+  max_workers_ = std::max(1, port::NumSchedulableCPUs());
+  ComputePriorities();
+  return Status::OK();
+}
+
+void StaticScheduleExecutor::ComputePriorities() {
+  grappler::GrapplerItem item;
+  item.id = "static_schedule_executor";
+  graph_->ToGraphDef(&item.graph);
+  DeviceSet device_set;
+  device_set.AddDevice(params_.device);
+  grappler::VirtualCluster cluster(&device_set);
+
+  std::unordered_map<const NodeDef*, grappler::Costs::NanoSeconds>
+      execution_times;
+  std::unordered_map<const NodeDef*, grappler::Costs::NanoSeconds>
+      required_times;
+  Status s =
+      grappler::EstimateEarliestExecutionTimes(item, &cluster,
+                                               &execution_times);
+  if (s.ok()) {
+    s = grappler::EstimateRequiredTimes(item, &cluster, execution_times,
+                                        &required_times);
+  }
+  if (s.ok()) {
+    std::unordered_map<string, int64> required_by_name;
+    for (const auto& it : required_times) {
+      required_by_name[it.first->name()] = it.second.count();
+    }
+    for (NodeItem& node_item : nodes_) {
+      auto it = required_by_name.find(node_item.node->name());
+      if (it == required_by_name.end()) {
+        s = errors::Internal("No time estimate for ", node_item.node->name());
+        break;
+      }
+      node_item.priority = it->second;
+    }
+    if (s.ok()) return;
+  }
+
+  VLOG(1) << "Scheduling by longest paths instead of estimated times: " << s;
+  std::vector<int64> depth(nodes_.size(), 1);
+  for (int32 i = nodes_.size() - 1; i >= 0; --i) {
+    const NodeItem& node_item = nodes_[i];
+    for (int32 e = node_item.out_edge_start; e < node_item.out_edge_limit;
+         ++e) {
+      depth[i] = std::max(depth[i], depth[out_edges_[e].dst] + 1);
+    }
+    nodes_[i].priority = -depth[i];
+  }
+}
+
+// The state of one step of a StaticScheduleExecutor. Deletes itself when
+// the step is done.
+class StaticScheduleState {
+ public:
+  StaticScheduleState(const Executor::Args& args,
+                      const StaticScheduleExecutor* impl);
+  ~StaticScheduleState();
+
+  void RunAsync(Executor::DoneCallback done);
+
+ private:
+  typedef StaticScheduleExecutor::NodeItem NodeItem;
+  typedef StaticScheduleExecutor::OutEdge OutEdge;
+  typedef gtl::InlinedVector<TensorValue, 4> TensorValueVec;
+  typedef gtl::InlinedVector<DeviceContext*, 4> DeviceContextVec;
+  typedef gtl::InlinedVector<AllocatorAttributes, 4> AllocatorAttributeVec;
+
+  // An input or output of a node: either a tensor, or a reference to a
+  // tensor and the mutex that guards it.
+  struct Entry {
+    Tensor val;
+    Tensor* ref = nullptr;
+    mutex* ref_mu = nullptr;
+    bool has_value = false;
+    DeviceContext* device_context = nullptr;
+    AllocatorAttributes alloc_attr;
+  };
+  typedef gtl::InlinedVector<Entry, 4> EntryVector;
+
+  struct AsyncState;
+
+  // Runs `id` and then the ready nodes of the step, most urgent first,
+  // until there are none left to take.
+  void RunWorker(int32 id);
+
+  // Runs node `id`. Returns false if its kernel runs asynchronously, in
+  // which case the kernel's callback completes the node. Otherwise appends
+  // the nodes that became ready to `ready`.
+  bool Process(int32 id, std::vector<int32>* ready);
+
+  Status PrepareInputs(const NodeItem& item, Entry* first_input,
+                       TensorValueVec* inputs,
+                       DeviceContextVec* input_device_contexts,
+                       AllocatorAttributeVec* input_alloc_attrs,
+                       bool* is_input_dead);
+  Status ProcessOutputs(const NodeItem& item, OpKernelContext* ctx,
+                        EntryVector* outputs, NodeExecStatsInterface* stats);
+
+  // Passes `outputs` to the consumers of node `id` and appends those that
+  // became ready to `ready`.
+  void PropagateOutputs(int32 id, bool is_dead, EntryVector* outputs,
+                        std::vector<int32>* ready);
+
+  // Records the statistics and status of a node that finished.
+  void NodeDone(const Status& s, const NodeItem& item,
+                NodeExecStatsInterface* stats);
+
+  // Makes the nodes in `ready` runnable. Returns the node the calling
+  // worker runs next, or -1 if it has nothing left to do. Callers that are
+  // not workers must start a worker for the returned node.
+  int32 Schedule(const std::vector<int32>& ready, bool from_worker);
+
+  void Finish();
+
+  const bool vlog_;
+  const bool log_memory_;
+  const int64 step_id_;
+  Rendezvous* rendezvous_;
+  CollectiveExecutor* collective_executor_;
+  SessionState* session_state_;
+  TensorStore* tensor_store_;
+  ScopedStepContainer* step_container_;
+  StepStatsCollectorInterface* stats_collector_;
+  checkpoint::TensorSliceReaderCacheWrapper slice_reader_cache_;
+  CallFrameInterface* call_frame_;
+  const StaticScheduleExecutor* impl_;
+  CancellationManager* cancellation_manager_;
+  Executor::Args::Runner runner_;
+  const bool sync_on_finish_;
+  PlannedArena* arena_ = nullptr;
+
+  DeviceContextMap device_context_map_;
+
+  // The inputs of all nodes, laid out as given by NodeItem::input_start.
+  std::vector<Entry> entries_;
+  // The number of inputs that each node still waits for.
+  std::unique_ptr<std::atomic<int32>[]> pending_;
+  // Whether each node has a dead input.
+  std::unique_ptr<std::atomic<bool>[]> dead_;
+
+  // The number of nodes that are ready or running.
+  std::atomic<int64> num_outstanding_{0};
+  // Set once a node fails; the remaining ready nodes are then skipped.
+  std::atomic<bool> aborted_{false};
+  // A lock-free hint of ready_.size().
+  std::atomic<int> num_queued_{0};
+
+  mutex mu_;
+  // A heap of the ready nodes that no worker has taken yet. The most
+  // urgent node is at the front.
+  std::vector<int32> ready_ GUARDED_BY(mu_);
+  int num_workers_ GUARDED_BY(mu_) = 0;
+  Status status_ GUARDED_BY(mu_);
+  Executor::DoneCallback done_cb_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StaticScheduleState);
+};
+
+// State kept alive for executing an asynchronous node in another thread.
+// The vectors that the params point to are copied, since the stack frame
+// that filled them in is gone when the kernel completes.
+struct StaticScheduleState::AsyncState {
+  AsyncState(const OpKernelContext::Params& p, int32 _id, bool _is_dead,
+             const NodeItem* _item, Entry* _first_input,
+             NodeExecStatsInterface* _stats)
+      : saved_inputs(*p.inputs),
+        saved_input_device_contexts(*p.input_device_contexts),
+        saved_input_alloc_attrs(*p.input_alloc_attrs),
+        params(p),
+        id(_id),
+        is_dead(_is_dead),
+        item(_item),
+        first_input(_first_input),
+        ctx(&params, item->num_outputs),
+        stats(_stats) {
+    params.inputs = &saved_inputs;
+    params.input_device_contexts = &saved_input_device_contexts;
+    params.input_alloc_attrs = &saved_input_alloc_attrs;
+  }
+
+  TensorValueVec saved_inputs;
+  DeviceContextVec saved_input_device_contexts;
+  AllocatorAttributeVec saved_input_alloc_attrs;
+  OpKernelContext::Params params;
+  int32 id;
+  bool is_dead;
+  const NodeItem* item;
+  Entry* first_input;
+  OpKernelContext ctx;
+  NodeExecStatsInterface* stats;
+};
+
+StaticScheduleState::StaticScheduleState(const Executor::Args& args,
+                                         const StaticScheduleExecutor* impl)
+    : vlog_(VLOG_IS_ON(1)),
+      log_memory_(LogMemory::IsEnabled()),
+      step_id_(args.step_id),
+      rendezvous_(args.rendezvous),
+      collective_executor_(args.collective_executor),
+      session_state_(args.session_state),
+      tensor_store_(args.tensor_store),
+      step_container_(args.step_container),
+      stats_collector_(args.stats_collector),
+      call_frame_(args.call_frame),
+      impl_(impl),
+      cancellation_manager_(args.cancellation_manager),
+      runner_(args.runner),
+      sync_on_finish_(args.sync_on_finish),
+      entries_(impl->total_inputs_) {
+  const int32 num_nodes = impl_->nodes_.size();
+  pending_.reset(new std::atomic<int32>[num_nodes]);
+  dead_.reset(new std::atomic<bool>[num_nodes]);
+  for (int32 i = 0; i < num_nodes; ++i) {
+    pending_[i].store(impl_->nodes_[i].num_pending, std::memory_order_relaxed);
+    dead_[i].store(false, std::memory_order_relaxed);
+  }
+  if (impl_->arena_pool_ != nullptr) {
+    arena_ = impl_->arena_pool_->Acquire();
+  }
+}
+
+StaticScheduleState::~StaticScheduleState() {
+  for (DeviceContext* device_context : device_context_map_) {
+    device_context->Unref();
+  }
+  if (arena_ != nullptr) {
+    impl_->arena_pool_->Release(arena_);
+  }
+}
+
+void StaticScheduleState::RunAsync(Executor::DoneCallback done) {
+  const Status fill_status = impl_->params_.device->FillContextMap(
+      impl_->graph_.get(), &device_context_map_);
+  if (!fill_status.ok()) {
+    delete this;
+    done(fill_status);
+    return;
+  }
+  if (impl_->root_nodes_.empty()) {
+    delete this;
+    done(Status::OK());
+    return;
+  }
+  done_cb_ = std::move(done);
+  num_outstanding_ = impl_->root_nodes_.size();
+  const int32 first = Schedule(impl_->root_nodes_, /*from_worker=*/false);
+  DCHECK_GE(first, 0);
+  runner_([this, first]() { RunWorker(first); });
+}
+
+void StaticScheduleState::RunWorker(int32 id) {
+  std::vector<int32> ready;
+  while (id >= 0) {
+    ready.clear();
+    if (!Process(id, &ready)) {
+      // The node is completed by its kernel's callback.
+      id = Schedule(ready, /*from_worker=*/true);
+      continue;
+    }
+    if (!ready.empty()) {
+      num_outstanding_.fetch_add(ready.size(), std::memory_order_relaxed);
+    }
+    const int32 next = Schedule(ready, /*from_worker=*/true);
+    if (num_outstanding_.fetch_sub(1) == 1) {
+      DCHECK_LT(next, 0);
+      Finish();
+      return;
+    }
+    id = next;
+  }
+}
+
+int32 StaticScheduleState::Schedule(const std::vector<int32>& ready,
+                                    bool from_worker) {
+  // A worker keeps running a chain of nodes without taking the lock as long
+  // as nothing else is waiting.
+  if (from_worker && ready.size() == 1 &&
+      num_queued_.load(std::memory_order_relaxed) == 0) {
+    return ready[0];
+  }
+
+  auto runs_after = [this](int32 a, int32 b) {
+    return impl_->RunsBefore(b, a);
+  };
+  int32 next = -1;
+  gtl::InlinedVector<int32, 4> new_workers;
+  {
+    mutex_lock l(mu_);
+    if (!from_worker) ++num_workers_;
+    for (int32 id : ready) {
+      ready_.push_back(id);
+      std::push_heap(ready_.begin(), ready_.end(), runs_after);
+    }
+    if (ready_.empty()) {
+      --num_workers_;
+    } else {
+      std::pop_heap(ready_.begin(), ready_.end(), runs_after);
+      next = ready_.back();
+      ready_.pop_back();
+    }
+    while (!ready_.empty() && num_workers_ < impl_->max_workers_) {
+      std::pop_heap(ready_.begin(), ready_.end(), runs_after);
+      new_workers.push_back(ready_.back());
+      ready_.pop_back();
+      ++num_workers_;
+    }
+    num_queued_.store(ready_.size(), std::memory_order_relaxed);
+  }
+  for (int32 id : new_workers) {
+    runner_([this, id]() { RunWorker(id); });
+  }
+  return next;
+}
+
+bool StaticScheduleState::Process(int32 id, std::vector<int32>* ready) {
+  const NodeItem& item = impl_->nodes_[id];
+  const Node* node = item.node;
+  Device* device = impl_->params_.device;
+  Entry* first_input = entries_.data() + item.input_start;
+
+  if (aborted_.load(std::memory_order_relaxed)) {
+    for (int i = 0; i < item.num_inputs; ++i) first_input[i] = Entry();
+    return true;
+  }
+
+  const bool is_dead = dead_[id].load(std::memory_order_relaxed);
+  if (vlog_) {
+    VLOG(1) << "Process node: " << node->id() << " step " << step_id_ << " "
+            << SummarizeNode(*node) << (is_dead ? " is dead" : "")
+            << " device: " << device->name();
+  }
+
+  EntryVector outputs;
+  Status s;
+  NodeExecStatsInterface* stats = nullptr;
+  if (is_dead && !item.is_transfer) {
+    // Only send/recv transfer nodes run with dead inputs, to propagate the
+    // dead bit to other devices.
+    outputs.resize(item.num_outputs);
+  } else {
+    TensorValueVec inputs;
+    DeviceContextVec input_device_contexts;
+    AllocatorAttributeVec input_alloc_attrs;
+    bool is_input_dead = false;
+    s = PrepareInputs(item, first_input, &inputs, &input_device_contexts,
+                      &input_alloc_attrs, &is_input_dead);
+    if (s.ok()) {
+      if (stats_collector_ != nullptr && !is_dead) {
+        stats = stats_collector_->CreateNodeExecStats(node);
+        stats->RecordExecutorStarted();
+      }
+
+      OpKernelContext::Params params;
+      params.step_id = step_id_;
+      params.device = device;
+      params.log_memory = log_memory_;
+      params.rendezvous = rendezvous_;
+      params.collective_executor = collective_executor_;
+      params.session_state = session_state_;
+      params.tensor_store = tensor_store_;
+      params.cancellation_manager = cancellation_manager_;
+      params.call_frame = call_frame_;
+      params.function_library = impl_->params_.function_library;
+      params.resource_manager = device->resource_manager();
+      params.step_container = step_container_;
+      params.slice_reader_cache = &slice_reader_cache_;
+      params.inputs = &inputs;
+      params.input_device_contexts = &input_device_contexts;
+      params.input_alloc_attrs = &input_alloc_attrs;
+      params.runner = &runner_;
+      params.stats_collector = stats_collector_;
+      params.track_allocations = stats != nullptr && stats->TrackAllocations();
+      if (node->id() < device_context_map_.size()) {
+        params.op_device_context = device_context_map_[node->id()];
+      }
+      params.op_kernel = item.kernel;
+      params.is_input_dead = is_input_dead;
+      params.output_attr_array = &impl_->output_attrs_[item.output_start];
+      params.forward_from_array = &impl_->forward_from_[item.output_start];
+      params.output_allocator_array =
+          arena_ == nullptr ? nullptr : arena_->OutputAllocators(node->id());
+
+      if (item.kernel_is_async) {
+        AsyncState* state =
+            new AsyncState(params, id, is_dead, &item, first_input, stats);
+        auto done = [this, state]() {
+          const NodeItem& item = *state->item;
+          if (state->stats) state->stats->RecordComputeEnded();
+          EntryVector outputs;
+          Status s =
+              ProcessOutputs(item, &state->ctx, &outputs, state->stats);
+          if (state->stats) state->stats->SetMemory(&state->ctx);
+          if (vlog_) {
+            VLOG(2) << "Async kernel done: " << item.node->id() << " step "
+                    << step_id_ << " " << SummarizeNode(*item.node);
+          }
+          for (int i = 0; i < item.num_inputs; ++i) {
+            state->first_input[i] = Entry();
+          }
+          std::vector<int32> ready;
+          if (s.ok()) {
+            PropagateOutputs(state->id, state->is_dead, &outputs, &ready);
+          }
+          outputs.clear();
+          NodeDone(s, item, state->stats);
+          delete state;
+
+          if (!ready.empty()) {
+            num_outstanding_.fetch_add(ready.size(),
+                                       std::memory_order_relaxed);
+          }
+          const int32 next = Schedule(ready, /*from_worker=*/false);
+          if (next >= 0) {
+            runner_([this, next]() { RunWorker(next); });
+          }
+          if (num_outstanding_.fetch_sub(1) == 1) Finish();
+        };
+        if (stats) stats->RecordComputeStarted();
+        device->ComputeAsync(item.kernel->AsAsync(), &state->ctx, done);
+        return false;
+      }
+
+      OpKernelContext ctx(&params, item.num_outputs);
+      if (stats) stats->RecordComputeStarted();
+      {
+        ScopedPerThreadMaxParallelism parallelism(std::min(
+            item.intra_op_parallelism, GetPerThreadMaxParallelism()));
+        device->Compute(item.kernel, &ctx);
+      }
+      if (stats) stats->RecordComputeEnded();
+      s = ProcessOutputs(item, &ctx, &outputs, stats);
+      if (stats) stats->SetMemory(&ctx);
+    }
+  }
+
+  if (vlog_) {
+    VLOG(2) << "Synchronous kernel done: " << node->id() << " step "
+            << step_id_ << " " << SummarizeNode(*node)
+            << (is_dead ? " is dead" : "") << " device: " << device->name();
+  }
+  for (int i = 0; i < item.num_inputs; ++i) first_input[i] = Entry();
+  if (s.ok()) PropagateOutputs(id, is_dead, &outputs, ready);
+  NodeDone(s, item, stats);
+  return true;
+}
+
+Status StaticScheduleState::PrepareInputs(
+    const NodeItem& item, Entry* first_input, TensorValueVec* inputs,
+    DeviceContextVec* input_device_contexts,
+    AllocatorAttributeVec* input_alloc_attrs, bool* is_input_dead) {
+  const Node* node = item.node;
+  inputs->resize(item.num_inputs);
+  input_device_contexts->resize(item.num_inputs);
+  input_alloc_attrs->resize(item.num_inputs);
+  *is_input_dead = false;
+
+  for (int i = 0; i < item.num_inputs; ++i) {
+    const bool expect_ref = IsRefType(node->input_type(i));
+    Entry* entry = first_input + i;
+    (*input_device_contexts)[i] = entry->device_context;
+    (*input_alloc_attrs)[i] = entry->alloc_attr;
+    TensorValue* inp = &(*inputs)[i];
+
+    // Only transfer nodes run with inputs that have no value.
+    if (!entry->has_value) {
+      DCHECK(item.is_transfer) << node->name() << " - input " << i;
+      entry->has_value = true;
+      entry->val = *kEmptyTensor;
+      inp->tensor = &entry->val;
+      *is_input_dead = true;
+      continue;
+    }
+    if (entry->ref == nullptr) {
+      if (expect_ref) {
+        return AttachDef(
+            errors::InvalidArgument(i, "-th input expects a ref type"),
+            item.kernel->def());
+      }
+      inp->tensor = &entry->val;
+      continue;
+    }
+    {
+      mutex_lock ml(*entry->ref_mu);
+      if (!entry->ref->IsInitialized() && !item.is_initialization_op) {
+        return AttachDef(errors::FailedPrecondition(
+                             "Attempting to use uninitialized value ",
+                             item.kernel->requested_input(i)),
+                         item.kernel->def());
+      }
+    }
+    if (expect_ref) {
+      inp->mutex_if_ref = entry->ref_mu;
+      inp->tensor = entry->ref;
+    } else {
+      // Automatically deref the tensor ref when the op expects a tensor but
+      // is given a ref to a tensor. Need to deref it under the mutex.
+      {
+        mutex_lock l(*entry->ref_mu);
+        entry->val = *entry->ref;
+      }
+      entry->ref = nullptr;
+      entry->ref_mu = nullptr;
+      inp->tensor = &entry->val;
+      // The dtype of entry->ref could have been changed by another operation
+      // that ran after the operation that "produced" it executed, so
+      // re-validate that the type of the dereferenced tensor matches the
+      // expected input type.
+      if (node->input_type(i) != inp->tensor->dtype()) {
+        return AttachDef(
+            errors::InvalidArgument(
+                i, "-th input expects type ",
+                DataTypeString(node->input_type(i)),
+                " but automatically dereferenced input tensor has type ",
+                DataTypeString(inp->tensor->dtype())),
+            item.kernel->def());
+      }
+    }
+  }
+  return Status::OK();
+}
+
+Status StaticScheduleState::ProcessOutputs(const NodeItem& item,
+                                           OpKernelContext* ctx,
+                                           EntryVector* outputs,
+                                           NodeExecStatsInterface* stats) {
+  const Node* node = item.node;
+  DCHECK_EQ(0, outputs->size());
+  outputs->resize(item.num_outputs);
+
+  Status s = ctx->status();
+  if (!s.ok()) {
+    s = AttachDef(s, item.kernel->def());
+    if (s.code() == error::RESOURCE_EXHAUSTED && stats_collector_) {
+      string err =
+          stats_collector_->ReportAllocsOnResourceExhausted(s.error_message());
+      s = Status(s.code(), strings::StrCat(s.error_message(), err));
+    }
+    return s;
+  }
+
+  DeviceContext* device_context = nullptr;
+  if (node->id() < device_context_map_.size()) {
+    device_context = device_context_map_[node->id()];
+  }
+
+  for (int i = 0; i < item.num_outputs; ++i) {
+    const TensorValue val = ctx->release_output(i);
+    if (val.tensor == nullptr) {
+      // Unless it's a Recv, the node must produce a tensor value at i-th
+      // output.
+      if (!IsRecv(node)) {
+        s.Update(errors::Internal("Missing ", i, "-th output from ",
+                                  SummarizeNode(*node)));
+      }
+      continue;
+    }
+    Entry* out = &(*outputs)[i];
+    out->device_context = device_context;
+    out->alloc_attr = ctx->output_alloc_attr(i);
+
+    // Sanity check of output tensor types.
+    DataType dtype;
+    if (val.is_ref()) {
+      mutex_lock ml(*val.mutex_if_ref);
+      dtype = MakeRefType(val->dtype());
+    } else {
+      dtype = val->dtype();
+    }
+    if (dtype == node->output_type(i)) {
+      if (stats && val.tensor->IsInitialized()) {
+        stats->SetOutput(i, val.tensor);
+      }
+      out->has_value = true;
+      if (val.is_ref()) {
+        out->ref = val.tensor;
+        out->ref_mu = val.mutex_if_ref;
+        if (log_memory_) {
+          Tensor to_log;
+          {
+            // Dereference the tensor under the lock.
+            mutex_lock l(*out->ref_mu);
+            to_log = *out->ref;
+          }
+          LogMemory::RecordTensorOutput(ctx->op_kernel().name(),
+                                        ctx->step_id(), i, to_log);
+        }
+      } else {
+        out->val = std::move(*val.tensor);
+        if (log_memory_) {
+          LogMemory::RecordTensorOutput(ctx->op_kernel().name(),
+                                        ctx->step_id(), i, out->val);
+        }
+      }
+    } else {
+      s.Update(errors::Internal("Output ", i, " of type ",
+                                DataTypeString(dtype),
+                                " does not match declared output type ",
+                                DataTypeString(node->output_type(i)),
+                                " for node ", SummarizeNode(*node)));
+    }
+    if (!val.is_ref()) {
+      // If OpKernelContext returns outputs via pass-by-value, we
+      // don't need this trouble.
+      delete val.tensor;
+    }
+  }
+  return s;
+}
+
+void StaticScheduleState::PropagateOutputs(int32 id, bool is_dead,
+                                           EntryVector* outputs,
+                                           std::vector<int32>* ready) {
+  const NodeItem& item = impl_->nodes_[id];
+  const OutEdge* edges = impl_->out_edges_.data();
+  for (int32 e = item.out_edge_start; e < item.out_edge_limit; ++e) {
+    const OutEdge& edge = edges[e];
+    bool dst_dead = is_dead;
+    if (edge.dst_input >= 0) {
+      Entry* out = &(*outputs)[edge.src_output];
+      if (!out->has_value) {
+        dst_dead = true;
+      } else {
+        Entry* in = &entries_[impl_->nodes_[edge.dst].input_start +
+                              edge.dst_input];
+        if (edge.is_last) {
+          *in = std::move(*out);
+        } else {
+          *in = *out;
+        }
+      }
+    }
+    if (dst_dead) dead_[edge.dst].store(true, std::memory_order_relaxed);
+    if (pending_[edge.dst].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      ready->push_back(edge.dst);
+    }
+  }
+}
+
+void StaticScheduleState::NodeDone(const Status& s, const NodeItem& item,
+                                   NodeExecStatsInterface* stats) {
+  if (stats) {
+    stats->RecordExecutorEnded();
+    // Transfers 'stats' ownership back to 'stats_collector_'.
+    stats->Done(impl_->params_.device->name());
+  }
+
+  if (s.ok()) return;
+  bool abort_run = false;
+  {
+    mutex_lock l(mu_);
+    if (status_.ok()) {
+      abort_run = true;
+      status_ = s;
+    }
+  }
+  if (abort_run) {
+    aborted_.store(true, std::memory_order_relaxed);
+    if (rendezvous_) {
+      rendezvous_->StartAbort(s);
+    }
+    if (collective_executor_) {
+      collective_executor_->StartAbort(s);
+    }
+    if (cancellation_manager_) {
+      cancellation_manager_->StartCancel();
+    }
+  }
+}
+
+void StaticScheduleState::Finish() {
+  mu_.lock();
+  Status status = status_;
+  auto done_cb = std::move(done_cb_);
+  auto runner = std::move(runner_);
+  mu_.unlock();
+  if (sync_on_finish_ && status.ok()) {
+    // Block until the device has finished all queued operations.
+    status = impl_->params_.device->Sync();
+  }
+  delete this;
+  CHECK(done_cb != nullptr);
+  runner([=]() { done_cb(status); });
+}
+
+void StaticScheduleExecutor::RunAsync(const Args& args, DoneCallback done) {
+  (new StaticScheduleState(args, this))->RunAsync(std::move(done));
+}
+
+class StaticScheduleExecutorRegistrar {
+ public:
+  StaticScheduleExecutorRegistrar() {
+    ExecutorFactory::Register("STATIC_SCHEDULE", new Factory);
+  }
+
+ private:
+  class Factory : public ExecutorFactory {
+    Status NewExecutor(const LocalExecutorParams& params,
+                       std::unique_ptr<const Graph> graph,
+                       std::unique_ptr<Executor>* out_executor) override {
+      if (!CanScheduleStatically(params.device, *graph)) {
+        VLOG(1) << "Running a graph with control flow or on "
+                << params.device->name() << " with the default executor";
+        Executor* ret = nullptr;
+        TF_RETURN_IF_ERROR(NewLocalExecutor(params, std::move(graph), &ret));
+        out_executor->reset(ret);
+        return Status::OK();
+      }
+      std::unique_ptr<StaticScheduleExecutor> executor(
+          new StaticScheduleExecutor(params, std::move(graph)));
+      TF_RETURN_IF_ERROR(executor->Initialize());
+      *out_executor = std::move(executor);
+      return Status::OK();
+    }
+  };
+};
+static StaticScheduleExecutorRegistrar registrar;
+
+}  // namespace
+}  // namespace tensorflow
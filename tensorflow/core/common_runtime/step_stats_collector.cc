@@ -14,6 +14,10 @@ limitations under the License.
 ==============================================================================*/
 
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
+
+#include <atomic>
+#include <thread>
+
 #include "tensorflow/core/common_runtime/costmodel_manager.h"
 #include "tensorflow/core/framework/allocation_description.pb.h"
 #include "tensorflow/core/framework/op_kernel.h"
@@ -27,12 +31,19 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/scanner.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/profile_utils/cpu_utils.h"
 
 namespace tensorflow {
 namespace {
 const int kMaxAllocReportNodes = 100;
 const float kMaxAllocReportFraction = 0.99;
 
+// Maximum number of LightweightStepStatsCollector node stats that a thread
+// keeps around for reuse.
+const int kMaxCachedNodeStatsPerThread = 256;
+
+std::atomic<uint64> next_lightweight_collector_id(1);
+
 struct AllocStats {
   std::map<int64, std::vector<string>> nodes_by_size;
   int64 total_bytes = 0;
@@ -46,6 +57,21 @@ NodeExecStatsWrapper::NodeExecStatsWrapper(const string& node_name)
 }
 NodeExecStatsWrapper::NodeExecStatsWrapper(NodeExecStats* stats)
     : stats_(stats) {}
+NodeExecStatsWrapper::NodeExecStatsWrapper(const Node* node,
+                                           StepStatsCollector* collector)
+    : stats_(new NodeExecStats), node_(node), step_stats_collector_(collector) {
+  stats_->set_node_name(node->name());
+}
+
+void NodeExecStatsWrapper::Done(const string& device) {
+  DCHECK(node_ != nullptr && step_stats_collector_ != nullptr);
+  if (SetTimelineLabel(node_)) {
+    // Only record non-transfer nodes.
+    delete this;
+    return;
+  }
+  step_stats_collector_->Save(device, this);
+}
 
 void NodeExecStatsWrapper::SetOutput(int slot, const Tensor* v) {
   DCHECK(v);
@@ -338,6 +364,11 @@ void StepStatsCollector::BuildCostModel(
   }
 }
 
+NodeExecStatsInterface* StepStatsCollector::CreateNodeExecStats(
+    const Node* node) {
+  return new NodeExecStatsWrapper(node, this);
+}
+
 void StepStatsCollector::Save(const string& device, NodeExecStats* nt) {
   Save(device, new NodeExecStatsWrapper(nt));
 }
@@ -476,4 +507,218 @@ void StepStatsCollector::FinalizeInternal() {
     }
   }
 }
+
+// The stats of one execution of a node, which only fill in an Event.
+class LightweightStepStatsCollector::NodeStats : public NodeExecStatsInterface {
+ public:
+  // Returns stats for an execution of `node`, reusing a previously released
+  // object of the calling thread if possible.
+  static NodeStats* Get(LightweightStepStatsCollector* collector,
+                        const Node* node) {
+    std::vector<std::unique_ptr<NodeStats>>* free_list = FreeList();
+    NodeStats* stats;
+    if (free_list->empty()) {
+      stats = new NodeStats;
+    } else {
+      stats = free_list->back().release();
+      free_list->pop_back();
+    }
+    stats->collector_ = collector;
+    stats->event_ = Event();
+    stats->event_.node = node;
+    return stats;
+  }
+
+  void Done(const string& device) override {
+    if (!IsTransferNode(event_.node)) {
+      event_.device = &device;
+      collector_->Record(event_);
+    }
+    Release();
+  }
+
+  void SetScheduled(int64 nanos) override { event_.scheduled_nanos = nanos; }
+  void RecordExecutorStarted() override {
+    event_.all_start = collector_->Now();
+  }
+  void RecordComputeStarted() override { event_.op_start = collector_->Now(); }
+  void RecordComputeEnded() override { event_.op_end = collector_->Now(); }
+  void RecordExecutorEnded() override { event_.all_end = collector_->Now(); }
+
+  bool TrackAllocations() const override { return false; }
+  void SetMemory(OpKernelContext* ctx) override {}
+  void SetOutput(int slot, const Tensor* v) override {}
+  void SetReferencedTensors(const TensorReferenceVector& tensors) override {}
+
+ private:
+  NodeStats() {}
+
+  static std::vector<std::unique_ptr<NodeStats>>* FreeList() {
+    static thread_local std::vector<std::unique_ptr<NodeStats>> free_list;
+    return &free_list;
+  }
+
+  void Release() {
+    std::vector<std::unique_ptr<NodeStats>>* free_list = FreeList();
+    if (free_list->size() < kMaxCachedNodeStatsPerThread) {
+      free_list->emplace_back(this);
+    } else {
+      delete this;
+    }
+  }
+
+  LightweightStepStatsCollector* collector_ = nullptr;  // Not owned.
+  Event event_;
+};
+
+// The events recorded by one thread. Once `max_events_per_thread_` events
+// have been recorded, the oldest ones get overwritten.
+struct LightweightStepStatsCollector::ThreadBuffer {
+  std::thread::id thread_id;
+  std::vector<Event> events;
+  // Total number of events recorded, including the overwritten ones.
+  int64 num_recorded = 0;
+};
+
+LightweightStepStatsCollector::LightweightStepStatsCollector(
+    StepStats* ss, int max_events_per_thread)
+    : id_(next_lightweight_collector_id.fetch_add(1)),
+      step_stats_(ss),
+      max_events_per_thread_(max_events_per_thread),
+      use_cycle_counter_(profile_utils::CpuUtils::GetCurrentClockCycle() !=
+                         profile_utils::CpuUtils::DUMMY_CYCLE_CLOCK),
+      start_ticks_(Now()),
+      start_nanos_(Env::Default()->NowNanos()) {
+  CHECK_GT(max_events_per_thread_, 0);
+}
+
+LightweightStepStatsCollector::~LightweightStepStatsCollector() {}
+
+uint64 LightweightStepStatsCollector::Now() const {
+  if (use_cycle_counter_) {
+    return profile_utils::CpuUtils::GetCurrentClockCycle();
+  }
+  return Env::Default()->NowNanos();
+}
+
+NodeExecStatsInterface* LightweightStepStatsCollector::CreateNodeExecStats(
+    const Node* node) {
+  return NodeStats::Get(this, node);
+}
+
+LightweightStepStatsCollector::ThreadBuffer*
+LightweightStepStatsCollector::GetThreadBuffer() {
+  // The collector a thread recorded into last, and its buffer. Collector ids
+  // are never reused, so a stale entry never matches.
+  struct CachedBuffer {
+    uint64 collector_id = 0;
+    ThreadBuffer* buffer = nullptr;
+  };
+  static thread_local CachedBuffer cached;
+  if (cached.collector_id == id_) {
+    return cached.buffer;
+  }
+  const std::thread::id thread_id = std::this_thread::get_id();
+  ThreadBuffer* buffer = nullptr;
+  {
+    mutex_lock l(mu_);
+    for (const auto& b : buffers_) {
+      if (b->thread_id == thread_id) {
+        buffer = b.get();
+        break;
+      }
+    }
+    if (buffer == nullptr) {
+      buffers_.emplace_back(new ThreadBuffer);
+      buffer = buffers_.back().get();
+      buffer->thread_id = thread_id;
+      buffer->events.reserve(std::min(max_events_per_thread_, 256));
+    }
+  }
+  cached.collector_id = id_;
+  cached.buffer = buffer;
+  return buffer;
+}
+
+void LightweightStepStatsCollector::Record(const Event& event) {
+  ThreadBuffer* buffer = GetThreadBuffer();
+  if (buffer->num_recorded < max_events_per_thread_) {
+    buffer->events.push_back(event);
+  } else {
+    buffer->events[buffer->num_recorded % max_events_per_thread_] = event;
+  }
+  ++buffer->num_recorded;
+}
+
+void LightweightStepStatsCollector::Finalize() {
+  mutex_lock l(mu_);
+  if (!step_stats_ || finalized_) {
+    return;
+  }
+  finalized_ = true;
+
+  // Calibrate the ticks against the wall clock over the whole step, rather
+  // than trusting the nominal frequency of the cycle counter.
+  const uint64 end_ticks = Now();
+  const int64 end_nanos = Env::Default()->NowNanos();
+  double nanos_per_tick = 1.0;
+  if (use_cycle_counter_ && end_ticks > start_ticks_) {
+    nanos_per_tick = static_cast<double>(end_nanos - start_nanos_) /
+                     static_cast<double>(end_ticks - start_ticks_);
+  }
+  auto to_nanos = [this, nanos_per_tick](uint64 ticks) -> int64 {
+    const int64 delta = static_cast<int64>(ticks - start_ticks_);
+    return start_nanos_ + static_cast<int64>(delta * nanos_per_tick);
+  };
+
+  std::map<string, DeviceStepStats*> dev_stats_pb;
+  for (auto& ds : *step_stats_->mutable_dev_stats()) {
+    dev_stats_pb[ds.device()] = &ds;
+  }
+  for (const auto& buffer : buffers_) {
+    const int64 num_events = buffer->events.size();
+    num_dropped_events_ += buffer->num_recorded - num_events;
+    // Emit the events oldest first.
+    const int64 first = buffer->num_recorded % num_events;
+    for (int64 i = 0; i < num_events; ++i) {
+      const Event& event = buffer->events[(first + i) % num_events];
+      DeviceStepStats*& dss = dev_stats_pb[*event.device];
+      if (dss == nullptr) {
+        dss = step_stats_->add_dev_stats();
+        dss->set_device(*event.device);
+      }
+      NodeExecStats* ns = dss->add_node_stats();
+      ns->set_node_name(event.node->name());
+      if (event.scheduled_nanos != 0) {
+        ns->set_scheduled_micros(event.scheduled_nanos /
+                                 EnvTime::kMicrosToNanos);
+        ns->set_scheduled_nanos(event.scheduled_nanos);
+      }
+      const int64 all_start_nanos = to_nanos(event.all_start);
+      ns->set_all_start_micros(all_start_nanos / EnvTime::kMicrosToNanos);
+      ns->set_all_start_nanos(all_start_nanos);
+      if (event.op_start != 0) {
+        const int64 rel_nanos = to_nanos(event.op_start) - all_start_nanos;
+        ns->set_op_start_rel_micros(rel_nanos / EnvTime::kMicrosToNanos);
+        ns->set_op_start_rel_nanos(rel_nanos);
+      }
+      if (event.op_end != 0) {
+        const int64 rel_nanos = to_nanos(event.op_end) - all_start_nanos;
+        ns->set_op_end_rel_micros(rel_nanos / EnvTime::kMicrosToNanos);
+        ns->set_op_end_rel_nanos(rel_nanos);
+      }
+      const int64 all_end_rel_nanos = to_nanos(event.all_end) - all_start_nanos;
+      ns->set_all_end_rel_micros(all_end_rel_nanos / EnvTime::kMicrosToNanos);
+      ns->set_all_end_rel_nanos(all_end_rel_nanos);
+      ns->set_timeline_label(strings::StrCat(
+          event.node->name(), " = ", event.node->type_string(), "(",
+          str_util::Join(event.node->requested_inputs(), ", "), ")"));
+    }
+  }
+  if (num_dropped_events_ > 0) {
+    VLOG(1) << "Dropped " << num_dropped_events_
+            << " node stats because per-thread buffers were full.";
+  }
+}
+
 }  // namespace tensorflow
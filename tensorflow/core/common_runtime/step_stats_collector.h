@@ -22,6 +22,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_reference.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/platform/types.h"
@@ -39,33 +40,85 @@ class StepStats;
 class Tensor;
 class TrackingAllocator;
 
+class StepStatsCollector;
+
+// Statistics collection interface for one execution of a node.
+//
+// An executor creates one with StepStatsCollectorInterface::
+// CreateNodeExecStats(), records the progress of the node through it, and
+// hands it back with Done(), after which it must not be used.
+class NodeExecStatsInterface {
+ public:
+  virtual ~NodeExecStatsInterface() {}
+
+  // Called when the node is done. The collector that created these stats
+  // takes them back. `device` must outlive the collector.
+  virtual void Done(const string& device) = 0;
+
+  // Records the absolute time in nanoseconds at which this node became
+  // runnable (i.e. was scheduled for execution).
+  virtual void SetScheduled(int64 nanos) = 0;
+
+  // Called immediately after this node starts being processed by the executor.
+  virtual void RecordExecutorStarted() = 0;
+
+  // Called immediately before this node's `Compute()` or `ComputeAsync()`
+  // method is called.
+  virtual void RecordComputeStarted() = 0;
+
+  // Called immediately after this node's `Compute()` method returned (or, for
+  // asynchronous operations, the callback passed to its `ComputeAsync()` method
+  // was called).
+  virtual void RecordComputeEnded() = 0;
+
+  // Called immediately after this executor finishes processing this node.
+  virtual void RecordExecutorEnded() = 0;
+
+  // Returns true if the allocations of this node should be tracked and
+  // reported with SetMemory().
+  virtual bool TrackAllocations() const = 0;
+
+  // Records information about the memory allocated during the execution of this
+  // node.
+  virtual void SetMemory(OpKernelContext* ctx) = 0;
+
+  // Records information about the tensor produced by this node at the given
+  // output slot.
+  virtual void SetOutput(int slot, const Tensor* v) = 0;
+
+  // Records information about the tensors that were accessed during the
+  // execution of this node.
+  virtual void SetReferencedTensors(const TensorReferenceVector& tensors) = 0;
+};
+
 // Wraps NodeExecStats and adds allocation to it.
-class NodeExecStatsWrapper {
+class NodeExecStatsWrapper : public NodeExecStatsInterface {
  public:
   NodeExecStatsWrapper(const string& node_name);
   // Owns 'stats'.
   NodeExecStatsWrapper(NodeExecStats* stats);
+  // The stats of an execution of `node`, which Done() saves to `collector`.
+  NodeExecStatsWrapper(const Node* node, StepStatsCollector* collector);
 
   // Destructor calls Finalize() to release the TrackingAllocators.
-  ~NodeExecStatsWrapper() { Finalize(); }
+  ~NodeExecStatsWrapper() override { Finalize(); }
 
-  // Records the absolute time in nanoseconds at which this node became
-  // runnable (i.e. was scheduled for execution).
-  void SetScheduled(int64 nanos) {
+  // Sets the timeline label and saves these stats to the collector that
+  // created them, unless the node is a transfer node.
+  void Done(const string& device) override;
+
+  void SetScheduled(int64 nanos) override {
     stats_->set_scheduled_micros(nanos / EnvTime::kMicrosToNanos);
     stats_->set_scheduled_nanos(nanos);
   }
 
-  // Called immediately after this node starts being processed by the executor.
-  void RecordExecutorStarted() {
+  void RecordExecutorStarted() override {
     int64 now_nanos = Env::Default()->NowNanos();
     stats_->set_all_start_micros(now_nanos / EnvTime::kMicrosToNanos);
     stats_->set_all_start_nanos(now_nanos);
   }
 
-  // Called immediately before this node's `Compute()` or `ComputeAsync()`
-  // method is called.
-  void RecordComputeStarted() {
+  void RecordComputeStarted() override {
     int64 now_nanos = Env::Default()->NowNanos();
     DCHECK_NE(stats_->all_start_micros(), 0);
     DCHECK_NE(stats_->all_start_nanos(), 0);
@@ -74,10 +127,7 @@ class NodeExecStatsWrapper {
     stats_->set_op_start_rel_nanos(now_nanos - stats_->all_start_nanos());
   }
 
-  // Called immediately after this node's `Compute()` method returned (or, for
-  // asynchronous operations, the callback passed to its `ComputeAsync()` method
-  // was called).
-  void RecordComputeEnded() {
+  void RecordComputeEnded() override {
     int64 now_nanos = Env::Default()->NowNanos();
     DCHECK_NE(stats_->all_start_micros(), 0);
     DCHECK_NE(stats_->all_start_nanos(), 0);
@@ -86,8 +136,7 @@ class NodeExecStatsWrapper {
     stats_->set_op_end_rel_nanos(now_nanos - stats_->all_start_nanos());
   }
 
-  // Called immediately after this executor finishes processing this node.
-  void RecordExecutorEnded() {
+  void RecordExecutorEnded() override {
     int64 now_nanos = Env::Default()->NowNanos();
     DCHECK_NE(stats_->all_start_micros(), 0);
     DCHECK_NE(stats_->all_start_nanos(), 0);
@@ -96,17 +145,10 @@ class NodeExecStatsWrapper {
     stats_->set_all_end_rel_nanos(now_nanos - stats_->all_start_nanos());
   }
 
-  // Records information about the tensor produced by this node at the given
-  // output slot.
-  void SetOutput(int slot, const Tensor* v);
-
-  // Records information about the memory allocated during the execution of this
-  // node.
-  void SetMemory(OpKernelContext* ctx);
-
-  // Records information about the tensors that were accessed during the
-  // execution of this node.
-  void SetReferencedTensors(const TensorReferenceVector& tensors);
+  bool TrackAllocations() const override { return true; }
+  void SetMemory(OpKernelContext* ctx) override;
+  void SetOutput(int slot, const Tensor* v) override;
+  void SetReferencedTensors(const TensorReferenceVector& tensors) override;
 
   // Sets the timeline_label field of the wrapped NodeExecStats, using data
   // from *node. Returns true iff the node is a transfer node.
@@ -128,6 +170,9 @@ class NodeExecStatsWrapper {
   gtl::InlinedVector<std::pair<AllocatorMemoryUsed*, TrackingAllocator*>, 2>
       allocations_;
   std::unique_ptr<NodeExecStats> stats_;
+  // Not owned. Set for stats created by StepStatsCollector.
+  const Node* const node_ = nullptr;
+  StepStatsCollector* const step_stats_collector_ = nullptr;
 };
 
 // Statistics collection interface for individual node execution.
@@ -138,8 +183,9 @@ class StepStatsCollectorInterface {
  public:
   virtual ~StepStatsCollectorInterface() {}
 
-  // Saves `stats` to the collector.
-  virtual void Save(const string& device, NodeExecStatsWrapper* stats) = 0;
+  // Creates the stats of one execution of `node`. The caller hands them back
+  // with NodeExecStatsInterface::Done().
+  virtual NodeExecStatsInterface* CreateNodeExecStats(const Node* node) = 0;
 
   // Generates a string reporting the currently used memory based
   // on ResourceExhausted OOM `err` message.
@@ -167,7 +213,9 @@ class StepStatsCollector : public StepStatsCollectorInterface {
   // Save saves nt to the DeviceStats object associated with device.
   // Should be called before Finalize.
   void Save(const string& device, NodeExecStats* nt);
-  void Save(const string& device, NodeExecStatsWrapper* stats) override;
+  void Save(const string& device, NodeExecStatsWrapper* stats);
+
+  NodeExecStatsInterface* CreateNodeExecStats(const Node* node) override;
 
   string ReportAllocsOnResourceExhausted(const string& err) override;
 
@@ -192,6 +240,88 @@ class StepStatsCollector : public StepStatsCollectorInterface {
   uint64 collectedNodes GUARDED_BY(mu_) = 0;
 };
 
+// A collector for tracing steps in production at a low overhead. It only
+// records when each node was scheduled, started and ended, as a fixed-size
+// event in a buffer of the thread that finished the node, without taking a
+// lock or allocating memory. The events are converted into the StepStats at
+// the end of the step, by Finalize().
+//
+// Timestamps are read from the CPU cycle counter if there is one, and are
+// converted to wall time using the cycles and time elapsed during the step.
+// Each thread keeps the latest `max_events_per_thread` events of a step; the
+// older ones are dropped. The memory and outputs of the nodes are not
+// recorded.
+//
+// The graphs of the nodes and the devices passed to Done() must outlive the
+// collector.
+class LightweightStepStatsCollector : public StepStatsCollectorInterface {
+ public:
+  // Does not take ownership of `ss`.
+  explicit LightweightStepStatsCollector(StepStats* ss,
+                                         int max_events_per_thread = 1 << 14);
+  ~LightweightStepStatsCollector() override;
+
+  NodeExecStatsInterface* CreateNodeExecStats(const Node* node) override;
+
+  // Allocations are not tracked, so there is nothing to report.
+  string ReportAllocsOnResourceExhausted(const string& err) override {
+    return "";
+  }
+
+  // Converts the recorded events into the StepStats passed to the
+  // constructor. Must be called once all nodes are done. Calling it more
+  // than once won't have any effect.
+  void Finalize();
+
+  // Returns the number of events that were dropped because the buffer of
+  // their thread was full. Only valid after Finalize().
+  int64 num_dropped_events() const { return num_dropped_events_; }
+
+ private:
+  class NodeStats;
+  struct ThreadBuffer;
+
+  // A compact record of the execution of one node. Times other than
+  // `scheduled_nanos` are in ticks of Now().
+  struct Event {
+    const Node* node;
+    const string* device;
+    int64 scheduled_nanos;
+    uint64 all_start;
+    uint64 op_start;
+    uint64 op_end;
+    uint64 all_end;
+  };
+
+  // Returns the current time, in cycles if use_cycle_counter_, otherwise in
+  // nanoseconds.
+  uint64 Now() const;
+
+  // Appends `event` to the buffer of the calling thread.
+  void Record(const Event& event);
+
+  // Returns the buffer of the calling thread, creating it if needed.
+  ThreadBuffer* GetThreadBuffer();
+
+  // Identifies this collector among all the collectors of the process, so
+  // that threads can cache their buffer.
+  const uint64 id_;
+  StepStats* const step_stats_;
+  const int max_events_per_thread_;
+  const bool use_cycle_counter_;
+  // The time at which the collector was created, in ticks of Now() and in
+  // nanoseconds.
+  const uint64 start_ticks_;
+  const int64 start_nanos_;
+  int64 num_dropped_events_ = 0;
+
+  mutex mu_;
+  bool finalized_ GUARDED_BY(mu_) = false;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(LightweightStepStatsCollector);
+};
+
 }  // namespace tensorflow
 
 #endif  // TENSORFLOW_CORE_COMMON_RUNTIME_STEP_STATS_COLLECTOR_H_
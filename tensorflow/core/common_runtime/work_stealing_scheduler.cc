@@ -0,0 +1,164 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/work_stealing_scheduler.h"
+
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+namespace {
+
+// Identifies the scheduler and queue owned by the worker running on the
+// calling thread, if any. Saved and restored around each drain loop so that
+// schedulers can nest (e.g. a function executor run inline from a kernel).
+struct CurrentWorker {
+  const WorkStealingScheduler* scheduler;
+  int queue_id;
+};
+thread_local CurrentWorker current_worker = {nullptr, -1};
+
+}  // namespace
+
+WorkStealingScheduler::WorkStealingScheduler(int max_workers, Runner runner)
+    : max_workers_(max_workers),
+      runner_(std::move(runner)),
+      queues_(new WorkQueue[max_workers + 1]),
+      num_active_workers_(0),
+      num_pending_(0),
+      num_steals_(0) {
+  CHECK_GT(max_workers_, 0);
+  free_ids_.reserve(max_workers_);
+  for (int i = max_workers_ - 1; i >= 0; --i) {
+    free_ids_.push_back(i);
+  }
+}
+
+WorkStealingScheduler::~WorkStealingScheduler() {
+  DCHECK_EQ(num_pending_.load(), 0);
+  DCHECK_EQ(num_active_workers_.load(), 0);
+}
+
+void WorkStealingScheduler::Schedule(Closure fn) {
+  const int queue_id = current_worker.scheduler == this
+                           ? current_worker.queue_id
+                           : max_workers_;
+  {
+    WorkQueue& queue = queues_[queue_id];
+    mutex_lock l(queue.mu);
+    queue.closures.push_back(std::move(fn));
+  }
+  // NOTE: num_pending_ must be incremented before we look at the number of
+  // active workers. A worker that is about to exit decrements
+  // num_active_workers_ before re-checking num_pending_, so either it sees
+  // this closure or we see its free slot and start a new worker.
+  num_pending_.fetch_add(1);
+  MaybeStartWorker();
+}
+
+bool WorkStealingScheduler::IsCurrentThreadWorker() const {
+  return current_worker.scheduler == this;
+}
+
+bool WorkStealingScheduler::TryReserveWorker() {
+  int active = num_active_workers_.load();
+  while (active < max_workers_) {
+    if (num_active_workers_.compare_exchange_weak(active, active + 1)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void WorkStealingScheduler::MaybeStartWorker() {
+  if (!TryReserveWorker()) return;
+  Ref();
+  runner_([this]() {
+    WorkerLoop();
+    Unref();
+  });
+}
+
+int WorkStealingScheduler::AcquireQueueId() {
+  mutex_lock l(ids_mu_);
+  // A queue id is always released before its active-worker slot, so a
+  // worker holding a slot is guaranteed to find a free id.
+  DCHECK(!free_ids_.empty());
+  const int id = free_ids_.back();
+  free_ids_.pop_back();
+  return id;
+}
+
+void WorkStealingScheduler::ReleaseQueueId(int id) {
+  mutex_lock l(ids_mu_);
+  free_ids_.push_back(id);
+}
+
+bool WorkStealingScheduler::NextClosure(int id, Closure* fn) {
+  if (num_pending_.load(std::memory_order_relaxed) == 0) {
+    return false;
+  }
+  // Own deque: LIFO, so the most recently produced work runs next.
+  {
+    WorkQueue& queue = queues_[id];
+    mutex_lock l(queue.mu);
+    if (!queue.closures.empty()) {
+      *fn = std::move(queue.closures.back());
+      queue.closures.pop_back();
+      num_pending_.fetch_sub(1);
+      return true;
+    }
+  }
+  // Injection queue first, then the other workers: FIFO, so that thieves
+  // take the oldest (coldest) work and leave the owner its recent work.
+  for (int i = 0; i < max_workers_; ++i) {
+    const int victim = i == 0 ? max_workers_ : (id + i) % max_workers_;
+    WorkQueue& queue = queues_[victim];
+    mutex_lock l(queue.mu);
+    if (!queue.closures.empty()) {
+      *fn = std::move(queue.closures.front());
+      queue.closures.pop_front();
+      num_pending_.fetch_sub(1);
+      num_steals_.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  return false;
+}
+
+void WorkStealingScheduler::WorkerLoop() {
+  const CurrentWorker saved = current_worker;
+  int id = AcquireQueueId();
+  current_worker = {this, id};
+  Closure fn;
+  while (true) {
+    if (NextClosure(id, &fn)) {
+      fn();
+      fn = nullptr;
+      continue;
+    }
+    // Our own deque is empty here, and only this worker pushes to it, so it
+    // is safe to hand the id back.
+    ReleaseQueueId(id);
+    current_worker = saved;
+    num_active_workers_.fetch_sub(1);
+    // Re-check for work scheduled while all slots appeared to be taken.
+    if (num_pending_.load() == 0 || !TryReserveWorker()) break;
+    id = AcquireQueueId();
+    current_worker = {this, id};
+  }
+}
+
+}  // namespace tensorflow
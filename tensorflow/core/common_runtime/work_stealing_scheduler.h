@@ -0,0 +1,118 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_WORK_STEALING_SCHEDULER_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_WORK_STEALING_SCHEDULER_H_
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/lib/core/refcount.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// WorkStealingScheduler multiplexes closures onto at most "max_workers"
+// long-running workers, each of which is started by handing a drain loop
+// to an underlying "runner" (typically backed by the inter-op thread pool).
+//
+// Every worker owns a deque. A closure scheduled from inside a worker is
+// pushed onto that worker's own deque and is popped LIFO by the owner, so
+// that successors of a node tend to run on the thread that produced their
+// inputs while the data is still hot in its caches. Closures scheduled from
+// any other thread go to a shared injection queue. A worker whose own deque
+// is empty steals FIFO from the injection queue and then from the other
+// workers. New workers are only started while fewer than "max_workers" are
+// active, and a worker exits once it finds no work anywhere.
+//
+// The scheduler is reference counted: each running worker holds a
+// reference, so the owner may drop its reference while workers are still
+// draining.
+class WorkStealingScheduler : public core::RefCounted {
+ public:
+  typedef std::function<void()> Closure;
+  typedef std::function<void(Closure)> Runner;
+
+  // REQUIRES: max_workers > 0.
+  WorkStealingScheduler(int max_workers, Runner runner);
+
+  // Schedules "fn" to run on one of the workers.
+  void Schedule(Closure fn);
+
+  // Returns true iff the calling thread is currently running a worker of
+  // this scheduler.
+  bool IsCurrentThreadWorker() const;
+
+  int max_workers() const { return max_workers_; }
+
+  // Number of closures that were run by a worker other than the one that
+  // scheduled them (including closures taken from the injection queue).
+  int64 num_steals() const {
+    return num_steals_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  ~WorkStealingScheduler() override;
+
+  struct WorkQueue {
+    mutex mu;
+    std::deque<Closure> closures GUARDED_BY(mu);
+  };
+
+  // Starts a new worker if fewer than max_workers_ are active.
+  void MaybeStartWorker();
+
+  // Atomically claims an active-worker slot. Returns false if all
+  // max_workers_ slots are taken.
+  bool TryReserveWorker();
+
+  // The drain loop run by each worker.
+  void WorkerLoop();
+
+  // Takes the next closure for worker "id": its own deque first, then the
+  // injection queue, then the other workers' deques.
+  bool NextClosure(int id, Closure* fn);
+
+  int AcquireQueueId();
+  void ReleaseQueueId(int id);
+
+  const int max_workers_;
+  const Runner runner_;
+
+  // queues_[0, max_workers_) are owned by workers; queues_[max_workers_] is
+  // the shared injection queue.
+  std::unique_ptr<WorkQueue[]> queues_;
+
+  mutex ids_mu_;
+  std::vector<int> free_ids_ GUARDED_BY(ids_mu_);
+
+  // Number of workers currently started or running.
+  std::atomic<int> num_active_workers_;
+  // Number of closures queued but not yet taken by a worker.
+  std::atomic<int64> num_pending_;
+  std::atomic<int64> num_steals_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(WorkStealingScheduler);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_WORK_STEALING_SCHEDULER_H_
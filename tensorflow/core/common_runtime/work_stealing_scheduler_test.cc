@@ -0,0 +1,110 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/work_stealing_scheduler.h"
+
+#include <atomic>
+
+#include "tensorflow/core/lib/core/blocking_counter.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+WorkStealingScheduler* NewScheduler(int max_workers,
+                                    thread::ThreadPool* pool) {
+  return new WorkStealingScheduler(
+      max_workers, [pool](std::function<void()> fn) { pool->Schedule(fn); });
+}
+
+TEST(WorkStealingSchedulerTest, RunsAllClosures) {
+  thread::ThreadPool pool(Env::Default(), "test", 4);
+  WorkStealingScheduler* scheduler = NewScheduler(4, &pool);
+  const int kNumClosures = 10000;
+  std::atomic<int> count(0);
+  BlockingCounter done(kNumClosures);
+  for (int i = 0; i < kNumClosures; ++i) {
+    scheduler->Schedule([&count, &done]() {
+      count++;
+      done.DecrementCount();
+    });
+  }
+  done.Wait();
+  EXPECT_EQ(kNumClosures, count);
+  scheduler->Unref();
+}
+
+TEST(WorkStealingSchedulerTest, NestedScheduling) {
+  thread::ThreadPool pool(Env::Default(), "test", 4);
+  WorkStealingScheduler* scheduler = NewScheduler(4, &pool);
+  EXPECT_FALSE(scheduler->IsCurrentThreadWorker());
+  // Each closure spawns a binary tree of closures from inside a worker,
+  // which exercises both the local deques and stealing.
+  const int kDepth = 12;
+  const int kNumClosures = (1 << (kDepth + 1)) - 1;
+  std::atomic<int> count(0);
+  std::atomic<int> num_on_worker(0);
+  BlockingCounter done(kNumClosures);
+  std::function<void(int)> spawn;
+  spawn = [&](int depth) {
+    scheduler->Schedule([&, depth]() {
+      if (scheduler->IsCurrentThreadWorker()) num_on_worker++;
+      count++;
+      if (depth > 0) {
+        spawn(depth - 1);
+        spawn(depth - 1);
+      }
+      done.DecrementCount();
+    });
+  };
+  spawn(kDepth);
+  done.Wait();
+  EXPECT_EQ(kNumClosures, count);
+  EXPECT_EQ(kNumClosures, num_on_worker);
+  scheduler->Unref();
+}
+
+TEST(WorkStealingSchedulerTest, OwnerOutlivedByWorkers) {
+  thread::ThreadPool pool(Env::Default(), "test", 2);
+  WorkStealingScheduler* scheduler = NewScheduler(2, &pool);
+  BlockingCounter done(100);
+  for (int i = 0; i < 100; ++i) {
+    scheduler->Schedule([&done]() { done.DecrementCount(); });
+  }
+  // Dropping the owner's reference must not wait for or break the workers.
+  scheduler->Unref();
+  done.Wait();
+}
+
+static void BM_Schedule(int iters, int num_threads) {
+  testing::StopTiming();
+  thread::ThreadPool pool(Env::Default(), "bench", num_threads);
+  WorkStealingScheduler* scheduler = NewScheduler(num_threads, &pool);
+  BlockingCounter done(iters);
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    scheduler->Schedule([&done]() { done.DecrementCount(); });
+  }
+  done.Wait();
+  testing::StopTiming();
+  scheduler->Unref();
+}
+BENCHMARK(BM_Schedule)->Arg(1)->Arg(4)->Arg(16);
+
+}  // namespace
+}  // namespace tensorflow
@@ -82,6 +82,15 @@ void BaseRendezvousMgr::RecvLocalAsync(int64 step_id,
   rendez->RecvLocalAsync(parsed, std::move(done_cb));
 }
 
+bool BaseRendezvousMgr::TryRecvLocal(int64 step_id,
+                                     const Rendezvous::ParsedKey& parsed,
+                                     Rendezvous::DoneCallback done) {
+  BaseRemoteRendezvous* rendez = FindOrCreate(step_id);
+  // "done" is either run before TryRecvLocal returns or not at all.
+  core::ScopedUnref unref(rendez);
+  return rendez->TryRecvLocal(parsed, std::move(done));
+}
+
 Status BaseRendezvousMgr::RecvLocal(int64 step_id,
                                     const Rendezvous::ParsedKey& parsed,
                                     Tensor* val, bool* is_dead) {
@@ -358,6 +367,18 @@ void BaseRemoteRendezvous::RecvLocalAsyncInternal(const ParsedKey& parsed,
   local_->RecvAsync(parsed, Args(), std::move(done));
 }
 
+bool BaseRemoteRendezvous::TryRecvLocal(const ParsedKey& parsed,
+                                        DoneCallback done) {
+  // Before Initialize(), no tensor of the step can have been produced.
+  if (!is_initialized()) return false;
+  Status s = ValidateDevices(parsed, true /* is_src */);
+  if (!s.ok()) {
+    done(s, Args(), Args(), Tensor(), false);
+    return true;
+  }
+  return local_->TryRecv(parsed, Args(), std::move(done));
+}
+
 void BaseRemoteRendezvous::StartAbort(const Status& s) {
   CHECK(!s.ok());
   local_->StartAbort(s);
@@ -78,6 +78,14 @@ class BaseRendezvousMgr : public RendezvousMgrInterface {
   void RecvLocalAsync(int64 step_id, const Rendezvous::ParsedKey& parsed,
                       Rendezvous::DoneCallback done) override;
 
+  // Runs "done" and returns true if the tensor for "parsed" has already been
+  // produced or an error occurs. Returns false without running "done"
+  // otherwise.
+  //
+  // This method is used by the rpc handler of RecvTensors.
+  bool TryRecvLocal(int64 step_id, const Rendezvous::ParsedKey& parsed,
+                    Rendezvous::DoneCallback done) override;
+
   // Synchronous wrapper for RecvLocalAsync.
   Status RecvLocal(int64 step_id, const Rendezvous::ParsedKey& parsed,
                    Tensor* val, bool* is_dead) override;
@@ -149,6 +157,10 @@ class BaseRemoteRendezvous : public RemoteRendezvous {
   // REQUIRES: "parsed" is one that will be Saved into the local rendezvous.
   void RecvLocalAsync(const ParsedKey& parsed, DoneCallback done);
 
+  // Like RecvLocalAsync, but returns false without running "done" if the
+  // tensor for "parsed" hasn't been produced yet.
+  bool TryRecvLocal(const ParsedKey& parsed, DoneCallback done);
+
  protected:
   virtual void RecvFromRemoteAsync(const Rendezvous::ParsedKey& parsed,
                                    const Rendezvous::Args& args,
@@ -32,6 +32,7 @@ class CompleteGroupCall : public CancellableCall {
     req_.set_group_size(group.group_size);
     req_.set_device_type(group.device_type.type_string());
     req_.add_device_name(device_name);
+    req_.set_recursive_halving_max_bytes(group.recursive_halving_max_bytes);
   }
   ~CompleteGroupCall() override {}
 
@@ -82,7 +83,7 @@ CollectiveParamResolverDistributed::CollectiveParamResolverDistributed(
     const ConfigProto& config, const DeviceMgr* dev_mgr,
     DeviceResolverDistributed* dev_resolver, WorkerCacheInterface* worker_cache,
     const string& task_name)
-    : CollectiveParamResolverLocal(dev_mgr, dev_resolver, task_name),
+    : CollectiveParamResolverLocal(config, dev_mgr, dev_resolver, task_name),
       worker_cache_(worker_cache),
       group_leader_(task_name == config.experimental().collective_group_leader()
                         ? ""
@@ -91,6 +92,7 @@ CollectiveParamResolverDistributed::CollectiveParamResolverDistributed(
 void CollectiveParamResolverDistributed::CompleteParamsAsync(
     const string& device, CollectiveParams* cp, CancellationManager* cancel_mgr,
     const StatusCallback& done) {
+  cp->group.recursive_halving_max_bytes = recursive_halving_max_bytes_;
   CompleteGroupDistributed(device, cp, cancel_mgr,
                            [this, device, cp, cancel_mgr, done](
                                const Status& s, const GroupRec* gr) {
@@ -110,6 +112,8 @@ void CollectiveParamResolverDistributed::CompleteGroupAsync(
   cp.group.group_key = request->group_key();
   cp.group.group_size = request->group_size();
   cp.group.device_type = DeviceType(request->device_type());
+  cp.group.recursive_halving_max_bytes =
+      request->recursive_halving_max_bytes();
   for (const string& dn : request->device_name()) {
     cp.instance.device_names.push_back(dn);
   }
@@ -122,6 +126,8 @@ void CollectiveParamResolverDistributed::CompleteGroupAsync(
           response->set_group_size(gr->group.group_size);
           response->set_device_type(gr->group.device_type.type_string());
           response->set_num_tasks(gr->task_set.size());
+          response->set_recursive_halving_max_bytes(
+              gr->group.recursive_halving_max_bytes);
           for (const string& dn : gr->device_list) {
             response->add_device_name(dn);
           }
@@ -211,6 +217,7 @@ Status CollectiveParamResolverDistributed::UpdateGroupCache(
   gr->group.group_key = resp.group_key();
   gr->group.group_size = resp.group_size();
   gr->group.num_tasks = resp.num_tasks();
+  gr->group.recursive_halving_max_bytes = resp.recursive_halving_max_bytes();
   if (resp.device_name_size() != gr->group.group_size) {
     return errors::Internal(
         "CompleteGroupResponse group_size doesn't match device_name list");
@@ -319,5 +319,34 @@ TEST_F(DeviceResDistTest, Workers4Devices3) {
   ValidateCollectiveParams(num_workers, num_devices);
 }
 
+TEST_F(DeviceResDistTest, DifferentRecursiveHalvingMaxBytes) {
+  const string leader = "/job:worker/replica:0/task:0";
+  const string other = "/job:worker/replica:0/task:1";
+  ConfigProto config;
+  config.mutable_experimental()->set_collective_group_leader(leader);
+  DefineWorker(config, leader, "CPU", 1);
+  config.mutable_experimental()->set_collective_recursive_halving_max_bytes(
+      1024);
+  DefineWorker(config, other, "CPU", 1);
+  DefineCollectiveParams(2, 1);
+
+  // The device of the leader creates the group, and the device of the task
+  // with a different setting is refused rather than later picking another
+  // all-reduce implementation.
+  cp_resolvers_[leader]->CompleteParamsAsync(
+      strings::StrCat(leader, "/device:CPU:0"), &cp_[0], &cm_,
+      [](const Status& s) {});
+  Notification note;
+  Status status;
+  cp_resolvers_[other]->CompleteParamsAsync(
+      strings::StrCat(other, "/device:CPU:0"), &cp_[1], &cm_,
+      [&note, &status](const Status& s) {
+        status = s;
+        note.Notify();
+      });
+  note.WaitForNotification();
+  EXPECT_TRUE(errors::IsInvalidArgument(status)) << status;
+}
+
 }  // namespace
 }  // namespace tensorflow
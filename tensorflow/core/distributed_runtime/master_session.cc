@@ -1245,6 +1245,11 @@ Status MasterSession::CreateWorkerSessions(
       return status;
     }
 
+    // Workers use the RPC options of the session to talk to each other.
+    *workers[i]
+         .request.mutable_server_def()
+         ->mutable_default_session_config()
+         ->mutable_rpc_options() = session_opts_.config.rpc_options();
     if (options.cluster_def) {
       *workers[i].request.mutable_server_def()->mutable_cluster() =
           *options.cluster_def;
@@ -1255,7 +1260,7 @@ Status MasterSession::CreateWorkerSessions(
       // is in use.
       workers[i].request.set_isolate_session_state(true);
     } else {
-      // NOTE(mrry): Do not set any component of the ServerDef,
+      // NOTE(mrry): Do not set any other component of the ServerDef,
       // because the worker will use its local configuration.
       workers[i].request.set_isolate_session_state(
           session_opts_.config.isolate_session_state());
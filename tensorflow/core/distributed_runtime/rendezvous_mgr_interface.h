@@ -81,6 +81,14 @@ class RendezvousMgrInterface {
                               const Rendezvous::ParsedKey& parsed,
                               Rendezvous::DoneCallback done) = 0;
 
+  // Runs "done" and returns true if the tensor for "parsed" has already been
+  // produced or an error occurs. Returns false without running "done"
+  // otherwise.
+  //
+  // This method is used by the rpc handler of RecvTensors.
+  virtual bool TryRecvLocal(int64 step_id, const Rendezvous::ParsedKey& parsed,
+                            Rendezvous::DoneCallback done) = 0;
+
   // Synchronous wrapper for RecvLocalAsync.
   virtual Status RecvLocal(int64 step_id, const Rendezvous::ParsedKey& parsed,
                            Tensor* val, bool* is_dead) = 0;
@@ -55,6 +55,7 @@ class GrpcRemoteWorker : public WorkerInterface {
         cleanupall_(Method(GrpcWorkerMethod::kCleanupAll)),
         recvtensor_(Method(GrpcWorkerMethod::kRecvTensor)),
         recvbuf_(Method(GrpcWorkerMethod::kRecvBuf)),
+        recvtensors_(Method(GrpcWorkerMethod::kRecvTensors)),
         logging_(Method(GrpcWorkerMethod::kLogging)),
         tracing_(Method(GrpcWorkerMethod::kTracing)),
         completegroup_(Method(GrpcWorkerMethod::kCompleteGroup)),
@@ -124,6 +125,13 @@ class GrpcRemoteWorker : public WorkerInterface {
     IssueRequest(request, response, recvbuf_, std::move(done), call_opts);
   }
 
+  void RecvTensorsAsync(CallOptions* call_opts,
+                        const RecvTensorsRequest* request,
+                        RecvTensorsResponse* response,
+                        StatusCallback done) override {
+    IssueRequest(request, response, recvtensors_, std::move(done), call_opts);
+  }
+
   void CompleteGroupAsync(CallOptions* call_opts,
                           const CompleteGroupRequest* request,
                           CompleteGroupResponse* response,
@@ -246,6 +254,7 @@ class GrpcRemoteWorker : public WorkerInterface {
   const ::grpc::string cleanupall_;
   const ::grpc::string recvtensor_;
   const ::grpc::string recvbuf_;
+  const ::grpc::string recvtensors_;
   const ::grpc::string logging_;
   const ::grpc::string tracing_;
   const ::grpc::string completegroup_;
@@ -17,6 +17,7 @@ limitations under the License.
 #include "grpcpp/support/byte_buffer.h"
 #include "grpcpp/support/slice.h"
 #include "tensorflow/core/common_runtime/dma_helper.h"
+#include "tensorflow/core/distributed_runtime/tensor_coding.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/tensor_reference.h"
@@ -137,6 +138,12 @@ static void EncodeSkeleton(const Tensor& val, io::ProtoEncodeHelper* e) {
 
 void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val,
                               ::grpc::ByteBuffer* result) {
+  EncodeTensorToByteBuffer(is_dead, val, RPCOptions::RAW, result);
+}
+
+void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val,
+                              RPCOptions::TensorEncoding encoding,
+                              ::grpc::ByteBuffer* result) {
   const int kLargeTensorBytes = 1024;
   RecvTensorResponse response;
   if (is_dead) {
@@ -158,7 +165,14 @@ void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val,
     io::ProtoEncodeHelper e_skeleton(skeleton.data(), skeleton.size());
     EncodeSkeleton(val, &e_skeleton);
 
-    StringPiece tdata = val.tensor_data();
+    // The content of "val", or its encoding with "encoding" if it applies.
+    string encoded;
+    const bool is_encoded = encoding != RPCOptions::RAW && !is_dead &&
+                            EncodeTensorContent(encoding, val, &encoded);
+    if (is_encoded) {
+      response.set_encoding(encoding);
+    }
+    StringPiece tdata = is_encoded ? StringPiece(encoded) : val.tensor_data();
     uint32 overall_tensor_proto_bytesize =
         (e_skeleton.size() +
          VarLengthEncodingSize(TensorProto::kTensorContentFieldNumber,
@@ -179,8 +193,9 @@ void EncodeTensorToByteBuffer(bool is_dead, const Tensor& val,
     // backing store, with appropriate reference counts to keep the
     // backing store alive as needed.
     //
-    // We enable this behavior if the tensor is large.
-    bool share_tensor_slice_memory = (tdata.size() > kLargeTensorBytes);
+    // We enable this behavior if the tensor is large and sent raw.
+    bool share_tensor_slice_memory =
+        !is_encoded && (tdata.size() > kLargeTensorBytes);
 
     // (Omitted internal-only conditional)
 
@@ -17,8 +17,10 @@ limitations under the License.
 
 #include "grpcpp/support/byte_buffer.h"
 #include "grpcpp/support/slice.h"
+#include "tensorflow/core/distributed_runtime/tensor_coding.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/test.h"
@@ -100,4 +102,29 @@ TEST_F(GrpcTensorCodingTest, Simple) {
 
 TEST_F(GrpcTensorCodingTest, StringTensor) { DoTestForStrings(DT_STRING); }
 
+TEST_F(GrpcTensorCodingTest, EncodedTensor) {
+  Tensor t(DT_FLOAT, TensorShape({1000}));
+  test::FillFn<float>(&t, [](int i) { return i * 0.25f; });
+  for (RPCOptions::TensorEncoding encoding :
+       {RPCOptions::BFLOAT16, RPCOptions::HALF}) {
+    ::grpc::ByteBuffer buf;
+    grpc::EncodeTensorToByteBuffer(false, t, encoding, &buf);
+    std::vector<::grpc::Slice> slices;
+    (void)buf.Dump(&slices);
+    string tmp;
+    for (const auto& s : slices) {
+      tmp.append(reinterpret_cast<const char*>(s.begin()), s.size());
+    }
+
+    RecvTensorResponse response;
+    EXPECT_TRUE(response.ParseFromString(tmp));
+    EXPECT_EQ(encoding, response.encoding());
+    EXPECT_EQ(t.TotalBytes() / 2, response.tensor().tensor_content().size());
+    Tensor result(DT_FLOAT, TensorShape(response.tensor().tensor_shape()));
+    TF_EXPECT_OK(DecodeTensorContent(
+        encoding, response.tensor().tensor_content(), &result));
+    test::ExpectTensorNear<float>(t, result, 1.0);
+  }
+}
+
 }  // namespace tensorflow
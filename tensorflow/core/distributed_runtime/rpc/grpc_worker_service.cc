@@ -165,6 +165,9 @@ class GrpcWorkerService : public AsyncServiceInterface {
       for (int i = 0; i < 500; ++i) {
         ENQUEUE_REQUEST(RecvBuf, true);
       }
+      for (int i = 0; i < 100; ++i) {
+        ENQUEUE_REQUEST(RecvTensors, true);
+      }
       for (int i = 0; i < 100; ++i) {
         ENQUEUE_REQUEST(RunGraph, true);
       }
@@ -303,6 +306,21 @@ class GrpcWorkerService : public AsyncServiceInterface {
       EnqueueRecvTensorRequestRaw();
     }
 
+    void RecvTensorsHandler(
+        WorkerCall<RecvTensorsRequest, RecvTensorsResponse>* call) {
+      Schedule([this, call]() {
+        CallOptions* call_opts = new CallOptions;
+        call->SetCancelCallback([call_opts]() { call_opts->StartCancel(); });
+        worker_->RecvTensorsAsync(call_opts, &call->request, &call->response,
+                                  [call, call_opts](const Status& s) {
+                                    call->ClearCancelCallback();
+                                    delete call_opts;
+                                    call->SendResponse(ToGrpcStatus(s));
+                                  });
+      });
+      ENQUEUE_REQUEST(RecvTensors, true);
+    }
+
     void CleanupGraphHandler(
         WorkerCall<CleanupGraphRequest, CleanupGraphResponse>* call) {
       Schedule([this, call]() {
@@ -483,10 +501,12 @@ void GrpcWorker::GrpcRecvTensorAsync(CallOptions* opts,
                   << " gpu_info: " << src_dev->tensorflow_gpu_device_info();
               // "val" is on an accelerator device. Uses the device_context to
               // fill the copy on host.
-              StatusCallback copy_ready = [response, done, copy,
-                                           is_dead](const Status& s) {
+              const RPCOptions::TensorEncoding encoding = request->encoding();
+              StatusCallback copy_ready = [response, done, copy, is_dead,
+                                           encoding](const Status& s) {
                 // The value is now ready to be returned on the wire.
-                grpc::EncodeTensorToByteBuffer(is_dead, *copy, response);
+                grpc::EncodeTensorToByteBuffer(is_dead, *copy, encoding,
+                                               response);
                 done(s);
                 delete copy;
               };
@@ -494,7 +514,8 @@ void GrpcWorker::GrpcRecvTensorAsync(CallOptions* opts,
               send_dev_context->CopyDeviceTensorToCPU(
                   &val, request->rendezvous_key(), src_dev, copy, copy_ready);
             } else {
-              grpc::EncodeTensorToByteBuffer(is_dead, val, response);
+              grpc::EncodeTensorToByteBuffer(is_dead, val, request->encoding(),
+                                             response);
               done(Status::OK());
             }
           }
@@ -579,6 +600,122 @@ void GrpcWorker::RecvBufAsync(CallOptions* opts, const RecvBufRequest* request,
       });
 }
 
+// RecvTensorsAsync: encodes the tensors into protocol buffers rather than
+// directly into a ::grpc::ByteBuffer like GrpcRecvTensorAsync, which costs an
+// extra copy. The rendezvous only batches small tensors, for which the round
+// trips saved outweigh the copies.
+//
+// It doesn't wait for the tensors that haven't been produced yet, and reports
+// them as not ready instead. The source may only produce one of them after
+// the caller has received another tensor of the same batch, so waiting for
+// all of them could deadlock the step.
+void GrpcWorker::RecvTensorsAsync(CallOptions* opts,
+                                  const RecvTensorsRequest* request,
+                                  RecvTensorsResponse* response,
+                                  StatusCallback done) {
+  const int num_requests = request->request_size();
+  std::vector<Rendezvous::ParsedKey> parsed_keys(num_requests);
+  std::vector<Device*> src_devs(num_requests, nullptr);
+  for (int i = 0; i < num_requests; ++i) {
+    const RecvTensorRequest& req = request->request(i);
+    Status s = recent_request_ids_.TrackUnique(
+        req.request_id(), "RecvTensors (GrpcWorker)", req);
+    if (s.ok()) {
+      s = Rendezvous::ParseKey(req.rendezvous_key(), &parsed_keys[i]);
+    }
+    if (s.ok()) {
+      s = PrepareRecvTensor(parsed_keys[i], &src_devs[i]);
+    }
+    if (!s.ok()) {
+      done(s);
+      return;
+    }
+    response->add_response();
+  }
+  if (num_requests == 0) {
+    done(Status::OK());
+    return;
+  }
+
+  // Completes the call when the last tensor has been encoded.
+  struct State {
+    mutex mu;
+    Status status GUARDED_BY(mu);
+    int pending GUARDED_BY(mu);
+    StatusCallback done;
+  };
+  State* state = new State;
+  state->pending = num_requests;
+  state->done = std::move(done);
+  auto finish = [state](const Status& s) {
+    bool last;
+    Status status;
+    {
+      mutex_lock l(state->mu);
+      state->status.Update(s);
+      last = --state->pending == 0;
+      status = state->status;
+    }
+    if (last) {
+      state->done(status);
+      delete state;
+    }
+  };
+
+  for (int i = 0; i < num_requests; ++i) {
+    TRACEPRINTF("RecvTensors: %lld %s", request->request(i).step_id(),
+                request->request(i).rendezvous_key().c_str());
+    RecvTensorResponse* resp = response->mutable_response(i);
+    Device* src_dev = src_devs[i];
+    const bool ready = env_->rendezvous_mgr->TryRecvLocal(
+        request->request(i).step_id(), parsed_keys[i],
+        [this, request, i, resp, src_dev, finish](
+            const Status& status, const Rendezvous::Args& send_args,
+            const Rendezvous::Args& recv_args, const Tensor& val,
+            const bool is_dead) {
+          if (!status.ok()) {
+            finish(status);
+            return;
+          }
+          resp->set_is_dead(is_dead);
+          resp->set_send_start_micros(env_->env->NowMicros());
+          if (is_dead) {
+            finish(Status::OK());
+          } else if (src_dev->tensorflow_gpu_device_info() &&
+                     !send_args.alloc_attrs.on_host()) {
+            // "val" is on an accelerator device. Uses the device_context to
+            // fill a copy on host.
+            DeviceContext* send_dev_context = send_args.device_context;
+            CHECK(send_dev_context)
+                << "send dev name: " << src_dev->name()
+                << " gpu_info: " << src_dev->tensorflow_gpu_device_info();
+            AllocatorAttributes alloc_attrs;
+            alloc_attrs.set_gpu_compatible(true);
+            alloc_attrs.set_on_host(true);
+            Allocator* alloc = src_dev->GetAllocator(alloc_attrs);
+            Tensor* copy = new Tensor(alloc, val.dtype(), val.shape());
+            send_dev_context->CopyDeviceTensorToCPU(
+                &val, request->request(i).rendezvous_key(), src_dev, copy,
+                [resp, copy, finish](const Status& s) {
+                  if (s.ok()) {
+                    copy->AsProtoTensorContent(resp->mutable_tensor());
+                  }
+                  delete copy;
+                  finish(s);
+                });
+          } else {
+            val.AsProtoTensorContent(resp->mutable_tensor());
+            finish(Status::OK());
+          }
+        });
+    if (!ready) {
+      // The tensor is left in the rendezvous for a RecvTensor call.
+      response->add_not_ready(i);
+      finish(Status::OK());
+    }
+  }
+}
+
 void GrpcWorker::LoggingAsync(const LoggingRequest* request,
                               LoggingResponse* response, StatusCallback done) {
   auto env = this->env();
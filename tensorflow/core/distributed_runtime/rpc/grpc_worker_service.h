@@ -46,6 +46,13 @@ class GrpcWorker : public Worker {
   virtual void RecvBufAsync(CallOptions* opts, const RecvBufRequest* request,
                             RecvBufResponse* response, StatusCallback done);
 
+  // Receives the tensors of `request` that are already available in the local
+  // rendezvous, and lists the others in `response->not_ready()`.
+  virtual void RecvTensorsAsync(CallOptions* opts,
+                                const RecvTensorsRequest* request,
+                                RecvTensorsResponse* response,
+                                StatusCallback done);
+
   WorkerEnv* env();
 
  private:
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/rpc/rpc_rendezvous_mgr.h"
 
+#include <unordered_map>
 #include <unordered_set>
 
 #include "tensorflow/core/common_runtime/device.h"
@@ -32,15 +33,84 @@ limitations under the License.
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 
+class RpcRendezvousMgr::RecvBatchPolicy {
+ public:
+  // Tensors of at most this many bytes are batched.
+  static const int64 kMaxBatchedTensorBytes = 64 << 10;
+  // A batch is sent as soon as it has this many recvs.
+  static const int kMaxRecvsPerBatch = 256;
+
+  explicit RecvBatchPolicy(int64 window_micros)
+      : window_micros_(window_micros) {}
+
+  // How long a batch waits for more recvs before it is sent. Recvs aren't
+  // batched if it isn't positive.
+  int64 window_micros() const { return window_micros_; }
+
+  // Whether the recv of `key` from `src_worker` should be batched.
+  bool ShouldBatch(const string& src_worker, StringPiece key) {
+    if (window_micros_ <= 0) return false;
+    mutex_lock l(mu_);
+    if (unsupported_workers_.count(src_worker) > 0) return false;
+    const string key_str(key);
+    if (late_keys_.count(key_str) > 0) return false;
+    auto it = small_keys_.find(key_str);
+    return it != small_keys_.end() && it->second;
+  }
+
+  // Records the size of a tensor received on `key`.
+  void RecordTensorSize(StringPiece key, int64 bytes) {
+    if (window_micros_ <= 0) return;
+    mutex_lock l(mu_);
+    // Keys of loop iterations are unique, so bound the memory they use.
+    if (small_keys_.size() >= kMaxKeys) small_keys_.clear();
+    small_keys_[string(key)] = bytes <= kMaxBatchedTensorBytes;
+  }
+
+  // Records that the tensor of `key` wasn't ready when a batch asked for it.
+  // Such a tensor is produced late in the step, so batching it only costs an
+  // extra round trip.
+  void RecordNotReady(StringPiece key) {
+    mutex_lock l(mu_);
+    if (late_keys_.size() >= kMaxKeys) late_keys_.clear();
+    late_keys_.insert(string(key));
+  }
+
+  // Stops batching the recvs from `src_worker`, which doesn't implement
+  // RecvTensors.
+  void MarkUnsupported(const string& src_worker) {
+    mutex_lock l(mu_);
+    unsupported_workers_.insert(src_worker);
+  }
+
+ private:
+  static const size_t kMaxKeys = 1 << 20;
+
+  const int64 window_micros_;
+
+  mutex mu_;
+  std::unordered_map<string, bool> small_keys_ GUARDED_BY(mu_);
+  std::unordered_set<string> late_keys_ GUARDED_BY(mu_);
+  std::unordered_set<string> unsupported_workers_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(RecvBatchPolicy);
+};
+
 namespace {
 
+class RpcRecvTensorsCall;
+
 class RpcRemoteRendezvous : public BaseRemoteRendezvous {
  public:
-  RpcRemoteRendezvous(const WorkerEnv* env, int64 step_id)
-      : BaseRemoteRendezvous(env, step_id) {}
+  RpcRemoteRendezvous(
+      const WorkerEnv* env, int64 step_id,
+      std::shared_ptr<RpcRendezvousMgr::RecvBatchPolicy> batch_policy)
+      : BaseRemoteRendezvous(env, step_id),
+        batch_policy_(std::move(batch_policy)) {}
 
  protected:
   void RecvFromRemoteAsync(const Rendezvous::ParsedKey& parsed,
@@ -50,6 +120,34 @@ class RpcRemoteRendezvous : public BaseRemoteRendezvous {
  private:
   ~RpcRemoteRendezvous() override {}
 
+  // Receives the tensor of "parsed" with a RecvTensor call of its own.
+  void RecvOneFromRemoteAsync(const Rendezvous::ParsedKey& parsed,
+                              const Rendezvous::Args& recv_args,
+                              DoneCallback done);
+
+  // Adds the recv of "parsed" to the pending batch of "src_worker", and
+  // sends the batch if it is full.
+  void AddToBatch(const string& src_worker,
+                  const Rendezvous::ParsedKey& parsed, Device* dst_device,
+                  const Rendezvous::Args& recv_args, DoneCallback done);
+
+  // Sends the pending batch of "src_worker" if it is still "batch_id".
+  void FlushBatch(const string& src_worker, int64 batch_id);
+
+  void StartBatch(RpcRecvTensorsCall* call);
+
+  // Returns how the sender should encode the tensor of "parsed", according
+  // to the RPC options of the session.
+  RPCOptions::TensorEncoding RecvEncoding(const Rendezvous::ParsedKey& parsed);
+
+  const std::shared_ptr<RpcRendezvousMgr::RecvBatchPolicy> batch_policy_;
+
+  mutex batch_mu_;
+  int64 next_batch_id_ GUARDED_BY(batch_mu_) = 0;
+  // The batch that is waiting for more recvs, for each source worker.
+  std::unordered_map<string, RpcRecvTensorsCall*> pending_batches_
+      GUARDED_BY(batch_mu_);
+
   TF_DISALLOW_COPY_AND_ASSIGN(RpcRemoteRendezvous);
 };
 
@@ -59,6 +157,7 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
   RpcRecvTensorCall() : wi_(nullptr), dst_device_(nullptr) {}
 
   void Init(WorkerInterface* wi, int64 step_id, StringPiece key,
+            RPCOptions::TensorEncoding encoding,
             AllocatorAttributes alloc_attrs, Device* dst_device,
             const Rendezvous::Args& recv_args, Rendezvous::DoneCallback done) {
     wi_ = wi;
@@ -69,6 +168,7 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
     req_.set_step_id(step_id);
     req_.set_rendezvous_key(key.data(), key.size());
     req_.set_request_id(GetUniqueRequestId());
+    req_.set_encoding(encoding);
   }
 
   void Reset(WorkerCacheInterface* wc) {
@@ -204,10 +304,134 @@ static RpcRecvTensorFreeList* get_call_freelist() {
   return call_freelist;
 }
 
+// Used to retrieve a batch of tensors from the same remote process.
+class RpcRecvTensorsCall : public BaseRecvTensorCall {
+ public:
+  struct Recv {
+    Rendezvous::ParsedKey parsed;
+    Device* dst_device;
+    Rendezvous::Args recv_args;
+    Rendezvous::DoneCallback done;
+  };
+
+  RpcRecvTensorsCall(const string& src_worker, int64 id)
+      : src_worker_(src_worker), id_(id), wi_(nullptr) {}
+
+  ~RpcRecvTensorsCall() override {
+    CHECK_EQ(static_cast<WorkerInterface*>(nullptr), wi_)
+        << "Leaking WorkerInterface in RpcRecvTensorsCall destructor.";
+  }
+
+  void Add(int64 step_id, const Rendezvous::ParsedKey& parsed,
+           Device* dst_device, const Rendezvous::Args& recv_args,
+           Rendezvous::DoneCallback done) {
+    RecvTensorRequest* req = req_.add_request();
+    req->set_step_id(step_id);
+    req->set_rendezvous_key(parsed.FullKey().data(), parsed.FullKey().size());
+    req->set_request_id(GetUniqueRequestId());
+    recvs_.push_back({parsed, dst_device, recv_args, std::move(done)});
+  }
+
+  void set_worker(WorkerInterface* wi) { wi_ = wi; }
+  WorkerInterface* release_worker() {
+    WorkerInterface* wi = wi_;
+    wi_ = nullptr;
+    return wi;
+  }
+
+  void Start(std::function<void()> recv_done) override {
+    wi_->RecvTensorsAsync(&opts_, &req_, &resp_,
+                          [this, recv_done](const Status& s) {
+                            if (!s.ok()) {
+                              mutex_lock l(mu_);
+                              status_.Update(s);
+                            }
+                            recv_done();
+                          });
+  }
+
+  void StartAbort(const Status& s) override {
+    {
+      mutex_lock l(mu_);
+      status_.Update(s);
+    }
+    opts_.StartCancel();
+  }
+
+  Status status() const override {
+    mutex_lock l(mu_);
+    return status_;
+  }
+
+  // Returns which tensors of a successful response weren't ready on the
+  // source worker, and are still there.
+  std::vector<bool> NotReady() const {
+    std::vector<bool> not_ready(recvs_.size(), false);
+    for (int i : resp_.not_ready()) {
+      if (i >= 0 && static_cast<size_t>(i) < not_ready.size()) {
+        not_ready[i] = true;
+      }
+    }
+    return not_ready;
+  }
+
+  // Decodes the i-th tensor of a successful response.
+  Status GetTensor(int i, Tensor* val, bool* is_dead) const {
+    if (i >= resp_.response_size()) {
+      return errors::Internal("RecvTensors response is missing ",
+                              recvs_[i].parsed.FullKey());
+    }
+    const RecvTensorResponse& resp = resp_.response(i);
+    *is_dead = resp.is_dead();
+    if (*is_dead) return Status::OK();
+    return recvs_[i].dst_device->MakeTensorFromProto(
+        resp.tensor(), recvs_[i].recv_args.alloc_attrs, val);
+  }
+
+  const string& src_worker() const { return src_worker_; }
+  int64 id() const { return id_; }
+  int num_recvs() const { return recvs_.size(); }
+  std::vector<Recv>* mutable_recvs() { return &recvs_; }
+
+ private:
+  const string src_worker_;
+  const int64 id_;
+  WorkerInterface* wi_;
+  std::vector<Recv> recvs_;
+  CallOptions opts_;
+  RecvTensorsRequest req_;
+  RecvTensorsResponse resp_;
+
+  mutable mutex mu_;
+  Status status_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(RpcRecvTensorsCall);
+};
+
 void RpcRemoteRendezvous::RecvFromRemoteAsync(
     const Rendezvous::ParsedKey& parsed, const Rendezvous::Args& recv_args,
     DoneCallback done) {
   CHECK(is_initialized());
+  if (batch_policy_->window_micros() > 0) {
+    string src_worker;
+    string src_rel_device;
+    Device* dst_device;
+    // Errors are reported by the unbatched path.
+    if (DeviceNameUtils::SplitDeviceName(parsed.src_device, &src_worker,
+                                         &src_rel_device) &&
+        batch_policy_->ShouldBatch(src_worker, parsed.FullKey()) &&
+        session()->device_mgr()->LookupDevice(parsed.dst_device, &dst_device)
+            .ok()) {
+      AddToBatch(src_worker, parsed, dst_device, recv_args, std::move(done));
+      return;
+    }
+  }
+  RecvOneFromRemoteAsync(parsed, recv_args, std::move(done));
+}
+
+void RpcRemoteRendezvous::RecvOneFromRemoteAsync(
+    const Rendezvous::ParsedKey& parsed, const Rendezvous::Args& recv_args,
+    DoneCallback done) {
   Status s;
 
   // Prepare a RecvTensor call that can handle being aborted.
@@ -238,8 +462,8 @@ void RpcRemoteRendezvous::RecvFromRemoteAsync(
     return;
   }
 
-  call->Init(rwi, step_id_, parsed.FullKey(), recv_args.alloc_attrs, dst_device,
-             recv_args, std::move(done));
+  call->Init(rwi, step_id_, parsed.FullKey(), RecvEncoding(parsed),
+             recv_args.alloc_attrs, dst_device, recv_args, std::move(done));
 
   // Record "call" in active_ so that it can be aborted cleanly.
   RegisterCall(call);
@@ -252,6 +476,10 @@ void RpcRemoteRendezvous::RecvFromRemoteAsync(
     // If StartAbort was called prior to DeregisterCall, then the
     // current status should be bad.
     Status s = call->status();
+    if (s.ok() && !call->is_dead()) {
+      batch_policy_->RecordTensorSize(call->req_.rendezvous_key(),
+                                      call->tensor().TotalBytes());
+    }
     call->done()(s, Args(), call->recv_args(), call->tensor(), call->is_dead());
     session()->worker_cache->ReleaseWorker(call->src_worker_, call->wi_);
     call->wi_ = nullptr;
@@ -260,14 +488,147 @@ void RpcRemoteRendezvous::RecvFromRemoteAsync(
   });
 }
 
+RPCOptions::TensorEncoding RpcRemoteRendezvous::RecvEncoding(
+    const Rendezvous::ParsedKey& parsed) {
+  const RPCOptions& rpc_options = session()->rpc_options;
+  const RPCOptions::TensorEncoding encoding = rpc_options.tensor_encoding();
+  if (encoding == RPCOptions::BFLOAT16 || encoding == RPCOptions::HALF) {
+    const string& scope = rpc_options.lossy_tensor_encoding_scope();
+    if (!str_util::StrContains(parsed.edge_name,
+                               scope.empty() ? "gradients/" : scope)) {
+      return RPCOptions::RAW;
+    }
+  }
+  return encoding;
+}
+
+void RpcRemoteRendezvous::AddToBatch(const string& src_worker,
+                                     const Rendezvous::ParsedKey& parsed,
+                                     Device* dst_device,
+                                     const Rendezvous::Args& recv_args,
+                                     DoneCallback done) {
+  RpcRecvTensorsCall* full_batch = nullptr;
+  {
+    mutex_lock l(batch_mu_);
+    RpcRecvTensorsCall*& batch = pending_batches_[src_worker];
+    if (batch == nullptr) {
+      batch = new RpcRecvTensorsCall(src_worker, next_batch_id_++);
+      // Send the batch when the window closes, unless it fills up before.
+      const int64 batch_id = batch->id();
+      Ref();
+      env_->env->SchedClosureAfter(batch_policy_->window_micros(),
+                                   [this, src_worker, batch_id]() {
+                                     FlushBatch(src_worker, batch_id);
+                                     Unref();
+                                   });
+    }
+    batch->Add(step_id_, parsed, dst_device, recv_args, std::move(done));
+    if (batch->num_recvs() >=
+        RpcRendezvousMgr::RecvBatchPolicy::kMaxRecvsPerBatch) {
+      full_batch = batch;
+      pending_batches_.erase(src_worker);
+    }
+  }
+  if (full_batch != nullptr) {
+    StartBatch(full_batch);
+  }
+}
+
+void RpcRemoteRendezvous::FlushBatch(const string& src_worker,
+                                     int64 batch_id) {
+  RpcRecvTensorsCall* batch = nullptr;
+  {
+    mutex_lock l(batch_mu_);
+    auto it = pending_batches_.find(src_worker);
+    if (it == pending_batches_.end() || it->second->id() != batch_id) {
+      // The batch was full and has already been sent.
+      return;
+    }
+    batch = it->second;
+    pending_batches_.erase(it);
+  }
+  StartBatch(batch);
+}
+
+void RpcRemoteRendezvous::StartBatch(RpcRecvTensorsCall* call) {
+  WorkerSession* sess = session();
+  WorkerInterface* rwi = sess->worker_cache->CreateWorker(call->src_worker());
+  if (rwi == nullptr) {
+    Status s = errors::Internal("No worker known as ", call->src_worker());
+    for (auto& recv : *call->mutable_recvs()) {
+      recv.done(s, Args(), recv.recv_args, Tensor{}, false);
+    }
+    delete call;
+    return;
+  }
+  call->set_worker(rwi);
+
+  // Record "call" in active_ so that it can be aborted cleanly.
+  RegisterCall(call);
+
+  // Start "call".
+  Ref();
+  call->Start([this, call]() {
+    // Removes "call" from active_. Prevent StartAbort().
+    DeregisterCall(call);
+    session()->worker_cache->ReleaseWorker(call->src_worker(),
+                                           call->release_worker());
+    Status s = call->status();
+    if (errors::IsUnimplemented(s)) {
+      // The source worker doesn't implement RecvTensors, so it hasn't
+      // consumed any of the tensors. Receive them one by one instead.
+      batch_policy_->MarkUnsupported(call->src_worker());
+      for (auto& recv : *call->mutable_recvs()) {
+        RecvOneFromRemoteAsync(recv.parsed, recv.recv_args,
+                               std::move(recv.done));
+      }
+    } else {
+      std::vector<bool> not_ready;
+      if (s.ok()) not_ready = call->NotReady();
+      for (int i = 0; i < call->num_recvs(); ++i) {
+        RpcRecvTensorsCall::Recv& recv = (*call->mutable_recvs())[i];
+        if (s.ok() && not_ready[i]) {
+          // The source worker hasn't produced the tensor yet. It may depend
+          // on the other tensors of the batch, so wait for it on its own.
+          batch_policy_->RecordNotReady(recv.parsed.FullKey());
+          RecvOneFromRemoteAsync(recv.parsed, recv.recv_args,
+                                 std::move(recv.done));
+          continue;
+        }
+        Tensor val;
+        bool is_dead = false;
+        Status recv_status = s;
+        if (recv_status.ok()) {
+          recv_status = call->GetTensor(i, &val, &is_dead);
+        }
+        if (recv_status.ok() && !is_dead) {
+          batch_policy_->RecordTensorSize(recv.parsed.FullKey(),
+                                          val.TotalBytes());
+        }
+        recv.done(recv_status, Args(), recv.recv_args, val, is_dead);
+      }
+    }
+    delete call;
+    Unref();
+  });
+}
+
 }  // namespace
 
 RpcRendezvousMgr::RpcRendezvousMgr(const WorkerEnv* env)
-    : BaseRendezvousMgr(env) {}
+    : BaseRendezvousMgr(env) {
+  int64 batch_window_micros = 0;
+  Status status = ReadInt64FromEnvVar("TF_RPC_RECV_BATCH_WINDOW_MICROS", 0,
+                                      &batch_window_micros);
+  if (!status.ok()) {
+    LOG(ERROR) << "RpcRendezvousMgr: " << status.error_message();
+  }
+  batch_policy_ = std::make_shared<RecvBatchPolicy>(batch_window_micros);
+}
 
 BaseRemoteRendezvous* RpcRendezvousMgr::Create(int64 step_id,
                                                const WorkerEnv* worker_env) {
-  return new RpcRemoteRendezvous(worker_env, step_id);
+  return new RpcRemoteRendezvous(worker_env, step_id, batch_policy_);
 }
 
 }  // end namespace tensorflow
@@ -16,6 +16,8 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_RPC_RENDEZVOUS_MGR_H_
 #define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_RPC_RENDEZVOUS_MGR_H_
 
+#include <memory>
+
 #include "tensorflow/core/distributed_runtime/base_rendezvous_mgr.h"
 #include "tensorflow/core/distributed_runtime/worker_env.h"
 #include "tensorflow/core/platform/macros.h"
@@ -42,14 +44,28 @@ class DeviceMgr;
 //
 // Tensors sent and recved through rendezvous managed by this
 // RendezvousMgr must have keys generated by Rendezvous::CreateKey.
+//
+// If the environment variable TF_RPC_RECV_BATCH_WINDOW_MICROS is set to a
+// positive value, the rendezvous of a step coalesces the recvs of small
+// tensors from the same worker issued within that many microseconds into a
+// single RecvTensors call. A tensor is considered small if it was small the
+// last time it was received on the same key, so the first step receives all
+// tensors with individual RecvTensor calls. The source worker only returns
+// the tensors of a batch that it has already produced; the others are
+// received with individual RecvTensor calls, in this and later steps.
 class RpcRendezvousMgr : public BaseRendezvousMgr {
  public:
   explicit RpcRendezvousMgr(const WorkerEnv* env);
 
+  // Decides which recvs are batched. Shared by the rendezvous of all steps.
+  class RecvBatchPolicy;
+
  protected:
   BaseRemoteRendezvous* Create(int64 step_id, const WorkerEnv* worker_env);
 
  private:
+  std::shared_ptr<RecvBatchPolicy> batch_policy_;
+
   TF_DISALLOW_COPY_AND_ASSIGN(RpcRendezvousMgr);
 };
 
@@ -15,14 +15,20 @@ limitations under the License.
 
 #include "tensorflow/core/distributed_runtime/rpc/rpc_rendezvous_mgr.h"
 
+#include "tensorflow/core/common_runtime/device_factory.h"
 #include "tensorflow/core/common_runtime/process_util.h"
+#include "tensorflow/core/distributed_runtime/tensor_coding.h"
+#include "tensorflow/core/distributed_runtime/test_utils.h"
 #include "tensorflow/core/framework/control_flow.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/public/session_options.h"
 
 namespace tensorflow {
 
@@ -200,6 +206,250 @@ TEST_F(RpcRendezvousMgrTest, TransferDummyDeviceContext) {
   dc->Unref();
 }
 
+TEST_F(RpcRendezvousMgrTest, TryRecvLocal) {
+  const int64 step_id = 123;
+  const Rendezvous::ParsedKey key = MakeKey(Rendezvous::CreateKey(
+      "/job:mnist/replica:1/task:2/cpu:0", 7890,
+      "/job:mnist/replica:1/task:2/cpu:1", "foo", FrameAndIter(0, 0)));
+  RemoteRendezvous* rendez = rmgr_.Find(step_id);
+  core::ScopedUnref unref(rendez);
+  Status status;
+  Tensor val;
+  auto done = [&status, &val](const Status& s, const Rendezvous::Args&,
+                              const Rendezvous::Args&, const Tensor& v,
+                              bool is_dead) {
+    status = s;
+    val = v;
+  };
+
+  // Nothing is ready before the rendezvous is initialized and the tensor is
+  // sent.
+  EXPECT_FALSE(rmgr_.TryRecvLocal(step_id, key, done));
+  TF_ASSERT_OK(rendez->Initialize(&worker_session_));
+  EXPECT_FALSE(rmgr_.TryRecvLocal(step_id, key, done));
+
+  TF_ASSERT_OK(rendez->Send(key, Rendezvous::Args(), V("peach"), false));
+  EXPECT_TRUE(rmgr_.TryRecvLocal(step_id, key, done));
+  TF_EXPECT_OK(status);
+  EXPECT_EQ(V(val), "peach");
+
+  // The tensor has been consumed.
+  EXPECT_FALSE(rmgr_.TryRecvLocal(step_id, key, done));
+
+  rendez->StartAbort(errors::Aborted(""));
+  EXPECT_TRUE(rmgr_.TryRecvLocal(step_id, key, done));
+  EXPECT_TRUE(errors::IsAborted(status));
+  rmgr_.Cleanup(step_id);
+}
+
+namespace {
+// Fake remote worker that serves the tensors it is given, and counts the calls
+// it gets. Like GrpcWorker, RecvTensor waits for a tensor that hasn't been set
+// yet, while RecvTensors reports it as not ready.
+class FakeRemoteWorker : public TestWorkerInterface {
+ public:
+  void SetTensor(const string& key, const Tensor& val) {
+    std::vector<std::pair<TensorResponse*, StatusCallback>> waiters;
+    {
+      mutex_lock l(mu_);
+      tensors_[key] = val;
+      waiters.swap(waiters_[key]);
+      waiters_.erase(key);
+    }
+    for (auto& waiter : waiters) {
+      Reply(key, waiter.first, std::move(waiter.second));
+    }
+  }
+
+  void RemoveTensor(const string& key) {
+    mutex_lock l(mu_);
+    tensors_.erase(key);
+  }
+
+  void RecvTensorAsync(CallOptions* opts, const RecvTensorRequest* request,
+                       TensorResponse* response, StatusCallback done) override {
+    const string& key = request->rendezvous_key();
+    {
+      mutex_lock l(mu_);
+      ++num_recv_tensor_calls_;
+      if (tensors_.count(key) == 0) {
+        waiters_[key].emplace_back(response, std::move(done));
+        return;
+      }
+    }
+    Reply(key, response, std::move(done));
+  }
+
+  void RecvTensorsAsync(CallOptions* opts, const RecvTensorsRequest* request,
+                        RecvTensorsResponse* response,
+                        StatusCallback done) override {
+    {
+      mutex_lock l(mu_);
+      ++num_recv_tensors_calls_;
+      num_batched_recvs_ += request->request_size();
+      for (int i = 0; i < request->request_size(); ++i) {
+        RecvTensorResponse* resp = response->add_response();
+        auto it = tensors_.find(request->request(i).rendezvous_key());
+        if (it == tensors_.end()) {
+          response->add_not_ready(i);
+        } else {
+          it->second.AsProtoTensorContent(resp->mutable_tensor());
+        }
+      }
+    }
+    done(Status::OK());
+  }
+
+  int num_recv_tensor_calls() {
+    mutex_lock l(mu_);
+    return num_recv_tensor_calls_;
+  }
+  int num_recv_tensors_calls() {
+    mutex_lock l(mu_);
+    return num_recv_tensors_calls_;
+  }
+  int num_batched_recvs() {
+    mutex_lock l(mu_);
+    return num_batched_recvs_;
+  }
+
+ private:
+  void Reply(const string& key, TensorResponse* response,
+             StatusCallback done) {
+    RecvTensorResponse proto;
+    {
+      mutex_lock l(mu_);
+      tensors_[key].AsProtoTensorContent(proto.mutable_tensor());
+    }
+    done(response->InitFrom(&proto));
+  }
+
+  mutex mu_;
+  std::unordered_map<string, Tensor> tensors_ GUARDED_BY(mu_);
+  std::unordered_map<string,
+                     std::vector<std::pair<TensorResponse*, StatusCallback>>>
+      waiters_ GUARDED_BY(mu_);
+  int num_recv_tensor_calls_ GUARDED_BY(mu_) = 0;
+  int num_recv_tensors_calls_ GUARDED_BY(mu_) = 0;
+  int num_batched_recvs_ GUARDED_BY(mu_) = 0;
+};
+}  // namespace
+
+class RpcRendezvousMgrBatchingTest : public ::testing::Test {
+ protected:
+  RpcRendezvousMgrBatchingTest() {
+    TestWorkerCache* cache = new TestWorkerCache;
+    cache->AddWorker("/job:mnist/replica:1/task:3", &remote_worker_);
+    std::vector<Device*> devices = {DeviceFactory::NewDevice(
+        "CPU", SessionOptions(), "/job:mnist/replica:1/task:2")};
+    session_.reset(new WorkerSession(
+        "rpc_session", "/job:mnist/replica:1/task:2",
+        std::unique_ptr<WorkerCacheInterface>(cache),
+        std::unique_ptr<DeviceMgr>(new DeviceMgr(devices)),
+        std::unique_ptr<GraphMgr>()));
+    env_.env = Env::Default();
+    setenv("TF_RPC_RECV_BATCH_WINDOW_MICROS", "10000", 1 /* overwrite */);
+    rmgr_.reset(new RpcRendezvousMgr(&env_));
+    unsetenv("TF_RPC_RECV_BATCH_WINDOW_MICROS");
+  }
+
+  // Returns the key of the tensor "name" sent by the remote worker.
+  static Rendezvous::ParsedKey RemoteKey(const string& name) {
+    return MakeKey(Rendezvous::CreateKey(
+        "/job:mnist/replica:1/task:3/device:CPU:0", 7890,
+        "/job:mnist/replica:1/task:2/device:CPU:0", name, FrameAndIter(0, 0)));
+  }
+
+  FakeRemoteWorker remote_worker_;
+  WorkerEnv env_;
+  std::unique_ptr<WorkerSession> session_;
+  std::unique_ptr<RpcRendezvousMgr> rmgr_;
+};
+
+TEST_F(RpcRendezvousMgrBatchingTest, BatchesSmallRemoteRecvs) {
+  const int kNumTensors = 3;
+  std::vector<Rendezvous::ParsedKey> keys;
+  for (int i = 0; i < kNumTensors; ++i) {
+    keys.push_back(RemoteKey(strings::StrCat("t", i)));
+    remote_worker_.SetTensor(string(keys[i].FullKey()),
+                             V(strings::StrCat("peach", i)));
+  }
+
+  // The first step learns the sizes of the tensors, and the second one
+  // receives them all in one batch.
+  for (int64 step_id = 1; step_id <= 2; ++step_id) {
+    RemoteRendezvous* rendez = rmgr_->Find(step_id);
+    core::ScopedUnref unref(rendez);
+    TF_ASSERT_OK(rendez->Initialize(session_.get()));
+    BlockingCounter counter(kNumTensors);
+    for (int i = 0; i < kNumTensors; ++i) {
+      rendez->RecvAsync(
+          keys[i], Rendezvous::Args(),
+          [i, &counter](const Status& s, const Rendezvous::Args& send_args,
+                        const Rendezvous::Args& recv_args, const Tensor& val,
+                        bool is_dead) {
+            TF_EXPECT_OK(s);
+            EXPECT_FALSE(is_dead);
+            EXPECT_EQ(V(val), strings::StrCat("peach", i));
+            counter.DecrementCount();
+          });
+    }
+    counter.Wait();
+    rmgr_->Cleanup(step_id);
+  }
+  EXPECT_EQ(kNumTensors, remote_worker_.num_recv_tensor_calls());
+  EXPECT_EQ(1, remote_worker_.num_recv_tensors_calls());
+  EXPECT_EQ(kNumTensors, remote_worker_.num_batched_recvs());
+}
+
+TEST_F(RpcRendezvousMgrBatchingTest, DependentRecvs) {
+  // The remote worker only produces "z" once this worker has received "w",
+  // like a parameter server that sends a variable, and then a value computed
+  // from what this worker sends back. Both recvs are issued at the start of
+  // the step, so a batch holding both must not wait for "z".
+  const Rendezvous::ParsedKey w = RemoteKey("w");
+  const Rendezvous::ParsedKey z = RemoteKey("z");
+  const string z_key(z.FullKey());
+
+  // The first step learns the sizes of the tensors, and the second one
+  // batches both recvs. "z" isn't batched anymore in the third one.
+  for (int64 step_id = 1; step_id <= 3; ++step_id) {
+    remote_worker_.SetTensor(string(w.FullKey()), V("peach"));
+    remote_worker_.RemoveTensor(z_key);
+    RemoteRendezvous* rendez = rmgr_->Find(step_id);
+    core::ScopedUnref unref(rendez);
+    TF_ASSERT_OK(rendez->Initialize(session_.get()));
+    BlockingCounter counter(2);
+    rendez->RecvAsync(
+        w, Rendezvous::Args(),
+        [this, &z_key, &counter](const Status& s,
+                                 const Rendezvous::Args& send_args,
+                                 const Rendezvous::Args& recv_args,
+                                 const Tensor& val, bool is_dead) {
+          TF_EXPECT_OK(s);
+          EXPECT_EQ(V(val), "peach");
+          remote_worker_.SetTensor(z_key, V("pear"));
+          counter.DecrementCount();
+        });
+    rendez->RecvAsync(
+        z, Rendezvous::Args(),
+        [&counter](const Status& s, const Rendezvous::Args& send_args,
+                   const Rendezvous::Args& recv_args, const Tensor& val,
+                   bool is_dead) {
+          TF_EXPECT_OK(s);
+          EXPECT_EQ(V(val), "pear");
+          counter.DecrementCount();
+        });
+    counter.Wait();
+    rmgr_->Cleanup(step_id);
+  }
+  // Step 1 receives both tensors on their own, step 2 batches both but
+  // receives "z" on its own, and step 3 only batches "w".
+  EXPECT_EQ(4, remote_worker_.num_recv_tensor_calls());
+  EXPECT_EQ(2, remote_worker_.num_recv_tensors_calls());
+  EXPECT_EQ(3, remote_worker_.num_batched_recvs());
+}
+
 // NOTE: Remote Send/Recv is better tested in worker_test.cc
 
 }  // namespace tensorflow
@@ -101,6 +101,9 @@ Status SessionMgr::CreateSession(const string& session,
         worker_env_->device_mgr, std::move(graph_mgr));
   }
 
+  worker_session->rpc_options =
+      server_def.default_session_config().rpc_options();
+
   sessions_.insert(std::make_pair(session, std::move(worker_session)));
   return Status::OK();
 }
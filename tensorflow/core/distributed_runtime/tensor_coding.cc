@@ -18,11 +18,120 @@ limitations under the License.
 #include "google/protobuf/any.pb.h"
 
 #include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/framework/bfloat16.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
+#include "tensorflow/core/platform/snappy.h"
 
 namespace tensorflow {
 
+namespace {
+
+// Tensors smaller than this aren't worth encoding.
+const size_t kMinEncodedTensorBytes = 1024;
+
+// Parses "proto", whose content is encoded with "encoding", into "*val".
+Status TensorFromEncodedProto(RPCOptions::TensorEncoding encoding,
+                              Allocator* allocator, const TensorProto& proto,
+                              Tensor* val) {
+  if (!TensorShape::IsValid(proto.tensor_shape())) {
+    return errors::InvalidArgument("Invalid tensor shape in response");
+  }
+  Tensor decoded(allocator, proto.dtype(), TensorShape(proto.tensor_shape()));
+  TF_RETURN_IF_ERROR(
+      DecodeTensorContent(encoding, proto.tensor_content(), &decoded));
+  *val = std::move(decoded);
+  return Status::OK();
+}
+
+}  // namespace
+
+bool EncodeTensorContent(RPCOptions::TensorEncoding encoding, const Tensor& val,
+                         string* content) {
+  if (!DataTypeCanUseMemcpy(val.dtype()) ||
+      val.TotalBytes() < kMinEncodedTensorBytes) {
+    return false;
+  }
+  const StringPiece data = val.tensor_data();
+  const int64 num_elements = val.NumElements();
+  switch (encoding) {
+    case RPCOptions::SNAPPY:
+      return port::Snappy_Compress(data.data(), data.size(), content) &&
+             content->size() < data.size();
+    case RPCOptions::BFLOAT16: {
+      if (val.dtype() != DT_FLOAT) return false;
+      content->resize(num_elements * sizeof(bfloat16));
+      FloatToBFloat16(val.flat<float>().data(),
+                      reinterpret_cast<bfloat16*>(&(*content)[0]),
+                      num_elements);
+      return true;
+    }
+    case RPCOptions::HALF: {
+      if (val.dtype() != DT_FLOAT) return false;
+      content->resize(num_elements * sizeof(Eigen::half));
+      const float* src = val.flat<float>().data();
+      Eigen::half* dst = reinterpret_cast<Eigen::half*>(&(*content)[0]);
+      for (int64 i = 0; i < num_elements; ++i) {
+        dst[i] = Eigen::half(src[i]);
+      }
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+Status DecodeTensorContent(RPCOptions::TensorEncoding encoding,
+                           StringPiece content, Tensor* val) {
+  const StringPiece buf = val->tensor_data();
+  char* dst = const_cast<char*>(buf.data());
+  const int64 num_elements = val->NumElements();
+  switch (encoding) {
+    case RPCOptions::RAW:
+      if (content.size() != buf.size()) break;
+      memcpy(dst, content.data(), content.size());
+      return Status::OK();
+    case RPCOptions::SNAPPY: {
+      size_t length;
+      if (!port::Snappy_GetUncompressedLength(content.data(), content.size(),
+                                              &length) ||
+          length != buf.size() ||
+          !port::Snappy_Uncompress(content.data(), content.size(), dst)) {
+        break;
+      }
+      return Status::OK();
+    }
+    case RPCOptions::BFLOAT16:
+      if (val->dtype() != DT_FLOAT ||
+          content.size() != num_elements * sizeof(bfloat16)) {
+        break;
+      }
+      BFloat16ToFloat(reinterpret_cast<const bfloat16*>(content.data()),
+                      val->flat<float>().data(), num_elements);
+      return Status::OK();
+    case RPCOptions::HALF: {
+      if (val->dtype() != DT_FLOAT ||
+          content.size() != num_elements * sizeof(Eigen::half)) {
+        break;
+      }
+      const Eigen::half* src =
+          reinterpret_cast<const Eigen::half*>(content.data());
+      float* out = val->flat<float>().data();
+      for (int64 i = 0; i < num_elements; ++i) {
+        out[i] = static_cast<float>(src[i]);
+      }
+      return Status::OK();
+    }
+    default:
+      return errors::InvalidArgument("Unknown tensor encoding ", encoding);
+  }
+  return errors::InvalidArgument(
+      "Cannot decode ", content.size(), " bytes of ",
+      RPCOptions::TensorEncoding_Name(encoding), " content into a ",
+      DataTypeString(val->dtype()), " tensor of shape ",
+      val->shape().DebugString());
+}
+
 TensorResponse::Source::~Source() {}
 
 void TensorResponse::Clear() {
@@ -54,11 +163,17 @@ Status TensorResponse::InitFrom(RecvTensorResponse* response) {
   Status s;
   meta_.Swap(response);
   if (on_host_) {
-    if (!tensor_.FromProto(allocator_, meta_.tensor())) {
+    if (meta_.encoding() != RPCOptions::RAW) {
+      s = TensorFromEncodedProto(meta_.encoding(), allocator_, meta_.tensor(),
+                                 &tensor_);
+    } else if (!tensor_.FromProto(allocator_, meta_.tensor())) {
       s = errors::InvalidArgument("Cannot parse tensor from response");
     }
   } else {
-    s = device_->MakeTensorFromProto(meta_.tensor(), alloc_attrs_, &tensor_);
+    s = DecodeMetaTensorContent();
+    if (s.ok()) {
+      s = device_->MakeTensorFromProto(meta_.tensor(), alloc_attrs_, &tensor_);
+    }
   }
   {
     TensorProto empty;
@@ -87,8 +202,10 @@ Status TensorResponse::ParseFrom(Source* source) {
     if (!meta_.ParseFromCodedStream(&input) || !input.ConsumedEntireMessage()) {
       return errors::InvalidArgument("Cannot parse tensor from response");
     }
-    Status s =
-        device_->MakeTensorFromProto(meta_.tensor(), alloc_attrs_, &tensor_);
+    Status s = DecodeMetaTensorContent();
+    if (s.ok()) {
+      s = device_->MakeTensorFromProto(meta_.tensor(), alloc_attrs_, &tensor_);
+    }
     // Reduce memory usage for big tensors.
     {
       TensorProto empty;
@@ -196,6 +313,17 @@ bool TensorResponse::ParseTensorSubmessage(
         seen_tensor_content = true;
         TensorShape shape(tensor_meta->tensor_shape());
         Tensor t(allocator_, tensor_meta->dtype(), shape);
+        if (meta_.encoding() != RPCOptions::RAW) {
+          // Decode the content into the tensor buffer, from contiguous
+          // storage since the input stream may be fragmented.
+          string content;
+          if (!input->ReadString(&content, num_bytes) ||
+              !DecodeTensorContent(meta_.encoding(), content, &t).ok()) {
+            return false;
+          }
+          tensor_ = std::move(t);
+          break;
+        }
         StringPiece buf = t.tensor_data();
         if (static_cast<size_t>(num_bytes) != buf.size()) return false;
         // TODO(jeff,sanjay): Figure out a way to avoid this copy if
@@ -254,6 +382,14 @@ bool TensorResponse::ParseFast(Source* source) {
         meta_.set_send_start_micros(static_cast<int64>(v));
         break;
       }
+      case RecvTensorResponse::kEncodingFieldNumber: {
+        uint32 v;
+        if ((wt != WIRETYPE_VARINT) || !input.ReadVarint32(&v)) return false;
+        // The encoding has to precede the content it applies to.
+        if (meta_.has_tensor()) return false;
+        meta_.set_encoding(static_cast<RPCOptions::TensorEncoding>(v));
+        break;
+      }
       case RecvTensorResponse::kTransportOptionsFieldNumber: {
         if ((wt != WIRETYPE_LENGTH_DELIMITED) ||
             !ReadNestedMessage(&input, meta_.mutable_transport_options()))
@@ -270,13 +406,29 @@ bool TensorResponse::ParseFast(Source* source) {
   return false;
 }
 
+Status TensorResponse::DecodeMetaTensorContent() {
+  if (meta_.encoding() == RPCOptions::RAW) return Status::OK();
+  Tensor decoded;
+  TF_RETURN_IF_ERROR(TensorFromEncodedProto(meta_.encoding(), cpu_allocator(),
+                                            meta_.tensor(), &decoded));
+  decoded.AsProtoTensorContent(meta_.mutable_tensor());
+  meta_.set_encoding(RPCOptions::RAW);
+  return Status::OK();
+}
+
 bool TensorResponse::ParseSlow(Source* source) {
   if (!meta_.ParseFromZeroCopyStream(source->contents())) {
     return false;
   }
 
   Tensor parsed(meta_.tensor().dtype());
-  if (!parsed.FromProto(allocator_, meta_.tensor())) {
+  if (meta_.encoding() != RPCOptions::RAW) {
+    if (!TensorFromEncodedProto(meta_.encoding(), allocator_, meta_.tensor(),
+                                &parsed)
+             .ok()) {
+      return false;
+    }
+  } else if (!parsed.FromProto(allocator_, meta_.tensor())) {
     return false;
   }
   tensor_ = std::move(parsed);
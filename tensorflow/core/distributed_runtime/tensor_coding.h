@@ -96,6 +96,10 @@ class TensorResponse {
   bool ParseFast(Source* source);
   bool ParseSlow(Source* source);
 
+  // Replaces the encoded content of meta_.tensor(), if any, by its raw
+  // content, for devices that make tensors from protos.
+  Status DecodeMetaTensorContent();
+
   bool on_host_ = false;
   DeviceBase* device_ = nullptr;
   AllocatorAttributes alloc_attrs_;
@@ -105,6 +109,17 @@ class TensorResponse {
   RecvTensorResponse meta_;
 };
 
+// Encodes the content of "val" with "encoding" into "*content". Returns false
+// if the encoding doesn't apply to "val" or doesn't make it smaller, in which
+// case the content has to be sent raw.
+bool EncodeTensorContent(RPCOptions::TensorEncoding encoding, const Tensor& val,
+                         string* content);
+
+// Decodes "content", encoded with "encoding", directly into the buffer of
+// "*val", which must already have the dtype and shape of the tensor.
+Status DecodeTensorContent(RPCOptions::TensorEncoding encoding,
+                           StringPiece content, Tensor* val);
+
 }  // namespace tensorflow
 
 #endif  // TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_TENSOR_CODING_H_
@@ -19,6 +19,7 @@ limitations under the License.
 #include "tensorflow/core/framework/device_base.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/env.h"
@@ -156,6 +157,61 @@ TEST_F(TensorResponseTest, Simple) {
 
 TEST_F(TensorResponseTest, StringTensor) { DoTestForStrings(DT_STRING); }
 
+TEST_F(TensorResponseTest, EncodedContent) {
+  // Values that are exact in bfloat16 and float16, and compress well.
+  Tensor src(DT_FLOAT, TensorShape({64, 64}));
+  auto flat = src.flat<float>();
+  for (int i = 0; i < flat.size(); i++) {
+    flat(i) = (i % 16) * 0.5f;
+  }
+  DummyDevice cpu_device(Env::Default());
+  for (RPCOptions::TensorEncoding encoding :
+       {RPCOptions::SNAPPY, RPCOptions::BFLOAT16, RPCOptions::HALF}) {
+    string content;
+    if (!EncodeTensorContent(encoding, src, &content)) {
+      // Snappy isn't available on all platforms.
+      EXPECT_EQ(encoding, RPCOptions::SNAPPY);
+      continue;
+    }
+    EXPECT_LT(content.size(), src.TotalBytes());
+
+    RecvTensorResponse header;
+    header.set_encoding(encoding);
+    RecvTensorResponse body;
+    body.mutable_tensor()->set_dtype(DT_FLOAT);
+    src.shape().AsProto(body.mutable_tensor()->mutable_tensor_shape());
+    body.mutable_tensor()->set_tensor_content(content);
+    // The encoding precedes the tensor on the wire when it is sent by
+    // grpc::EncodeTensorToByteBuffer(), which the fast path relies on, and
+    // follows it when the response is serialized as a whole.
+    string encoded_first;
+    header.AppendToString(&encoded_first);
+    body.AppendToString(&encoded_first);
+    RecvTensorResponse full = body;
+    full.set_encoding(encoding);
+    string encoded_last;
+    full.AppendToString(&encoded_last);
+
+    for (const string* encoded : {&encoded_first, &encoded_last}) {
+      StringSource source(encoded, 7);
+      TensorResponse response;
+      response.InitAlloc(&cpu_device, AllocatorAttributes());
+      TF_EXPECT_OK(response.ParseFrom(&source));
+      test::ExpectTensorEqual<float>(src, response.tensor());
+    }
+  }
+
+  // The lossy encodings only apply to float tensors, and small tensors are
+  // sent raw.
+  string content;
+  Tensor ints(DT_INT32, TensorShape({1024}));
+  ints.flat<int32>().setZero();
+  EXPECT_FALSE(EncodeTensorContent(RPCOptions::BFLOAT16, ints, &content));
+  Tensor small(DT_FLOAT, TensorShape({4}));
+  small.flat<float>().setZero();
+  EXPECT_FALSE(EncodeTensorContent(RPCOptions::HALF, small, &content));
+}
+
 string MakeFloatTensorTestCase(int num_elems) {
   std::vector<int8> v(num_elems);
   for (int i = 0; i < num_elems; i++) {
@@ -99,6 +99,12 @@ class TestWorkerInterface : public WorkerInterface {
     done(errors::Unimplemented("RecvBufAsync"));
   }
 
+  void RecvTensorsAsync(CallOptions* opts, const RecvTensorsRequest* request,
+                        RecvTensorsResponse* response,
+                        StatusCallback done) override {
+    done(errors::Unimplemented("RecvTensorsAsync"));
+  }
+
   void CompleteGroupAsync(CallOptions* opts,
                           const CompleteGroupRequest* request,
                           CompleteGroupResponse* response,
@@ -354,6 +354,16 @@ void Worker::RecvBufAsync(CallOptions* opts, const RecvBufRequest* request,
   done(errors::Unimplemented("Worker::RecvBufAsync()"));
 }
 
+void Worker::RecvTensorsAsync(CallOptions* opts,
+                              const RecvTensorsRequest* request,
+                              RecvTensorsResponse* response,
+                              StatusCallback done) {
+  // The base Worker class does not implement RecvTensorsAsync, for the same
+  // reason as RecvTensorAsync. Use a transport-specific implementation (such
+  // as `GrpcWorker::RecvTensorsAsync()`) instead.
+  done(errors::Unimplemented("Worker::RecvTensorsAsync()"));
+}
+
 void Worker::CompleteGroupAsync(CallOptions* opts,
                                 const CompleteGroupRequest* request,
                                 CompleteGroupResponse* response,
@@ -31,6 +31,9 @@ void AllocatorStats::Clear() {
   this->max_bytes_in_use = 0;
   this->max_alloc_size = 0;
   this->bytes_limit = 0;
+  this->num_cache_hits = 0;
+  this->num_cache_misses = 0;
+  this->bytes_in_caches = 0;
 }
 
 string AllocatorStats::DebugString() const {
@@ -39,9 +42,13 @@ string AllocatorStats::DebugString() const {
       "InUse:        %20lld\n"
       "MaxInUse:     %20lld\n"
       "NumAllocs:    %20lld\n"
-      "MaxAllocSize: %20lld\n",
+      "MaxAllocSize: %20lld\n"
+      "CacheHits:    %20lld\n"
+      "CacheMisses:  %20lld\n"
+      "InCaches:     %20lld\n",
       this->bytes_limit, this->bytes_in_use, this->max_bytes_in_use,
-      this->num_allocs, this->max_alloc_size);
+      this->num_allocs, this->max_alloc_size, this->num_cache_hits,
+      this->num_cache_misses, this->bytes_in_caches);
 }
 
 constexpr size_t Allocator::kAllocatorAlignment;
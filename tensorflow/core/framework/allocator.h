@@ -57,6 +57,13 @@ struct AllocatorStats {
   // unknown.
   int64 bytes_limit;
 
+  // For allocators with per-thread caches: the number of allocations served
+  // from a cache, the number of cacheable allocations that missed, and the
+  // bytes held in caches. Cached bytes are not counted in bytes_in_use.
+  int64 num_cache_hits;
+  int64 num_cache_misses;
+  int64 bytes_in_caches;
+
   AllocatorStats() { Clear(); }
 
   void Clear();
@@ -50,7 +50,9 @@ string CollGroupParams::ToString() const {
   return strings::StrCat("CollGroupParams {group_key=", group_key,
                          " group_size=", group_size,
                          " device_type=", device_type.type_string(),
-                         " num_tasks=", num_tasks, "}");
+                         " num_tasks=", num_tasks,
+                         " recursive_halving_max_bytes=",
+                         recursive_halving_max_bytes, "}");
 }
 
 CollInstanceParams& CollInstanceParams::operator=(
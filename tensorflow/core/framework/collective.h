@@ -53,9 +53,16 @@ struct CollGroupParams {
   int32 group_size;
   DeviceType device_type;
   int32 num_tasks;  // number of distinct tasks in group
+  // All-reduces of at most this many bytes use recursive halving.  Set by
+  // the param resolver, the same for every member of the group.
+  int64 recursive_halving_max_bytes;
   string ToString() const;
   CollGroupParams()
-      : group_key(0), group_size(0), device_type(DEVICE_CPU), num_tasks(0) {}
+      : group_key(0),
+        group_size(0),
+        device_type(DEVICE_CPU),
+        num_tasks(0),
+        recursive_halving_max_bytes(0) {}
 };
 
 // The best implementation of a collective op depends on many factors
@@ -23,6 +23,7 @@ limitations under the License.
 #include "tensorflow/core/framework/dataset_stateful_op_whitelist.h"
 #include "tensorflow/core/framework/function.h"
 #include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/model.h"
 #include "tensorflow/core/framework/node_def.pb.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
@@ -290,6 +291,11 @@ class IteratorContext {
 
     // The Allocator to be used to allocate the output of an iterator.
     std::function<Allocator*(AllocatorAttributes)> allocator_getter = nullptr;
+
+    // If non-null, the performance model of the input pipeline. Iterators
+    // created with this context record their processing time in the model,
+    // and may register parameters for the model to tune.
+    std::shared_ptr<model::Model> model = nullptr;
   };
 
   explicit IteratorContext(Params params) : params_(std::move(params)) {}
@@ -341,6 +347,8 @@ class IteratorContext {
     return params_.stats_aggregator_getter;
   }
 
+  std::shared_ptr<model::Model> model() { return params_.model; }
+
  private:
   Params params_;
 };
@@ -448,6 +456,13 @@ class IteratorBase {
                                  IteratorStateReader* reader) {
     return errors::Unimplemented("RestoreInternal");
   }
+
+ private:
+  friend class DatasetBase;  // For access to `AddToModel()`.
+
+  // Adds this iterator to the performance model `ctx->model()`, as an input
+  // of the iterator with prefix `output_prefix`.
+  virtual void AddToModel(IteratorContext* ctx, const string& output_prefix) {}
 };
 
 // Represents runtime information needed to construct a dataset.
@@ -497,6 +512,9 @@ class DatasetBase : public core::RefCounted {
   Status MakeIterator(IteratorContext* ctx, const string& prefix,
                       std::unique_ptr<IteratorBase>* iterator) const {
     *iterator = MakeIteratorInternal(prefix);
+    if (ctx->model()) {
+      (*iterator)->AddToModel(ctx, prefix);
+    }
     return (*iterator)->Initialize(ctx);
   }
 
@@ -561,7 +579,12 @@ class DatasetBaseIterator : public IteratorBase {
     params_.dataset->Ref();
   }
 
-  ~DatasetBaseIterator() override { params_.dataset->Unref(); }
+  ~DatasetBaseIterator() override {
+    if (node_) {
+      model_->RemoveNode(node_);
+    }
+    params_.dataset->Unref();
+  }
 
   // The sequence of iterators leading up to this iterator.
   const string& prefix() const { return params_.prefix; }
@@ -577,7 +600,28 @@ class DatasetBaseIterator : public IteratorBase {
   Status GetNext(IteratorContext* ctx, std::vector<Tensor>* out_tensors,
                  bool* end_of_sequence) final {
     tracing::ScopedActivity activity(params_.prefix);
+    // The time spent in this call is attributed to this iterator rather than
+    // to the iterator calling it.
+    std::shared_ptr<model::Node> output;
+    if (node_) {
+      const int64 now = ctx->env()->NowNanos();
+      output = node_->output();
+      if (output && !output->record_stop(now)) {
+        output.reset();
+      }
+      node_->record_start(now);
+    }
     Status s = GetNextInternal(ctx, out_tensors, end_of_sequence);
+    if (node_) {
+      const int64 now = ctx->env()->NowNanos();
+      if (s.ok() && !*end_of_sequence) {
+        node_->record_element();
+      }
+      node_->record_stop(now);
+      if (output) {
+        output->record_start(now);
+      }
+    }
     if (TF_PREDICT_FALSE(errors::IsOutOfRange(s) && !*end_of_sequence)) {
       s = errors::Internal(
           "Iterator \"", params_.prefix,
@@ -604,8 +648,58 @@ class DatasetBaseIterator : public IteratorBase {
     return strings::StrCat(params_.prefix, ":", name);
   }
 
+  // Returns the node of this iterator in the performance model of the
+  // pipeline, or nullptr if the pipeline is not modeled.
+  const std::shared_ptr<model::Node>& model_node() const { return node_; }
+
+  // Registers a parameter of this iterator that the performance model may
+  // tune within [`min`, `max`]. Returns nullptr if the pipeline is not
+  // modeled.
+  std::shared_ptr<model::Parameter> AddTunableParameter(const string& name,
+                                                        int64 initial_value,
+                                                        int64 min, int64 max) {
+    if (!node_) {
+      return nullptr;
+    }
+    return model_->AddTunableParameter(node_, name, initial_value, min, max);
+  }
+
+  // Starts and stops measuring the processing time of this iterator in the
+  // calling thread. `GetNext()` does this for the calling thread; iterators
+  // that do work in background threads should call these around that work.
+  void RecordStart(IteratorContext* ctx) {
+    if (node_) {
+      node_->record_start(ctx->env()->NowNanos());
+    }
+  }
+  void RecordStop(IteratorContext* ctx) {
+    if (node_) {
+      node_->record_stop(ctx->env()->NowNanos());
+    }
+  }
+
+  // Called around blocking on another thread for an element, so that the
+  // blocked time is recorded as wait time rather than processing time.
+  void RecordWaitStart(IteratorContext* ctx) {
+    if (node_) {
+      node_->record_wait_start(ctx->env()->NowNanos());
+    }
+  }
+  void RecordWaitStop(IteratorContext* ctx) {
+    if (node_) {
+      node_->record_wait_stop(ctx->env()->NowNanos());
+    }
+  }
+
  private:
+  void AddToModel(IteratorContext* ctx, const string& output_prefix) final {
+    model_ = ctx->model();
+    node_ = model_->AddNode(params_.prefix, output_prefix);
+  }
+
   BaseParams params_;
+  std::shared_ptr<model::Model> model_;
+  std::shared_ptr<model::Node> node_;
 };
 
 // Represents an iterator that is associated with a particular dataset
@@ -0,0 +1,309 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/framework/model.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace model {
+
+namespace {
+
+// `Optimize()` stops increasing parameters once the best increment improves
+// the output time by less than this fraction.
+constexpr double kMinRelativeImprovement = 0.01;
+
+// Returns the expected time a consumer with `consumer_time` per element
+// waits for an element from a producer with `producer_time` per element,
+// when the two are connected by a buffer of `buffer_size` elements.
+double WaitTime(double producer_time, double consumer_time,
+                int64 buffer_size) {
+  if (producer_time <= 0) {
+    return 0;
+  }
+  if (buffer_size <= 0) {
+    return producer_time;
+  }
+  const double ratio = consumer_time / producer_time;
+  double p_buffer_empty;
+  if (std::abs(ratio - 1) < 1e-6) {
+    p_buffer_empty = 1.0 / (buffer_size + 1);
+  } else {
+    p_buffer_empty = (1 - ratio) / (1 - std::pow(ratio, buffer_size + 1.0));
+  }
+  return p_buffer_empty * producer_time;
+}
+
+}  // namespace
+
+struct Model::Snapshot {
+  Node::Type type = Node::Type::kSync;
+  int64 num_elements = 0;
+  // Processing time per element, in nanoseconds.
+  double self_time = 0;
+  std::map<string, int64> fixed_parameters;
+  std::map<string, std::shared_ptr<Parameter>> tunable_parameters;
+  std::vector<std::unique_ptr<Snapshot>> inputs;
+
+  // Number of elements consumed from `input` per element produced.
+  double Ratio(const Snapshot& input) const {
+    if (num_elements == 0) {
+      return 1;
+    }
+    return static_cast<double>(input.num_elements) / num_elements;
+  }
+
+  int64 ParameterValue(const string& name,
+                       const ParameterValues& values) const {
+    auto tunable = tunable_parameters.find(name);
+    if (tunable != tunable_parameters.end()) {
+      auto value = values.find(tunable->second.get());
+      return value != values.end() ? value->second
+                                   : tunable->second->value();
+    }
+    auto fixed = fixed_parameters.find(name);
+    return fixed != fixed_parameters.end() ? fixed->second : 1;
+  }
+
+  // Returns the sum of the output times of the inputs, weighted by the
+  // number of elements consumed from each, when the inputs are consumed
+  // every `consumer_time` nanoseconds.
+  double InputTime(double consumer_time, const ParameterValues& values) const {
+    double input_time = 0;
+    for (const auto& input : inputs) {
+      const double ratio = Ratio(*input);
+      if (ratio <= 0) continue;
+      input_time += ratio * input->OutputTime(consumer_time / ratio, values);
+    }
+    return input_time;
+  }
+
+  // Returns the expected time per element that a consumer which requests an
+  // element every `consumer_time` nanoseconds waits for this node.
+  double OutputTime(double consumer_time,
+                    const ParameterValues& values) const {
+    switch (type) {
+      case Node::Type::kSync:
+        return self_time + InputTime(consumer_time + self_time, values);
+      case Node::Type::kAsyncMap: {
+        // Inputs are fetched sequentially and processed in parallel.
+        const int64 parallelism =
+            std::max<int64>(1, ParameterValue("parallelism", values));
+        const double producer_time =
+            std::max(self_time / parallelism,
+                     InputTime(self_time / parallelism, values));
+        return WaitTime(producer_time, consumer_time, parallelism);
+      }
+      case Node::Type::kAsyncInterleave: {
+        // Each worker fetches from and processes its own input.
+        const int64 parallelism =
+            std::max<int64>(1, ParameterValue("parallelism", values));
+        const double producer_time =
+            (self_time + InputTime(self_time, values)) / parallelism;
+        return WaitTime(producer_time, consumer_time,
+                        parallelism * ParameterValue("buffer_size", values));
+      }
+      case Node::Type::kPrefetch: {
+        // The background thread requests input elements as fast as it can.
+        const double producer_time = self_time + InputTime(0, values);
+        return WaitTime(producer_time, consumer_time,
+                        ParameterValue("buffer_size", values));
+      }
+    }
+    return self_time;
+  }
+
+  // Returns the CPU time, in nanoseconds, spent in this node and its inputs
+  // per element produced.
+  double TotalProcessingTime() const {
+    double total = self_time;
+    for (const auto& input : inputs) {
+      total += Ratio(*input) * input->TotalProcessingTime();
+    }
+    return total;
+  }
+
+  void CollectTunableParameters(std::vector<Parameter*>* result) const {
+    for (const auto& parameter : tunable_parameters) {
+      result->push_back(parameter.second.get());
+    }
+    for (const auto& input : inputs) {
+      input->CollectTunableParameters(result);
+    }
+  }
+};
+
+std::shared_ptr<Node> Model::AddNode(const string& name,
+                                     const string& output_name) {
+  mutex_lock l(mu_);
+  std::shared_ptr<Node> output;
+  auto it = lookup_table_.find(output_name);
+  if (it != lookup_table_.end()) {
+    output = it->second;
+  }
+  std::shared_ptr<Node> node(new Node(id_counter_++, name, output));
+  if (output) {
+    output->inputs_.push_back(node);
+  } else if (!output_) {
+    output_ = node;
+  }
+  lookup_table_[name] = node;
+  return node;
+}
+
+void Model::RemoveNode(const std::shared_ptr<Node>& node) {
+  mutex_lock l(mu_);
+  std::shared_ptr<Node> output;
+  {
+    mutex_lock node_lock(node->mu_);
+    output.swap(node->output_);
+  }
+  if (output) {
+    output->inputs_.remove(node);
+  }
+  for (const std::shared_ptr<Node>& input : node->inputs_) {
+    mutex_lock input_lock(input->mu_);
+    input->output_.reset();
+  }
+  node->inputs_.clear();
+  auto it = lookup_table_.find(node->name());
+  // Another iterator with the same name may have replaced `node`.
+  if (it != lookup_table_.end() && it->second == node) {
+    lookup_table_.erase(it);
+  }
+  if (output_ == node) {
+    output_.reset();
+  }
+}
+
+std::shared_ptr<Parameter> Model::AddTunableParameter(
+    const std::shared_ptr<Node>& node, const string& name, int64 initial_value,
+    int64 min, int64 max) {
+  DCHECK_LE(min, max);
+  std::shared_ptr<Parameter> parameter(
+      new Parameter(std::min(std::max(initial_value, min), max), min, max));
+  mutex_lock l(node->mu_);
+  node->tunable_parameters_[name] = parameter;
+  return parameter;
+}
+
+void Model::RecordConsumerTime(int64 delta_nanos) {
+  mutex_lock l(mu_);
+  consumer_time_ += delta_nanos;
+  num_consumer_times_++;
+}
+
+std::unique_ptr<Model::Snapshot> Model::TakeSnapshot(
+    const std::shared_ptr<Node>& node) {
+  std::unique_ptr<Snapshot> snapshot(new Snapshot);
+  {
+    tf_shared_lock l(node->mu_);
+    snapshot->type = node->type_;
+    snapshot->num_elements = node->num_elements_;
+    if (node->num_elements_ > 0) {
+      snapshot->self_time =
+          static_cast<double>(node->processing_time_) / node->num_elements_;
+    }
+    snapshot->fixed_parameters = node->fixed_parameters_;
+    snapshot->tunable_parameters = node->tunable_parameters_;
+  }
+  for (const std::shared_ptr<Node>& input : node->inputs_) {
+    snapshot->inputs.push_back(TakeSnapshot(input));
+  }
+  return snapshot;
+}
+
+double Model::OutputTime() {
+  std::unique_ptr<Snapshot> snapshot;
+  double consumer_time = 0;
+  {
+    tf_shared_lock l(mu_);
+    if (!output_) return 0;
+    snapshot = TakeSnapshot(output_);
+    if (num_consumer_times_ > 0) {
+      consumer_time = static_cast<double>(consumer_time_) / num_consumer_times_;
+    }
+  }
+  return snapshot->OutputTime(consumer_time, ParameterValues());
+}
+
+void Model::Optimize(int64 cpu_budget) {
+  std::unique_ptr<Snapshot> snapshot;
+  double consumer_time = 0;
+  {
+    tf_shared_lock l(mu_);
+    if (!output_) return;
+    snapshot = TakeSnapshot(output_);
+    if (num_consumer_times_ > 0) {
+      consumer_time = static_cast<double>(consumer_time_) / num_consumer_times_;
+    }
+  }
+  if (snapshot->num_elements == 0) return;
+  std::vector<Parameter*> parameters;
+  snapshot->CollectTunableParameters(&parameters);
+  if (parameters.empty()) return;
+
+  // Hill climbing: starting from the minimum of every parameter, repeatedly
+  // increment the parameter that reduces the output time the most, until no
+  // increment helps or the pipeline would use more than `cpu_budget` cores.
+  // Each element takes `processing_time` of CPU and is consumed every
+  // `consumer_time + output_time`.
+  ParameterValues values;
+  for (Parameter* parameter : parameters) {
+    values[parameter] = parameter->min();
+  }
+  const double processing_time = snapshot->TotalProcessingTime();
+  while (true) {
+    const double output_time = snapshot->OutputTime(consumer_time, values);
+    Parameter* best_parameter = nullptr;
+    double best_delta = kMinRelativeImprovement * output_time;
+    for (Parameter* parameter : parameters) {
+      int64& value = values[parameter];
+      if (value >= parameter->max()) continue;
+      value++;
+      const double new_output_time =
+          snapshot->OutputTime(consumer_time, values);
+      value--;
+      if (processing_time > cpu_budget * (consumer_time + new_output_time)) {
+        continue;
+      }
+      const double delta = output_time - new_output_time;
+      if (delta > best_delta) {
+        best_parameter = parameter;
+        best_delta = delta;
+      }
+    }
+    if (best_parameter == nullptr) break;
+    values[best_parameter]++;
+  }
+
+  for (const auto& value : values) {
+    Parameter* parameter = value.first;
+    if (parameter->value() != value.second) {
+      VLOG(2) << "Setting tunable parameter to " << value.second;
+      parameter->value_.store(value.second, std::memory_order_relaxed);
+    }
+  }
+  VLOG(2) << "Estimated output time: "
+          << snapshot->OutputTime(consumer_time, values) << "ns";
+}
+
+}  // namespace model
+}  // namespace tensorflow
@@ -0,0 +1,284 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_FRAMEWORK_MODEL_H_
+#define TENSORFLOW_CORE_FRAMEWORK_MODEL_H_
+
+#include <atomic>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace model {
+
+// Value of a parallelism or buffer size argument of a dataset that asks for
+// the argument to be tuned by the model of the pipeline.
+constexpr int64 kAutoTune = -1;
+
+// A knob of an iterator that the model may tune, such as the number of
+// parallel calls of a map or the size of a prefetch buffer.
+//
+// The iterator reads the current value with `value()` whenever it needs it;
+// `Model::Optimize()` stores new values without taking any iterator lock, so
+// an iterator that is blocked may only observe a new value after it is woken
+// up for another reason (e.g. an element was produced or consumed).
+class Parameter {
+ public:
+  Parameter(int64 value, int64 min, int64 max)
+      : value_(value), min_(min), max_(max) {}
+
+  int64 value() const { return value_.load(std::memory_order_relaxed); }
+  int64 min() const { return min_; }
+  int64 max() const { return max_; }
+
+ private:
+  friend class Model;
+
+  std::atomic<int64> value_;
+  const int64 min_;
+  const int64 max_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(Parameter);
+};
+
+// A node of the model. There is one node for each iterator of the modeled
+// input pipeline, and the inputs of a node are the nodes of the iterators it
+// consumes.
+//
+// A node records how many elements its iterator produced and how much time
+// the iterator spent producing them, excluding the time spent in its inputs.
+// All recording methods are thread-safe.
+class Node {
+ public:
+  // Determines how the output time of a node depends on its processing time
+  // and on the output time of its inputs.
+  enum class Type {
+    // Produces elements synchronously, in the thread of its consumer.
+    kSync,
+    // Fetches input elements one at a time and processes up to
+    // "parallelism" of them concurrently, buffering up to "parallelism"
+    // results (e.g. a parallel map).
+    kAsyncMap,
+    // Runs "parallelism" workers that each consume their own input and
+    // buffer up to "buffer_size" elements (e.g. a parallel interleave).
+    kAsyncInterleave,
+    // Produces elements in a background thread into a buffer of
+    // "buffer_size" elements (e.g. a prefetch).
+    kPrefetch,
+  };
+
+  Node(int64 id, const string& name, std::shared_ptr<Node> output)
+      : id_(id), name_(name), output_(std::move(output)) {}
+
+  int64 id() const { return id_; }
+  const string& name() const { return name_; }
+
+  // Returns the node consuming the output of this node, if any.
+  std::shared_ptr<Node> output() LOCKS_EXCLUDED(mu_) {
+    tf_shared_lock l(mu_);
+    return output_;
+  }
+
+  Type type() LOCKS_EXCLUDED(mu_) {
+    tf_shared_lock l(mu_);
+    return type_;
+  }
+  void set_type(Type type) LOCKS_EXCLUDED(mu_) {
+    mutex_lock l(mu_);
+    type_ = type;
+  }
+
+  // Sets the value of a parameter ("parallelism" or "buffer_size") that is
+  // not tuned by the model. Parameters default to 1.
+  void set_parameter(const string& name, int64 value) LOCKS_EXCLUDED(mu_) {
+    mutex_lock l(mu_);
+    fixed_parameters_[name] = value;
+  }
+
+  // Starts measuring processing time in the calling thread.
+  void record_start(int64 time_nanos) LOCKS_EXCLUDED(mu_) {
+    mutex_lock l(mu_);
+    work_start_[std::this_thread::get_id()] = time_nanos;
+  }
+
+  // Stops measuring processing time in the calling thread. Returns false,
+  // and does nothing, if the time was not being measured.
+  bool record_stop(int64 time_nanos) LOCKS_EXCLUDED(mu_) {
+    mutex_lock l(mu_);
+    return RecordStopLocked(time_nanos);
+  }
+
+  // Called when the calling thread blocks until another thread produces an
+  // element. Until `record_wait_stop()`, the time is recorded as wait time
+  // rather than processing time.
+  void record_wait_start(int64 time_nanos) LOCKS_EXCLUDED(mu_) {
+    mutex_lock l(mu_);
+    RecordStopLocked(time_nanos);
+    wait_start_[std::this_thread::get_id()] = time_nanos;
+  }
+
+  void record_wait_stop(int64 time_nanos) LOCKS_EXCLUDED(mu_) {
+    mutex_lock l(mu_);
+    const std::thread::id id = std::this_thread::get_id();
+    auto it = wait_start_.find(id);
+    if (it != wait_start_.end()) {
+      wait_time_ += time_nanos - it->second;
+      wait_start_.erase(it);
+      work_start_[id] = time_nanos;
+    }
+  }
+
+  // Adds processing time that was measured by the caller, e.g. the duration
+  // of an asynchronous function call.
+  void add_processing_time(int64 delta_nanos) LOCKS_EXCLUDED(mu_) {
+    mutex_lock l(mu_);
+    processing_time_ += delta_nanos;
+  }
+
+  void record_element() LOCKS_EXCLUDED(mu_) {
+    mutex_lock l(mu_);
+    num_elements_++;
+  }
+
+  int64 num_elements() LOCKS_EXCLUDED(mu_) {
+    tf_shared_lock l(mu_);
+    return num_elements_;
+  }
+
+  int64 processing_time() LOCKS_EXCLUDED(mu_) {
+    tf_shared_lock l(mu_);
+    return processing_time_;
+  }
+
+  int64 wait_time() LOCKS_EXCLUDED(mu_) {
+    tf_shared_lock l(mu_);
+    return wait_time_;
+  }
+
+ private:
+  friend class Model;
+
+  bool RecordStopLocked(int64 time_nanos) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    auto it = work_start_.find(std::this_thread::get_id());
+    if (it == work_start_.end()) {
+      return false;
+    }
+    processing_time_ += time_nanos - it->second;
+    work_start_.erase(it);
+    return true;
+  }
+
+  const int64 id_;
+  const string name_;
+  mutex mu_;
+  std::shared_ptr<Node> output_ GUARDED_BY(mu_);
+  Type type_ GUARDED_BY(mu_) = Type::kSync;
+  std::map<string, int64> fixed_parameters_ GUARDED_BY(mu_);
+  std::map<string, std::shared_ptr<Parameter>> tunable_parameters_
+      GUARDED_BY(mu_);
+  int64 num_elements_ GUARDED_BY(mu_) = 0;
+  int64 processing_time_ GUARDED_BY(mu_) = 0;
+  int64 wait_time_ GUARDED_BY(mu_) = 0;
+  // Start times of the threads that are working for or waiting on this node.
+  std::map<std::thread::id, int64> work_start_ GUARDED_BY(mu_);
+  std::map<std::thread::id, int64> wait_start_ GUARDED_BY(mu_);
+
+  // Guarded by the `mu_` of the model that owns this node.
+  std::list<std::shared_ptr<Node>> inputs_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(Node);
+};
+
+// A performance model of an input pipeline.
+//
+// The model is a tree of nodes, one per iterator, fed with the processing
+// time and element counts recorded by the iterators. From these it estimates
+// the output time of the pipeline -- the expected time its consumer waits for
+// an element -- as a function of the tunable parameters of the iterators.
+// `Optimize()` searches for parameter values that minimize the output time
+// without using more CPU than a given budget, and hands them to the
+// iterators.
+//
+// Asynchronous nodes are modeled as a producer and a consumer connected by a
+// bounded buffer. With producer time `x` and consumer time `c` per element,
+// and a buffer of `b` elements, the consumer finds the buffer empty with
+// probability `(1 - r) / (1 - r^(b+1))`, where `r = c / x` (the M/M/1/b
+// queue), in which case it waits for about `x`.
+//
+// All methods are thread-safe.
+class Model {
+ public:
+  Model() = default;
+
+  // Adds a node for the iterator `name`, as an input of the node of the
+  // iterator `output_name`. The first node that is added becomes the output
+  // of the model.
+  std::shared_ptr<Node> AddNode(const string& name, const string& output_name)
+      LOCKS_EXCLUDED(mu_);
+
+  // Removes `node` and detaches it from its output and inputs.
+  void RemoveNode(const std::shared_ptr<Node>& node) LOCKS_EXCLUDED(mu_);
+
+  // Registers a parameter of `node` that `Optimize()` may set to any value
+  // in [`min`, `max`]. Returns the parameter, whose value is `initial_value`
+  // until the next call to `Optimize()`.
+  std::shared_ptr<Parameter> AddTunableParameter(
+      const std::shared_ptr<Node>& node, const string& name,
+      int64 initial_value, int64 min, int64 max) LOCKS_EXCLUDED(mu_);
+
+  // Records the time the consumer of the pipeline spent between receiving an
+  // element and requesting the next one.
+  void RecordConsumerTime(int64 delta_nanos) LOCKS_EXCLUDED(mu_);
+
+  // Returns the estimated output time of the pipeline in nanoseconds, using
+  // the current values of the tunable parameters.
+  double OutputTime() LOCKS_EXCLUDED(mu_);
+
+  // Sets the tunable parameters to the values that minimize the estimated
+  // output time, subject to the estimated CPU usage of the pipeline not
+  // exceeding `cpu_budget` cores. Does nothing until the pipeline produced
+  // at least one element.
+  void Optimize(int64 cpu_budget) LOCKS_EXCLUDED(mu_);
+
+ private:
+  // A copy of the statistics and parameters of a node and its inputs, which
+  // the optimization works on without holding any lock.
+  struct Snapshot;
+  using ParameterValues = std::map<Parameter*, int64>;
+
+  std::unique_ptr<Snapshot> TakeSnapshot(const std::shared_ptr<Node>& node)
+      SHARED_LOCKS_REQUIRED(mu_);
+
+  mutex mu_;
+  int64 id_counter_ GUARDED_BY(mu_) = 1;
+  std::shared_ptr<Node> output_ GUARDED_BY(mu_);
+  std::map<string, std::shared_ptr<Node>> lookup_table_ GUARDED_BY(mu_);
+  int64 consumer_time_ GUARDED_BY(mu_) = 0;
+  int64 num_consumer_times_ GUARDED_BY(mu_) = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(Model);
+};
+
+}  // namespace model
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_FRAMEWORK_MODEL_H_
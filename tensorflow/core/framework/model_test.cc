@@ -0,0 +1,127 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/framework/model.h"
+
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace model {
+namespace {
+
+// Records `num_elements` elements, each taking `time_per_element`
+// nanoseconds of processing time in `node`.
+void RecordElements(Node* node, int64 num_elements, int64 time_per_element) {
+  for (int64 i = 0; i < num_elements; ++i) {
+    node->add_processing_time(time_per_element);
+    node->record_element();
+  }
+}
+
+TEST(ModelTest, AddAndRemoveNodes) {
+  Model model;
+  std::shared_ptr<Node> output = model.AddNode("a", "");
+  std::shared_ptr<Node> input = model.AddNode("a::b", "a");
+  EXPECT_EQ(output, input->output());
+  EXPECT_EQ(nullptr, output->output());
+
+  model.RemoveNode(input);
+  EXPECT_EQ(nullptr, input->output());
+  model.RemoveNode(output);
+  EXPECT_EQ(0, model.OutputTime());
+}
+
+TEST(ModelTest, RecordTime) {
+  Model model;
+  std::shared_ptr<Node> node = model.AddNode("a", "");
+  EXPECT_FALSE(node->record_stop(100));
+  node->record_start(100);
+  node->record_wait_start(150);
+  node->record_wait_stop(170);
+  EXPECT_TRUE(node->record_stop(200));
+  EXPECT_EQ(80, node->processing_time());
+  EXPECT_EQ(20, node->wait_time());
+}
+
+TEST(ModelTest, SyncOutputTime) {
+  Model model;
+  std::shared_ptr<Node> output = model.AddNode("a", "");
+  std::shared_ptr<Node> input = model.AddNode("a::b", "a");
+  RecordElements(output.get(), 10, 100);
+  // The input produces two elements for each element of the output.
+  RecordElements(input.get(), 20, 50);
+  EXPECT_DOUBLE_EQ(200, model.OutputTime());
+}
+
+TEST(ModelTest, OptimizeAsyncMap) {
+  Model model;
+  std::shared_ptr<Node> node = model.AddNode("a", "");
+  node->set_type(Node::Type::kAsyncMap);
+  std::shared_ptr<Parameter> parallelism =
+      model.AddTunableParameter(node, "parallelism", 1, 1, 8);
+  EXPECT_EQ(1, parallelism->value());
+  RecordElements(node.get(), 100, 1000);
+  // The consumer is fast, so the output time is about the processing time.
+  model.RecordConsumerTime(10);
+  const double sequential_output_time = model.OutputTime();
+
+  model.Optimize(/*cpu_budget=*/8);
+  EXPECT_GT(parallelism->value(), 1);
+  EXPECT_LE(parallelism->value(), 8);
+  EXPECT_LT(model.OutputTime(), sequential_output_time);
+}
+
+TEST(ModelTest, OptimizeRespectsCpuBudget) {
+  Model model;
+  std::shared_ptr<Node> node = model.AddNode("a", "");
+  node->set_type(Node::Type::kAsyncMap);
+  std::shared_ptr<Parameter> parallelism =
+      model.AddTunableParameter(node, "parallelism", 4, 1, 8);
+  RecordElements(node.get(), 100, 1000);
+  model.RecordConsumerTime(10);
+
+  model.Optimize(/*cpu_budget=*/2);
+  EXPECT_EQ(2, parallelism->value());
+}
+
+TEST(ModelTest, OptimizePrefetch) {
+  Model model;
+  std::shared_ptr<Node> output = model.AddNode("a", "");
+  output->set_type(Node::Type::kPrefetch);
+  std::shared_ptr<Parameter> buffer_size =
+      model.AddTunableParameter(output, "buffer_size", 1, 1, 16);
+  std::shared_ptr<Node> input = model.AddNode("a::b", "a");
+  RecordElements(output.get(), 100, 0);
+  RecordElements(input.get(), 100, 1000);
+  // The consumer is as fast as the producer, so a larger buffer helps.
+  model.RecordConsumerTime(1000);
+
+  model.Optimize(/*cpu_budget=*/4);
+  EXPECT_GT(buffer_size->value(), 1);
+}
+
+TEST(ModelTest, OptimizeWithoutElements) {
+  Model model;
+  std::shared_ptr<Node> node = model.AddNode("a", "");
+  node->set_type(Node::Type::kAsyncMap);
+  std::shared_ptr<Parameter> parallelism =
+      model.AddTunableParameter(node, "parallelism", 3, 1, 8);
+  model.Optimize(/*cpu_budget=*/8);
+  EXPECT_EQ(3, parallelism->value());
+}
+
+}  // namespace
+}  // namespace model
+}  // namespace tensorflow
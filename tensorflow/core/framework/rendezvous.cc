@@ -45,6 +45,7 @@ Rendezvous::ParsedKey& Rendezvous::ParsedKey::operator=(const ParsedKey& b) {
   dst = b.dst;
   edge_name = StringPiece(buf_.data() + (b.edge_name.data() - b_base),
                           b.edge_name.size());
+  slot = b.slot;
   return *this;
 }
 
@@ -146,6 +147,11 @@ Status Rendezvous::Recv(const ParsedKey& key, const Args& args, Tensor* val,
   return Recv(key, args, val, is_dead, no_timeout);
 }
 
+bool Rendezvous::TryRecv(const ParsedKey& key, const Args& args,
+                         DoneCallback done) {
+  return false;
+}
+
 class LocalRendezvousImpl : public Rendezvous {
  public:
   explicit LocalRendezvousImpl() {}
@@ -235,6 +241,38 @@ class LocalRendezvousImpl : public Rendezvous {
     delete item;
   }
 
+  bool TryRecv(const ParsedKey& key, const Args& recv_args,
+               DoneCallback done) override {
+    uint64 key_hash = KeyHash(key.FullKey());
+    VLOG(2) << "TryRecv " << this << " " << key_hash << " " << key.FullKey();
+
+    mu_.lock();
+    if (!status_.ok()) {
+      // Rendezvous has been aborted.
+      Status s = status_;
+      mu_.unlock();
+      done(s, Args(), recv_args, Tensor(), false);
+      return true;
+    }
+
+    auto it = table_.find(key_hash);
+    if (it == table_.end() || it->second.empty() ||
+        !it->second.front()->IsSendValue()) {
+      // There is no message to pick up yet.
+      mu_.unlock();
+      return false;
+    }
+
+    Item* item = it->second.front();
+    it->second.pop_front();
+    mu_.unlock();
+
+    DCHECK(item->IsSendValue());
+    done(Status::OK(), item->send_args, recv_args, item->value, item->is_dead);
+    delete item;
+    return true;
+  }
+
   void StartAbort(const Status& status) override {
     CHECK(!status.ok());
     Table table;
@@ -66,6 +66,13 @@ class Rendezvous : public core::RefCounted {
     StringPiece dst_device;
     DeviceNameUtils::ParsedName dst;
     StringPiece edge_name;
+    // If non-negative, the slot that the graph partitioner pre-assigned to
+    // the Send/Recv pair using this key (see
+    // PartitionOptions::assign_rendezvous_slots). A Rendezvous may match
+    // the pair through this slot instead of through the full key; others
+    // ignore it. Only set on keys of the top-level frame and iteration,
+    // which a pair uses at most once per step.
+    int32 slot = -1;
 
     ParsedKey() {}
     ParsedKey(const ParsedKey& b) { *this = b; }
@@ -108,6 +115,13 @@ class Rendezvous : public core::RefCounted {
   virtual void RecvAsync(const ParsedKey& key, const Args& args,
                          DoneCallback done) = 0;
 
+  // Like RecvAsync(), but doesn't wait for the tensor for "key": runs "done"
+  // and returns true if the tensor has already been sent or the rendezvous
+  // has been aborted, and returns false without consuming anything
+  // otherwise. The default implementation always returns false.
+  virtual bool TryRecv(const ParsedKey& key, const Args& args,
+                       DoneCallback done);
+
   // Synchronous wrapper for RecvAsync.
   Status Recv(const ParsedKey& key, const Args& args, Tensor* val,
               bool* is_dead, int64 timeout_ms);
@@ -976,6 +976,7 @@ Status Partition(const PartitionOptions& opts, Graph* g,
 
   int32 num_data = 0;
   int32 num_control = 0;
+  int32 num_rendezvous_slots = 0;
   for (const Node* dst : g->op_nodes()) {
     dstp = opts.node_to_loc(dst);
     GraphDef* dst_graph = &(*partitions)[dstp];
@@ -1117,6 +1118,12 @@ Status Partition(const PartitionOptions& opts, Graph* g,
           AddRecv(opts, g_info, dst_graph, edge, &real_recv, &status);
       if (!status.ok()) return status;
 
+      if (opts.assign_rendezvous_slots) {
+        AddNodeAttr("_rendezvous_slot", num_rendezvous_slots, send);
+        AddNodeAttr("_rendezvous_slot", num_rendezvous_slots, real_recv);
+        ++num_rendezvous_slots;
+      }
+
       // Fix up the control flow edge.
       // NOTE(yuanbyu): 'real_recv' must be the real recv node.
       if (src_graph == dst_graph) {
@@ -76,6 +76,13 @@ struct PartitionOptions {
   // in the graph as a node attribute.
   bool need_to_record_start_times = false;
   std::vector<Microseconds> start_times;
+
+  // If true, each Send/Recv pair added by Partition is assigned a distinct
+  // integer slot, numbered from 0 and recorded in the "_rendezvous_slot"
+  // attr of both nodes, so that a rendezvous created for the partitions can
+  // match the pair without looking up its key. See
+  // Rendezvous::ParsedKey::slot.
+  bool assign_rendezvous_slots = false;
 };
 
 // Partition "input" graph into a set of graphs, one per location.
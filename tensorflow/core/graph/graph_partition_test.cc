@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "tensorflow/core/graph/graph_partition.h"
 
+#include <map>
+#include <set>
 #include <unordered_map>
 #include <utility>
 
@@ -458,6 +460,52 @@ TEST_F(GraphPartitionTest, PartitionIncompleteGraph) {
   EXPECT_EQ(error::INVALID_ARGUMENT, status.code()) << status;
 }
 
+TEST_F(GraphPartitionTest, RendezvousSlots) {
+  auto a1 = FloatInput(in_.WithOpName("A1"));
+  auto b1 = FloatInput(in_.WithOpName("B1"));
+  Combine(in_.WithOpName("B2"), a1, b1);
+  Combine(in_.WithOpName("A2").WithControlDependencies(b1), a1, a1);
+
+  Graph g(OpRegistry::Global());
+  TF_ASSERT_OK(ConvertGraphDefToGraph(GraphConstructorOptions(), ToGraphDef(),
+                                      &g));
+  for (Node* node : g.nodes()) {
+    node->set_assigned_device_name(DeviceName(node));
+  }
+  PartitionOptions popts;
+  popts.node_to_loc = SplitByDevice;
+  popts.new_name = [&g](const string& prefix) { return g.NewName(prefix); };
+  popts.get_incarnation = [](const string&) { return 1; };
+  popts.assign_rendezvous_slots = true;
+  TF_ASSERT_OK(Partition(popts, &g, &partitions_));
+  EXPECT_EQ(2, partitions_.size());
+
+  // Both ends of a pair get the same slot, and each pair its own slot.
+  std::map<string, int32> send_slots;
+  std::map<string, int32> recv_slots;
+  for (const auto& kv : partitions_) {
+    for (const NodeDef& ndef : kv.second.node()) {
+      if (ndef.op() != "_Send" && ndef.op() != "_Recv") continue;
+      string tensor_name;
+      TF_ASSERT_OK(GetNodeAttr(ndef, "tensor_name", &tensor_name));
+      int32 slot;
+      TF_ASSERT_OK(GetNodeAttr(ndef, "_rendezvous_slot", &slot));
+      if (ndef.op() == "_Send") {
+        send_slots[tensor_name] = slot;
+      } else {
+        recv_slots[tensor_name] = slot;
+      }
+    }
+  }
+  EXPECT_EQ(2, send_slots.size());
+  EXPECT_EQ(send_slots, recv_slots);
+  std::set<int32> slots;
+  for (const auto& kv : send_slots) {
+    slots.insert(kv.second);
+  }
+  EXPECT_EQ(std::set<int32>({0, 1}), slots);
+}
+
 TEST_F(GraphPartitionTest, Functions) {
   FunctionDefLibrary fdef_lib;
   *fdef_lib.add_function() = test::function::XTimesTwo();
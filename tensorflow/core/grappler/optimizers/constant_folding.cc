@@ -17,6 +17,8 @@ limitations under the License.
 
 #include "tensorflow/core/grappler/optimizers/constant_folding.h"
 
+#include <numeric>
+
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/attr_value.pb.h"
 #include "tensorflow/core/framework/function.pb.h"
@@ -34,10 +36,12 @@ limitations under the License.
 #include "tensorflow/core/grappler/optimizers/evaluation_utils.h"
 #include "tensorflow/core/grappler/optimizers/symbolic_shapes.h"
 #include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
 #include "tensorflow/core/lib/core/stringpiece.h"
 #include "tensorflow/core/lib/gtl/cleanup.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/strings/numbers.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/denormal.h"
@@ -971,8 +975,8 @@ Status ConstantFolding::EvaluateNode(const NodeDef& node,
                                               resource_mgr_.get(), output);
 }
 
-Status ConstantFolding::EvaluateOneFoldable(const NodeDef& node,
-                                            std::vector<NodeDef>* outputs) {
+Status ConstantFolding::EvaluateOneFoldable(
+    const NodeDef& node, std::vector<NodeDef>* outputs) const {
   TensorVector inputs;
   TensorVector output_tensors;
   auto inputs_cleanup = gtl::MakeCleanup([&inputs, &output_tensors] {
@@ -1012,10 +1016,7 @@ Status ConstantFolding::EvaluateOneFoldable(const NodeDef& node,
 
   outputs->resize(output_tensors.size());
   for (size_t i = 0; i < output_tensors.size(); i++) {
-    string node_name = OptimizedNodeName(node, "-folded");
-    if (output_tensors.size() > 1) {
-      node_name = strings::StrCat(node_name, "-", i);
-    }
+    const string node_name = FoldedNodeName(node, i, output_tensors.size());
     if (output_tensors[i].tensor) {
       TF_RETURN_IF_ERROR(
           CreateNodeDef(node_name, output_tensors[i], &outputs->at(i)));
@@ -1028,7 +1029,151 @@ Status ConstantFolding::EvaluateOneFoldable(const NodeDef& node,
   return Status::OK();
 }
 
-Status ConstantFolding::FoldNode(NodeDef* node, GraphDef* output_graph) {
+namespace {
+
+// Bounds the estimated memory of the nodes that FoldGraph() evaluates
+// together, as well as the size of the results it memoizes.
+constexpr int64 kFoldingMemoryBudget = 1LL << 30;
+
+// Batches of nodes that take less memory than this to evaluate are too cheap
+// to be worth evaluating concurrently.
+constexpr int64 kMinParallelFoldingBytes = 64 << 10;
+
+// Returns a key that identifies the values computed by `node`: its op, its
+// attributes and its data inputs, after replacing the inputs found in
+// `aliases` by constants known to hold the same values.
+string FoldingKey(const NodeDef& node,
+                  const std::unordered_map<string, string>& aliases) {
+  NodeDef signature;
+  signature.set_op(node.op());
+  *signature.mutable_attr() = node.attr();
+  for (const auto& input : node.input()) {
+    if (IsControlInput(input)) {
+      break;
+    }
+    int port;
+    string input_name = ParseNodeName(input, &port);
+    auto it = aliases.find(input_name);
+    if (it != aliases.end()) {
+      input_name = it->second;
+    }
+    signature.add_input(strings::StrCat(input_name, ":", port));
+  }
+  string key;
+  SerializeToStringDeterministic(signature, &key);
+  return key;
+}
+
+// The constants that a node was folded into, which FoldGraph() reuses for
+// the nodes that compute the same values.
+struct MemoizedFold {
+  // The names under which the values can be found in the graph, or an empty
+  // string for dead outputs.
+  std::vector<string> names;
+  // The result of EvaluateOneFoldable().
+  std::vector<NodeDef> const_nodes;
+};
+
+// Returns the names under which the values of `const_nodes`, the folded
+// outputs of `node`, can be found in the graph once `node` is folded.
+std::vector<string> FoldedValueNames(const NodeDef& node,
+                                     const std::vector<NodeDef>& const_nodes) {
+  std::vector<string> names;
+  for (const NodeDef& const_node : const_nodes) {
+    if (const_node.name().empty()) {
+      names.emplace_back();
+    } else {
+      // Nodes with a single output are rewritten in place.
+      names.push_back(const_nodes.size() == 1 ? node.name()
+                                              : const_node.name());
+    }
+  }
+  return names;
+}
+
+}  // namespace
+
+string ConstantFolding::FoldedNodeName(const NodeDef& node, int output,
+                                       int num_outputs) const {
+  string node_name = OptimizedNodeName(node, "-folded");
+  if (num_outputs > 1) {
+    node_name = strings::StrCat(node_name, "-", output);
+  }
+  return node_name;
+}
+
+int64 ConstantFolding::EstimateFoldingMemory(const NodeDef& node) const {
+  int64 input_bytes = 0;
+  for (const auto& input : node.input()) {
+    if (IsControlInput(input)) {
+      break;
+    }
+    const NodeDef* input_node = node_map_->GetNode(input);
+    if (input_node == nullptr || !IsReallyConstant(*input_node)) {
+      continue;
+    }
+    const TensorProto& raw_val = input_node->attr().at("value").tensor();
+    if (TensorShape::IsValid(raw_val.tensor_shape())) {
+      const TensorShape shape(raw_val.tensor_shape());
+      input_bytes += shape.num_elements() * DataTypeSize(raw_val.dtype());
+    } else {
+      input_bytes += raw_val.ByteSizeLong();
+    }
+  }
+  return 2 * input_bytes;
+}
+
+void ConstantFolding::EvaluateFoldables(
+    const std::vector<NodeDef*>& nodes, std::vector<Status>* statuses,
+    std::vector<std::vector<NodeDef>>* outputs) {
+  statuses->assign(nodes.size(), Status::OK());
+  outputs->clear();
+  outputs->resize(nodes.size());
+
+  std::vector<int64> bytes(nodes.size());
+  int64 total_bytes = 0;
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    bytes[i] = EstimateFoldingMemory(*nodes[i]);
+    total_bytes += bytes[i];
+  }
+  // Handing small nodes to the thread pool costs more than evaluating them.
+  const int num_threads = port::NumSchedulableCPUs();
+  if (nodes.size() < 2 || num_threads < 2 ||
+      total_bytes < kMinParallelFoldingBytes) {
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      (*statuses)[i] = EvaluateOneFoldable(*nodes[i], &(*outputs)[i]);
+    }
+    return;
+  }
+
+  if (folding_pool_ == nullptr) {
+    folding_pool_.reset(
+        new thread::ThreadPool(Env::Default(), "constant_folding",
+                               num_threads));
+  }
+  // Start with the most expensive nodes, so that they don't end up delaying
+  // the whole batch.
+  std::vector<int> order(nodes.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&bytes](int a, int b) { return bytes[a] > bytes[b]; });
+  BlockingCounter counter(nodes.size());
+  for (int i : order) {
+    folding_pool_->Schedule([this, &nodes, statuses, outputs, &counter, i]() {
+      // TensorFlow flushes denormals to zero and rounds to nearest, so we do
+      // the same here.
+      port::ScopedFlushDenormal flush;
+      port::ScopedSetRound round(FE_TONEAREST);
+      (*statuses)[i] = EvaluateOneFoldable(*nodes[i], &(*outputs)[i]);
+      counter.DecrementCount();
+    });
+  }
+  counter.Wait();
+}
+
+Status ConstantFolding::FoldNode(NodeDef* node,
+                                 std::vector<NodeDef>* const_nodes,
+                                 GraphDef* output_graph) {
   if (IsMerge(*node)) {
     // Merge nodes are special, in the sense that they execute as soon as one of
     // their input is ready. We can therefore fold a merge node iff it has at
@@ -1120,11 +1265,9 @@ Status ConstantFolding::FoldNode(NodeDef* node, GraphDef* output_graph) {
     return Status::OK();
   }
 
-  std::vector<NodeDef> const_nodes;
-  TF_RETURN_IF_ERROR(EvaluateOneFoldable(*node, &const_nodes));
   NodeDef* constant_output = nullptr;
-  for (int i = 0; i < const_nodes.size(); i++) {
-    NodeDef* const_node = &const_nodes[i];
+  for (int i = 0; i < const_nodes->size(); i++) {
+    NodeDef* const_node = &(*const_nodes)[i];
     if (const_node->name().empty()) {
       // Dead output: we can't create a constant to encode its value, so we'll
       // just skip it. We'll preserve the edges that originate from that
@@ -1153,7 +1296,7 @@ Status ConstantFolding::FoldNode(NodeDef* node, GraphDef* output_graph) {
 
     // We rewrite the existing node if it only has a single output, and
     // create new nodes otherwise.
-    if (const_nodes.size() == 1) {
+    if (const_nodes->size() == 1) {
       node->set_op("Const");
       // Note we need to clear the inputs in NodeMap before we clear the inputs
       // in the node, otherwise NodeMap would see empty inputs and effectively
@@ -1186,7 +1329,7 @@ Status ConstantFolding::FoldNode(NodeDef* node, GraphDef* output_graph) {
     }
   }
 
-  if (const_nodes.size() > 1) {
+  if (const_nodes->size() > 1) {
     auto outputs = node_map_->GetOutputs(node->name());
     for (NodeDef* output : outputs) {
       for (int i = 0; i < output->input_size(); i++) {
@@ -1201,12 +1344,12 @@ Status ConstantFolding::FoldNode(NodeDef* node, GraphDef* output_graph) {
                                      constant_output->name());
               *output->mutable_input(i) = AsControlDependency(*constant_output);
             }
-          } else if (port < const_nodes.size() &&
-                     !const_nodes[port].name().empty()) {
+          } else if (port < const_nodes->size() &&
+                     !(*const_nodes)[port].name().empty()) {
             // Replace alive outputs with the corresponding constant.
             node_map_->UpdateInput(output->name(), NodeName(output->input(i)),
-                                   const_nodes[port].name());
-            *output->mutable_input(i) = const_nodes[port].name();
+                                   (*const_nodes)[port].name());
+            *output->mutable_input(i) = (*const_nodes)[port].name();
           } else {
             // Leave this edge alone.
             VLOG(1) << "Preserving edge from " << node->name() << ":" << port
@@ -1234,30 +1377,132 @@ Status ConstantFolding::FoldGraph(GraphDef* output) {
       queue.push_back(graph_->mutable_node(i));
     }
   }
+  // The folds that nodes computing the same values can reuse, and the
+  // constants known to hold the same values as others.
+  std::unordered_map<string, MemoizedFold> memo;
+  int64 memo_bytes = 0;
+  std::unordered_map<string, string> aliases;
+  auto rename_folded_nodes = [this](const NodeDef& node,
+                                    std::vector<NodeDef>* const_nodes) {
+    for (size_t i = 0; i < const_nodes->size(); ++i) {
+      NodeDef* const_node = &(*const_nodes)[i];
+      if (!const_node->name().empty()) {
+        const_node->set_name(FoldedNodeName(node, i, const_nodes->size()));
+      }
+    }
+  };
   while (!queue.empty()) {
-    NodeDef* node = queue.front();
-    queue.pop_front();
-    if (processed_nodes.count(node->name())) {
-      continue;
+    // The inputs of the nodes in the queue are already constant, so they
+    // don't depend on each other. Evaluate as many of them at once as the
+    // memory budget allows, then fold them one by one in queue order.
+    std::vector<NodeDef*> batch;
+    std::unordered_set<NodeDef*> in_batch;
+    int64 batch_bytes = 0;
+    while (!queue.empty()) {
+      NodeDef* node = queue.front();
+      if (processed_nodes.count(node->name()) || in_batch.count(node)) {
+        queue.pop_front();
+        continue;
+      }
+      const int64 bytes = IsMerge(*node) ? 0 : EstimateFoldingMemory(*node);
+      if (!batch.empty() && batch_bytes + bytes > kFoldingMemoryBudget) {
+        break;
+      }
+      queue.pop_front();
+      batch.push_back(node);
+      in_batch.insert(node);
+      batch_bytes += bytes;
     }
-    // We need to record a copy of output nodes before FoldNode() modifies it.
-    // We also need to ensure that the fanout is sorted deterministically.
-    const std::set<NodeDef*>& outputs = node_map_->GetOutputs(node->name());
-    std::vector<NodeDef*> fanout(outputs.begin(), outputs.end());
-    std::sort(fanout.begin(), fanout.end(),
-              [](const NodeDef* n1, const NodeDef* n2) {
-                return n1->name() < n2->name();
-              });
-
-    Status s = FoldNode(node, output);
-    processed_nodes.insert(node->name());
-    if (!s.ok()) {
-      VLOG(1) << "Failed to fold node " << node->DebugString()
-              << "\nError message: " << s;
-    } else {
-      for (auto& output : fanout) {
-        if (IsFoldable(*output)) {
-          queue.push_back(output);
+
+    // Only evaluate the first of the nodes that compute the same values, and
+    // none of those whose values are memoized.
+    std::vector<string> keys(batch.size());
+    std::vector<int> evaluation(batch.size(), -1);
+    std::vector<NodeDef*> to_evaluate;
+    std::unordered_map<string, int> evaluated_keys;
+    for (size_t i = 0; i < batch.size(); ++i) {
+      if (IsMerge(*batch[i])) {
+        continue;
+      }
+      keys[i] = FoldingKey(*batch[i], aliases);
+      if (memo.count(keys[i])) {
+        continue;
+      }
+      auto it = evaluated_keys.emplace(keys[i], to_evaluate.size());
+      if (it.second) {
+        to_evaluate.push_back(batch[i]);
+      }
+      evaluation[i] = it.first->second;
+    }
+    std::vector<Status> statuses;
+    std::vector<std::vector<NodeDef>> results;
+    EvaluateFoldables(to_evaluate, &statuses, &results);
+
+    for (size_t i = 0; i < batch.size(); ++i) {
+      NodeDef* node = batch[i];
+      // We need to record a copy of output nodes before FoldNode() modifies
+      // it. We also need to ensure that the fanout is sorted
+      // deterministically.
+      const std::set<NodeDef*>& outputs = node_map_->GetOutputs(node->name());
+      std::vector<NodeDef*> fanout(outputs.begin(), outputs.end());
+      std::sort(fanout.begin(), fanout.end(),
+                [](const NodeDef* n1, const NodeDef* n2) {
+                  return n1->name() < n2->name();
+                });
+
+      Status s;
+      std::vector<NodeDef> const_nodes;
+      const bool evaluated =
+          evaluation[i] >= 0 && to_evaluate[evaluation[i]] == node;
+      auto memoized = memo.find(keys[i]);
+      if (IsMerge(*node)) {
+        s = FoldNode(node, &const_nodes, output);
+      } else if (!evaluated && memoized != memo.end()) {
+        // Reuse the values of an identical node, under names of our own.
+        const_nodes = memoized->second.const_nodes;
+        rename_folded_nodes(*node, &const_nodes);
+        const std::vector<string> names = FoldedValueNames(*node, const_nodes);
+        s = FoldNode(node, &const_nodes, output);
+        if (s.ok()) {
+          for (size_t j = 0; j < names.size(); ++j) {
+            if (!names[j].empty()) {
+              aliases[names[j]] = memoized->second.names[j];
+            }
+          }
+        }
+      } else {
+        s = statuses[evaluation[i]];
+        if (s.ok()) {
+          const_nodes = results[evaluation[i]];
+          if (!evaluated) {
+            // The values of an identical node that weren't memoized.
+            rename_folded_nodes(*node, &const_nodes);
+          }
+          s = FoldNode(node, &const_nodes, output);
+        }
+        if (s.ok() && evaluated) {
+          std::vector<NodeDef>& result = results[evaluation[i]];
+          int64 bytes = 0;
+          for (const NodeDef& const_node : result) {
+            bytes += const_node.ByteSizeLong();
+          }
+          if (memo_bytes + bytes <= kFoldingMemoryBudget) {
+            memo_bytes += bytes;
+            MemoizedFold& fold = memo[keys[i]];
+            fold.names = FoldedValueNames(*node, result);
+            fold.const_nodes = result;
+          }
+        }
+      }
+      processed_nodes.insert(node->name());
+      if (!s.ok()) {
+        VLOG(1) << "Failed to fold node " << node->DebugString()
+                << "\nError message: " << s;
+      } else {
+        for (auto& output : fanout) {
+          if (IsFoldable(*output)) {
+            queue.push_back(output);
+          }
         }
       }
     }
@@ -22,6 +22,7 @@ limitations under the License.
 #include "tensorflow/core/grappler/costs/graph_properties.h"
 #include "tensorflow/core/grappler/optimizers/graph_optimizer.h"
 #include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/protobuf/rewriter_config.pb.h"
 
 namespace tensorflow {
@@ -72,9 +73,29 @@ class ConstantFolding : public GraphOptimizer {
                       gtl::InlinedVector<TensorValue, 4>* output) const;
 
   Status EvaluateOneFoldable(const NodeDef& node,
-                             std::vector<NodeDef>* outputs);
-
-  Status FoldNode(NodeDef* node, GraphDef* output_graph);
+                             std::vector<NodeDef>* outputs) const;
+
+  // Returns the name of the constant that encodes the output `output` of
+  // `node`, which has `num_outputs` outputs, once folded.
+  string FoldedNodeName(const NodeDef& node, int output,
+                        int num_outputs) const;
+
+  // Estimates the memory needed to evaluate `node`: its materialized inputs,
+  // plus as much again for its outputs.
+  int64 EstimateFoldingMemory(const NodeDef& node) const;
+
+  // Evaluates the foldable nodes in `nodes`, which must not depend on each
+  // other, with EvaluateOneFoldable(). Large enough batches are evaluated
+  // concurrently on folding_pool_.
+  void EvaluateFoldables(const std::vector<NodeDef*>& nodes,
+                         std::vector<Status>* statuses,
+                         std::vector<std::vector<NodeDef>>* outputs);
+
+  // Replaces `node` with the constants in `const_nodes`, computed by
+  // EvaluateOneFoldable(). Merge nodes are folded without being evaluated,
+  // so `const_nodes` is ignored for them.
+  Status FoldNode(NodeDef* node, std::vector<NodeDef>* const_nodes,
+                  GraphDef* output_graph);
 
   bool IsOnes(const NodeDef& node) const;
   bool IsZeros(const NodeDef& node) const;
@@ -219,6 +240,8 @@ class ConstantFolding : public GraphOptimizer {
   std::unique_ptr<DeviceBase> owned_device_;
 
   std::unique_ptr<ResourceMgr> resource_mgr_;
+  // Evaluates independent foldable nodes concurrently. Created on first use.
+  std::unique_ptr<thread::ThreadPool> folding_pool_;
   GraphDef* graph_;
   std::unique_ptr<NodeMap> node_map_;
   std::unordered_set<string> nodes_to_preserve_;
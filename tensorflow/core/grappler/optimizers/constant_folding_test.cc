@@ -3204,6 +3204,54 @@ TEST_F(ConstantFoldingTest, FoldingPreservesDenormalFlushing) {
   test::ExpectTensorEqual<float>(tensors_expected[0], tensors[0]);
 }
 
+TEST_F(ConstantFoldingTest, ParallelFoldingAndMemoization) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  // The inputs are large enough for the independent sums to be evaluated
+  // concurrently.
+  Tensor x_t(DT_FLOAT, TensorShape({128, 128}));
+  for (int i = 0; i < x_t.NumElements(); ++i) {
+    x_t.flat<float>()(i) = 0.5f * i;
+  }
+  Output x = ops::Const(s.WithOpName("x"), x_t);
+  std::vector<Output> consts;
+  std::vector<Output> sums;
+  GrapplerItem item;
+  for (int i = 0; i < 8; ++i) {
+    consts.push_back(ops::Const(s.WithOpName(strings::StrCat("c", i)),
+                                static_cast<float>(i), {}));
+    sums.push_back(
+        ops::Add(s.WithOpName(strings::StrCat("sum", i)), x, consts[i]));
+    if (i > 0) {
+      item.fetch.push_back(strings::StrCat("sum", i));
+    }
+  }
+  // "dup" computes the same values as "sum0", and so do their fanouts.
+  Output dup = ops::Add(s.WithOpName("dup"), x, consts[0]);
+  Output neg_sum = ops::Neg(s.WithOpName("neg_sum"), sums[0]);
+  Output neg_dup = ops::Neg(s.WithOpName("neg_dup"), dup);
+  item.fetch.push_back("neg_sum");
+  item.fetch.push_back("neg_dup");
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  ConstantFolding optimizer(nullptr /* cpu_device */);
+  GraphDef output;
+  Status status = optimizer.Optimize(nullptr, item, &output);
+  TF_EXPECT_OK(status);
+
+  EXPECT_EQ(item.fetch.size(), output.node_size());
+  for (const NodeDef& node : output.node()) {
+    EXPECT_EQ("Const", node.op()) << node.name();
+  }
+
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch);
+  auto tensors = EvaluateNodes(output, item.fetch);
+  EXPECT_EQ(item.fetch.size(), tensors_expected.size());
+  EXPECT_EQ(item.fetch.size(), tensors.size());
+  for (int i = 0; i < item.fetch.size(); ++i) {
+    test::ExpectTensorEqual<float>(tensors_expected[i], tensors[i]);
+  }
+}
+
 }  // namespace
 }  // namespace grappler
 }  // namespace tensorflow
@@ -0,0 +1,178 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/intra_op_parallelism_optimizer.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/grappler/clusters/cluster.h"
+#include "tensorflow/core/grappler/costs/virtual_placer.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/optimizers/static_schedule.h"
+#include "tensorflow/core/lib/core/errors.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+// A kernel should get at least this much work per thread that it shards its
+// computation over, otherwise the cost of waking up and synchronizing the
+// threads outweighs what they save.
+constexpr int64 kMinNanosPerThread = 50000;
+
+// The number of threads that the nodes running on a device could use over
+// time.
+class ThreadDemand {
+ public:
+  void Add(int64 start, int64 end, int threads) {
+    events_.emplace_back(start, threads);
+    events_.emplace_back(end, -threads);
+  }
+
+  // Must be called after the last call to Add() and before the first call
+  // to Average().
+  void Finalize() {
+    std::sort(events_.begin(), events_.end());
+    int64 level = 0;
+    double integral = 0;
+    for (const auto& event : events_) {
+      if (!times_.empty() && times_.back() == event.first) {
+        level += event.second;
+        levels_.back() = level;
+        continue;
+      }
+      if (!times_.empty()) {
+        integral += levels_.back() * static_cast<double>(event.first -
+                                                         times_.back());
+      }
+      level += event.second;
+      times_.push_back(event.first);
+      levels_.push_back(level);
+      integrals_.push_back(integral);
+    }
+    events_.clear();
+  }
+
+  // Returns the average number of threads used between `start` and `end`.
+  double Average(int64 start, int64 end) const {
+    return (Integral(end) - Integral(start)) / (end - start);
+  }
+
+ private:
+  // Returns the number of thread-nanoseconds used until `time`.
+  double Integral(int64 time) const {
+    auto it = std::upper_bound(times_.begin(), times_.end(), time);
+    if (it == times_.begin()) {
+      return 0;
+    }
+    const int i = it - times_.begin() - 1;
+    return integrals_[i] + levels_[i] * static_cast<double>(time - times_[i]);
+  }
+
+  std::vector<std::pair<int64, int>> events_;
+  // The number of threads used is levels_[i] from times_[i] to times_[i + 1],
+  // and integrals_[i] thread-nanoseconds are used until times_[i].
+  std::vector<int64> times_;
+  std::vector<int64> levels_;
+  std::vector<double> integrals_;
+};
+
+}  // namespace
+
+Status IntraOpParallelismOptimizer::Optimize(Cluster* cluster,
+                                             const GrapplerItem& item,
+                                             GraphDef* output) {
+  if (cluster == nullptr) {
+    return errors::InvalidArgument("cluster == nullptr");
+  }
+  *output = item.graph;
+
+  std::unordered_map<const NodeDef*, Costs::NanoSeconds> completion_times;
+  std::unordered_map<const NodeDef*, Costs::NanoSeconds> execution_times;
+  TF_RETURN_IF_ERROR(EstimateEarliestExecutionTimes(
+      item, cluster, &completion_times, &execution_times));
+
+  // The number of threads that each CPU node could use, and when it runs.
+  struct NodeDemand {
+    int index;
+    string device;
+    int num_cores;
+    int threads;
+    int64 start;
+    int64 end;
+  };
+  std::vector<NodeDemand> demands;
+  std::unordered_map<string, ThreadDemand> device_demands;
+  VirtualPlacer placer(cluster);
+  for (int i = 0; i < item.graph.node_size(); ++i) {
+    const NodeDef& node = item.graph.node(i);
+    auto execution_time = execution_times.find(&node);
+    if (execution_time == execution_times.end()) {
+      // Not reached by the schedule, e.g. in a loop.
+      continue;
+    }
+    const DeviceProperties& device = placer.get_device(node);
+    if (device.type() != "CPU") {
+      continue;
+    }
+    NodeDemand demand;
+    demand.index = i;
+    demand.device = placer.get_canonical_device_name(node);
+    demand.num_cores = std::max<int>(1, device.num_cores());
+    // The cost model assumes that the node uses all the cores of the device.
+    const int64 nanos = execution_time->second.count();
+    const int64 work = nanos * demand.num_cores;
+    demand.threads = std::max<int64>(
+        1, std::min<int64>(work / kMinNanosPerThread, demand.num_cores));
+    demand.end = completion_times[&node].count();
+    demand.start = demand.end - std::max<int64>(1, nanos);
+    device_demands[demand.device].Add(demand.start, demand.end,
+                                      demand.threads);
+    demands.push_back(demand);
+  }
+  for (auto& device_demand : device_demands) {
+    device_demand.second.Finalize();
+  }
+
+  for (const NodeDemand& demand : demands) {
+    // Share the cores with the nodes that run at the same time, in
+    // proportion to the number of threads that each could use.
+    const double concurrent_threads = std::max<double>(
+        demand.threads,
+        device_demands[demand.device].Average(demand.start, demand.end));
+    const int share = static_cast<int>(demand.num_cores * demand.threads /
+                                       concurrent_threads);
+    const int parallelism = std::max(1, std::min(share, demand.threads));
+    if (parallelism < demand.num_cores) {
+      NodeDef* node = output->mutable_node(demand.index);
+      (*node->mutable_attr())["_intra_op_parallelism"].set_i(parallelism);
+    }
+  }
+  return Status::OK();
+}
+
+void IntraOpParallelismOptimizer::Feedback(Cluster* cluster,
+                                           const GrapplerItem& item,
+                                           const GraphDef& optimize_output,
+                                           double result) {
+  // Takes no feedback.
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
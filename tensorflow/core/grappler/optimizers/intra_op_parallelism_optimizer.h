@@ -0,0 +1,54 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_INTRA_OP_PARALLELISM_OPTIMIZER_H_
+#define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_INTRA_OP_PARALLELISM_OPTIMIZER_H_
+
+#include "tensorflow/core/grappler/optimizers/graph_optimizer.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// Caps the number of intra-op threads that each CPU kernel can use, so that
+// kernels running concurrently don't oversubscribe the intra-op thread pool
+// that they share.
+//
+// The cost model predicts the execution time of each node and when it runs
+// in the earliest possible schedule of the graph. A node can use one thread
+// per 50us of single-threaded work, up to the number of cores of its device.
+// When the nodes that run at the same time on a device could use more
+// threads than it has cores, these are divided among them in proportion to
+// how many they could use. Nodes whose cap is lower than the number of cores
+// get an "_intra_op_parallelism" attribute, which the executor applies with
+// ScopedPerThreadMaxParallelism while running their kernel: small ops then
+// run inline, and large ones still get as many threads as they can use.
+class IntraOpParallelismOptimizer : public GraphOptimizer {
+ public:
+  IntraOpParallelismOptimizer() {}
+  ~IntraOpParallelismOptimizer() override {}
+
+  string name() const override { return "intra_op_parallelism_optimizer"; };
+
+  Status Optimize(Cluster* cluster, const GrapplerItem& item,
+                  GraphDef* output) override;
+
+  void Feedback(Cluster* cluster, const GrapplerItem& item,
+                const GraphDef& optimize_output, double result) override;
+};
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_INTRA_OP_PARALLELISM_OPTIMIZER_H_
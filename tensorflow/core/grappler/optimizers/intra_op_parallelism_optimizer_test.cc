@@ -0,0 +1,121 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/intra_op_parallelism_optimizer.h"
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/grappler/clusters/virtual_cluster.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+class IntraOpParallelismOptimizerTest : public ::testing::Test {
+ public:
+  std::unique_ptr<VirtualCluster> CreateVirtualCluster() const {
+    // Invent a CPU so that predictions remain the same from machine to machine.
+    DeviceProperties cpu_device;
+    cpu_device.set_type("CPU");
+    cpu_device.set_frequency(1000);
+    cpu_device.set_num_cores(64);
+    cpu_device.set_bandwidth(32);
+    cpu_device.set_l1_cache_size(32 * 1024);
+    cpu_device.set_l2_cache_size(256 * 1024);
+    cpu_device.set_l3_cache_size(4 * 1024 * 1024);
+    std::unordered_map<string, DeviceProperties> devices;
+    devices["/job:localhost/replica:0/task:0/cpu:0"] = cpu_device;
+    return std::unique_ptr<VirtualCluster>(new VirtualCluster(devices));
+  }
+
+  // Returns the intra-op parallelism of `node`, or -1 if it's not capped.
+  int IntraOpParallelism(const GraphDef& graph, const string& node) const {
+    for (const NodeDef& n : graph.node()) {
+      if (n.name() == node) {
+        auto it = n.attr().find("_intra_op_parallelism");
+        return it == n.attr().end() ? -1 : it->second.i();
+      }
+    }
+    ADD_FAILURE() << "Node " << node << " not found";
+    return 0;
+  }
+};
+
+TEST_F(IntraOpParallelismOptimizerTest, LargeOpIsNotCapped) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT,
+                              ops::Placeholder::Shape({2048, 2048}));
+  Output m = ops::MatMul(s.WithOpName("m"), x, x);
+  Output a = ops::Const(s.WithOpName("a"), 1.0f, {});
+  Output b = ops::Const(s.WithOpName("b"), 2.0f, {});
+  Output small = ops::Add(s.WithOpName("small").WithControlDependencies(m),
+                          a, b);
+
+  GrapplerItem item;
+  item.fetch = {"small"};
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  std::unique_ptr<VirtualCluster> cluster(CreateVirtualCluster());
+  IntraOpParallelismOptimizer optimizer;
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(cluster.get(), item, &output));
+
+  EXPECT_EQ(item.graph.node_size(), output.node_size());
+  EXPECT_EQ(-1, IntraOpParallelism(output, "m"));
+  // Too small to be worth sharding.
+  EXPECT_EQ(1, IntraOpParallelism(output, "small"));
+}
+
+TEST_F(IntraOpParallelismOptimizerTest, ConcurrentOpsShareCores) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT,
+                              ops::Placeholder::Shape({2048, 2048}));
+  Output m1 = ops::MatMul(s.WithOpName("m1"), x, x);
+  Output m2 = ops::MatMul(s.WithOpName("m2"), x, x);
+  Output sum = ops::Add(s.WithOpName("sum"), m1, m2);
+
+  GrapplerItem item;
+  item.fetch = {"sum"};
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  std::unique_ptr<VirtualCluster> cluster(CreateVirtualCluster());
+  IntraOpParallelismOptimizer optimizer;
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(cluster.get(), item, &output));
+
+  // The two matmuls run at the same time and could each use all the cores.
+  EXPECT_EQ(32, IntraOpParallelism(output, "m1"));
+  EXPECT_EQ(32, IntraOpParallelism(output, "m2"));
+}
+
+TEST_F(IntraOpParallelismOptimizerTest, RequiresCluster) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output a = ops::Const(s.WithOpName("a"), 1.0f, {});
+  Output b = ops::Add(s.WithOpName("b"), a, a);
+
+  GrapplerItem item;
+  item.fetch = {"b"};
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+
+  IntraOpParallelismOptimizer optimizer;
+  GraphDef output;
+  EXPECT_FALSE(optimizer.Optimize(nullptr, item, &output).ok());
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
@@ -414,9 +414,91 @@ void RecomputeSubgraph(
   }
 }
 
+// Keeps only the subgraphs whose recomputation is needed to bring the estimated
+// peak memory usage of every device below `memory_budget`, preferring those
+// that free the most memory at the peak. Returns false if the memory usage
+// can't be estimated.
+bool SelectRecomputationsWithinBudget(
+    Cluster* cluster, const GrapplerItem& item, int64 memory_budget,
+    std::vector<RecomputedSubGraph>* subgraphs) {
+  GraphMemory memory(item);
+  const std::unordered_map<string, DeviceProperties>& devices =
+      cluster->GetDevices();
+  Status s = memory.InferStatically(devices);
+  if (!s.ok()) {
+    VLOG(1) << "Failed to infer memory usage: " << s.error_message();
+    return false;
+  }
+
+  // The memory that each over budget device needs to free, and the memory that
+  // the outputs of each node use on it at the peak.
+  std::unordered_map<string, int64> required_savings;
+  std::unordered_map<string, std::pair<string, int64>> live_memory;
+  for (const auto& device : devices) {
+    const GraphMemory::MemoryUsage& mem_usage =
+        memory.GetPeakMemoryUsage(device.first);
+    if (mem_usage.used_memory <= memory_budget) {
+      continue;
+    }
+    required_savings[device.first] = mem_usage.used_memory - memory_budget;
+    for (const auto& live_tensor : mem_usage.live_tensors) {
+      auto& node_memory = live_memory[live_tensor.node];
+      node_memory.first = device.first;
+      node_memory.second += live_tensor.memory_used;
+    }
+  }
+
+  // Recomputing a subgraph frees the activations of all its nodes at the peak,
+  // since the targets use the recomputed copies instead.
+  std::vector<std::pair<int64, const RecomputedSubGraph*>> savings;
+  for (const RecomputedSubGraph& subgraph : *subgraphs) {
+    int64 subgraph_savings = 0;
+    for (const NodeDef* node : subgraph.recomputed_source_nodes) {
+      auto it = live_memory.find(node->name());
+      if (it != live_memory.end()) {
+        subgraph_savings += it->second.second;
+      }
+    }
+    if (subgraph_savings > 0) {
+      savings.emplace_back(subgraph_savings, &subgraph);
+    }
+  }
+  std::stable_sort(savings.begin(), savings.end(),
+                   [](const std::pair<int64, const RecomputedSubGraph*>& a,
+                      const std::pair<int64, const RecomputedSubGraph*>& b) {
+                     return a.first > b.first;
+                   });
+
+  std::vector<RecomputedSubGraph> selected;
+  for (const auto& candidate : savings) {
+    bool needed = false;
+    for (const NodeDef* node : candidate.second->recomputed_source_nodes) {
+      auto it = live_memory.find(node->name());
+      if (it != live_memory.end() && required_savings[it->second.first] > 0) {
+        needed = true;
+      }
+    }
+    if (!needed) {
+      continue;
+    }
+    for (const NodeDef* node : candidate.second->recomputed_source_nodes) {
+      auto it = live_memory.find(node->name());
+      if (it != live_memory.end()) {
+        required_savings[it->second.first] -= it->second.second;
+      }
+    }
+    VLOG(1) << "Recomputing a subgraph to save " << candidate.first
+            << " bytes at the peak";
+    selected.push_back(*candidate.second);
+  }
+  subgraphs->swap(selected);
+  return true;
+}
+
 void RecomputationRewritingPass(RewriterConfig::MemOptType optimization_level,
                                 const string& recomputation_targets_name_scope,
-                                GraphDef* graph, const GrapplerItem& item) {
+                                GraphDef* graph, const GrapplerItem& item,
+                                Cluster* cluster, int64 memory_budget) {
   if (optimization_level != RewriterConfig::RECOMPUTATION_HEURISTICS &&
       optimization_level != RewriterConfig::HEURISTICS &&
       optimization_level != RewriterConfig::MANUAL) {
@@ -466,6 +548,12 @@ void RecomputationRewritingPass(RewriterConfig::MemOptType optimization_level,
                   node.attr().count(kRecomputeHint) > 0);
         },
         is_target);
+    if (memory_budget > 0 && cluster != nullptr) {
+      // Trade compute for memory only as far as needed to fit in the budget.
+      // If the memory usage can't be estimated, recompute everything.
+      SelectRecomputationsWithinBudget(cluster, item, memory_budget,
+                                       &recomputed_subgraphs);
+    }
   } else if (optimization_level == RewriterConfig::MANUAL) {
     recomputed_subgraphs = GetOpGroupsToRecompute(
         graph, node_map,
@@ -744,6 +832,53 @@ Status BuildSwapPair(NodeDef* node, int input_to_swap,
   return Status::OK();
 }
 
+// Like BuildSwapPair, but for tensors that are already on the host: the first
+// node truncates the tensor to bfloat16, which halves the memory it uses until
+// the second node expands it back to float.
+Status BuildCompressionPair(
+    NodeDef* node, int input_to_compress,
+    const std::unordered_map<string, const NodeDef*>& name_map,
+    GraphDef* graph, std::pair<NodeDef*, NodeDef*>* compression_pair) {
+  const OpDef* op_def;
+  TF_RETURN_IF_ERROR(OpRegistry::Global()->LookUpOpDef(node->op(), &op_def));
+  DataType input_type;
+  TF_RETURN_IF_ERROR(
+      InputTypeForNode(*node, *op_def, input_to_compress, &input_type));
+  if (input_type != DT_FLOAT) {
+    return errors::InvalidArgument("Can't compress input ", input_to_compress,
+                                   " of node ", node->name(),
+                                   " since it isn't a float");
+  }
+
+  string tensor_to_compress =
+      strings::StrCat(node->name(), "_", input_to_compress);
+  string compress_name = strings::StrCat("compress_", tensor_to_compress);
+  string decompress_name = strings::StrCat("decompress_", tensor_to_compress);
+  if (name_map.find(compress_name) != name_map.end() ||
+      name_map.find(decompress_name) != name_map.end()) {
+    return errors::InvalidArgument("Input ", input_to_compress, " of node ",
+                                   node->name(), " is already compressed");
+  }
+
+  NodeDef* compress_node = graph->add_node();
+  compress_node->set_name(compress_name);
+  compress_node->set_op("Cast");
+  compress_node->set_device(node->device());
+  (*compress_node->mutable_attr())["SrcT"].set_type(DT_FLOAT);
+  (*compress_node->mutable_attr())["DstT"].set_type(DT_BFLOAT16);
+
+  NodeDef* decompress_node = graph->add_node();
+  decompress_node->set_name(decompress_name);
+  decompress_node->set_op("Cast");
+  decompress_node->set_device(node->device());
+  *decompress_node->add_input() = compress_node->name();
+  (*decompress_node->mutable_attr())["SrcT"].set_type(DT_BFLOAT16);
+  (*decompress_node->mutable_attr())["DstT"].set_type(DT_FLOAT);
+
+  *compression_pair = std::make_pair(compress_node, decompress_node);
+  return Status::OK();
+}
+
 static int64 EstimateSize(const OpInfo::TensorProperties& t) {
   DataType dtype = t.dtype();
   int64 size = DataTypeSize(dtype);
@@ -766,6 +901,9 @@ static int64 EstimateSize(const OpInfo::TensorProperties& t) {
 struct SwapInfo {
   std::vector<int> inputs_to_swap;
   Costs::NanoSeconds time_to_swap = 0;
+  // Whether to compress the inputs in place instead of swapping them to the
+  // host.
+  bool compress = false;
 };
 
 static const NodeDef* FindSwapInTrigger(
@@ -933,6 +1071,18 @@ static bool IsSwappable(GraphView::InputPort input) {
   return !IsRefType(dtype);
 }
 
+static bool IsCompressible(GraphView::OutputPort output) {
+  const OpDef* op_def;
+  if (!OpRegistry::Global()->LookUpOpDef(output.node->op(), &op_def).ok()) {
+    return false;
+  }
+  DataType dtype;
+  if (!OutputTypeForNode(*output.node, *op_def, output.port_id, &dtype).ok()) {
+    return false;
+  }
+  return dtype == DT_FLOAT;
+}
+
 struct MemInfo {
   GraphView::OutputPort port;
   int64 memory_used;
@@ -943,7 +1093,8 @@ struct MemInfo {
 };
 
 static bool IdentifySwappingCandidates(
-    Cluster* cluster, GrapplerItem* item, std::unordered_set<string>* skip_list,
+    Cluster* cluster, GrapplerItem* item, int64 memory_budget,
+    bool compress_activations, std::unordered_set<string>* skip_list,
     std::unordered_map<NodeDef*, SwapInfo>* nodes_to_swap) {
   GraphMemory memory(*item);
   const std::unordered_map<string, DeviceProperties>& devices =
@@ -958,19 +1109,26 @@ static bool IdentifySwappingCandidates(
   for (const auto& device : devices) {
     const string& name = device.first;
     const DeviceProperties& prop = device.second;
-    if (prop.type() != "GPU") {
+    // Tensors on a CPU are already on the host: compress them instead.
+    const bool compress = prop.type() == "CPU" && compress_activations;
+    if (prop.type() != "GPU" && !compress) {
       continue;
     }
-    if (prop.memory_size() <= 0) {
+    int64 memory_limit = prop.memory_size();
+    if (memory_budget > 0 &&
+        (memory_limit <= 0 || memory_budget < memory_limit)) {
+      memory_limit = memory_budget;
+    }
+    if (memory_limit <= 0) {
       VLOG(1) << "Peak memory usage unknown for device " << name;
       continue;
     }
     const GraphMemory::MemoryUsage& mem_usage = memory.GetPeakMemoryUsage(name);
 
-    if (mem_usage.used_memory <= prop.memory_size()) {
+    if (mem_usage.used_memory <= memory_limit) {
       continue;
     }
-    int64 required_savings = mem_usage.used_memory - prop.memory_size();
+    int64 required_savings = mem_usage.used_memory - memory_limit;
 
     std::unordered_map<string, Costs::NanoSeconds> op_completion_times;
     {
@@ -1025,12 +1183,14 @@ static bool IdentifySwappingCandidates(
       }
       GraphView::OutputPort port =
           graph.GetOutputPort(live_tensor.node, live_tensor.output_id);
-      if (!IsSwappable(graph, port)) {
+      if (!IsSwappable(graph, port) || (compress && !IsCompressible(port))) {
         continue;
       }
       MemInfo mem_info;
       mem_info.port = port;
-      mem_info.memory_used = live_tensor.memory_used;
+      // Compressing to bfloat16 only saves half of the memory.
+      mem_info.memory_used =
+          compress ? live_tensor.memory_used / 2 : live_tensor.memory_used;
       Costs::Duration allocation_time = live_tensor.allocation_time;
       Costs::Duration earliest_use(Costs::Duration::infinity());
       bool valid = true;
@@ -1093,8 +1253,9 @@ static bool IdentifySwappingCandidates(
                 << mem_info.port.node->name() << ":" << mem_info.port.port_id
                 << " of size " << mem_info.memory_used;
 
-        (*nodes_to_swap)[fanout_to_swap.node].inputs_to_swap.push_back(
-            fanout_to_swap.port_id);
+        SwapInfo& swap_info = (*nodes_to_swap)[fanout_to_swap.node];
+        swap_info.inputs_to_swap.push_back(fanout_to_swap.port_id);
+        swap_info.compress = compress;
       }
       required_savings -= mem_info.memory_used;
       updated_graph = true;
@@ -1107,14 +1268,17 @@ static bool IdentifySwappingCandidates(
 }
 
 bool SwappingPass(RewriterConfig::MemOptType optimization_level,
-                  Cluster* cluster, GrapplerItem* item,
+                  Cluster* cluster, int64 memory_budget,
+                  bool compress_activations, GrapplerItem* item,
                   std::unordered_set<string>* skip_list) {
   std::unordered_map<NodeDef*, SwapInfo> nodes_to_swap;
   if (optimization_level == RewriterConfig::DEFAULT_MEM_OPT ||
       optimization_level == RewriterConfig::SWAPPING_HEURISTICS ||
       optimization_level == RewriterConfig::HEURISTICS) {
     // Use heuristics to figure out what needs to be swapped;
-    IdentifySwappingCandidates(cluster, item, skip_list, &nodes_to_swap);
+    IdentifySwappingCandidates(cluster, item, memory_budget,
+                               compress_activations, skip_list,
+                               &nodes_to_swap);
   }
   // Look for manual annotatations in the graph.
   for (auto& node : *item->graph.mutable_node()) {
@@ -1151,8 +1315,10 @@ bool SwappingPass(RewriterConfig::MemOptType optimization_level,
       const OpInfo::TensorProperties& t = props[input_id];
       bytes_to_swap += EstimateSize(t);
     }
-    // Let's assume we're going to swap over PCIe running at 16 GBps.
-    swap_info.time_to_swap = bytes_to_swap / 16;
+    // Let's assume we're going to swap over PCIe running at 16 GBps, and that
+    // casting on the host runs at 8 GBps.
+    swap_info.time_to_swap =
+        swap_info.compress ? bytes_to_swap / 8 : bytes_to_swap / 16;
   }
 
   std::unordered_map<const NodeDef*, Costs::NanoSeconds> execution_times;
@@ -1206,8 +1372,12 @@ bool SwappingPass(RewriterConfig::MemOptType optimization_level,
       }
 
       std::pair<NodeDef*, NodeDef*> swap_nodes;
-      if (!BuildSwapPair(node, input_id, name_map, &item->graph, &swap_nodes)
-               .ok()) {
+      Status s = swap_info.compress
+                     ? BuildCompressionPair(node, input_id, name_map,
+                                            &item->graph, &swap_nodes)
+                     : BuildSwapPair(node, input_id, name_map, &item->graph,
+                                     &swap_nodes);
+      if (!s.ok()) {
         continue;
       }
       *swap_nodes.first->add_input() = node->input(input_id);
@@ -1305,7 +1475,7 @@ Status MemoryOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
 
   RecomputationRewritingPass(optimization_level_,
                              recomputation_targets_name_scope_, optimized_graph,
-                             item);
+                             item, cluster, memory_budget_);
 
   GrapplerItem optimized_item(item, optimized_graph);
   std::unordered_set<string> skip_list;
@@ -1327,6 +1497,7 @@ Status MemoryOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
          optimization_level_ == RewriterConfig::MANUAL) &&
         cluster != nullptr) {
       updated_graph |= SwappingPass(optimization_level_, cluster,
+                                    memory_budget_, compress_activations_,
                                     &optimized_item, &skip_list);
     }
   }
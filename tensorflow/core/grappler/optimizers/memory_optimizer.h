@@ -30,11 +30,20 @@ class MemoryOptimizer : public GraphOptimizer {
   // recomputation_targets_name_scope: Name scope for potential outputs of
   //   recomputations. See
   //   RewriterConfig::memory_optimizer_target_node_name_scope.
+  // memory_budget: Peak memory usage to aim for on each device, or 0 to use
+  //   the memory size of the devices. See
+  //   RewriterConfig::memory_optimizer_memory_budget.
+  // compress_activations: Whether activations may be compressed to bfloat16
+  //   on CPU devices. See
+  //   RewriterConfig::memory_optimizer_compress_activations.
   explicit MemoryOptimizer(
       RewriterConfig::MemOptType optimization_level,
-      const string& recomputation_targets_name_scope = "gradients/")
+      const string& recomputation_targets_name_scope = "gradients/",
+      int64 memory_budget = 0, bool compress_activations = false)
       : optimization_level_(optimization_level),
-        recomputation_targets_name_scope_(recomputation_targets_name_scope) {}
+        recomputation_targets_name_scope_(recomputation_targets_name_scope),
+        memory_budget_(memory_budget),
+        compress_activations_(compress_activations) {}
   ~MemoryOptimizer() override {}
 
   string name() const override { return "memory_optimizer"; };
@@ -48,6 +57,8 @@ class MemoryOptimizer : public GraphOptimizer {
  private:
   RewriterConfig::MemOptType optimization_level_;
   string recomputation_targets_name_scope_;
+  int64 memory_budget_;
+  bool compress_activations_;
 };
 
 }  // end namespace grappler
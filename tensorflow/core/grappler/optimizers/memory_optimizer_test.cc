@@ -338,6 +338,90 @@ TEST_F(MemoryOptimizerTest, SwappingHeuristics) {
 #endif
 }
 
+TEST_F(MemoryOptimizerTest, CompressActivationsOnCpu) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output v = ops::Variable(s.WithOpName("v").WithDevice("/cpu:0"),
+                           {128, 128, 8}, DT_FLOAT);
+  Output a = ops::Identity(s.WithOpName("a").WithDevice("/cpu:0"), v);
+  Output b = ops::Square(s.WithOpName("b").WithDevice("/cpu:0"), v);
+  Output c = ops::Sqrt(s.WithOpName("c").WithDevice("/cpu:0"), a);
+  Output d = ops::Identity(s.WithOpName("d").WithDevice("/cpu:0"), b);
+  Output axis = ops::Const(s.WithOpName("axis").WithDevice("/cpu:0"), 0);
+  Output e =
+      ops::Concat(s.WithOpName("e").WithDevice("/cpu:0"), {a, b, c, d}, axis);
+  Output f = ops::Square(s.WithOpName("f").WithDevice("/cpu:0"), a);
+  Output g = ops::Sqrt(s.WithOpName("g").WithDevice("/cpu:0"), b);
+  Output h = ops::Exp(s.WithOpName("h").WithDevice("/cpu:0"), c);
+  Output i = ops::Log(s.WithOpName("i").WithDevice("/cpu:0"), d);
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  item.fetch = {"e", "f", "g", "h", "i"};
+
+  std::unique_ptr<VirtualCluster> cluster(CreateVirtualCluster());
+
+  // Tensors can't be swapped out of a CPU.
+  MemoryOptimizer swapping(RewriterConfig::SWAPPING_HEURISTICS);
+  GraphDef output;
+  TF_EXPECT_OK(swapping.Optimize(cluster.get(), item, &output));
+  EXPECT_EQ(item.graph.node_size(), output.node_size());
+
+  MemoryOptimizer compressing(RewriterConfig::SWAPPING_HEURISTICS,
+                              "gradients/", 0, true);
+  TF_EXPECT_OK(compressing.Optimize(cluster.get(), item, &output));
+
+  NodeMap node_map(&output);
+  int num_compressed = 0;
+  for (const string& input : node_map.GetNode("e")->input()) {
+    if (input.find("decompress_e_") != 0) {
+      continue;
+    }
+    ++num_compressed;
+    const NodeDef* decompress = node_map.GetNode(input);
+    EXPECT_EQ("Cast", decompress->op());
+    EXPECT_EQ(DT_BFLOAT16, decompress->attr().at("SrcT").type());
+    EXPECT_EQ(DT_FLOAT, decompress->attr().at("DstT").type());
+    const NodeDef* compress = node_map.GetNode(decompress->input(0));
+    EXPECT_EQ("Cast", compress->op());
+    EXPECT_EQ(DT_FLOAT, compress->attr().at("SrcT").type());
+    EXPECT_EQ(DT_BFLOAT16, compress->attr().at("DstT").type());
+  }
+  EXPECT_LT(0, num_compressed);
+}
+
+TEST_F(MemoryOptimizerTest, RecomputationWithinBudget) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output a = ops::Variable(s.WithOpName("a").WithDevice("/cpu:0"),
+                           {128, 128, 8}, DT_FLOAT);
+  Output b = ops::Relu(s.WithOpName("b").WithDevice("/cpu:0"), a);
+  Output c = ops::Sqrt(s.WithOpName("c").WithDevice("/cpu:0"), b);
+  Output d = ops::AddN(s.WithOpName("gradients/d").WithDevice("/cpu:0"), {c});
+  Output e =
+      ops::AddN(s.WithOpName("gradients/e").WithDevice("/cpu:0"), {d, b});
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  item.fetch = {"gradients/e"};
+
+  std::unique_ptr<VirtualCluster> cluster(CreateVirtualCluster());
+
+  // The graph already fits in the budget: nothing is recomputed.
+  MemoryOptimizer large_budget(RewriterConfig::RECOMPUTATION_HEURISTICS,
+                               "gradients/", 1LL << 40);
+  GraphDef output;
+  TF_EXPECT_OK(large_budget.Optimize(cluster.get(), item, &output));
+  EXPECT_EQ(item.graph.node_size(), output.node_size());
+  EXPECT_EQ(nullptr, NodeMap(&output).GetNode("Recomputed/b"));
+
+  // The activation of b is live at the peak, and has to be recomputed.
+  MemoryOptimizer small_budget(RewriterConfig::RECOMPUTATION_HEURISTICS,
+                               "gradients/", 1024);
+  TF_EXPECT_OK(small_budget.Optimize(cluster.get(), item, &output));
+  NodeMap node_map(&output);
+  EXPECT_NE(nullptr, node_map.GetNode("Recomputed/b"));
+  EXPECT_EQ("Recomputed/b", node_map.GetNode("gradients/e")->input(1));
+}
+
 TEST_F(MemoryOptimizerTest, UnswappableInputs) {
   tensorflow::Scope s = tensorflow::Scope::NewRootScope();
   Output v = ops::Variable(s.WithOpName("v").WithDevice("/gpu:0"),
@@ -24,10 +24,12 @@ limitations under the License.
 #include "tensorflow/core/grappler/optimizers/debug_stripper.h"
 #include "tensorflow/core/grappler/optimizers/dependency_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/function_optimizer.h"
+#include "tensorflow/core/grappler/optimizers/intra_op_parallelism_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/layout_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/loop_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/memory_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/model_pruner.h"
+#include "tensorflow/core/grappler/optimizers/optimized_graph_cache.h"
 #include "tensorflow/core/grappler/optimizers/remapper.h"
 #include "tensorflow/core/grappler/optimizers/scoped_allocator_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/shape_optimizer.h"
@@ -35,6 +37,7 @@ limitations under the License.
 #include "tensorflow/core/grappler/utils/functions.h"
 #include "tensorflow/core/grappler/utils/topological_sort.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/monitoring/counter.h"
 #include "tensorflow/core/util/ptr_util.h"
 
 namespace tensorflow {
@@ -94,6 +97,7 @@ std::unique_ptr<GraphOptimizer> MetaOptimizer::MakeNewOptimizer(
   MK_OPT("scoped_allocator",
          new ScopedAllocatorOptimizer(cfg_.scoped_allocator_optimization(),
                                       cfg_.scoped_allocator_opts()));
+  MK_OPT("intra_op_parallelism", new IntraOpParallelismOptimizer());
 
   return std::unique_ptr<GraphOptimizer>();
 }
@@ -138,15 +142,16 @@ Status MetaOptimizer::InitializeOptimizers(
     optimizers->push_back(MakeUnique<LayoutOptimizer>());
   }
   if (cfg_.memory_optimization() != RewriterConfig::NO_MEM_OPT) {
-    if (cfg_.memory_optimizer_target_node_name_scope().empty()) {
-      optimizers->push_back(
-          // Use the default target node name prefix "gradients/"
-          MakeUnique<MemoryOptimizer>(cfg_.memory_optimization()));
-    } else {
-      optimizers->push_back(MakeUnique<MemoryOptimizer>(
-          cfg_.memory_optimization(),
-          cfg_.memory_optimizer_target_node_name_scope()));
-    }
+    // Use the default target node name prefix "gradients/" unless another one
+    // is specified.
+    const string target_node_name_scope =
+        cfg_.memory_optimizer_target_node_name_scope().empty()
+            ? "gradients/"
+            : cfg_.memory_optimizer_target_node_name_scope();
+    optimizers->push_back(MakeUnique<MemoryOptimizer>(
+        cfg_.memory_optimization(), target_node_name_scope,
+        cfg_.memory_optimizer_memory_budget(),
+        cfg_.memory_optimizer_compress_activations()));
   }
   if (cfg_.auto_parallel().enable()) {
     optimizers->push_back(
@@ -156,6 +161,9 @@ Status MetaOptimizer::InitializeOptimizers(
     optimizers->push_back(MakeUnique<ScopedAllocatorOptimizer>(
         cfg_.scoped_allocator_optimization(), cfg_.scoped_allocator_opts()));
   }
+  if (cfg_.intra_op_parallelism_optimization() == RewriterConfig::ON) {
+    optimizers->push_back(MakeUnique<IntraOpParallelismOptimizer>());
+  }
   return Status::OK();
 }
 
@@ -233,6 +241,7 @@ Status MetaOptimizer::OptimizeGraph(Cluster* cluster, const GrapplerItem& item,
   GraphOptimizationResult optimization_result(item.id);
   GraphOptimizer* fusion_optimizer = nullptr;
   GraphOptimizer* sa_optimizer = nullptr;
+  GraphOptimizer* parallelism_optimizer = nullptr;
 
   for (int iteration = 0; iteration < NumIterations(cfg_); ++iteration) {
     // Don't bother optimizing further if the graph is already tiny.
@@ -256,6 +265,12 @@ Status MetaOptimizer::OptimizeGraph(Cluster* cluster, const GrapplerItem& item,
         if (fusion_optimizer == nullptr) fusion_optimizer = optimizer.get();
         continue;
       }
+      if (optimizer->name() == "intra_op_parallelism_optimizer") {
+        if (parallelism_optimizer == nullptr) {
+          parallelism_optimizer = optimizer.get();
+        }
+        continue;
+      }
       Status status = RunOptimizer(optimizer.get(), cluster, &optimized_item,
                                    optimized_graph, &optimization_result);
       if (status.ok()) is_optimized = true;
@@ -274,13 +289,22 @@ Status MetaOptimizer::OptimizeGraph(Cluster* cluster, const GrapplerItem& item,
     if (status.ok()) is_optimized = true;
   }
 
-  // ScopedAllocatorOptimizer must run last.
+  // ScopedAllocatorOptimizer must run last of the optimizers that rewrite
+  // the graph.
   if (sa_optimizer != nullptr) {
     Status status = RunOptimizer(sa_optimizer, cluster, &optimized_item,
                                  optimized_graph, &optimization_result);
     if (status.ok()) is_optimized = true;
   }
 
+  // IntraOpParallelismOptimizer annotates the nodes of the final graph.
+  if (parallelism_optimizer != nullptr) {
+    Status status = RunOptimizer(parallelism_optimizer, cluster,
+                                 &optimized_item, optimized_graph,
+                                 &optimization_result);
+    if (status.ok()) is_optimized = true;
+  }
+
   // Record graph optimization result.
   optimization_results_.push_back(optimization_result);
 
@@ -328,6 +352,42 @@ Status MetaOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
                                GraphDef* optimized_graph) {
   optimization_results_.clear();
 
+  if (cfg_.optimized_graph_cache_dir().empty()) {
+    return OptimizeGraphAndFunctions(cluster, item, optimized_graph);
+  }
+
+  static auto* cache_lookups = monitoring::Counter<1>::New(
+      "/tensorflow/core/grappler/optimized_graph_cache_lookups",
+      "The number of lookups in the cache of optimized graphs, by result.",
+      "result");
+  const OptimizedGraphCache cache(cfg_.optimized_graph_cache_dir());
+  const uint64 key = OptimizedGraphCache::Fingerprint(item, cluster, cfg_);
+  Status s = cache.Lookup(key, item, optimized_graph);
+  if (s.ok()) {
+    VLOG(1) << "Found the optimized graph of " << item.id << " in the cache";
+    cache_lookups->GetCell("hit")->IncrementBy(1);
+    return Status::OK();
+  }
+  if (errors::IsNotFound(s)) {
+    cache_lookups->GetCell("miss")->IncrementBy(1);
+  } else {
+    LOG(WARNING) << "Ignoring invalid optimized graph cache entry: " << s;
+    cache_lookups->GetCell("invalid")->IncrementBy(1);
+  }
+
+  TF_RETURN_IF_ERROR(OptimizeGraphAndFunctions(cluster, item, optimized_graph));
+  s = cache.Insert(key, *optimized_graph);
+  if (!s.ok()) {
+    LOG(WARNING) << "Failed to cache the optimized graph of " << item.id
+                 << ": " << s;
+  }
+  return Status::OK();
+}
+
+Status MetaOptimizer::OptimizeGraphAndFunctions(Cluster* cluster,
+                                                const GrapplerItem& item,
+                                                GraphDef* optimized_graph) {
+
   // 1. Optimize main graph
   TF_RETURN_IF_ERROR(OptimizeGraph(cluster, item, optimized_graph));
 
@@ -427,6 +487,7 @@ bool MetaOptimizerEnabled(const RewriterConfig& cfg) {
          cfg.memory_optimization() != RewriterConfig::NO_MEM_OPT ||
          cfg.debug_stripper() == RewriterConfig::ON ||
          cfg.scoped_allocator_optimization() == RewriterConfig::ON ||
+         cfg.intra_op_parallelism_optimization() == RewriterConfig::ON ||
          !cfg.optimizers().empty() || !cfg.custom_optimizers().empty();
 }
 
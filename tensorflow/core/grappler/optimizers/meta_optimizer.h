@@ -58,6 +58,12 @@ class MetaOptimizer : public GraphOptimizer {
   Status OptimizeGraph(Cluster* cluster, const GrapplerItem& item,
                        GraphDef* optimized_graph);
 
+  // Optimizes the main graph of the item, then its function library.
+  // Optimize() does the same, unless it finds the result in the cache of
+  // optimized graphs.
+  Status OptimizeGraphAndFunctions(Cluster* cluster, const GrapplerItem& item,
+                                   GraphDef* optimized_graph);
+
   DeviceBase* const cpu_device_;  // may be NULL
   RewriterConfig cfg_;
 
@@ -0,0 +1,180 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/optimized_graph_cache.h"
+
+#include <map>
+#include <unordered_set>
+
+#include "tensorflow/core/framework/tensor_shape.pb.h"
+#include "tensorflow/core/lib/core/coding.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/raw_coding.h"
+#include "tensorflow/core/lib/hash/crc32c.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/random/random.h"
+#include "tensorflow/core/lib/strings/numbers.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/public/version.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+// An entry holds the key, the masked crc32c of the serialized graph, then
+// the serialized graph.
+constexpr size_t kHeaderSize = sizeof(uint64) + sizeof(uint32);
+
+uint64 FingerprintProto(const protobuf::MessageLite& msg) {
+  string serialized;
+  SerializeToStringDeterministic(msg, &serialized);
+  return Fingerprint64(serialized);
+}
+
+uint64 FingerprintNames(uint64 fp, const std::vector<string>& names) {
+  fp = FingerprintCat64(fp, names.size());
+  for (const string& name : names) {
+    fp = FingerprintCat64(fp, Fingerprint64(name));
+  }
+  return fp;
+}
+
+}  // namespace
+
+OptimizedGraphCache::OptimizedGraphCache(const string& directory, Env* env)
+    : directory_(directory), env_(env) {}
+
+/* static */
+uint64 OptimizedGraphCache::Fingerprint(const GrapplerItem& item,
+                                        const Cluster* cluster,
+                                        const RewriterConfig& cfg) {
+  // The serialization of the graph and the behavior of the optimizers may
+  // both change with the version.
+  uint64 fp = Fingerprint64(TF_VERSION_STRING);
+  fp = FingerprintCat64(fp, TF_GRAPH_DEF_VERSION);
+  fp = FingerprintCat64(fp, FingerprintProto(item.graph));
+
+  // Only the types and shapes of the feeds matter, not their values.
+  fp = FingerprintCat64(fp, item.feed.size());
+  for (const auto& feed : item.feed) {
+    fp = FingerprintCat64(fp, Fingerprint64(feed.first));
+    fp = FingerprintCat64(fp, feed.second.dtype());
+    TensorShapeProto shape;
+    feed.second.shape().AsProto(&shape);
+    fp = FingerprintCat64(fp, FingerprintProto(shape));
+  }
+  fp = FingerprintNames(fp, item.fetch);
+  fp = FingerprintNames(fp, item.init_ops);
+  fp = FingerprintNames(fp, item.keep_ops);
+  fp = FingerprintNames(
+      fp, {item.save_op, item.restore_op, item.save_restore_loc_tensor});
+
+  if (cluster != nullptr) {
+    const std::map<string, DeviceProperties> devices(
+        cluster->GetDevices().begin(), cluster->GetDevices().end());
+    fp = FingerprintCat64(fp, devices.size());
+    for (const auto& device : devices) {
+      fp = FingerprintCat64(fp, Fingerprint64(device.first));
+      fp = FingerprintCat64(fp, FingerprintProto(device.second));
+    }
+  }
+
+  // Where the graph is cached does not change how it is optimized.
+  RewriterConfig cfg_without_cache = cfg;
+  cfg_without_cache.clear_optimized_graph_cache_dir();
+  return FingerprintCat64(fp, FingerprintProto(cfg_without_cache));
+}
+
+string OptimizedGraphCache::EntryPath(uint64 key) const {
+  return io::JoinPath(directory_,
+                      strings::StrCat(strings::FpToString(key), ".graph"));
+}
+
+Status OptimizedGraphCache::Lookup(uint64 key, const GrapplerItem& item,
+                                   GraphDef* optimized_graph) const {
+  const string path = EntryPath(key);
+  string entry;
+  Status s = ReadFileToString(env_, path, &entry);
+  if (errors::IsNotFound(s)) {
+    return s;
+  } else if (!s.ok()) {
+    return errors::DataLoss("Failed to read ", path, ": ", s.error_message());
+  }
+
+  if (entry.size() < kHeaderSize) {
+    return errors::DataLoss("Truncated optimized graph cache entry ", path);
+  }
+  if (core::DecodeFixed64(entry.data()) != key) {
+    return errors::DataLoss("Optimized graph cache entry ", path,
+                            " has the wrong key");
+  }
+  const char* payload = entry.data() + kHeaderSize;
+  const size_t payload_size = entry.size() - kHeaderSize;
+  const uint32 masked_crc =
+      core::DecodeFixed32(entry.data() + sizeof(uint64));
+  if (crc32c::Unmask(masked_crc) != crc32c::Value(payload, payload_size)) {
+    return errors::DataLoss("Checksum mismatch in optimized graph cache entry ",
+                            path);
+  }
+  GraphDef graph;
+  if (!graph.ParseFromArray(payload, payload_size)) {
+    return errors::DataLoss("Failed to parse optimized graph cache entry ",
+                            path);
+  }
+
+  // The optimizers never remove these nodes, so an entry without them
+  // can't be the result of optimizing `item`.
+  std::unordered_set<string> nodes_to_preserve = item.NodesToPreserve();
+  for (const NodeDef& node : graph.node()) {
+    nodes_to_preserve.erase(node.name());
+  }
+  if (!nodes_to_preserve.empty()) {
+    return errors::DataLoss("Optimized graph cache entry ", path,
+                            " lacks node ", *nodes_to_preserve.begin());
+  }
+
+  optimized_graph->Swap(&graph);
+  return Status::OK();
+}
+
+Status OptimizedGraphCache::Insert(uint64 key,
+                                   const GraphDef& optimized_graph) const {
+  string payload;
+  if (!SerializeToStringDeterministic(optimized_graph, &payload)) {
+    return errors::Internal("Failed to serialize the optimized graph");
+  }
+  string entry(kHeaderSize, '\0');
+  core::EncodeFixed64(&entry[0], key);
+  core::EncodeFixed32(&entry[sizeof(uint64)],
+                      crc32c::Mask(crc32c::Value(payload.data(),
+                                                 payload.size())));
+  entry.append(payload);
+
+  TF_RETURN_IF_ERROR(env_->RecursivelyCreateDir(directory_));
+  const string path = EntryPath(key);
+  const string tmp_path =
+      strings::StrCat(path, ".tmp", strings::FpToString(random::New64()));
+  TF_RETURN_IF_ERROR(WriteStringToFile(env_, tmp_path, entry));
+  Status s = env_->RenameFile(tmp_path, path);
+  if (!s.ok()) {
+    env_->DeleteFile(tmp_path).IgnoreError();
+  }
+  return s;
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
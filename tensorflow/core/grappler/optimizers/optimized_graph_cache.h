@@ -0,0 +1,66 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_OPTIMIZED_GRAPH_CACHE_H_
+#define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_OPTIMIZED_GRAPH_CACHE_H_
+
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/grappler/clusters/cluster.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/protobuf/rewriter_config.pb.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// A cache of optimized graphs in a local directory, which lets processes
+// reuse the result of optimizing the same graph in the same way.
+//
+// Entries are addressed by a fingerprint of everything that the result of
+// the optimization depends on: the graph, its feeds, fetches and other
+// nodes to preserve, the devices of the cluster, the RewriterConfig and the
+// version of TensorFlow. Each entry is written to a temporary file that is
+// then renamed, so concurrent writers and readers never see partial entries.
+class OptimizedGraphCache {
+ public:
+  explicit OptimizedGraphCache(const string& directory,
+                               Env* env = Env::Default());
+
+  // Returns the key of the optimization of `item` for `cluster` (which may
+  // be null) with `cfg`.
+  static uint64 Fingerprint(const GrapplerItem& item, const Cluster* cluster,
+                            const RewriterConfig& cfg);
+
+  // Reads the graph cached under `key` into `optimized_graph`. Returns
+  // NotFound if there is no entry, and DataLoss if the entry is corrupted or
+  // lacks one of the nodes that the optimization of `item` must preserve.
+  Status Lookup(uint64 key, const GrapplerItem& item,
+                GraphDef* optimized_graph) const;
+
+  // Caches `optimized_graph` under `key`, replacing any previous entry.
+  Status Insert(uint64 key, const GraphDef& optimized_graph) const;
+
+ private:
+  string EntryPath(uint64 key) const;
+
+  const string directory_;
+  Env* const env_;
+};
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_OPTIMIZED_GRAPH_CACHE_H_
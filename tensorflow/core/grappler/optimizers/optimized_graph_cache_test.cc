@@ -0,0 +1,116 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/optimized_graph_cache.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/inputs/trivial_test_graph_input_yielder.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/strings/numbers.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+class OptimizedGraphCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    TrivialTestGraphInputYielder fake_input(4, 1, 10, false, {"CPU:0"});
+    CHECK(fake_input.NextItem(&item_));
+    directory_ = io::JoinPath(testing::TmpDir(), "optimized_graph_cache");
+  }
+
+  GrapplerItem item_;
+  string directory_;
+};
+
+TEST_F(OptimizedGraphCacheTest, Fingerprint) {
+  RewriterConfig cfg;
+  const uint64 key = OptimizedGraphCache::Fingerprint(item_, nullptr, cfg);
+  EXPECT_EQ(key, OptimizedGraphCache::Fingerprint(item_, nullptr, cfg));
+
+  // The location of the cache is not part of the key.
+  RewriterConfig cfg_with_cache = cfg;
+  cfg_with_cache.set_optimized_graph_cache_dir(directory_);
+  EXPECT_EQ(key,
+            OptimizedGraphCache::Fingerprint(item_, nullptr, cfg_with_cache));
+
+  RewriterConfig other_cfg = cfg;
+  other_cfg.set_constant_folding(RewriterConfig::OFF);
+  EXPECT_NE(key, OptimizedGraphCache::Fingerprint(item_, nullptr, other_cfg));
+
+  GrapplerItem other_item = item_;
+  other_item.fetch.push_back(item_.graph.node(0).name());
+  EXPECT_NE(key, OptimizedGraphCache::Fingerprint(other_item, nullptr, cfg));
+
+  other_item = item_;
+  other_item.graph.mutable_node(0)->set_device("/device:CPU:1");
+  EXPECT_NE(key, OptimizedGraphCache::Fingerprint(other_item, nullptr, cfg));
+}
+
+TEST_F(OptimizedGraphCacheTest, InsertAndLookup) {
+  const OptimizedGraphCache cache(directory_);
+  const uint64 key =
+      OptimizedGraphCache::Fingerprint(item_, nullptr, RewriterConfig());
+
+  GraphDef optimized_graph;
+  EXPECT_TRUE(errors::IsNotFound(cache.Lookup(key, item_, &optimized_graph)));
+
+  TF_EXPECT_OK(cache.Insert(key, item_.graph));
+  TF_EXPECT_OK(cache.Lookup(key, item_, &optimized_graph));
+  EXPECT_EQ(item_.graph.DebugString(), optimized_graph.DebugString());
+
+  // Other keys still miss.
+  EXPECT_TRUE(
+      errors::IsNotFound(cache.Lookup(key + 1, item_, &optimized_graph)));
+}
+
+TEST_F(OptimizedGraphCacheTest, RejectsInvalidEntries) {
+  const OptimizedGraphCache cache(directory_);
+  const uint64 key =
+      OptimizedGraphCache::Fingerprint(item_, nullptr, RewriterConfig());
+  TF_EXPECT_OK(cache.Insert(key, item_.graph));
+
+  const string path = io::JoinPath(
+      directory_, strings::StrCat(strings::FpToString(key), ".graph"));
+  string entry;
+  TF_EXPECT_OK(ReadFileToString(Env::Default(), path, &entry));
+
+  // Corrupted graph.
+  string corrupted = entry;
+  corrupted[corrupted.size() - 1] ^= 1;
+  TF_EXPECT_OK(WriteStringToFile(Env::Default(), path, corrupted));
+  GraphDef optimized_graph;
+  EXPECT_TRUE(
+      errors::IsDataLoss(cache.Lookup(key, item_, &optimized_graph)));
+
+  // Truncated entry.
+  TF_EXPECT_OK(WriteStringToFile(Env::Default(), path, entry.substr(0, 5)));
+  EXPECT_TRUE(
+      errors::IsDataLoss(cache.Lookup(key, item_, &optimized_graph)));
+
+  // Graph missing a fetch node.
+  GraphDef pruned_graph = item_.graph;
+  pruned_graph.clear_node();
+  TF_EXPECT_OK(cache.Insert(key, pruned_graph));
+  EXPECT_TRUE(
+      errors::IsDataLoss(cache.Lookup(key, item_, &optimized_graph)));
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
@@ -15,13 +15,21 @@ limitations under the License.
 
 #include "tensorflow/core/grappler/optimizers/remapper.h"
 
+#include <queue>
+
 #include "tensorflow/core/framework/versions.pb.h"
 #include "tensorflow/core/grappler/costs/graph_properties.h"
+#include "tensorflow/core/grappler/devices.h"
 #include "tensorflow/core/grappler/graph_view.h"
 #include "tensorflow/core/grappler/grappler_item.h"
 #include "tensorflow/core/grappler/op_types.h"
 #include "tensorflow/core/grappler/optimizers/constant_folding.h"
+#include "tensorflow/core/grappler/optimizers/symbolic_shapes.h"
 #include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/grappler/utils/topological_sort.h"
+#include "tensorflow/core/lib/gtl/flatset.h"
+#include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/logging.h"
 
 namespace tensorflow {
@@ -165,15 +173,528 @@ void AddBatchNormNodes(GraphDef* optimized_graph, const NodeDef& fused_node) {
   *r->add_input() = c->name();
 }
 
+namespace {
+
+// A Conv2D or MatMul node followed by a chain of nodes that can be applied to
+// its output as the fused ops of a _FusedConv2D or _FusedMatMul node.
+struct ContractionWithFusedOps {
+  const NodeDef* contraction = nullptr;
+  // The nodes of the chain, in order. The last one is replaced by the fused
+  // node, and all others are removed.
+  std::vector<const NodeDef*> fused_nodes;
+  std::vector<string> fused_ops;
+  float epsilon = 0.0001f;
+};
+
+bool IsOnCpu(const NodeDef& node, bool has_gpus) {
+  if (node.device().empty()) return !has_gpus;
+  return str_util::StrContains(str_util::Lowercase(node.device()), "cpu");
+}
+
+string GetStringAttr(const NodeDef& node, const string& name,
+                     const string& default_value) {
+  const auto it = node.attr().find(name);
+  return it == node.attr().end() ? default_value : it->second.s();
+}
+
+// Returns the consumer of the first output of `node` if it is the only
+// consumer of `node`, takes the output as its first input, and `node` may be
+// removed.
+const NodeDef* GetSoleConsumer(const GraphView& graph, const NodeDef& node,
+                               const std::unordered_set<string>& preserve) {
+  if (preserve.count(node.name()) > 0) return nullptr;
+  const auto fanout =
+      graph.GetFanoutEdges(node, /*include_controlled_edges=*/true);
+  if (fanout.size() != 1) return nullptr;
+  const GraphView::Edge& edge = *fanout.begin();
+  if (edge.src.port_id != 0 || edge.tgt.port_id != 0) return nullptr;
+  return edge.tgt.node;
+}
+
+// Returns true if `node` is a Conv2D or MatMul that the CPU fused kernels
+// support, followed by at least one node they can fuse, and fills in
+// `pattern`. Matches Conv2D/MatMul -> BiasAdd -> FusedBatchNorm ->
+// Relu/Relu6/Elu, where every node after the contraction is optional, and
+// FusedBatchNorm is only fused into Conv2D.
+bool FindContractionWithFusedOps(const GraphView& graph, const NodeDef& node,
+                                 const std::unordered_set<string>& preserve,
+                                 bool has_gpus,
+                                 ContractionWithFusedOps* pattern) {
+  const bool is_conv = node.op() == "Conv2D";
+  if (!is_conv && node.op() != "MatMul") return false;
+  if (!IsOnCpu(node, has_gpus)) return false;
+  const DataType dtype = GetDataTypeFromAttr(node, "T");
+  if (dtype != DT_FLOAT && dtype != DT_DOUBLE) return false;
+  if (is_conv) {
+    if (GetStringAttr(node, "data_format", "NHWC") != "NHWC") return false;
+    if (node.attr().count("dilations") > 0) {
+      for (int64 dilation : node.attr().at("dilations").list().i()) {
+        if (dilation != 1) return false;
+      }
+    }
+  }
+  auto is_fusable = [&node, dtype](const NodeDef* next) {
+    return next != nullptr && next->device() == node.device() &&
+           GetDataTypeFromAttr(*next, "T") == dtype;
+  };
+
+  *pattern = ContractionWithFusedOps();
+  pattern->contraction = &node;
+  const NodeDef* next = GetSoleConsumer(graph, node, preserve);
+  if (is_fusable(next) && next->op() == "BiasAdd" &&
+      GetStringAttr(*next, "data_format", "NHWC") == "NHWC") {
+    pattern->fused_nodes.push_back(next);
+    pattern->fused_ops.push_back("BiasAdd");
+    next = GetSoleConsumer(graph, *next, preserve);
+  }
+  if (is_conv && is_fusable(next) &&
+      (next->op() == "FusedBatchNorm" || next->op() == "FusedBatchNormV2") &&
+      next->attr().count("is_training") > 0 &&
+      !next->attr().at("is_training").b() &&
+      GetStringAttr(*next, "data_format", "NHWC") == "NHWC" &&
+      (next->op() == "FusedBatchNorm" ||
+       GetDataTypeFromAttr(*next, "U") == dtype)) {
+    pattern->fused_nodes.push_back(next);
+    pattern->fused_ops.push_back("FusedBatchNorm");
+    if (next->attr().count("epsilon") > 0) {
+      pattern->epsilon = next->attr().at("epsilon").f();
+    }
+    next = GetSoleConsumer(graph, *next, preserve);
+  }
+  if (is_fusable(next) && (next->op() == "Relu" || next->op() == "Relu6" ||
+                           next->op() == "Elu")) {
+    pattern->fused_nodes.push_back(next);
+    pattern->fused_ops.push_back(next->op());
+  }
+  if (pattern->fused_nodes.empty()) return false;
+
+  // The fused node only has the first output of the node it replaces.
+  for (const GraphView::Edge& edge : graph.GetFanoutEdges(
+           *pattern->fused_nodes.back(), /*include_controlled_edges=*/false)) {
+    if (edge.src.port_id != 0) return false;
+  }
+  return true;
+}
+
+void AddFusedContractionNode(const ContractionWithFusedOps& pattern,
+                             GraphDef* optimized_graph) {
+  const NodeDef& contraction = *pattern.contraction;
+  NodeDef* fused = optimized_graph->add_node();
+  fused->set_name(pattern.fused_nodes.back()->name());
+  fused->set_op(contraction.op() == "Conv2D" ? "_FusedConv2D" : "_FusedMatMul");
+  fused->set_device(contraction.device());
+  *fused->add_input() = contraction.input(0);
+  *fused->add_input() = contraction.input(1);
+  int num_args = 0;
+  for (const NodeDef* node : pattern.fused_nodes) {
+    int node_args = 0;
+    if (node->op() == "BiasAdd") {
+      node_args = 1;
+    } else if (node->op() != "Relu" && node->op() != "Relu6" &&
+               node->op() != "Elu") {
+      node_args = 4;  // The scale, offset, mean and variance of a batch norm.
+    }
+    for (int i = 1; i <= node_args; ++i) *fused->add_input() = node->input(i);
+    num_args += node_args;
+  }
+  // Keep the control dependencies of all the nodes that are fused.
+  gtl::FlatSet<string> control_inputs;
+  auto add_control_inputs = [fused, &control_inputs](const NodeDef& node) {
+    for (const string& input : node.input()) {
+      if (IsControlInput(input) && control_inputs.insert(input).second) {
+        *fused->add_input() = input;
+      }
+    }
+  };
+  add_control_inputs(contraction);
+  for (const NodeDef* node : pattern.fused_nodes) add_control_inputs(*node);
+
+  auto* attr = fused->mutable_attr();
+  const auto& src_attr = contraction.attr();
+  for (const char* name : {"T", "strides", "padding", "data_format",
+                           "dilations", "transpose_a", "transpose_b"}) {
+    if (src_attr.count(name) > 0) (*attr)[name] = src_attr.at(name);
+  }
+  (*attr)["num_args"].set_i(num_args);
+  for (const string& op : pattern.fused_ops) {
+    (*attr)["fused_ops"].mutable_list()->add_s(op);
+  }
+  (*attr)["epsilon"].set_f(pattern.epsilon);
+}
+
+// The most ops that one _ElementwiseOpsComposition node computes.
+constexpr int kMaxComposedOps = 64;
+
+// Returns true if _ElementwiseOpsComposition computes unary `op` for values of
+// `dtype`.
+// WARN: This should be consistent with unary_ops_composition.cc.
+bool IsComposableUnaryOp(const string& op, DataType dtype) {
+  static const gtl::FlatSet<string>* const kOps = new gtl::FlatSet<string>{
+      "Abs",   "Ceil",  "Cos",   "Elu",        "Exp",   "Expm1",
+      "Floor", "Inv",   "Log",   "Log1p",      "Neg",   "Reciprocal",
+      "Relu",  "Relu6", "Round", "Rsqrt",      "Selu",  "Sigmoid",
+      "Sin",   "Sqrt",  "Square", "Tanh"};
+  // Ops that are not computed for half.
+  static const gtl::FlatSet<string>* const kNonHalfOps =
+      new gtl::FlatSet<string>{"Acos",  "Acosh", "Asin", "Asinh", "Atan",
+                               "Atanh", "Cosh",  "Rint", "Sinh",  "Tan"};
+  return kOps->count(op) > 0 || (dtype != DT_HALF && kNonHalfOps->count(op));
+}
+
+bool IsLogicalOp(const NodeDef& node) {
+  return node.op() == "LogicalAnd" || node.op() == "LogicalOr" ||
+         node.op() == "LogicalNot";
+}
+
+// Returns the type of the result of `node` as part of an elementwise
+// composition of type `dtype`, which is either `dtype` or DT_BOOL, or
+// DT_INVALID if _ElementwiseOpsComposition does not compute `node`.
+DataType GetComposableType(const NodeDef& node, DataType dtype) {
+  static const gtl::FlatSet<string>* const kBinaryOps =
+      new gtl::FlatSet<string>{"Add",     "AddV2",   "Sub",
+                               "Mul",     "Div",     "RealDiv",
+                               "Maximum", "Minimum", "SquaredDifference"};
+  static const gtl::FlatSet<string>* const kCompareOps =
+      new gtl::FlatSet<string>{"Less",  "LessEqual", "Greater",
+                               "GreaterEqual", "Equal", "NotEqual"};
+  const string& op = node.op();
+  if (IsLogicalOp(node)) return DT_BOOL;
+  if (op == "Cast") {
+    if (GetDataTypeFromAttr(node, "DstT") != dtype) return DT_INVALID;
+    if (node.attr().count("Truncate") > 0 && node.attr().at("Truncate").b()) {
+      return DT_INVALID;
+    }
+    switch (GetDataTypeFromAttr(node, "SrcT")) {
+      case DT_BOOL:
+      case DT_HALF:
+      case DT_FLOAT:
+      case DT_DOUBLE:
+      case DT_INT8:
+      case DT_INT16:
+      case DT_INT32:
+      case DT_INT64:
+      case DT_UINT8:
+        return dtype;
+      default:
+        return DT_INVALID;
+    }
+  }
+  if (GetDataTypeFromAttr(node, "T") != dtype) return DT_INVALID;
+  if (kCompareOps->count(op) > 0) return DT_BOOL;
+  if (op == "BiasAdd") {
+    // Adds a row in NHWC.
+    return GetStringAttr(node, "data_format", "NHWC") == "NHWC" ? dtype
+                                                                : DT_INVALID;
+  }
+  // The ops of a _UnaryOpsComposition were checked when it was created.
+  if (kBinaryOps->count(op) > 0 || op == "Select" ||
+      op == "_UnaryOpsComposition" || IsComposableUnaryOp(op, dtype)) {
+    return dtype;
+  }
+  return DT_INVALID;
+}
+
+// Returns the type of data input `i` of `node` as part of an elementwise
+// composition of type `dtype`.
+DataType GetComposableInputType(const NodeDef& node, int i, DataType dtype) {
+  if (node.op() == "Cast") return GetDataTypeFromAttr(node, "SrcT");
+  if (IsLogicalOp(node) || (node.op() == "Select" && i == 0)) return DT_BOOL;
+  return dtype;
+}
+
+// Returns true if a tensor of `shape` can be an input of an elementwise
+// composition whose output has `out_shape`: it has the same shape, is a
+// scalar, or is a row, i.e. its shape is a suffix of `out_shape` once its
+// leading dimensions of size 1 are removed.
+bool IsComposableInputShape(const TensorShapeProto& shape,
+                            const TensorShapeProto& out_shape) {
+  if (ShapesSymbolicallyEqual(shape, out_shape)) return true;
+  if (shape.unknown_rank()) return false;
+  if (NumCoefficients(shape) == 1) return true;
+  int first = 0;
+  while (first < shape.dim_size() && shape.dim(first).size() == 1) ++first;
+  const int offset = out_shape.dim_size() - shape.dim_size();
+  for (int d = first; d < shape.dim_size(); ++d) {
+    if (offset + d < 0 || shape.dim(d).size() < 0 ||
+        shape.dim(d).size() != out_shape.dim(offset + d).size()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// A DAG of elementwise nodes that one _ElementwiseOpsComposition node
+// computes. It replaces the root of the DAG, whose result is its output, and
+// the other nodes only feed nodes of the DAG.
+struct ElementwiseComposition {
+  // The nodes of the DAG in topological order. The root is the last one.
+  std::vector<const NodeDef*> nodes;
+  DataType dtype = DT_INVALID;
+};
+
+// Returns true if `root` is an elementwise node on CPU that can be computed
+// together with some of the nodes that feed it by _ElementwiseOpsComposition,
+// and fills in `composition`. The nodes in `excluded` are not added to the
+// composition.
+bool FindElementwiseComposition(
+    const GraphView& graph, const GraphProperties& properties,
+    const std::unordered_map<const NodeDef*, int>& topo_order,
+    const NodeDef& root, const std::unordered_set<string>& preserve,
+    const std::unordered_set<string>& excluded, bool has_gpus,
+    ElementwiseComposition* composition) {
+  const DataType dtype = root.op() == "Cast"
+                             ? GetDataTypeFromAttr(root, "DstT")
+                             : GetDataTypeFromAttr(root, "T");
+  if (dtype != DT_HALF && dtype != DT_FLOAT && dtype != DT_DOUBLE) {
+    return false;
+  }
+  if (GetComposableType(root, dtype) != dtype || !IsOnCpu(root, has_gpus)) {
+    return false;
+  }
+  const auto& root_props = properties.GetOutputProperties(root.name());
+  if (root_props.size() != 1 || root_props[0].shape().unknown_rank()) {
+    return false;
+  }
+  const TensorShapeProto& shape = root_props[0].shape();
+
+  // All the inputs of the composition must be broadcast as scalars or rows.
+  auto has_composable_inputs = [&properties, &shape](const NodeDef& node) {
+    const auto& props = properties.GetInputProperties(node.name());
+    if (props.size() != NumNonControlInputs(node)) return false;
+    for (const auto& prop : props) {
+      if (!IsComposableInputShape(prop.shape(), shape)) return false;
+    }
+    // Select picks whole rows for a vector condition, which is not the same
+    // as broadcasting it, so its condition must be a scalar or have the shape
+    // of the output.
+    if (node.op() == "Select") {
+      const TensorShapeProto& condition = props[0].shape();
+      if (!ShapesSymbolicallyEqual(condition, shape) &&
+          (condition.unknown_rank() || condition.dim_size() != 0)) {
+        return false;
+      }
+    }
+    return true;
+  };
+  if (!has_composable_inputs(root)) return false;
+
+  // Visit the nodes that feed the composition from the last one in
+  // topological order, so that all the consumers of a node are visited before
+  // it.
+  auto topo_less = [&topo_order](const NodeDef* a, const NodeDef* b) {
+    return topo_order.at(a) < topo_order.at(b);
+  };
+  std::priority_queue<const NodeDef*, std::vector<const NodeDef*>,
+                      decltype(topo_less)>
+      candidates(topo_less);
+  std::unordered_set<const NodeDef*> visited;
+  auto add_inputs = [&graph, &candidates, &visited](const NodeDef& node) {
+    for (const string& input : node.input()) {
+      if (IsControlInput(input)) continue;
+      const NodeDef* input_node = graph.GetNode(NodeName(input));
+      if (input_node != nullptr && visited.insert(input_node).second) {
+        candidates.push(input_node);
+      }
+    }
+  };
+  auto num_ops = [](const NodeDef& node) {
+    return node.op() == "_UnaryOpsComposition"
+               ? node.attr().at("op_names").list().s_size()
+               : 1;
+  };
+
+  std::unordered_set<const NodeDef*> members = {&root};
+  int total_ops = num_ops(root);
+  add_inputs(root);
+  while (!candidates.empty()) {
+    const NodeDef* node = candidates.top();
+    candidates.pop();
+    if (preserve.count(node->name()) > 0 || excluded.count(node->name()) > 0 ||
+        node->device() != root.device() ||
+        GetComposableType(*node, dtype) == DT_INVALID ||
+        total_ops + num_ops(*node) > kMaxComposedOps) {
+      continue;
+    }
+    const auto& props = properties.GetOutputProperties(node->name());
+    if (props.size() != 1 ||
+        !ShapesSymbolicallyEqual(props[0].shape(), shape)) {
+      continue;
+    }
+    // The node must only feed the composition.
+    bool only_feeds_members = true;
+    for (const GraphView::Edge& edge :
+         graph.GetFanoutEdges(*node, /*include_controlled_edges=*/true)) {
+      only_feeds_members &= edge.tgt.port_id >= 0 &&
+                            members.count(edge.tgt.node) > 0;
+    }
+    if (!only_feeds_members || !has_composable_inputs(*node)) continue;
+    members.insert(node);
+    total_ops += num_ops(*node);
+    add_inputs(*node);
+  }
+  if (members.size() < 2) return false;
+
+  composition->dtype = dtype;
+  composition->nodes.assign(members.begin(), members.end());
+  std::sort(composition->nodes.begin(), composition->nodes.end(), topo_less);
+  return true;
+}
+
+void AddElementwiseCompositionNode(const ElementwiseComposition& composition,
+                                   GraphDef* optimized_graph) {
+  const NodeDef& root = *composition.nodes.back();
+  const DataType dtype = composition.dtype;
+  NodeDef* composed = optimized_graph->add_node();
+  composed->set_name(root.name());
+  composed->set_op("_ElementwiseOpsComposition");
+  composed->set_device(root.device());
+  auto* attr = composed->mutable_attr();
+  (*attr)["T"].set_type(dtype);
+
+  // The values of the composition are its inputs, followed by the results of
+  // its ops.
+  std::unordered_map<string, int> node_values;
+  for (const NodeDef* node : composition.nodes) node_values[node->name()] = -1;
+  std::unordered_map<string, int> input_values;
+  for (const NodeDef* node : composition.nodes) {
+    int i = 0;
+    for (const string& input : node->input()) {
+      if (IsControlInput(input)) continue;
+      int port;
+      const string input_node = ParseNodeName(input, &port);
+      const string tensor = strings::StrCat(input_node, ":", port);
+      if (node_values.count(input_node) == 0 &&
+          input_values.count(tensor) == 0) {
+        input_values[tensor] = composed->input_size();
+        *composed->add_input() = input;
+        (*attr)["Tin"].mutable_list()->add_type(
+            GetComposableInputType(*node, i, dtype));
+      }
+      ++i;
+    }
+  }
+
+  int num_values = composed->input_size();
+  auto* op_names = (*attr)["op_names"].mutable_list();
+  auto* operands = (*attr)["operands"].mutable_list();
+  for (const NodeDef* node : composition.nodes) {
+    for (const string& input : node->input()) {
+      if (IsControlInput(input)) continue;
+      int port;
+      const string input_node = ParseNodeName(input, &port);
+      const auto it = node_values.find(input_node);
+      operands->add_i(it != node_values.end()
+                          ? it->second
+                          : input_values[strings::StrCat(input_node, ":",
+                                                         port)]);
+    }
+    if (node->op() == "_UnaryOpsComposition") {
+      // Each op takes the result of the previous one.
+      const auto& names = node->attr().at("op_names").list();
+      for (int i = 0; i < names.s_size(); ++i) {
+        if (i > 0) operands->add_i(num_values - 1);
+        op_names->add_s(names.s(i));
+        ++num_values;
+      }
+    } else {
+      op_names->add_s(node->op() == "BiasAdd" ? "Add" : node->op());
+      ++num_values;
+    }
+    node_values[node->name()] = num_values - 1;
+  }
+
+  // Keep the control dependencies of all the nodes that are composed.
+  gtl::FlatSet<string> control_inputs;
+  for (const NodeDef* node : composition.nodes) {
+    for (const string& input : node->input()) {
+      if (IsControlInput(input) && node_values.count(NodeName(input)) == 0 &&
+          control_inputs.insert(input).second) {
+        *composed->add_input() = input;
+      }
+    }
+  }
+}
+
+}  // namespace
+
 Status Remapper::Optimize(Cluster* /*cluster*/, const GrapplerItem& item,
                           GraphDef* optimized_graph) {
   GraphProperties properties(item);
   TF_RETURN_IF_ERROR(properties.InferStatically(false));
   GraphView graph(const_cast<GraphDef*>(&item.graph));
 
+  // Fuse the bias add, batch norm and activation that follow a convolution or
+  // matrix multiplication on CPU into it, so that they are applied to each
+  // tile of its output while it is in cache rather than in separate passes
+  // over the whole output.
+  const std::unordered_set<string> preserve = item.NodesToPreserve();
+  const bool has_gpus = GetNumAvailableGPUs() > 0;
+  std::unordered_map<string, ContractionWithFusedOps> fused_contractions;
+  std::unordered_set<string> fused_away;
+  std::unordered_map<string, ElementwiseComposition> compositions;
+#ifndef INTEL_MKL
+  // With MKL, the layout pass rewrites these nodes into MKL kernels instead.
+  for (const NodeDef& node : item.graph.node()) {
+    ContractionWithFusedOps pattern;
+    if (!FindContractionWithFusedOps(graph, node, preserve, has_gpus,
+                                     &pattern)) {
+      continue;
+    }
+    fused_away.insert(node.name());
+    for (int i = 0; i + 1 < pattern.fused_nodes.size(); ++i) {
+      fused_away.insert(pattern.fused_nodes[i]->name());
+    }
+    fused_contractions[pattern.fused_nodes.back()->name()] = pattern;
+  }
+
+  // Compute DAGs of elementwise ops on CPU in a single pass over their
+  // inputs, rather than in one pass per op. Nodes are visited from the last
+  // one in topological order, so that each DAG is as large as possible.
+  std::unordered_map<const NodeDef*, int> topo_order;
+  if (ComputeTopologicalOrder(item.graph, &topo_order, nullptr).ok()) {
+    std::unordered_set<string> excluded = fused_away;
+    for (const auto& fused : fused_contractions) excluded.insert(fused.first);
+    std::vector<const NodeDef*> nodes;
+    for (const NodeDef& node : item.graph.node()) nodes.push_back(&node);
+    std::sort(nodes.begin(), nodes.end(),
+              [&topo_order](const NodeDef* a, const NodeDef* b) {
+                return topo_order[a] > topo_order[b];
+              });
+    for (const NodeDef* node : nodes) {
+      if (excluded.count(node->name()) > 0) continue;
+      ElementwiseComposition composition;
+      if (!FindElementwiseComposition(graph, properties, topo_order, *node,
+                                      preserve, excluded, has_gpus,
+                                      &composition)) {
+        continue;
+      }
+      for (const NodeDef* member : composition.nodes) {
+        excluded.insert(member->name());
+        if (member != node) fused_away.insert(member->name());
+      }
+      compositions[node->name()] = std::move(composition);
+    }
+  }
+#endif  // INTEL_MKL
+
   // During inference, most of the inputs to FusedBatchNorm are constant, and we
   // can therefore replace the op with a much cheaper set of primitives.
   for (const NodeDef& node : item.graph.node()) {
+    if (fused_away.count(node.name()) > 0) continue;
+    auto composed = compositions.find(node.name());
+    if (composed != compositions.end()) {
+      VLOG(1) << "Composing " << composed->second.nodes.size()
+              << " elementwise nodes into " << node.name();
+      AddElementwiseCompositionNode(composed->second, optimized_graph);
+      continue;
+    }
+    auto fused = fused_contractions.find(node.name());
+    if (fused != fused_contractions.end()) {
+      VLOG(1) << "Fusing " << fused->second.contraction->name() << " into "
+              << node.name();
+      AddFusedContractionNode(fused->second, optimized_graph);
+      continue;
+    }
     if (node.op() == "FusedBatchNorm" || node.op() == "FusedBatchNormV2") {
       bool optimizable = (node.attr().count("T") == 0 ||
                           node.attr().at("T").type() == DT_FLOAT);
@@ -14,6 +14,9 @@ limitations under the License.
 ==============================================================================*/
 
 #include "tensorflow/core/grappler/optimizers/remapper.h"
+
+#include <set>
+
 #include "tensorflow/cc/ops/standard_ops.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/grappler/devices.h"
@@ -91,5 +94,347 @@ TEST_F(RemapperTest, FusedBatchNormNCHW) {
   }
 }
 
+TEST_F(RemapperTest, FuseConv2DWithBiasAndRelu) {
+  tensorflow::Scope s =
+      tensorflow::Scope::NewRootScope().WithDevice("/device:CPU:0");
+  Output input = ops::Const(s.WithOpName("input"),
+                            Input::Initializer(1.5f, {2, 5, 7, 3}));
+  Output filter = ops::Const(
+      s.WithOpName("filter"),
+      {0.1f, -0.2f, 0.3f, -0.4f, 0.5f, -0.6f, 0.7f, -0.8f, 0.9f, -1.0f, 1.1f,
+       -1.2f, 1.3f, -1.4f, 1.5f, -1.6f, 1.7f, -1.8f, 1.9f, -2.0f, 2.1f, -2.2f,
+       2.3f, -2.4f},
+      {2, 2, 3, 2});
+  Output bias = ops::Const(s.WithOpName("bias"), {0.25f, -5.0f}, {2});
+  Output conv = ops::Conv2D(s.WithOpName("conv"), input, filter, {1, 2, 1, 1},
+                            "SAME");
+  Output bias_add = ops::BiasAdd(s.WithOpName("bias_add"), conv, bias);
+  Output relu = ops::Relu(s.WithOpName("relu"), bias_add);
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  item.fetch = {"relu"};
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch);
+  EXPECT_EQ(1, tensors_expected.size());
+
+  Remapper optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_CHECK_OK(optimizer.Optimize(nullptr, item, &output));
+
+  int found = 0;
+  for (const NodeDef& node : output.node()) {
+    EXPECT_NE("conv", node.name());
+    EXPECT_NE("bias_add", node.name());
+    if (node.name() == "relu") {
+      EXPECT_EQ("_FusedConv2D", node.op());
+      ASSERT_EQ(3, node.input_size());
+      EXPECT_EQ("input", node.input(0));
+      EXPECT_EQ("filter", node.input(1));
+      EXPECT_EQ("bias", node.input(2));
+      EXPECT_EQ(1, node.attr().at("num_args").i());
+      const auto& fused_ops = node.attr().at("fused_ops").list();
+      ASSERT_EQ(2, fused_ops.s_size());
+      EXPECT_EQ("BiasAdd", fused_ops.s(0));
+      EXPECT_EQ("Relu", fused_ops.s(1));
+      found++;
+    }
+  }
+  EXPECT_EQ(1, found);
+
+  auto tensors = EvaluateNodes(output, item.fetch);
+  EXPECT_EQ(1, tensors.size());
+  test::ExpectTensorNear<float>(tensors_expected[0], tensors[0], 1e-5);
+}
+
+TEST_F(RemapperTest, FuseConv2DWithBatchNormAndRelu6) {
+  tensorflow::Scope s =
+      tensorflow::Scope::NewRootScope().WithDevice("/device:CPU:0");
+  Output input = ops::Const(s.WithOpName("input"),
+                            Input::Initializer(-0.7f, {1, 4, 4, 2}));
+  Output filter = ops::Const(s.WithOpName("filter"),
+                             {1.0f, -2.0f, 3.0f, 4.0f}, {1, 1, 2, 2});
+  Output scale = ops::Const(s.WithOpName("scale"), {0.3f, 7.0f}, {2});
+  Output offset = ops::Const(s.WithOpName("offset"), {0.123f, 2.1f}, {2});
+  Output mean = ops::Const(s.WithOpName("mean"), {-7.3f, 8.3f}, {2});
+  Output variance = ops::Const(s.WithOpName("variance"), {0.57f, 1.0f}, {2});
+  Output conv = ops::Conv2D(s.WithOpName("conv"), input, filter, {1, 1, 1, 1},
+                            "VALID");
+  ops::FusedBatchNorm bn(s.WithOpName("batch_norm"), conv, scale, offset, mean,
+                         variance, ops::FusedBatchNorm::IsTraining(false));
+  Output relu6 = ops::Relu6(s.WithOpName("relu6"), bn.y);
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  item.fetch = {"relu6"};
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch);
+  EXPECT_EQ(1, tensors_expected.size());
+
+  Remapper optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_CHECK_OK(optimizer.Optimize(nullptr, item, &output));
+
+  int found = 0;
+  for (const NodeDef& node : output.node()) {
+    EXPECT_NE("batch_norm", node.name());
+    if (node.name() == "relu6") {
+      EXPECT_EQ("_FusedConv2D", node.op());
+      EXPECT_EQ(6, node.input_size());
+      EXPECT_EQ(4, node.attr().at("num_args").i());
+      found++;
+    }
+  }
+  EXPECT_EQ(1, found);
+
+  auto tensors = EvaluateNodes(output, item.fetch);
+  EXPECT_EQ(1, tensors.size());
+  test::ExpectTensorNear<float>(tensors_expected[0], tensors[0], 1e-5);
+}
+
+TEST_F(RemapperTest, FuseMatMulWithBiasAndElu) {
+  tensorflow::Scope s =
+      tensorflow::Scope::NewRootScope().WithDevice("/device:CPU:0");
+  Output a = ops::Const(s.WithOpName("a"),
+                        {1.0f, -2.0f, 3.0f, -4.0f, 5.0f, -6.0f}, {3, 2});
+  Output b = ops::Const(s.WithOpName("b"), {0.5f, -0.25f, 1.5f, 0.75f}, {2, 2});
+  Output bias = ops::Const(s.WithOpName("bias"), {-1.0f, 2.0f}, {2});
+  Output matmul = ops::MatMul(s.WithOpName("matmul"), a, b,
+                              ops::MatMul::TransposeB(true));
+  Output bias_add = ops::BiasAdd(s.WithOpName("bias_add"), matmul, bias);
+  Output elu = ops::Elu(s.WithOpName("elu"), bias_add);
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  item.fetch = {"elu"};
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch);
+  EXPECT_EQ(1, tensors_expected.size());
+
+  Remapper optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_CHECK_OK(optimizer.Optimize(nullptr, item, &output));
+
+  int found = 0;
+  for (const NodeDef& node : output.node()) {
+    if (node.name() == "elu") {
+      EXPECT_EQ("_FusedMatMul", node.op());
+      EXPECT_TRUE(node.attr().at("transpose_b").b());
+      found++;
+    }
+  }
+  EXPECT_EQ(1, found);
+
+  auto tensors = EvaluateNodes(output, item.fetch);
+  EXPECT_EQ(1, tensors.size());
+  test::ExpectTensorNear<float>(tensors_expected[0], tensors[0], 1e-6);
+}
+
+TEST_F(RemapperTest, DoNotFuseFetchedConv2D) {
+  tensorflow::Scope s =
+      tensorflow::Scope::NewRootScope().WithDevice("/device:CPU:0");
+  Output input = ops::Const(s.WithOpName("input"),
+                            Input::Initializer(1.0f, {1, 3, 3, 1}));
+  Output filter = ops::Const(s.WithOpName("filter"), {2.0f}, {1, 1, 1, 1});
+  Output bias = ops::Const(s.WithOpName("bias"), {0.5f}, {1});
+  Output conv = ops::Conv2D(s.WithOpName("conv"), input, filter, {1, 1, 1, 1},
+                            "SAME");
+  Output bias_add = ops::BiasAdd(s.WithOpName("bias_add"), conv, bias);
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  item.fetch = {"conv", "bias_add"};
+
+  Remapper optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_CHECK_OK(optimizer.Optimize(nullptr, item, &output));
+  for (const NodeDef& node : output.node()) {
+    if (node.name() == "conv") EXPECT_EQ("Conv2D", node.op());
+    if (node.name() == "bias_add") EXPECT_EQ("BiasAdd", node.op());
+  }
+}
+
+TEST_F(RemapperTest, ComposeElementwiseOps) {
+  tensorflow::Scope s =
+      tensorflow::Scope::NewRootScope().WithDevice("/device:CPU:0");
+  auto x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT,
+                            ops::Placeholder::Shape({4, 16}));
+  auto y = ops::Placeholder(s.WithOpName("y"), DT_FLOAT,
+                            ops::Placeholder::Shape({4, 16}));
+  Output b = ops::Const(s.WithOpName("b"), Input::Initializer(0.5f, {16}));
+  Output threshold = ops::Const(s.WithOpName("threshold"), 20.0f);
+  Output mul = ops::Mul(s.WithOpName("mul"), x, y);
+  Output add = ops::Add(s.WithOpName("add"), mul, b);
+  Output gate = ops::Greater(s.WithOpName("gate"), x, threshold);
+  Output select = ops::Select(s.WithOpName("select"), gate, add, y);
+  Output relu6 = ops::Relu6(s.WithOpName("relu6"), select);
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  item.fetch = {"relu6"};
+  auto x_t = GenerateRandomTensor<DT_FLOAT>(TensorShape({4, 16}));
+  auto y_t = GenerateRandomTensor<DT_FLOAT>(TensorShape({4, 16}));
+  item.feed = {{"x", x_t}, {"y", y_t}};
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch, item.feed);
+  EXPECT_EQ(1, tensors_expected.size());
+
+  Remapper optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_CHECK_OK(optimizer.Optimize(nullptr, item, &output));
+
+  int found = 0;
+  for (const NodeDef& node : output.node()) {
+    EXPECT_NE("mul", node.name());
+    EXPECT_NE("add", node.name());
+    EXPECT_NE("gate", node.name());
+    EXPECT_NE("select", node.name());
+    if (node.name() == "relu6") {
+      EXPECT_EQ("_ElementwiseOpsComposition", node.op());
+      std::set<string> inputs(node.input().begin(), node.input().end());
+      EXPECT_EQ(std::set<string>({"x", "y", "b", "threshold"}), inputs);
+      EXPECT_EQ(5, node.attr().at("op_names").list().s_size());
+      EXPECT_EQ(DT_FLOAT, node.attr().at("T").type());
+      found++;
+    }
+  }
+  EXPECT_EQ(1, found);
+
+  auto tensors = EvaluateNodes(output, item.fetch, item.feed);
+  EXPECT_EQ(1, tensors.size());
+  test::ExpectTensorNear<float>(tensors_expected[0], tensors[0], 1e-5);
+}
+
+TEST_F(RemapperTest, DontComposeSelectWithVectorCondition) {
+  tensorflow::Scope s =
+      tensorflow::Scope::NewRootScope().WithDevice("/device:CPU:0");
+  auto x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT,
+                            ops::Placeholder::Shape({4, 4}));
+  auto y = ops::Placeholder(s.WithOpName("y"), DT_FLOAT,
+                            ops::Placeholder::Shape({4, 4}));
+  auto cond = ops::Placeholder(s.WithOpName("cond"), DT_BOOL,
+                               ops::Placeholder::Shape({4}));
+  Output add = ops::Add(s.WithOpName("add"), x, y);
+  Output select = ops::Select(s.WithOpName("select"), cond, add, y);
+  Output relu = ops::Relu(s.WithOpName("relu"), select);
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  item.fetch = {"relu"};
+  Tensor cond_t(DT_BOOL, TensorShape({4}));
+  cond_t.vec<bool>().setValues({true, false, false, true});
+  item.feed = {{"x", GenerateRandomTensor<DT_FLOAT>(TensorShape({4, 4}))},
+               {"y", GenerateRandomTensor<DT_FLOAT>(TensorShape({4, 4}))},
+               {"cond", cond_t}};
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch, item.feed);
+  EXPECT_EQ(1, tensors_expected.size());
+
+  Remapper optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_CHECK_OK(optimizer.Optimize(nullptr, item, &output));
+
+  // Select picks whole rows for a vector condition, so it isn't composed.
+  int found = 0;
+  for (const NodeDef& node : output.node()) {
+    EXPECT_NE("_ElementwiseOpsComposition", node.op());
+    if (node.name() == "select") {
+      EXPECT_EQ("Select", node.op());
+      found++;
+    }
+  }
+  EXPECT_EQ(1, found);
+
+  auto tensors = EvaluateNodes(output, item.fetch, item.feed);
+  EXPECT_EQ(1, tensors.size());
+  test::ExpectTensorNear<float>(tensors_expected[0], tensors[0], 1e-6);
+}
+
+TEST_F(RemapperTest, ComposeCastAndBiasAdd) {
+  tensorflow::Scope s =
+      tensorflow::Scope::NewRootScope().WithDevice("/device:CPU:0");
+  auto x = ops::Placeholder(s.WithOpName("x"), DT_INT32,
+                            ops::Placeholder::Shape({2, 3}));
+  Output bias = ops::Const(s.WithOpName("bias"), {0.5f, -1.0f, 2.0f}, {3});
+  Output cast = ops::Cast(s.WithOpName("cast"), x, DT_FLOAT);
+  Output bias_add = ops::BiasAdd(s.WithOpName("bias_add"), cast, bias);
+  Output tanh = ops::Tanh(s.WithOpName("tanh"), bias_add);
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  item.fetch = {"tanh"};
+  item.feed = {{"x", GenerateRandomTensor<DT_INT32>(TensorShape({2, 3}))}};
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch, item.feed);
+  EXPECT_EQ(1, tensors_expected.size());
+
+  Remapper optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_CHECK_OK(optimizer.Optimize(nullptr, item, &output));
+
+  int found = 0;
+  for (const NodeDef& node : output.node()) {
+    EXPECT_NE("cast", node.name());
+    EXPECT_NE("bias_add", node.name());
+    if (node.name() == "tanh") {
+      EXPECT_EQ("_ElementwiseOpsComposition", node.op());
+      ASSERT_EQ(2, node.input_size());
+      EXPECT_EQ("x", node.input(0));
+      EXPECT_EQ("bias", node.input(1));
+      const auto& tin = node.attr().at("Tin").list();
+      ASSERT_EQ(2, tin.type_size());
+      EXPECT_EQ(DT_INT32, tin.type(0));
+      EXPECT_EQ(DT_FLOAT, tin.type(1));
+      const auto& op_names = node.attr().at("op_names").list();
+      ASSERT_EQ(3, op_names.s_size());
+      EXPECT_EQ("Cast", op_names.s(0));
+      EXPECT_EQ("Add", op_names.s(1));
+      EXPECT_EQ("Tanh", op_names.s(2));
+      const auto& operands = node.attr().at("operands").list();
+      ASSERT_EQ(4, operands.i_size());
+      EXPECT_EQ(0, operands.i(0));  // Cast(x)
+      EXPECT_EQ(2, operands.i(1));  // Add(cast, bias)
+      EXPECT_EQ(1, operands.i(2));
+      EXPECT_EQ(3, operands.i(3));  // Tanh(add)
+      found++;
+    }
+  }
+  EXPECT_EQ(1, found);
+
+  auto tensors = EvaluateNodes(output, item.fetch, item.feed);
+  EXPECT_EQ(1, tensors.size());
+  test::ExpectTensorNear<float>(tensors_expected[0], tensors[0], 1e-5);
+}
+
+TEST_F(RemapperTest, DoNotComposeNodesWithOtherConsumers) {
+  tensorflow::Scope s =
+      tensorflow::Scope::NewRootScope().WithDevice("/device:CPU:0");
+  auto x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT,
+                            ops::Placeholder::Shape({8}));
+  auto y = ops::Placeholder(s.WithOpName("y"), DT_FLOAT,
+                            ops::Placeholder::Shape({8}));
+  Output exp = ops::Exp(s.WithOpName("exp"), x);
+  Output add = ops::Add(s.WithOpName("add"), exp, y);
+  Output neg = ops::Neg(s.WithOpName("neg"), add);
+  Output sqrt = ops::Sqrt(s.WithOpName("sqrt"), exp);
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  item.fetch = {"neg", "sqrt"};
+
+  Remapper optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_CHECK_OK(optimizer.Optimize(nullptr, item, &output));
+
+  int found = 0;
+  for (const NodeDef& node : output.node()) {
+    EXPECT_NE("add", node.name());
+    if (node.name() == "exp") EXPECT_EQ("Exp", node.op());
+    if (node.name() == "sqrt") EXPECT_EQ("Sqrt", node.op());
+    if (node.name() == "neg") {
+      EXPECT_EQ("_ElementwiseOpsComposition", node.op());
+      ASSERT_EQ(2, node.input_size());
+      EXPECT_EQ("exp", node.input(0));
+      EXPECT_EQ("y", node.input(1));
+      found++;
+    }
+  }
+  EXPECT_EQ(1, found);
+}
+
 }  // namespace grappler
 }  // namespace tensorflow
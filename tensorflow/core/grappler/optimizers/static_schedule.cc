@@ -59,6 +59,15 @@ static Costs::NanoSeconds PredictExecutionTime(
 Status EstimateEarliestExecutionTimes(
     const GrapplerItem& item, const Cluster* cluster,
     std::unordered_map<const NodeDef*, Costs::NanoSeconds>* completion_times) {
+  return EstimateEarliestExecutionTimes(item, cluster, completion_times,
+                                        nullptr);
+}
+
+Status EstimateEarliestExecutionTimes(
+    const GrapplerItem& item, const Cluster* cluster,
+    std::unordered_map<const NodeDef*, Costs::NanoSeconds>* completion_times,
+    std::unordered_map<const NodeDef*, Costs::NanoSeconds>*
+        node_execution_times) {
   std::unordered_map<string, const NodeDef*> name_map;
   std::unordered_map<const NodeDef*, int> pending_inputs;
   std::deque<const NodeDef*> ready_nodes;
@@ -102,6 +111,9 @@ Status EstimateEarliestExecutionTimes(
 
     Costs::NanoSeconds execution_time =
         PredictExecutionTime(properties, estimator, placer, *node);
+    if (node_execution_times != nullptr) {
+      (*node_execution_times)[node] = execution_time;
+    }
     Costs::NanoSeconds completion_time =
         execution_time + (*completion_times)[node];
     (*completion_times)[node] = completion_time;
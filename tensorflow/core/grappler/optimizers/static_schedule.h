@@ -35,6 +35,14 @@ Status EstimateEarliestExecutionTimes(
     const GrapplerItem& item, const Cluster* cluster,
     std::unordered_map<const NodeDef*, Costs::NanoSeconds>* execution_times);
 
+// Same as above, but also returns the predicted execution time of each node
+// in `node_execution_times`.
+Status EstimateEarliestExecutionTimes(
+    const GrapplerItem& item, const Cluster* cluster,
+    std::unordered_map<const NodeDef*, Costs::NanoSeconds>* completion_times,
+    std::unordered_map<const NodeDef*, Costs::NanoSeconds>*
+        node_execution_times);
+
 // Compute the time by which the execution of each node must complete to ensure
 // the subsequent nodes can still be executed by the times predicted by the
 // EstimateEarliestExecutionTimes function.
@@ -211,6 +211,8 @@ class BatchResource : public ResourceBase {
                        int32 batch_timeout_micros, int32 max_enqueued_batches,
                        const std::vector<int32>& allowed_batch_sizes,
                        FunctionLibraryRuntime::Handle fhandle,
+                       bool enable_large_batch_splitting,
+                       int64 request_deadline_micros,
                        std::unique_ptr<BatchResource>* resource) {
     std::unique_ptr<BatchResource> new_resource(new BatchResource);
 
@@ -224,10 +226,17 @@ class BatchResource : public ResourceBase {
         max_enqueued_batches;
     new_resource->batcher_queue_options_.batch_timeout_micros =
         batch_timeout_micros;
+    new_resource->batcher_queue_options_.enable_large_batch_splitting =
+        enable_large_batch_splitting;
+    if (enable_large_batch_splitting) {
+      new_resource->batcher_queue_options_.split_input_task_func =
+          SplitInputTask;
+    }
 
     new_resource->allowed_batch_sizes_ = allowed_batch_sizes;
 
     new_resource->fhandle_ = fhandle;
+    new_resource->request_deadline_micros_ = request_deadline_micros;
 
     *resource = std::move(new_resource);
     return Status::OK();
@@ -268,6 +277,10 @@ class BatchResource : public ResourceBase {
     }
     batch_components->context = context;
     batch_components->done_callback = std::move(done_callback);
+    if (request_deadline_micros_ > 0) {
+      batch_components->deadline_time_micros =
+          context->env()->NowMicros() + request_deadline_micros_;
+    }
 
     BatcherQueue* batcher_queue;
     TF_RETURN_IF_ERROR(
@@ -278,7 +291,19 @@ class BatchResource : public ResourceBase {
  private:
   BatchResource() = default;
 
-  // One input to be batched. Corresponds to one invocation of the batch op.
+  // The state shared by the tasks that one invocation of the batch function
+  // op was split into. The outputs of the tasks are kept until all of them
+  // are done, and then concatenated into the outputs of the invocation.
+  struct SplitOutputs {
+    mutex mu;
+    int num_pending_tasks GUARDED_BY(mu);
+    Status status GUARDED_BY(mu);
+    // The outputs of each task, in the order the tasks were split in.
+    std::vector<std::vector<Tensor>> task_outputs GUARDED_BY(mu);
+  };
+
+  // One input to be batched. Corresponds to one invocation of the batch op,
+  // or to a part of it if it was split across batches.
   struct BatchTask : public serving::BatchTask {
     // A unique ID to identify this invocation of Batch.
     int64 guid;
@@ -288,13 +313,155 @@ class BatchResource : public ResourceBase {
     OpKernelContext* context;
     AsyncOpKernel::DoneCallback done_callback;
 
+    // The time by which the invocation should be processed, or 0 if none.
+    uint64 deadline_time_micros = 0;
+
+    // Set iff this task is a part of a split invocation, in which case
+    // 'split_index' is its position among the parts.
+    std::shared_ptr<SplitOutputs> split;
+    int split_index = 0;
+
     size_t size() const override { return inputs[0].shape().dim_size(0); }
+
+    uint64 deadline_micros() const override { return deadline_time_micros; }
   };
 
   using Batcher = serving::SharedBatchScheduler<BatchTask>;
   using BatcherQueue = serving::BatchScheduler<BatchTask>;
   using Batch = serving::Batch<BatchTask>;
 
+  // Splits 'input_task' into tasks that fill up the open batch first, and then
+  // whole batches. Used as QueueOptions::split_input_task_func.
+  static Status SplitInputTask(
+      std::unique_ptr<BatchTask>* input_task, int open_batch_remaining_slot,
+      int max_batch_size,
+      std::vector<std::unique_ptr<BatchTask>>* output_tasks) {
+    const BatchTask& input = **input_task;
+
+    std::vector<int64> output_sizes;
+    int64 remaining_size = input.size();
+    if (open_batch_remaining_slot > 0) {
+      output_sizes.push_back(std::min<int64>(open_batch_remaining_slot,
+                                             remaining_size));
+      remaining_size -= output_sizes.back();
+    }
+    while (remaining_size > 0) {
+      output_sizes.push_back(std::min<int64>(max_batch_size, remaining_size));
+      remaining_size -= output_sizes.back();
+    }
+
+    // For each input edge, the slices of the input with one entry per task.
+    std::vector<std::vector<Tensor>> split_inputs;
+    split_inputs.reserve(input.inputs.size());
+    for (const Tensor& tensor : input.inputs) {
+      const DataType type = tensor.dtype();
+      Status split_status;
+      std::vector<Tensor> slices;
+      switch (type) {
+#define CASE(type)                                                     \
+  case DataTypeToEnum<type>::value:                                    \
+    split_status =                                                     \
+        SplitCPU<type>(input.context, tensor, output_sizes, &slices);  \
+    break;
+        TF_CALL_ALL_TYPES(CASE);
+#undef CASE
+        default:
+          split_status =
+              errors::InvalidArgument("Unsupported data type: ", type);
+          break;
+      }
+      TF_RETURN_IF_ERROR(split_status);
+      split_inputs.push_back(std::move(slices));
+    }
+
+    auto split = std::make_shared<SplitOutputs>();
+    {
+      mutex_lock l(split->mu);
+      split->num_pending_tasks = output_sizes.size();
+      split->task_outputs.resize(output_sizes.size());
+    }
+    for (size_t i = 0; i < output_sizes.size(); ++i) {
+      std::unique_ptr<BatchTask> output_task(new BatchTask);
+      output_task->guid = input.guid;
+      for (const std::vector<Tensor>& slices : split_inputs) {
+        output_task->inputs.push_back(slices.at(i));
+      }
+      output_task->captured_inputs = input.captured_inputs;
+      output_task->context = input.context;
+      output_task->done_callback = input.done_callback;
+      output_task->deadline_time_micros = input.deadline_time_micros;
+      output_task->split = split;
+      output_task->split_index = i;
+      output_tasks->push_back(std::move(output_task));
+    }
+    input_task->reset();
+    return Status::OK();
+  }
+
+  // Sets the status of the invocation that 'task' belongs to and signals that
+  // it is done. If the invocation was split, only does so once all its parts
+  // are done, after concatenating their outputs.
+  static void FinishTask(BatchTask* task, const Status& status) {
+    if (task->split == nullptr) {
+      task->context->SetStatus(status);
+      task->done_callback();
+      return;
+    }
+
+    SplitOutputs* split = task->split.get();
+    Status final_status;
+    {
+      mutex_lock l(split->mu);
+      split->status.Update(status);
+      if (--split->num_pending_tasks > 0) {
+        return;
+      }
+      final_status = split->status;
+      if (final_status.ok()) {
+        final_status = ConcatSplitOutputs(task->context, split);
+      }
+    }
+    task->context->SetStatus(final_status);
+    task->done_callback();
+  }
+
+  // Concatenates the outputs of the parts of a split invocation into the
+  // outputs of 'context'.
+  static Status ConcatSplitOutputs(OpKernelContext* context,
+                                   SplitOutputs* split)
+      EXCLUSIVE_LOCKS_REQUIRED(split->mu) {
+    for (int i = 0; i < context->num_outputs(); ++i) {
+      std::vector<Tensor> to_concatenate;
+      to_concatenate.reserve(split->task_outputs.size());
+      for (const std::vector<Tensor>& outputs : split->task_outputs) {
+        if (static_cast<int>(outputs.size()) != context->num_outputs()) {
+          return errors::Internal("Wrong number of split output tensors");
+        }
+        to_concatenate.push_back(outputs[i]);
+      }
+
+      const DataType type = to_concatenate[0].dtype();
+      Status concat_status;
+      Tensor concatenated_tensor;
+      switch (type) {
+#define CASE(type)                                                   \
+  case DataTypeToEnum<type>::value:                                  \
+    concat_status =                                                  \
+        Concat<type>(context, to_concatenate, &concatenated_tensor); \
+    break;
+        TF_CALL_ALL_TYPES(CASE);
+#undef CASE
+        default:
+          concat_status =
+              errors::InvalidArgument("Unsupported data type: ", type);
+          break;
+      }
+      TF_RETURN_IF_ERROR(concat_status);
+      context->set_output(i, concatenated_tensor);
+    }
+    return Status::OK();
+  }
+
   // Validates that it's legal to combine the tasks in 'batch' into a batch.
   // Assumes the batch is non-empty.
   static Status ValidateBatch(const Batch& batch) {
@@ -462,7 +629,17 @@ class BatchResource : public ResourceBase {
 
       for (int j = 0; j < batch->num_tasks(); ++j) {
         BatchTask& task = *(batch->mutable_task(j));
-        task.context->set_output(i, split_tensor.at(j));
+        if (task.split == nullptr) {
+          task.context->set_output(i, split_tensor.at(j));
+        } else {
+          // The parts of a split invocation are concatenated once they are
+          // all done, in FinishTask().
+          mutex_lock l(task.split->mu);
+          std::vector<Tensor>& task_outputs =
+              task.split->task_outputs[task.split_index];
+          task_outputs.resize(combined_outputs.size());
+          task_outputs[i] = split_tensor.at(j);
+        }
       }  // (Ignore a possible final split_tensors entry containing the
          // padding.)
     }
@@ -488,8 +665,7 @@ class BatchResource : public ResourceBase {
         return;
       }
       for (int i = 0; i < batch->num_tasks(); ++i) {
-        batch->mutable_task(i)->context->SetStatus(status);
-        batch->mutable_task(i)->done_callback();
+        FinishTask(batch->mutable_task(i), status);
       }
       cleanup_done = true;
     };
@@ -686,6 +862,10 @@ class BatchResource : public ResourceBase {
 
   std::vector<int32> allowed_batch_sizes_;
   FunctionLibraryRuntime::Handle fhandle_;
+
+  // The latency budget of each invocation, from which its deadline is set, or
+  // 0 if invocations have no deadline.
+  int64 request_deadline_micros_ = 0;
 };
 
 class BatchFunctionKernel : public AsyncOpKernel {
@@ -707,6 +887,14 @@ class BatchFunctionKernel : public AsyncOpKernel {
                    c->GetAttr("max_enqueued_batches", &max_enqueued_batches_));
     OP_REQUIRES_OK(c, c->GetAttr("allowed_batch_sizes", &allowed_batch_sizes_));
     OP_REQUIRES_OK(c, ValidateAllowedBatchSizes());
+    OP_REQUIRES_OK(c, c->GetAttr("enable_large_batch_splitting",
+                                 &enable_large_batch_splitting_));
+    OP_REQUIRES_OK(c, c->GetAttr("request_deadline_micros",
+                                 &request_deadline_micros_));
+    OP_REQUIRES(c, request_deadline_micros_ >= 0,
+                errors::InvalidArgument(
+                    "request_deadline_micros must be non-negative; was ",
+                    request_deadline_micros_));
 
     auto lib = c->function_library();
     OP_REQUIRES(c, lib != nullptr, errors::Internal("No function library"));
@@ -723,10 +911,11 @@ class BatchFunctionKernel : public AsyncOpKernel {
     std::function<Status(BatchResource * *r)> creator = [this,
                                                          c](BatchResource** r) {
       std::unique_ptr<BatchResource> new_resource;
-      TF_RETURN_IF_ERROR(
-          BatchResource::Create(num_batch_threads_, max_batch_size_,
-                                batch_timeout_micros_, max_enqueued_batches_,
-                                allowed_batch_sizes_, fhandle_, &new_resource));
+      TF_RETURN_IF_ERROR(BatchResource::Create(
+          num_batch_threads_, max_batch_size_, batch_timeout_micros_,
+          max_enqueued_batches_, allowed_batch_sizes_, fhandle_,
+          enable_large_batch_splitting_, request_deadline_micros_,
+          &new_resource));
       *r = new_resource.release();
       return Status::OK();
     };
@@ -773,6 +962,8 @@ class BatchFunctionKernel : public AsyncOpKernel {
   int32 max_enqueued_batches_;
   std::vector<int32> allowed_batch_sizes_;
   FunctionLibraryRuntime::Handle fhandle_;
+  bool enable_large_batch_splitting_;
+  int64 request_deadline_micros_;
 };
 
 REGISTER_KERNEL_BUILDER(Name("BatchFunction").Device(DEVICE_CPU),
@@ -807,7 +998,8 @@ class BatchKernel : public AsyncOpKernel {
           TF_RETURN_IF_ERROR(BatchResource::Create(
               num_batch_threads_, max_batch_size_, batch_timeout_micros_,
               max_enqueued_batches_, allowed_batch_sizes_, kInvalidHandle,
-              &new_resource));
+              /*enable_large_batch_splitting=*/false,
+              /*request_deadline_micros=*/0, &new_resource));
           *r = new_resource.release();
           return Status::OK();
         };
@@ -62,6 +62,11 @@ class BatchTask {
   // Returns the size of the task, in terms of how much it contributes to the
   // size of a batch. (A batch's size is the sum of its task sizes.)
   virtual size_t size() const = 0;
+
+  // Returns the time, in microseconds as measured by Env::NowMicros(), by
+  // which the task should have been processed, or 0 if it has no deadline.
+  // Schedulers may use it to close a batch earlier than they otherwise would.
+  virtual uint64 deadline_micros() const { return 0; }
 };
 
 // A thread-safe collection of BatchTasks, to be executed together in some
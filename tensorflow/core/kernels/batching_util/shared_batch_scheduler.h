@@ -150,6 +150,11 @@ class SharedBatchScheduler
     //
     // The goal is to smooth out batch sizes under low request rates, and thus
     // avoid latency spikes.
+    //
+    // Independently of this timeout, a batch is also closed as soon as the
+    // earliest deadline among its tasks (see BatchTask::deadline_micros())
+    // would be missed by waiting any longer, given the time it recently took
+    // to process a batch from this queue.
     int64 batch_timeout_micros = 0;
 
     // The maximum allowable number of enqueued (accepted by Schedule() but
@@ -158,6 +163,25 @@ class SharedBatchScheduler
     // See the class documentation above for guidelines on how to tune this
     // parameter.
     size_t max_enqueued_batches = 10;
+
+    // If true, a task that doesn't fit into the open batch is split into
+    // smaller tasks with 'split_input_task_func', the first of which fills up
+    // the open batch and the others go into new batches. Tasks may then be as
+    // large as 'max_enqueued_batches' * 'max_batch_size', rather than
+    // 'max_batch_size'. If false, such a task goes into a new batch and the
+    // open batch is closed with whatever room it has left.
+    bool enable_large_batch_splitting = false;
+
+    // Splits '*input_task' into tasks whose sizes add up to its size, and
+    // appends them to 'output_tasks' in order. The first output task has size
+    // 'open_batch_remaining_slot', unless that is 0, and the others have size
+    // 'max_batch_size', except for the last which may be smaller. Required if
+    // 'enable_large_batch_splitting' is true. Called with a lock held on the
+    // queue, so it should be fast.
+    std::function<Status(std::unique_ptr<TaskType>* input_task,
+                         int open_batch_remaining_slot, int max_batch_size,
+                         std::vector<std::unique_ptr<TaskType>>* output_tasks)>
+        split_input_task_func;
   };
   Status AddQueue(const QueueOptions& options,
                   std::function<void(std::unique_ptr<Batch<TaskType>>)>
@@ -250,7 +274,11 @@ class Queue {
   size_t SchedulingCapacity() const;
 
   // Returns the maximum allowed size of tasks submitted to the queue.
-  size_t max_task_size() const { return options_.max_batch_size; }
+  size_t max_task_size() const {
+    return options_.enable_large_batch_splitting
+               ? options_.max_enqueued_batches * options_.max_batch_size
+               : options_.max_batch_size;
+  }
 
   // Called by a thread that is ready to process a batch, to request one from
   // this queue. Either returns a batch that is ready to be processed, or
@@ -277,6 +305,13 @@ class Queue {
   // Same as IsEmpty(), but assumes the caller already holds a lock on 'mu_'.
   bool IsEmptyInternal() const EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
+  // Same as Schedule(), for queues with 'enable_large_batch_splitting'.
+  Status ScheduleWithSplitting(std::unique_ptr<TaskType>* task);
+
+  // Adds 'task' to the open batch residing at the back of 'batches_'.
+  void AddTaskToOpenBatch(std::unique_ptr<TaskType> task)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
   // Closes the open batch residing at the back of 'batches_', and inserts a
   // fresh open batch behind it.
   void StartNewBatch() EXCLUSIVE_LOCKS_REQUIRED(mu_);
@@ -312,6 +347,14 @@ class Queue {
   // in 'batches_'. Valid iff that batch contains at least one task.
   uint64 open_batch_start_time_micros_ GUARDED_BY(mu_);
 
+  // The earliest deadline of the tasks in the open batch, or 0 if none of them
+  // has a deadline. Valid iff that batch contains at least one task.
+  uint64 open_batch_deadline_micros_ GUARDED_BY(mu_) = 0;
+
+  // A moving average of the time it took to process the recent batches, used
+  // to close a batch early enough for its tasks to meet their deadlines.
+  uint64 batch_processing_micros_ GUARDED_BY(mu_) = 0;
+
   // Whether this queue contains a batch that is eligible to be scheduled. Used
   // to keep track of when to call 'schedulable_batch_callback_'.
   bool schedulable_batch_ GUARDED_BY(mu_) = false;
@@ -408,6 +451,12 @@ Status SharedBatchScheduler<TaskType>::AddQueue(
         "max_enqueued_batches must be non-negative; was ",
         options.max_enqueued_batches);
   }
+  if (options.enable_large_batch_splitting &&
+      options.split_input_task_func == nullptr) {
+    return errors::InvalidArgument(
+        "split_input_task_func must be set when enable_large_batch_splitting "
+        "is true");
+  }
 
   auto schedulable_batch_callback = [this] {
     mutex_lock l(mu_);
@@ -526,6 +575,9 @@ Queue<TaskType>::~Queue() {
 
 template <typename TaskType>
 Status Queue<TaskType>::Schedule(std::unique_ptr<TaskType>* task) {
+  if (options_.enable_large_batch_splitting) {
+    return ScheduleWithSplitting(task);
+  }
   if ((*task)->size() > options_.max_batch_size) {
     return errors::InvalidArgument("Task size ", (*task)->size(),
                                    " is larger than maximum batch size ",
@@ -546,10 +598,72 @@ Status Queue<TaskType>::Schedule(std::unique_ptr<TaskType>* task) {
       }
       StartNewBatch();
     }
-    if (batches_.back()->empty()) {
-      open_batch_start_time_micros_ = env_->NowMicros();
+    AddTaskToOpenBatch(std::move(*task));
+
+    if (!schedulable_batch_) {
+      if (batches_.size() > 1 || IsOpenBatchSchedulable()) {
+        schedulable_batch_ = true;
+        notify_of_schedulable_batch = true;
+      }
+    }
+  }
+
+  if (notify_of_schedulable_batch) {
+    schedulable_batch_callback_();
+  }
+
+  return Status::OK();
+}
+
+template <typename TaskType>
+Status Queue<TaskType>::ScheduleWithSplitting(std::unique_ptr<TaskType>* task) {
+  const size_t task_size = (*task)->size();
+  if (task_size > max_task_size()) {
+    return errors::InvalidArgument("Task size ", task_size,
+                                   " is larger than maximum task size ",
+                                   max_task_size());
+  }
+
+  bool notify_of_schedulable_batch = false;
+  {
+    mutex_lock l(mu_);
+
+    DCHECK(!closed_);
+
+    const size_t open_batch_remaining_slot =
+        options_.max_batch_size - batches_.back()->size();
+    size_t num_new_batches = 0;
+    if (task_size > open_batch_remaining_slot) {
+      num_new_batches =
+          (task_size - open_batch_remaining_slot + options_.max_batch_size -
+           1) /
+          options_.max_batch_size;
+    }
+    if (batches_.size() + num_new_batches > options_.max_enqueued_batches) {
+      return errors::Unavailable(
+          "The batch scheduling queue to which this task was submitted is "
+          "full");
+    }
+
+    // A task that fits into a batch of its own needn't be split if the open
+    // batch is full anyway.
+    std::vector<std::unique_ptr<TaskType>> output_tasks;
+    if (num_new_batches == 0 ||
+        (open_batch_remaining_slot == 0 &&
+         task_size <= options_.max_batch_size)) {
+      output_tasks.push_back(std::move(*task));
+    } else {
+      TF_RETURN_IF_ERROR(options_.split_input_task_func(
+          task, open_batch_remaining_slot, options_.max_batch_size,
+          &output_tasks));
+    }
+    for (auto& output_task : output_tasks) {
+      if (batches_.back()->size() + output_task->size() >
+          options_.max_batch_size) {
+        StartNewBatch();
+      }
+      AddTaskToOpenBatch(std::move(output_task));
     }
-    batches_.back()->AddTask(std::move(*task));
 
     if (!schedulable_batch_) {
       if (batches_.size() > 1 || IsOpenBatchSchedulable()) {
@@ -566,6 +680,20 @@ Status Queue<TaskType>::Schedule(std::unique_ptr<TaskType>* task) {
   return Status::OK();
 }
 
+template <typename TaskType>
+void Queue<TaskType>::AddTaskToOpenBatch(std::unique_ptr<TaskType> task) {
+  const uint64 deadline_micros = task->deadline_micros();
+  if (batches_.back()->empty()) {
+    open_batch_start_time_micros_ = env_->NowMicros();
+    open_batch_deadline_micros_ = deadline_micros;
+  } else if (deadline_micros != 0 && (open_batch_deadline_micros_ == 0 ||
+                                      deadline_micros <
+                                          open_batch_deadline_micros_)) {
+    open_batch_deadline_micros_ = deadline_micros;
+  }
+  batches_.back()->AddTask(std::move(task));
+}
+
 template <typename TaskType>
 size_t Queue<TaskType>::NumEnqueuedTasks() const {
   mutex_lock l(mu_);
@@ -616,10 +744,19 @@ std::unique_ptr<Batch<TaskType>> Queue<TaskType>::ScheduleBatch() {
 
 template <typename TaskType>
 void Queue<TaskType>::ProcessBatch(std::unique_ptr<Batch<TaskType>> batch) {
+  const uint64 start_time_micros = env_->NowMicros();
   process_batch_callback_(std::move(batch));
+  const uint64 end_time_micros = env_->NowMicros();
 
   {
     mutex_lock l(mu_);
+    // Weighs the latest batch by 1/8, so that the estimate follows changes in
+    // the load without being thrown off by a single slow batch.
+    const uint64 processing_micros = end_time_micros > start_time_micros
+                                         ? end_time_micros - start_time_micros
+                                         : 0;
+    batch_processing_micros_ =
+        (7 * batch_processing_micros_ + processing_micros) / 8;
     --num_batches_being_processed_;
     if (empty_notification_ != nullptr && IsEmptyInternal()) {
       empty_notification_->Notify();
@@ -667,8 +804,13 @@ bool Queue<TaskType>::IsOpenBatchSchedulable() const {
   if (open_batch->empty()) {
     return false;
   }
+  const uint64 now_micros = env_->NowMicros();
+  if (open_batch_deadline_micros_ != 0 &&
+      now_micros + batch_processing_micros_ >= open_batch_deadline_micros_) {
+    return true;
+  }
   return closed_ || open_batch->size() >= options_.max_batch_size ||
-         env_->NowMicros() >=
+         now_micros >=
              open_batch_start_time_micros_ + options_.batch_timeout_micros;
 }
 
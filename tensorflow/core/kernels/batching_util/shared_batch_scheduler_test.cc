@@ -28,14 +28,18 @@ namespace {
 
 class FakeTask : public BatchTask {
  public:
-  explicit FakeTask(size_t size) : size_(size) {}
+  explicit FakeTask(size_t size, uint64 deadline_micros = 0)
+      : size_(size), deadline_micros_(deadline_micros) {}
 
   ~FakeTask() override = default;
 
   size_t size() const override { return size_; }
 
+  uint64 deadline_micros() const override { return deadline_micros_; }
+
  private:
   const size_t size_;
+  const uint64 deadline_micros_;
 
   TF_DISALLOW_COPY_AND_ASSIGN(FakeTask);
 };
@@ -50,6 +54,25 @@ Status ScheduleTask(size_t task_size, BatchScheduler<FakeTask>* scheduler) {
   return status;
 }
 
+// Splits 'input_task' the way QueueOptions::split_input_task_func should.
+Status SplitFakeTask(std::unique_ptr<FakeTask>* input_task,
+                     int open_batch_remaining_slot, int max_batch_size,
+                     std::vector<std::unique_ptr<FakeTask>>* output_tasks) {
+  int remaining_size = (*input_task)->size();
+  int next_size = open_batch_remaining_slot;
+  while (remaining_size > 0) {
+    if (next_size > 0) {
+      const int size = std::min(next_size, remaining_size);
+      output_tasks->emplace_back(
+          new FakeTask(size, (*input_task)->deadline_micros()));
+      remaining_size -= size;
+    }
+    next_size = max_batch_size;
+  }
+  input_task->reset();
+  return Status::OK();
+}
+
 // Creates a thread that waits on 'start' and then advances the fake clock in
 // 'env' in a loop until 'stop' is notified. Useful for allowing objects that
 // use the clock to be destroyed.
@@ -254,6 +277,110 @@ TEST(SharedBatchSchedulerTest, ObeysTimeout) {
   stop_teardown.Notify();
 }
 
+TEST(SharedBatchSchedulerTest, ClosesBatchAtDeadline) {
+  test_util::FakeClockEnv env(Env::Default());
+  Notification start_teardown, stop_teardown;
+  std::unique_ptr<Thread> teardown_thread =
+      CreateFakeClockAdvancerThread(&env, &start_teardown, &stop_teardown);
+
+  {
+    Notification batch_processed;
+    auto callback = [&batch_processed](std::unique_ptr<Batch<FakeTask>> batch) {
+      ASSERT_TRUE(batch->IsClosed());
+      EXPECT_EQ(2, batch->num_tasks());
+      batch_processed.Notify();
+    };
+
+    SharedBatchScheduler<FakeTask>::Options options;
+    options.num_batch_threads = 1;
+    options.env = &env;
+    std::shared_ptr<SharedBatchScheduler<FakeTask>> scheduler;
+    TF_ASSERT_OK(SharedBatchScheduler<FakeTask>::Create(options, &scheduler));
+    SharedBatchScheduler<FakeTask>::QueueOptions queue_options;
+    queue_options.max_batch_size = 10;
+    queue_options.batch_timeout_micros = 1000 * 1000;
+    queue_options.max_enqueued_batches = 2;
+    std::unique_ptr<BatchScheduler<FakeTask>> queue;
+    TF_ASSERT_OK(scheduler->AddQueue(queue_options, callback, &queue));
+
+    // The batch should be closed at the earliest deadline of its tasks, well
+    // before the timeout.
+    const uint64 now_micros = env.NowMicros();
+    std::unique_ptr<FakeTask> task(new FakeTask(1, now_micros + 20));
+    TF_ASSERT_OK(queue->Schedule(&task));
+    task.reset(new FakeTask(1, now_micros + 10));
+    TF_ASSERT_OK(queue->Schedule(&task));
+    env.AdvanceByMicroseconds(9);
+    Env::Default()->SleepForMicroseconds(10 * 1000 /* 10 milliseconds */);
+    EXPECT_FALSE(batch_processed.HasBeenNotified());
+    env.AdvanceByMicroseconds(1);
+    batch_processed.WaitForNotification();
+
+    start_teardown.Notify();
+  }
+  stop_teardown.Notify();
+}
+
+TEST(SharedBatchSchedulerTest, SplitsLargeTasks) {
+  test_util::FakeClockEnv env(Env::Default());
+  Notification start_teardown, stop_teardown;
+  std::unique_ptr<Thread> teardown_thread =
+      CreateFakeClockAdvancerThread(&env, &start_teardown, &stop_teardown);
+
+  {
+    mutex mu;
+    std::vector<std::vector<size_t>> batches;
+    Notification last_batch_processed;
+    auto callback = [&mu, &batches, &last_batch_processed](
+                        std::unique_ptr<Batch<FakeTask>> batch) {
+      ASSERT_TRUE(batch->IsClosed());
+      std::vector<size_t> task_sizes;
+      for (int i = 0; i < batch->num_tasks(); ++i) {
+        task_sizes.push_back(batch->task(i).size());
+      }
+      mutex_lock l(mu);
+      batches.push_back(task_sizes);
+      if (batches.size() == 3) {
+        last_batch_processed.Notify();
+      }
+    };
+
+    SharedBatchScheduler<FakeTask>::Options options;
+    options.num_batch_threads = 1;
+    options.env = &env;
+    std::shared_ptr<SharedBatchScheduler<FakeTask>> scheduler;
+    TF_ASSERT_OK(SharedBatchScheduler<FakeTask>::Create(options, &scheduler));
+    SharedBatchScheduler<FakeTask>::QueueOptions queue_options;
+    queue_options.max_batch_size = 4;
+    queue_options.batch_timeout_micros = 10;
+    queue_options.max_enqueued_batches = 3;
+    queue_options.enable_large_batch_splitting = true;
+    std::unique_ptr<BatchScheduler<FakeTask>> queue;
+    EXPECT_EQ(error::INVALID_ARGUMENT,
+              scheduler->AddQueue(queue_options, callback, &queue).code());
+    queue_options.split_input_task_func = SplitFakeTask;
+    TF_ASSERT_OK(scheduler->AddQueue(queue_options, callback, &queue));
+    EXPECT_EQ(12, queue->max_task_size());
+
+    EXPECT_EQ(error::INVALID_ARGUMENT, ScheduleTask(13, queue.get()).code());
+
+    // The second task should fill up the first batch, then a whole batch, and
+    // leave the rest in an open batch that is closed by the timeout.
+    TF_ASSERT_OK(ScheduleTask(1, queue.get()));
+    TF_ASSERT_OK(ScheduleTask(9, queue.get()));
+    env.AdvanceByMicroseconds(10);
+    last_batch_processed.WaitForNotification();
+    {
+      mutex_lock l(mu);
+      EXPECT_EQ((std::vector<std::vector<size_t>>{{1, 3}, {4}, {2}}),
+                batches);
+    }
+
+    start_teardown.Notify();
+  }
+  stop_teardown.Notify();
+}
+
 TEST(SharedBatchSchedulerTest, ObeysTimeoutWithRealClock) {
   Notification first_batch_processed, second_batch_processed;
   auto callback = [&first_batch_processed, &second_batch_processed](
@@ -144,6 +144,12 @@ class CollectiveReduceOpKernel : public CollectiveOpKernel {
                                {0}, 0, c->input(0).shape(), &output),
                            done);
     }
+    if (col_params_.group.group_size >
+        col_params_.instance.device_names.size()) {
+      // The size of the input guides the choice of the reduction algorithm
+      // when col_params_ is completed.
+      col_params_.instance.shape = c->input(0).shape();
+    }
     if (!CanProceedWithCompute(c, col_exec, done)) return;
     auto actual_done = [c, col_exec, done](const Status& s) {
       OP_REQUIRES_OK_ASYNC(c, s, done);
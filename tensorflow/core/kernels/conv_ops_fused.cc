@@ -19,6 +19,7 @@ limitations under the License.
 #define EIGEN_USE_THREADS
 
 #include <string.h>
+#include <algorithm>
 #include <map>
 #include <vector>
 #include "tensorflow/core/framework/common_shape_fns.h"
@@ -30,7 +31,9 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/tensor_slice.h"
 #include "tensorflow/core/kernels/bounds_check.h"
+#include "tensorflow/core/kernels/conv_2d.h"
 #include "tensorflow/core/kernels/conv_ops.h"
+#include "tensorflow/core/kernels/fused_epilogue.h"
 #include "tensorflow/core/kernels/gemm_functors.h"
 #include "tensorflow/core/kernels/image_resizer_state.h"
 #include "tensorflow/core/lib/core/threadpool.h"
@@ -40,6 +43,8 @@ limitations under the License.
 
 namespace tensorflow {
 
+typedef Eigen::ThreadPoolDevice CPUDevice;
+
 namespace {
 
 // We don't want to allocate a buffer to hold all the patches if the size is
@@ -54,6 +59,22 @@ const size_t kMaxChunkSize = (1 * 1024 * 1024);
 const size_t kMaxChunkSize = (16 * 1024 * 1024);
 #endif
 const size_t kResizeCacheSize = (8 * 1024 * 1024);
+// _FusedConv2D computes its output in tiles of whole rows of at most this
+// many bytes, so that a tile is still in cache when the fused ops are applied
+// to it.
+const size_t kMaxFusedTileSize = (128 * 1024);
+
+// Evaluates `expr` into the tile `output` of a _FusedConv2D output, on the
+// intra-op thread pool if `on_device` or else in the calling thread.
+template <typename Output, typename Expr>
+void AssignFusedTile(OpKernelContext* context, bool on_device, Output output,
+                     const Expr& expr) {
+  if (on_device) {
+    output.device(context->eigen_device<CPUDevice>()) = expr;
+  } else {
+    output = expr;
+  }
+}
 
 // Lookup method used when resizing.
 enum SamplingMode {
@@ -870,6 +891,198 @@ class FusedResizeConv2DUsingGemmOp : public OpKernel {
   TF_DISALLOW_COPY_AND_ASSIGN(FusedResizeConv2DUsingGemmOp);
 };
 
+// Implements a convolution followed by a bias add, batch normalization and
+// activation, as specified by its "fused_ops" attribute. See
+// FusedEpilogueSpec for the supported ops. The output is computed in tiles
+// of whole output rows of one image, in parallel, and the fused ops are
+// applied to each tile as soon as it is computed.
+template <class T>
+class FusedConv2DOp : public OpKernel {
+ public:
+  explicit FusedConv2DOp(OpKernelConstruction* context) : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("strides", &strides_));
+    OP_REQUIRES(context, strides_.size() == 4,
+                errors::InvalidArgument("Sliding window strides field must "
+                                        "specify 4 dimensions"));
+    string data_format;
+    OP_REQUIRES_OK(context, context->GetAttr("data_format", &data_format));
+    TensorFormat format;
+    OP_REQUIRES(context, FormatFromString(data_format, &format),
+                errors::InvalidArgument("Invalid data format"));
+    OP_REQUIRES(context, format == FORMAT_NHWC,
+                errors::Unimplemented("_FusedConv2D only supports the NHWC "
+                                      "data format on CPU."));
+    OP_REQUIRES(
+        context, strides_[0] == 1 && strides_[3] == 1,
+        errors::InvalidArgument("Current implementation does not yet support "
+                                "strides in the batch and depth dimensions."));
+    std::vector<int32> dilations;
+    OP_REQUIRES_OK(context, context->GetAttr("dilations", &dilations));
+    OP_REQUIRES(context,
+                dilations.size() == 4 &&
+                    std::all_of(dilations.begin(), dilations.end(),
+                                [](int32 d) { return d == 1; }),
+                errors::Unimplemented("_FusedConv2D does not support "
+                                      "dilations on CPU."));
+    OP_REQUIRES_OK(context, context->GetAttr("padding", &padding_));
+    OP_REQUIRES_OK(context, spec_.Init(context));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    // Input tensor is of the following dimensions:
+    // [ batch, in_rows, in_cols, in_depth ]
+    const Tensor& input = context->input(0);
+    // Input filter is of the following dimensions:
+    // [ filter_rows, filter_cols, in_depth, out_depth]
+    const Tensor& filter = context->input(1);
+    OP_REQUIRES(context, input.dims() == 4,
+                errors::InvalidArgument("input must be 4-dimensional",
+                                        input.shape().DebugString()));
+    OP_REQUIRES(context, filter.dims() == 4,
+                errors::InvalidArgument("filter must be 4-dimensional: ",
+                                        filter.shape().DebugString()));
+    const int64 batch = input.dim_size(0);
+    const int64 in_rows = input.dim_size(1);
+    const int64 in_cols = input.dim_size(2);
+    const int64 in_depth = input.dim_size(3);
+    const int64 filter_rows = filter.dim_size(0);
+    const int64 filter_cols = filter.dim_size(1);
+    const int64 out_depth = filter.dim_size(3);
+    OP_REQUIRES(context, in_depth == filter.dim_size(2),
+                errors::InvalidArgument(
+                    "input and filter must have the same depth: ", in_depth,
+                    " vs ", filter.dim_size(2)));
+
+    const int stride_rows = strides_[1];
+    const int stride_cols = strides_[2];
+    int64 out_rows, out_cols, pad_top, pad_bottom, pad_left, pad_right;
+    OP_REQUIRES_OK(context, GetWindowedOutputSizeVerbose(
+                                in_rows, filter_rows, stride_rows, padding_,
+                                &out_rows, &pad_top, &pad_bottom));
+    OP_REQUIRES_OK(context, GetWindowedOutputSizeVerbose(
+                                in_cols, filter_cols, stride_cols, padding_,
+                                &out_cols, &pad_left, &pad_right));
+
+    FusedEpilogue<T> epilogue;
+    OP_REQUIRES_OK(context, epilogue.Init(spec_, context, 2, out_depth));
+
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context, context->allocate_output(
+                                0, TensorShape({batch, out_rows, out_cols,
+                                                out_depth}),
+                                &output));
+    if (output->NumElements() == 0) return;
+
+    typedef Eigen::TensorMap<Eigen::Tensor<const T, 4, Eigen::RowMajor>,
+                             Eigen::Unaligned>
+        ConstTensor4;
+    typedef Eigen::TensorMap<Eigen::Tensor<T, 4, Eigen::RowMajor>,
+                             Eigen::Unaligned>
+        Tensor4;
+    const T* input_data = input.flat<T>().data();
+    T* output_data = output->flat<T>().data();
+    auto filter_tensor = filter.tensor<T, 4>();
+    const int64 in_row_size = in_cols * in_depth;
+    const int64 out_row_size = out_cols * out_depth;
+    const int64 rows_per_tile = std::max<int64>(
+        1, kMaxFusedTileSize / (out_row_size * sizeof(T)));
+    const int64 tiles_per_image =
+        (out_rows + rows_per_tile - 1) / rows_per_tile;
+    const int64 padded_cols = in_cols + pad_left + pad_right;
+
+    // Computes one tile of the output, holding its padded input rows in
+    // *padded_input if it needs any.
+    auto compute_tile = [&](int64 tile, bool on_device,
+                            std::vector<T>* padded_input) {
+      const int64 image = tile / tiles_per_image;
+      const int64 row_begin = (tile % tiles_per_image) * rows_per_tile;
+      const int64 row_end = std::min(out_rows, row_begin + rows_per_tile);
+      T* tile_data =
+          output_data + (image * out_rows + row_begin) * out_row_size;
+      Tensor4 tile_output(tile_data, 1, row_end - row_begin, out_cols,
+                          out_depth);
+      // The rows of the image, some of which may be padding, that the
+      // windows of the tile cover.
+      const int64 window_begin = row_begin * stride_rows - pad_top;
+      const int64 window_end =
+          (row_end - 1) * stride_rows - pad_top + filter_rows;
+      const int64 input_begin = std::max<int64>(0, window_begin);
+      const int64 input_end = std::min(in_rows, window_end);
+      if (input_end <= input_begin) {
+        tile_output.setZero();
+      } else {
+        ConstTensor4 tile_input(
+            input_data + (image * in_rows + input_begin) * in_row_size, 1,
+            input_end - input_begin, in_cols, in_depth);
+        if (window_begin == input_begin && window_end == input_end &&
+            padded_cols == in_cols) {
+          AssignFusedTile(context, on_device, tile_output,
+                          Eigen::SpatialConvolution(tile_input, filter_tensor,
+                                                    stride_cols, stride_rows,
+                                                    Eigen::PADDING_VALID));
+        } else {
+          // Eigen only pads the whole input, so pad the rows of the tile
+          // explicitly.
+          Eigen::array<std::pair<int64, int64>, 4> paddings;
+          paddings[0] = std::make_pair(0, 0);
+          paddings[1] = std::make_pair(input_begin - window_begin,
+                                       window_end - input_end);
+          paddings[2] = std::make_pair(pad_left, pad_right);
+          paddings[3] = std::make_pair(0, 0);
+          padded_input->resize((window_end - window_begin) * padded_cols *
+                               in_depth);
+          Tensor4(padded_input->data(), 1, window_end - window_begin,
+                  padded_cols, in_depth) = tile_input.pad(paddings);
+          AssignFusedTile(
+              context, on_device, tile_output,
+              Eigen::SpatialConvolution(
+                  ConstTensor4(padded_input->data(), 1,
+                               window_end - window_begin, padded_cols,
+                               in_depth),
+                  filter_tensor, stride_cols, stride_rows,
+                  Eigen::PADDING_VALID));
+        }
+      }
+      epilogue.Apply(tile_data, (row_end - row_begin) * out_cols);
+    };
+
+    const int64 num_tiles = batch * tiles_per_image;
+    if (num_tiles <
+        context->device()->tensorflow_cpu_worker_threads()->num_threads) {
+      // Too few tiles to keep the intra-op threads busy, e.g. for a batch of
+      // one, so each convolution is parallelized instead.
+      std::vector<T> padded_input;
+      for (int64 tile = 0; tile < num_tiles; ++tile) {
+        compute_tile(tile, true, &padded_input);
+      }
+      return;
+    }
+    FusedConvParallelFor(context, 0, num_tiles,
+                         [&](int64 task_begin, int64 task_end) {
+                           std::vector<T> padded_input;
+                           for (int64 tile = task_begin; tile != task_end;
+                                ++tile) {
+                             compute_tile(tile, false, &padded_input);
+                           }
+                         });
+  }
+
+ private:
+  std::vector<int32> strides_;
+  Padding padding_;
+  FusedEpilogueSpec spec_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(FusedConv2DOp);
+};
+
+#define REGISTER_FUSED_CONV2D(T)                                        \
+  REGISTER_KERNEL_BUILDER(                                              \
+      Name("_FusedConv2D").Device(DEVICE_CPU).TypeConstraint<T>("T"),   \
+      FusedConv2DOp<T>);
+
+TF_CALL_float(REGISTER_FUSED_CONV2D);
+TF_CALL_double(REGISTER_FUSED_CONV2D);
+
 #define REGISTER_FUSED(T)                                                 \
   REGISTER_KERNEL_BUILDER(                                                \
       Name("FusedResizeAndPadConv2D")                                     \
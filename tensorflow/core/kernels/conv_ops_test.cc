@@ -27,6 +27,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/ops_util.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/protobuf/rewriter_config.pb.h"
 #include "tensorflow/core/public/session.h"
 
 namespace tensorflow {
@@ -408,6 +409,140 @@ TEST_F(FusedResizePadConvOpTest, NoResizePadOnlySymmetricComparative) {
                                         "SAME", DT_FLOAT);
 }
 
+class FusedConv2DOpTest : public ::testing::Test {
+ protected:
+  // Compares _FusedConv2D with the Conv2D, BiasAdd, FusedBatchNorm and
+  // activation nodes it replaces.
+  void CompareFusedAndSeparate(int batch, int input_height, int input_width,
+                               int input_depth, int filter_size,
+                               int filter_count, int stride,
+                               const string& padding, bool with_bias,
+                               bool with_batch_norm,
+                               const string& activation) {
+    auto root = tensorflow::Scope::NewRootScope();
+    using namespace ::tensorflow::ops;  // NOLINT(build/namespaces)
+
+    Tensor input_data(DT_FLOAT, TensorShape({batch, input_height, input_width,
+                                             input_depth}));
+    input_data.flat<float>().setRandom();
+    input_data.flat<float>() -= input_data.flat<float>().constant(0.5f);
+    Output input =
+        Const(root.WithOpName("input"), Input::Initializer(input_data));
+    Tensor filter_data(DT_FLOAT, TensorShape({filter_size, filter_size,
+                                              input_depth, filter_count}));
+    filter_data.flat<float>().setRandom();
+    filter_data.flat<float>() -= filter_data.flat<float>().constant(0.5f);
+    Output filter =
+        Const(root.WithOpName("filter"), Input::Initializer(filter_data));
+    auto channel_values = [filter_count](float offset) {
+      Tensor t(DT_FLOAT, TensorShape({filter_count}));
+      test::FillFn<float>(&t, [offset](int i) { return offset + 0.1f * i; });
+      return t;
+    };
+
+    NodeDef fused;
+    fused.set_name("fused_conv");
+    fused.set_op("_FusedConv2D");
+    fused.add_input("input");
+    fused.add_input("filter");
+    std::vector<string> fused_ops;
+
+    Output output = Conv2D(root.WithOpName("conv"), input, filter,
+                           {1, stride, stride, 1}, padding);
+    if (with_bias) {
+      Output bias = Const(root.WithOpName("bias"),
+                          Input::Initializer(channel_values(-0.2f)));
+      output = BiasAdd(root.WithOpName("bias_add"), output, bias);
+      fused.add_input("bias");
+      fused_ops.push_back("BiasAdd");
+    }
+    if (with_batch_norm) {
+      const string names[] = {"scale", "offset", "mean", "variance"};
+      const float offsets[] = {0.5f, -0.3f, 0.1f, 0.8f};
+      std::vector<Output> args;
+      for (int i = 0; i < 4; ++i) {
+        args.push_back(Const(root.WithOpName(names[i]),
+                             Input::Initializer(channel_values(offsets[i]))));
+        fused.add_input(names[i]);
+      }
+      output = FusedBatchNorm(root.WithOpName("batch_norm"), output, args[0],
+                              args[1], args[2], args[3],
+                              FusedBatchNorm::IsTraining(false))
+                   .y;
+      fused_ops.push_back("FusedBatchNorm");
+    }
+    if (activation == "Relu") {
+      output = Relu(root.WithOpName("activation"), output);
+    } else if (activation == "Relu6") {
+      output = Relu6(root.WithOpName("activation"), output);
+    } else if (activation == "Elu") {
+      output = Elu(root.WithOpName("activation"), output);
+    }
+    if (!activation.empty()) fused_ops.push_back(activation);
+    Identity(root.WithOpName("separate_conv"), output);
+
+    tensorflow::GraphDef graph;
+    TF_ASSERT_OK(root.ToGraphDef(&graph));
+    auto* attr = fused.mutable_attr();
+    (*attr)["T"].set_type(DT_FLOAT);
+    (*attr)["num_args"].set_i(fused.input_size() - 2);
+    for (int i = 0; i < 4; ++i) {
+      (*attr)["strides"].mutable_list()->add_i(i == 1 || i == 2 ? stride : 1);
+    }
+    (*attr)["padding"].set_s(padding);
+    for (const string& op : fused_ops) {
+      (*attr)["fused_ops"].mutable_list()->add_s(op);
+    }
+    (*attr)["epsilon"].set_f(0.001f);
+    *graph.add_node() = fused;
+
+    // Keep the separate nodes as they are.
+    SessionOptions options;
+    RewriterConfig* rewrite_options =
+        options.config.mutable_graph_options()->mutable_rewrite_options();
+    rewrite_options->set_remapping(RewriterConfig::OFF);
+    rewrite_options->set_constant_folding(RewriterConfig::OFF);
+    options.config.mutable_graph_options()
+        ->mutable_optimizer_options()
+        ->set_opt_level(OptimizerOptions::L0);
+    std::unique_ptr<tensorflow::Session> session(
+        tensorflow::NewSession(options));
+    TF_ASSERT_OK(session->Create(graph));
+
+    std::vector<Tensor> unfused_tensors;
+    TF_ASSERT_OK(session->Run({}, {"separate_conv"}, {}, &unfused_tensors));
+
+    std::vector<Tensor> fused_tensors;
+    TF_ASSERT_OK(session->Run({}, {"fused_conv"}, {}, &fused_tensors));
+
+    test::ExpectTensorNear<float>(unfused_tensors[0], fused_tensors[0], 1e-4);
+  }
+};
+
+TEST_F(FusedConv2DOpTest, BiasAndRelu) {
+  CompareFusedAndSeparate(2, 9, 7, 3, 3, 4, 1, "SAME", true, false, "Relu");
+}
+
+TEST_F(FusedConv2DOpTest, BiasAndRelu6Strided) {
+  CompareFusedAndSeparate(1, 10, 11, 2, 3, 5, 2, "SAME", true, false,
+                          "Relu6");
+}
+
+TEST_F(FusedConv2DOpTest, BatchNormAndElu) {
+  CompareFusedAndSeparate(1, 6, 6, 4, 2, 3, 1, "VALID", false, true, "Elu");
+}
+
+TEST_F(FusedConv2DOpTest, BiasAndBatchNorm) {
+  CompareFusedAndSeparate(3, 5, 5, 2, 1, 2, 1, "VALID", true, true, "");
+}
+
+// Each output row is larger than a tile, so every row is a separate tile,
+// and the first and last tiles pad the input.
+TEST_F(FusedConv2DOpTest, ManyTiles) {
+  CompareFusedAndSeparate(2, 6, 128, 4, 3, 160, 1, "SAME", true, false,
+                          "Relu");
+}
+
 class ConvOpTest : public OpsTestBase {
  protected:
   void HandwrittenConv() {
@@ -12,11 +12,21 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
+#include <algorithm>
+#include <deque>
+
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/kernels/data/dataset.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/io/record_reader.h"
+#include "tensorflow/core/lib/io/record_writer.h"
+#include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 
 namespace tensorflow {
@@ -29,7 +39,20 @@ namespace {
 class CacheDatasetOp : public UnaryDatasetOpKernel {
  public:
   explicit CacheDatasetOp(OpKernelConstruction* ctx)
-      : UnaryDatasetOpKernel(ctx) {}
+      : UnaryDatasetOpKernel(ctx) {
+    // An in-memory cache keeps at most TF_DATA_CACHE_MEMORY_BUDGET_BYTES of
+    // elements in memory (0 means no limit) and spills the remaining elements
+    // to compressed files in TF_DATA_CACHE_SPILL_DIR (by default, a local
+    // temporary directory).
+    OP_REQUIRES_OK(
+        ctx, ReadInt64FromEnvVar("TF_DATA_CACHE_MEMORY_BUDGET_BYTES", 0,
+                                 &spill_options_.memory_budget_bytes));
+    OP_REQUIRES_OK(ctx, ReadInt64FromEnvVar("TF_DATA_CACHE_SPILL_SHARD_BYTES",
+                                            64 << 20,
+                                            &spill_options_.shard_bytes));
+    OP_REQUIRES_OK(ctx, ReadStringFromEnvVar("TF_DATA_CACHE_SPILL_DIR", "",
+                                             &spill_options_.directory));
+  }
 
   void MakeDataset(OpKernelContext* ctx, DatasetBase* input,
                    DatasetBase** output) override {
@@ -39,13 +62,25 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
                    ParseScalarArgument<string>(ctx, "filename", &filename));
 
     if (filename.empty()) {
-      *output = new MemoryDataset(ctx, input);
+      *output = new MemoryDataset(ctx, input, spill_options_);
     } else {
       *output = new FileDataset(ctx, input, filename, ctx->env());
     }
   }
 
  private:
+  // Configures how an in-memory cache spills elements to disk.
+  struct SpillOptions {
+    // Elements are spilled once the cached elements would use more than
+    // this many bytes of memory. Non-positive values disable spilling.
+    int64 memory_budget_bytes = 0;
+    // Approximate uncompressed size of each spill file.
+    int64 shard_bytes = 0;
+    // Directory for the spill files. If empty, a local temporary directory
+    // is used.
+    string directory;
+  };
+
   class FileDataset : public DatasetBase {
    public:
     explicit FileDataset(OpKernelContext* ctx, const DatasetBase* input,
@@ -541,10 +576,12 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
 
   class MemoryDataset : public DatasetBase {
    public:
-    explicit MemoryDataset(OpKernelContext* ctx, const DatasetBase* input)
+    explicit MemoryDataset(OpKernelContext* ctx, const DatasetBase* input,
+                           const SpillOptions& spill_options)
         : DatasetBase(DatasetContext(ctx)),
           input_(input),
-          cache_(new MemoryCache()) {
+          cache_(new MemoryCache(ctx->env(), input->output_dtypes().size(),
+                                 spill_options)) {
       input->Ref();
     }
 
@@ -587,14 +624,34 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
     // The expected use is that a single `MemoryWriterIterator` populates the
     // cache with dataset elements. Once all elements are cached, the cache can
     // be used by one or more `MemoryReaderIterator`s.
+    //
+    // If a memory budget is set, elements are kept in memory until they would
+    // exceed the budget. That element and all later ones are "spilled": they
+    // are written, one record per tensor, to ZLIB-compressed record files
+    // ("spill shards") of roughly `SpillOptions::shard_bytes` each. The
+    // elements in memory are therefore always a prefix of the cache, and each
+    // spill shard holds a contiguous range of the remaining elements that can
+    // be read independently of the others. Spill shards are deleted when the
+    // cache is reset or destroyed.
     class MemoryCache {
      public:
-      MemoryCache() = default;
+      MemoryCache(Env* env, size_t num_components,
+                  const SpillOptions& spill_options)
+          : env_(env),
+            num_components_(num_components),
+            spill_options_(spill_options) {}
+
+      ~MemoryCache() {
+        mutex_lock l(mu_);
+        DeleteSpillShards();
+      }
 
       // Marks the cache as completed.
-      void Complete() {
+      Status Complete() {
         mutex_lock l(mu_);
+        TF_RETURN_IF_ERROR(CloseSpillShard());
         completed_ = true;
+        return Status::OK();
       }
 
       // Returns whether the cache is claimed.
@@ -625,9 +682,12 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
         claimed_ = false;
         completed_ = false;
         cache_.clear();
+        bytes_in_memory_ = 0;
+        DeleteSpillShards();
       }
 
-      // Returns the element at the given index.
+      // Returns the element at the given index, which must be less than
+      // `num_in_memory()`.
       const std::vector<Tensor>& at(int64 index) {
         tf_shared_lock l(mu_);
         DCHECK(index < cache_.size());
@@ -635,24 +695,213 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
       }
 
       // Adds the element to the cache.
-      void emplace_back(std::vector<Tensor> element) {
+      Status emplace_back(std::vector<Tensor> element) {
+        mutex_lock l(mu_);
+        if (num_spilled_ == 0) {
+          int64 bytes = 0;
+          for (const Tensor& t : element) {
+            bytes += t.TotalBytes();
+          }
+          if (spill_options_.memory_budget_bytes <= 0 ||
+              bytes_in_memory_ + bytes <= spill_options_.memory_budget_bytes) {
+            bytes_in_memory_ += bytes;
+            cache_.emplace_back(std::move(element));
+            return Status::OK();
+          }
+        }
+        return Spill(element);
+      }
+
+      // Closes the spill shard being written, if any, so that all spilled
+      // elements can be read. Later elements go to a new shard.
+      Status FlushSpill() {
         mutex_lock l(mu_);
-        cache_.emplace_back(std::move(element));
+        return CloseSpillShard();
       }
 
       // Returns the size of the cache.
       size_t size() {
+        tf_shared_lock l(mu_);
+        return cache_.size() + num_spilled_;
+      }
+
+      // Returns the number of elements kept in memory. These are the first
+      // `num_in_memory()` elements of the cache.
+      size_t num_in_memory() {
         tf_shared_lock l(mu_);
         return cache_.size();
       }
 
+      // Returns the number of spill shards.
+      size_t num_spill_shards() {
+        tf_shared_lock l(mu_);
+        return spill_shards_.size();
+      }
+
+      // Finds the spill shard holding the spilled element at `index` and the
+      // offset of that element within the shard.
+      void LocateSpilledElement(size_t index, size_t* shard, size_t* offset) {
+        tf_shared_lock l(mu_);
+        DCHECK_GE(index, cache_.size());
+        DCHECK_LT(index, cache_.size() + num_spilled_);
+        auto it = std::upper_bound(
+            spill_shards_.begin(), spill_shards_.end(), index,
+            [](size_t i, const SpillShard& s) { return i < s.first_index; });
+        DCHECK(it != spill_shards_.begin());
+        --it;
+        *shard = it - spill_shards_.begin();
+        *offset = index - it->first_index;
+      }
+
+      // Reads all elements of a closed spill shard. Safe to call from several
+      // threads at once.
+      Status ReadSpillShard(size_t shard_index,
+                            std::vector<std::vector<Tensor>>* elements) {
+        SpillShard shard;
+        {
+          tf_shared_lock l(mu_);
+          DCHECK_LT(shard_index, spill_shards_.size());
+          shard = spill_shards_[shard_index];
+        }
+        std::unique_ptr<RandomAccessFile> file;
+        TF_RETURN_IF_ERROR(env_->NewRandomAccessFile(shard.filename, &file));
+        io::SequentialRecordReader reader(
+            file.get(), io::RecordReaderOptions::CreateRecordReaderOptions(
+                            kSpillCompressionType));
+        elements->clear();
+        elements->reserve(shard.num_elements);
+        string record;
+        for (size_t i = 0; i < shard.num_elements; ++i) {
+          elements->emplace_back();
+          std::vector<Tensor>& element = elements->back();
+          element.reserve(num_components_);
+          for (size_t j = 0; j < num_components_; ++j) {
+            TF_RETURN_IF_ERROR(reader.ReadRecord(&record));
+            TensorProto proto;
+            Tensor t;
+            if (!proto.ParseFromString(record) || !t.FromProto(proto)) {
+              return errors::DataLoss("Could not parse cache element ",
+                                      shard.first_index + i,
+                                      " from spill file ", shard.filename);
+            }
+            element.push_back(std::move(t));
+          }
+        }
+        return Status::OK();
+      }
+
      private:
+      static constexpr const char* const kSpillCompressionType = "ZLIB";
+
+      struct SpillShard {
+        string filename;
+        // Index in the cache of the first element of the shard.
+        size_t first_index = 0;
+        size_t num_elements = 0;
+      };
+
+      Status Spill(const std::vector<Tensor>& element)
+          EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        if (element.size() != num_components_) {
+          return errors::Internal("Cannot spill an element with ",
+                                  element.size(), " components, expected ",
+                                  num_components_);
+        }
+        if (spill_writer_ == nullptr) {
+          TF_RETURN_IF_ERROR(OpenSpillShard());
+        }
+        string record;
+        for (const Tensor& t : element) {
+          TensorProto proto;
+          t.AsProtoTensorContent(&proto);
+          record.clear();
+          if (!proto.SerializeToString(&record)) {
+            return errors::Internal("Could not serialize a tensor of shape ",
+                                    t.shape().DebugString(),
+                                    " for the cache spill file");
+          }
+          TF_RETURN_IF_ERROR(spill_writer_->WriteRecord(record));
+          spill_shard_bytes_ += record.size();
+        }
+        spill_shards_.back().num_elements++;
+        num_spilled_++;
+        if (spill_shard_bytes_ >= spill_options_.shard_bytes) {
+          TF_RETURN_IF_ERROR(CloseSpillShard());
+        }
+        return Status::OK();
+      }
+
+      Status OpenSpillShard() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        if (spill_prefix_.empty()) {
+          string directory = spill_options_.directory;
+          if (directory.empty()) {
+            std::vector<string> temp_directories;
+            env_->GetLocalTempDirectories(&temp_directories);
+            if (temp_directories.empty()) {
+              return errors::Unavailable(
+                  "No local temporary directory to spill the cache to. Set "
+                  "TF_DATA_CACHE_SPILL_DIR.");
+            }
+            directory = temp_directories[0];
+          }
+          TF_RETURN_IF_ERROR(env_->RecursivelyCreateDir(directory));
+          spill_prefix_ = io::JoinPath(
+              directory, strings::StrCat("tf_data_cache_", env_->NowMicros(),
+                                         "_", random::New64()));
+        }
+        SpillShard shard;
+        shard.filename =
+            strings::StrCat(spill_prefix_, "_", spill_shards_.size());
+        shard.first_index = cache_.size() + num_spilled_;
+        TF_RETURN_IF_ERROR(
+            env_->NewWritableFile(shard.filename, &spill_file_));
+        spill_writer_.reset(new io::RecordWriter(
+            spill_file_.get(),
+            io::RecordWriterOptions::CreateRecordWriterOptions(
+                kSpillCompressionType)));
+        spill_shards_.push_back(std::move(shard));
+        spill_shard_bytes_ = 0;
+        return Status::OK();
+      }
+
+      Status CloseSpillShard() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        if (spill_writer_ == nullptr) {
+          return Status::OK();
+        }
+        Status s = spill_writer_->Close();
+        spill_writer_.reset();
+        s.Update(spill_file_->Close());
+        spill_file_.reset();
+        return s;
+      }
+
+      void DeleteSpillShards() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        CloseSpillShard().IgnoreError();
+        for (const SpillShard& shard : spill_shards_) {
+          env_->DeleteFile(shard.filename).IgnoreError();
+        }
+        spill_shards_.clear();
+        num_spilled_ = 0;
+      }
+
+      Env* const env_;
+      const size_t num_components_;
+      const SpillOptions spill_options_;
       mutex mu_;
       // Determines whether a writer has claimed the cache.
       bool claimed_ GUARDED_BY(mu_) = false;
       // Determines whether all elements of the dataset have been cached.
       bool completed_ GUARDED_BY(mu_) = false;
       std::vector<std::vector<Tensor>> cache_ GUARDED_BY(mu_);
+      int64 bytes_in_memory_ GUARDED_BY(mu_) = 0;
+      // Spill files are named `<spill_prefix_>_<shard index>`.
+      string spill_prefix_ GUARDED_BY(mu_);
+      std::vector<SpillShard> spill_shards_ GUARDED_BY(mu_);
+      size_t num_spilled_ GUARDED_BY(mu_) = 0;
+      // The last spill shard, while it is being written.
+      std::unique_ptr<WritableFile> spill_file_ GUARDED_BY(mu_);
+      std::unique_ptr<io::RecordWriter> spill_writer_ GUARDED_BY(mu_);
+      int64 spill_shard_bytes_ GUARDED_BY(mu_) = 0;
     };
 
     class MemoryIterator : public DatasetIterator<MemoryDataset> {
@@ -687,20 +936,23 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
         if (cache_->IsClaimed()) {
           TF_RETURN_IF_ERROR(
               writer->WriteScalar(full_name("cache_claimed"), ""));
+          // Make the shard that is being written readable.
+          TF_RETURN_IF_ERROR(cache_->FlushSpill());
           size_t cache_size = cache_->size();
           TF_RETURN_IF_ERROR(
               writer->WriteScalar(full_name("cache_size"), cache_size));
-          for (size_t i = 0; i < cache_size; i++) {
-            auto& element = cache_->at(i);
-            TF_RETURN_IF_ERROR(writer->WriteScalar(
-                full_name(strings::StrCat("cache[", i, "].size")),
-                element.size()));
-            for (size_t j = 0; j < element.size(); ++j) {
-              TF_RETURN_IF_ERROR(writer->WriteTensor(
-                  full_name(strings::StrCat("cache[", i, "][", j, "]")),
-                  element[j]));
+          size_t i = 0;
+          for (; i < cache_->num_in_memory(); i++) {
+            TF_RETURN_IF_ERROR(SaveElement(writer, i, cache_->at(i)));
+          }
+          for (size_t shard = 0; shard < cache_->num_spill_shards(); ++shard) {
+            std::vector<std::vector<Tensor>> elements;
+            TF_RETURN_IF_ERROR(cache_->ReadSpillShard(shard, &elements));
+            for (const std::vector<Tensor>& element : elements) {
+              TF_RETURN_IF_ERROR(SaveElement(writer, i++, element));
             }
           }
+          DCHECK_EQ(i, cache_size);
           if (cache_->IsCompleted()) {
             TF_RETURN_IF_ERROR(
                 writer->WriteScalar(full_name("cache_completed"), ""));
@@ -744,10 +996,10 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
                   full_name(strings::StrCat("cache[", i, "][", j, "]")),
                   &element.back()));
             }
-            cache_->emplace_back(std::move(element));
+            TF_RETURN_IF_ERROR(cache_->emplace_back(std::move(element)));
           }
           if (reader->Contains(full_name("cache_completed"))) {
-            cache_->Complete();
+            TF_RETURN_IF_ERROR(cache_->Complete());
           }
         }
         InitializeIterator();
@@ -756,6 +1008,19 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
       }
 
      private:
+      Status SaveElement(IteratorStateWriter* writer, size_t index,
+                         const std::vector<Tensor>& element) {
+        TF_RETURN_IF_ERROR(writer->WriteScalar(
+            full_name(strings::StrCat("cache[", index, "].size")),
+            element.size()));
+        for (size_t j = 0; j < element.size(); ++j) {
+          TF_RETURN_IF_ERROR(writer->WriteTensor(
+              full_name(strings::StrCat("cache[", index, "][", j, "]")),
+              element[j]));
+        }
+        return Status::OK();
+      }
+
       class MemoryWriterIterator : public DatasetIterator<MemoryDataset> {
        public:
         explicit MemoryWriterIterator(const Params& params,
@@ -789,11 +1054,9 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
           TF_RETURN_IF_ERROR(
               input_impl_->GetNext(ctx, out_tensors, end_of_sequence));
           if (*end_of_sequence) {
-            cache_->Complete();
-            return Status::OK();
+            return cache_->Complete();
           }
-          cache_->emplace_back(*out_tensors);
-          return Status::OK();
+          return cache_->emplace_back(*out_tensors);
         }
 
        protected:
@@ -814,6 +1077,10 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
         std::shared_ptr<MemoryCache> cache_;
       };  // MemoryWriterIterator
 
+      // Reads elements from a completed cache. Spilled elements are read
+      // through a prefetcher that keeps up to `kSpillReadAhead` spill shards
+      // in flight on a small thread pool, so that reading one shard overlaps
+      // with decompressing the next ones.
       class MemoryReaderIterator : public DatasetIterator<MemoryDataset> {
        public:
         explicit MemoryReaderIterator(const Params& params,
@@ -822,6 +1089,11 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
           CHECK(cache);
         }
 
+        ~MemoryReaderIterator() override {
+          mutex_lock l(mu_);
+          WaitForShardReads(&l);
+        }
+
        protected:
         Status SaveInternal(IteratorStateWriter* writer) override {
           mutex_lock l(mu_);
@@ -837,6 +1109,8 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
             TF_RETURN_IF_ERROR(reader->ReadScalar(full_name("index"), &temp));
             index_ = static_cast<size_t>(temp);
           }
+          WaitForShardReads(&l);
+          shard_reads_.clear();
           return Status::OK();
         }
 
@@ -844,13 +1118,18 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
                                std::vector<Tensor>* out_tensors,
                                bool* end_of_sequence) override {
           mutex_lock l(mu_);
-          if (index_ < cache_->size()) {
+          if (index_ < cache_->num_in_memory()) {
             const std::vector<Tensor>& cache_tensors = cache_->at(index_);
             out_tensors->insert(out_tensors->begin(), cache_tensors.begin(),
                                 cache_tensors.end());
             index_++;
             *end_of_sequence = false;
             return Status::OK();
+          } else if (index_ < cache_->size()) {
+            TF_RETURN_IF_ERROR(GetSpilledElement(ctx, &l, out_tensors));
+            index_++;
+            *end_of_sequence = false;
+            return Status::OK();
           } else {
             *end_of_sequence = true;
             return Status::OK();
@@ -858,9 +1137,90 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
         }
 
        private:
+        static constexpr size_t kSpillReadAhead = 4;
+
+        // A read of one spill shard.
+        struct ShardRead {
+          size_t shard = 0;
+          bool done = false;
+          Status status;
+          std::vector<std::vector<Tensor>> elements;
+        };
+
+        Status GetSpilledElement(IteratorContext* ctx, mutex_lock* l,
+                                 std::vector<Tensor>* out_tensors)
+            EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+          size_t shard, offset;
+          cache_->LocateSpilledElement(index_, &shard, &offset);
+          while (!shard_reads_.empty() &&
+                 shard_reads_.front()->shard != shard) {
+            shard_reads_.pop_front();
+          }
+          size_t next_shard =
+              shard_reads_.empty() ? shard : shard_reads_.back()->shard + 1;
+          const size_t num_shards = cache_->num_spill_shards();
+          while (shard_reads_.size() < kSpillReadAhead &&
+                 next_shard < num_shards) {
+            ScheduleShardRead(ctx, next_shard++);
+          }
+          std::shared_ptr<ShardRead> read = shard_reads_.front();
+          while (!read->done) {
+            cond_var_.wait(*l);
+          }
+          TF_RETURN_IF_ERROR(read->status);
+          if (offset >= read->elements.size()) {
+            return errors::Internal("Spill shard ", shard, " has ",
+                                    read->elements.size(),
+                                    " elements, expected more than ", offset);
+          }
+          // Every element is read once per shard read, so it can be moved.
+          std::vector<Tensor>& element = read->elements[offset];
+          out_tensors->insert(out_tensors->begin(),
+                              std::make_move_iterator(element.begin()),
+                              std::make_move_iterator(element.end()));
+          if (offset + 1 == read->elements.size()) {
+            shard_reads_.pop_front();
+          }
+          return Status::OK();
+        }
+
+        void ScheduleShardRead(IteratorContext* ctx, size_t shard)
+            EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+          if (!read_pool_) {
+            read_pool_.reset(new thread::ThreadPool(
+                ctx->env(), "cache_spill_reader", kSpillReadAhead));
+          }
+          std::shared_ptr<ShardRead> read = std::make_shared<ShardRead>();
+          read->shard = shard;
+          shard_reads_.push_back(read);
+          num_outstanding_reads_++;
+          read_pool_->Schedule([this, read]() {
+            std::vector<std::vector<Tensor>> elements;
+            Status s = cache_->ReadSpillShard(read->shard, &elements);
+            mutex_lock l(mu_);
+            read->status = s;
+            read->elements = std::move(elements);
+            read->done = true;
+            num_outstanding_reads_--;
+            cond_var_.notify_all();
+          });
+        }
+
+        void WaitForShardReads(mutex_lock* l) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+          while (num_outstanding_reads_ > 0) {
+            cond_var_.wait(*l);
+          }
+        }
+
         mutex mu_;
+        condition_variable cond_var_;
         const std::shared_ptr<MemoryCache> cache_;
         size_t index_ GUARDED_BY(mu_);
+        // Reads of consecutive spill shards, starting with the shard that
+        // holds `index_` once the reader has reached the spilled elements.
+        std::deque<std::shared_ptr<ShardRead>> shard_reads_ GUARDED_BY(mu_);
+        int64 num_outstanding_reads_ GUARDED_BY(mu_) = 0;
+        std::unique_ptr<thread::ThreadPool> read_pool_ GUARDED_BY(mu_);
       };  // MemoryReaderIterator
 
       void InitializeIterator() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
@@ -885,7 +1245,9 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
     const DatasetBase* const input_;
     const std::shared_ptr<MemoryCache> cache_;
   };  // MemoryDataset
-};    // CacheDatasetOp
+
+  SpillOptions spill_options_;
+};  // CacheDatasetOp
 
 REGISTER_KERNEL_BUILDER(Name("CacheDataset").Device(DEVICE_CPU),
                         CacheDatasetOp);
@@ -0,0 +1,330 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/framework/partial_tensor_shape.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_util.h"
+#include "tensorflow/core/kernels/data/columnar_format.h"
+#include "tensorflow/core/kernels/data/dataset.h"
+
+namespace tensorflow {
+
+namespace {
+
+// See documentation in ../ops/dataset_ops.cc for a high-level
+// description of the following op.
+
+class ColumnarDatasetOp : public DatasetOpKernel {
+ public:
+  explicit ColumnarDatasetOp(OpKernelConstruction* ctx)
+      : DatasetOpKernel(ctx) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("output_types", &output_types_));
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("output_shapes", &output_shapes_));
+    OP_REQUIRES(ctx, output_types_.size() == output_shapes_.size(),
+                errors::InvalidArgument("output_types and output_shapes must "
+                                        "have the same length"));
+    for (const PartialTensorShape& shape : output_shapes_) {
+      OP_REQUIRES(ctx, shape.dims() >= 1,
+                  errors::InvalidArgument(
+                      "Each of output_shapes must have a batch dimension"));
+    }
+  }
+
+  void MakeDataset(OpKernelContext* ctx, DatasetBase** output) override {
+    const Tensor* filenames_tensor;
+    OP_REQUIRES_OK(ctx, ctx->input("filenames", &filenames_tensor));
+    OP_REQUIRES(
+        ctx, filenames_tensor->dims() <= 1,
+        errors::InvalidArgument("`filenames` must be a scalar or a vector."));
+    std::vector<string> filenames;
+    filenames.reserve(filenames_tensor->NumElements());
+    for (int i = 0; i < filenames_tensor->NumElements(); ++i) {
+      filenames.push_back(filenames_tensor->flat<string>()(i));
+    }
+
+    const Tensor* column_names_tensor;
+    OP_REQUIRES_OK(ctx, ctx->input("column_names", &column_names_tensor));
+    OP_REQUIRES(
+        ctx, TensorShapeUtils::IsVector(column_names_tensor->shape()),
+        errors::InvalidArgument("`column_names` must be a vector."));
+    OP_REQUIRES(ctx,
+                column_names_tensor->NumElements() == output_types_.size(),
+                errors::InvalidArgument(
+                    "Expected ", output_types_.size(),
+                    " column names but got ",
+                    column_names_tensor->NumElements()));
+    std::vector<string> column_names;
+    for (int i = 0; i < column_names_tensor->NumElements(); ++i) {
+      column_names.push_back(column_names_tensor->vec<string>()(i));
+    }
+
+    int64 batch_size;
+    OP_REQUIRES_OK(
+        ctx, ParseScalarArgument<int64>(ctx, "batch_size", &batch_size));
+    OP_REQUIRES(
+        ctx, batch_size > 0,
+        errors::InvalidArgument("`batch_size` must be greater than zero."));
+
+    *output = new Dataset(ctx, std::move(filenames), std::move(column_names),
+                          batch_size, output_types_, output_shapes_);
+  }
+
+ private:
+  class Dataset : public DatasetBase {
+   public:
+    Dataset(OpKernelContext* ctx, std::vector<string> filenames,
+            std::vector<string> column_names, int64 batch_size,
+            const DataTypeVector& output_types,
+            const std::vector<PartialTensorShape>& output_shapes)
+        : DatasetBase(DatasetContext(ctx)),
+          filenames_(std::move(filenames)),
+          column_names_(std::move(column_names)),
+          batch_size_(batch_size),
+          output_types_(output_types),
+          output_shapes_(output_shapes) {}
+
+    std::unique_ptr<IteratorBase> MakeIteratorInternal(
+        const string& prefix) const override {
+      return std::unique_ptr<IteratorBase>(
+          new Iterator({this, strings::StrCat(prefix, "::Columnar")}));
+    }
+
+    const DataTypeVector& output_dtypes() const override {
+      return output_types_;
+    }
+
+    const std::vector<PartialTensorShape>& output_shapes() const override {
+      return output_shapes_;
+    }
+
+    string DebugString() const override { return "ColumnarDatasetOp::Dataset"; }
+
+   protected:
+    Status AsGraphDefInternal(SerializationContext* ctx,
+                              DatasetGraphDefBuilder* b,
+                              Node** output) const override {
+      Node* filenames = nullptr;
+      TF_RETURN_IF_ERROR(b->AddVector(filenames_, &filenames));
+      Node* column_names = nullptr;
+      TF_RETURN_IF_ERROR(b->AddVector(column_names_, &column_names));
+      Node* batch_size = nullptr;
+      TF_RETURN_IF_ERROR(b->AddScalar(batch_size_, &batch_size));
+      TF_RETURN_IF_ERROR(b->AddDataset(
+          this, {filenames, column_names, batch_size}, output));
+      return Status::OK();
+    }
+
+   private:
+    class Iterator : public DatasetIterator<Dataset> {
+     public:
+      explicit Iterator(const Params& params)
+          : DatasetIterator<Dataset>(params) {}
+
+      Status GetNextInternal(IteratorContext* ctx,
+                             std::vector<Tensor>* out_tensors,
+                             bool* end_of_sequence) override {
+        mutex_lock l(mu_);
+        const size_t num_columns = dataset()->column_names_.size();
+        // The slices of the row groups that make up the batch, per column.
+        std::vector<std::vector<Tensor>> slices(num_columns);
+        int64 num_rows = 0;
+        while (num_rows < dataset()->batch_size_) {
+          if (reader_ && current_row_group_ < reader_->num_row_groups()) {
+            if (row_group_values_.empty()) {
+              TF_RETURN_IF_ERROR(ReadRowGroupLocked());
+            }
+            const int64 group_rows = reader_->num_rows(current_row_group_);
+            const int64 n = std::min(dataset()->batch_size_ - num_rows,
+                                     group_rows - current_row_);
+            for (size_t i = 0; i < num_columns; ++i) {
+              if (n == group_rows) {
+                slices[i].push_back(row_group_values_[i]);
+              } else {
+                slices[i].push_back(row_group_values_[i].Slice(
+                    current_row_, current_row_ + n));
+              }
+            }
+            num_rows += n;
+            current_row_ += n;
+            if (current_row_ == group_rows) {
+              ++current_row_group_;
+              current_row_ = 0;
+              row_group_values_.clear();
+            }
+            continue;
+          }
+
+          // We have reached the end of the current file, so maybe
+          // move on to next file.
+          if (reader_) {
+            ResetStreamsLocked();
+            ++current_file_index_;
+          }
+
+          // Iteration ends when there are no more files to process.
+          if (current_file_index_ == dataset()->filenames_.size()) {
+            break;
+          }
+
+          TF_RETURN_IF_ERROR(SetupStreamsLocked(ctx->env()));
+        }
+
+        if (num_rows == 0) {
+          *end_of_sequence = true;
+          return Status::OK();
+        }
+        out_tensors->reserve(num_columns);
+        for (size_t i = 0; i < num_columns; ++i) {
+          if (slices[i].size() == 1 && slices[i][0].IsAligned()) {
+            // The batch is a whole row group, which needs no copy.
+            out_tensors->push_back(std::move(slices[i][0]));
+          } else {
+            Tensor batch;
+            TF_RETURN_IF_ERROR(tensor::Concat(slices[i], &batch));
+            out_tensors->push_back(std::move(batch));
+          }
+        }
+        *end_of_sequence = false;
+        return Status::OK();
+      }
+
+     protected:
+      Status SaveInternal(IteratorStateWriter* writer) override {
+        mutex_lock l(mu_);
+        TF_RETURN_IF_ERROR(writer->WriteScalar(full_name("current_file_index"),
+                                               current_file_index_));
+        if (reader_) {
+          TF_RETURN_IF_ERROR(writer->WriteScalar(
+              full_name("current_row_group"), current_row_group_));
+          TF_RETURN_IF_ERROR(
+              writer->WriteScalar(full_name("current_row"), current_row_));
+        }
+        return Status::OK();
+      }
+
+      Status RestoreInternal(IteratorContext* ctx,
+                             IteratorStateReader* reader) override {
+        mutex_lock l(mu_);
+        ResetStreamsLocked();
+        int64 current_file_index;
+        TF_RETURN_IF_ERROR(reader->ReadScalar(full_name("current_file_index"),
+                                              &current_file_index));
+        current_file_index_ = size_t(current_file_index);
+        if (reader->Contains(full_name("current_row_group"))) {
+          TF_RETURN_IF_ERROR(SetupStreamsLocked(ctx->env()));
+          TF_RETURN_IF_ERROR(reader->ReadScalar(full_name("current_row_group"),
+                                                &current_row_group_));
+          TF_RETURN_IF_ERROR(
+              reader->ReadScalar(full_name("current_row"), &current_row_));
+          if (current_row_group_ > reader_->num_row_groups() ||
+              (current_row_group_ < reader_->num_row_groups() &&
+               current_row_ >= reader_->num_rows(current_row_group_))) {
+            return errors::DataLoss("Invalid position in ",
+                                    dataset()->filenames_[current_file_index_],
+                                    ": row ", current_row_, " of row group ",
+                                    current_row_group_);
+          }
+        }
+        return Status::OK();
+      }
+
+     private:
+      // Opens the file at `current_file_index_` and checks that it has the
+      // requested columns.
+      Status SetupStreamsLocked(Env* env) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        if (current_file_index_ >= dataset()->filenames_.size()) {
+          return errors::InvalidArgument(
+              "current_file_index_:", current_file_index_,
+              " >= filenames_.size():", dataset()->filenames_.size());
+        }
+
+        const string& filename = dataset()->filenames_[current_file_index_];
+        TF_RETURN_IF_ERROR(ColumnarReader::Open(env, filename, &reader_));
+        column_indices_.clear();
+        for (size_t i = 0; i < dataset()->column_names_.size(); ++i) {
+          int index;
+          TF_RETURN_IF_ERROR(
+              reader_->LookupColumn(dataset()->column_names_[i], &index));
+          const ColumnarColumn& column = reader_->columns()[index];
+          PartialTensorShape row_shape = dataset()->output_shapes_[i];
+          row_shape.RemoveDim(0);
+          if (column.dtype != dataset()->output_types_[i] ||
+              !row_shape.IsCompatibleWith(column.shape)) {
+            return errors::InvalidArgument(
+                "Column ", column.name, " in ", filename, " has type ",
+                DataTypeString(column.dtype), " and shape ",
+                column.shape.DebugString(), ", but expected type ",
+                DataTypeString(dataset()->output_types_[i]), " and shape ",
+                row_shape.DebugString());
+          }
+          column_indices_.push_back(index);
+        }
+        current_row_group_ = 0;
+        current_row_ = 0;
+        return Status::OK();
+      }
+
+      // Reads and decodes only the requested columns of the current row
+      // group.
+      Status ReadRowGroupLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        row_group_values_.resize(column_indices_.size());
+        for (size_t i = 0; i < column_indices_.size(); ++i) {
+          Status s = reader_->ReadColumn(current_row_group_,
+                                         column_indices_[i],
+                                         &row_group_values_[i]);
+          if (!s.ok()) {
+            row_group_values_.clear();
+            return s;
+          }
+        }
+        return Status::OK();
+      }
+
+      void ResetStreamsLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        reader_.reset();
+        column_indices_.clear();
+        row_group_values_.clear();
+        current_row_group_ = 0;
+        current_row_ = 0;
+      }
+
+      mutex mu_;
+      size_t current_file_index_ GUARDED_BY(mu_) = 0;
+      std::unique_ptr<ColumnarReader> reader_ GUARDED_BY(mu_);
+      // The index in the current file of each requested column.
+      std::vector<int> column_indices_ GUARDED_BY(mu_);
+      int64 current_row_group_ GUARDED_BY(mu_) = 0;
+      // The first row of the current row group that was not yet produced.
+      int64 current_row_ GUARDED_BY(mu_) = 0;
+      // The requested columns of the current row group, if read.
+      std::vector<Tensor> row_group_values_ GUARDED_BY(mu_);
+    };
+
+    const std::vector<string> filenames_;
+    const std::vector<string> column_names_;
+    const int64 batch_size_;
+    const DataTypeVector output_types_;
+    const std::vector<PartialTensorShape> output_shapes_;
+  };
+
+  DataTypeVector output_types_;
+  std::vector<PartialTensorShape> output_shapes_;
+};
+
+REGISTER_KERNEL_BUILDER(Name("ColumnarDataset").Device(DEVICE_CPU),
+                        ColumnarDatasetOp);
+
+}  // namespace
+
+}  // namespace tensorflow
@@ -0,0 +1,344 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/columnar_format.h"
+
+#include <cstring>
+
+#include "tensorflow/core/lib/core/coding.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/hash/crc32c.h"
+#include "tensorflow/core/platform/byte_order.h"
+
+namespace tensorflow {
+
+namespace {
+
+constexpr uint64 kColumnarMagic = 0x4e4d554c4f43u;  // "COLUMN"
+// footer_crc, footer_length and magic.
+constexpr size_t kTrailerSize = 4 + 8 + 8;
+
+Status CheckSupported(const ColumnarColumn& column) {
+  if (!port::kLittleEndian) {
+    return errors::Unimplemented(
+        "Columnar files are only supported on little-endian hosts");
+  }
+  if (column.dtype != DT_STRING && !DataTypeCanUseMemcpy(column.dtype)) {
+    return errors::InvalidArgument("Column ", column.name,
+                                   " has unsupported type ",
+                                   DataTypeString(column.dtype));
+  }
+  return Status::OK();
+}
+
+}  // namespace
+
+ColumnarWriter::ColumnarWriter(WritableFile* file,
+                               std::vector<ColumnarColumn> columns,
+                               int64 rows_per_group)
+    : file_(file),
+      columns_(std::move(columns)),
+      rows_per_group_(std::max<int64>(1, rows_per_group)),
+      chunks_(columns_.size()) {}
+
+Status ColumnarWriter::Add(const std::vector<Tensor>& values) {
+  if (finished_) {
+    return errors::FailedPrecondition("ColumnarWriter is finished");
+  }
+  if (values.size() != columns_.size()) {
+    return errors::InvalidArgument("Expected ", columns_.size(),
+                                   " values but got ", values.size());
+  }
+  for (size_t i = 0; i < columns_.size(); ++i) {
+    const ColumnarColumn& column = columns_[i];
+    TF_RETURN_IF_ERROR(CheckSupported(column));
+    const Tensor& value = values[i];
+    if (value.dtype() != column.dtype || value.shape() != column.shape) {
+      return errors::InvalidArgument(
+          "Expected a ", DataTypeString(column.dtype), " value of shape ",
+          column.shape.DebugString(), " for column ", column.name, " but got ",
+          DataTypeString(value.dtype()), " ", value.shape().DebugString());
+    }
+  }
+  for (size_t i = 0; i < columns_.size(); ++i) {
+    const Tensor& value = values[i];
+    string* chunk = &chunks_[i];
+    if (value.dtype() == DT_STRING) {
+      const auto strings = value.flat<string>();
+      for (int64 j = 0; j < strings.size(); ++j) {
+        core::PutVarint64(chunk, strings(j).size());
+        chunk->append(strings(j));
+      }
+    } else {
+      const StringPiece data = value.tensor_data();
+      chunk->append(data.data(), data.size());
+    }
+  }
+  if (++num_buffered_rows_ == rows_per_group_) {
+    TF_RETURN_IF_ERROR(FlushRowGroup());
+  }
+  return Status::OK();
+}
+
+Status ColumnarWriter::Append(StringPiece data) {
+  TF_RETURN_IF_ERROR(file_->Append(data));
+  offset_ += data.size();
+  return Status::OK();
+}
+
+Status ColumnarWriter::FlushRowGroup() {
+  if (num_buffered_rows_ == 0) return Status::OK();
+  core::PutVarint64(&row_groups_, num_buffered_rows_);
+  for (string& chunk : chunks_) {
+    core::PutVarint64(&row_groups_, offset_);
+    core::PutVarint64(&row_groups_, chunk.size());
+    char crc[sizeof(uint32)];
+    core::EncodeFixed32(crc, crc32c::Mask(crc32c::Value(chunk.data(),
+                                                        chunk.size())));
+    TF_RETURN_IF_ERROR(Append(chunk));
+    TF_RETURN_IF_ERROR(Append(StringPiece(crc, sizeof(crc))));
+    string().swap(chunk);
+  }
+  num_buffered_rows_ = 0;
+  ++num_row_groups_;
+  return Status::OK();
+}
+
+Status ColumnarWriter::Finish() {
+  if (finished_) {
+    return errors::FailedPrecondition("ColumnarWriter is finished");
+  }
+  for (const ColumnarColumn& column : columns_) {
+    TF_RETURN_IF_ERROR(CheckSupported(column));
+  }
+  TF_RETURN_IF_ERROR(FlushRowGroup());
+  finished_ = true;
+
+  string footer;
+  core::PutVarint64(&footer, columns_.size());
+  for (const ColumnarColumn& column : columns_) {
+    core::PutVarint64(&footer, column.name.size());
+    footer.append(column.name);
+    core::PutVarint64(&footer, column.dtype);
+    core::PutVarint64(&footer, column.shape.dims());
+    for (int64 dim : column.shape.dim_sizes()) {
+      core::PutVarint64(&footer, dim);
+    }
+  }
+  core::PutVarint64(&footer, num_row_groups_);
+  footer.append(row_groups_);
+  core::PutFixed32(&footer,
+                   crc32c::Mask(crc32c::Value(footer.data(), footer.size())));
+  core::PutFixed64(&footer, footer.size() - sizeof(uint32));
+  core::PutFixed64(&footer, kColumnarMagic);
+  return Append(footer);
+}
+
+Status ColumnarReader::Open(Env* env, const string& filename,
+                            std::unique_ptr<ColumnarReader>* reader) {
+  uint64 file_size;
+  TF_RETURN_IF_ERROR(env->GetFileSize(filename, &file_size));
+  std::unique_ptr<RandomAccessFile> file;
+  TF_RETURN_IF_ERROR(env->NewRandomAccessFile(filename, &file));
+  reader->reset(new ColumnarReader(filename, std::move(file)));
+  return (*reader)->ReadFooter(file_size);
+}
+
+Status ColumnarReader::ReadFooter(uint64 file_size) {
+  if (file_size < kTrailerSize) {
+    return errors::DataLoss("File ", filename_, " is too small to be a ",
+                            "columnar file");
+  }
+  char trailer_scratch[kTrailerSize];
+  StringPiece trailer;
+  TF_RETURN_IF_ERROR(file_->Read(file_size - kTrailerSize, kTrailerSize,
+                                 &trailer, trailer_scratch));
+  if (trailer.size() != kTrailerSize ||
+      core::DecodeFixed64(trailer.data() + 12) != kColumnarMagic) {
+    return errors::DataLoss("File ", filename_, " is not a columnar file");
+  }
+  const uint32 footer_crc = core::DecodeFixed32(trailer.data());
+  const uint64 footer_length = core::DecodeFixed64(trailer.data() + 4);
+  if (footer_length > file_size - kTrailerSize) {
+    return errors::DataLoss("Corrupted footer in ", filename_);
+  }
+  string footer_scratch(footer_length, '\0');
+  StringPiece footer;
+  TF_RETURN_IF_ERROR(file_->Read(file_size - kTrailerSize - footer_length,
+                                 footer_length, &footer, &footer_scratch[0]));
+  if (footer.size() != footer_length ||
+      crc32c::Unmask(footer_crc) !=
+          crc32c::Value(footer.data(), footer.size())) {
+    return errors::DataLoss("Corrupted footer in ", filename_);
+  }
+
+  auto corrupted = [this]() {
+    return errors::DataLoss("Corrupted footer in ", filename_);
+  };
+  uint64 num_columns;
+  if (!core::GetVarint64(&footer, &num_columns)) return corrupted();
+  for (uint64 i = 0; i < num_columns; ++i) {
+    ColumnarColumn column;
+    uint64 name_length, dtype, rank;
+    if (!core::GetVarint64(&footer, &name_length) ||
+        footer.size() < name_length) {
+      return corrupted();
+    }
+    column.name = string(footer.data(), name_length);
+    footer.remove_prefix(name_length);
+    if (!core::GetVarint64(&footer, &dtype) ||
+        !core::GetVarint64(&footer, &rank)) {
+      return corrupted();
+    }
+    column.dtype = static_cast<DataType>(dtype);
+    std::vector<int64> dims;
+    for (uint64 d = 0; d < rank; ++d) {
+      uint64 dim;
+      if (!core::GetVarint64(&footer, &dim)) return corrupted();
+      dims.push_back(dim);
+    }
+    TF_RETURN_IF_ERROR(TensorShapeUtils::MakeShape(dims, &column.shape));
+    TF_RETURN_IF_ERROR(CheckSupported(column));
+    columns_.push_back(std::move(column));
+  }
+  uint64 num_row_groups;
+  // Each row group takes at least one byte of the footer.
+  if (!core::GetVarint64(&footer, &num_row_groups) ||
+      num_row_groups > footer.size()) {
+    return corrupted();
+  }
+  // The chunks, each followed by its crc, lie before the footer.
+  const uint64 chunks_end = file_size - kTrailerSize - footer_length;
+  row_groups_.resize(num_row_groups);
+  for (RowGroup& row_group : row_groups_) {
+    uint64 num_rows;
+    if (!core::GetVarint64(&footer, &num_rows) || num_rows > kint64max) {
+      return corrupted();
+    }
+    row_group.num_rows = num_rows;
+    row_group.chunks.resize(num_columns);
+    for (uint64 i = 0; i < num_columns; ++i) {
+      uint64 offset, size;
+      if (!core::GetVarint64(&footer, &offset) ||
+          !core::GetVarint64(&footer, &size) || offset > chunks_end ||
+          size > chunks_end - offset ||
+          sizeof(uint32) > chunks_end - offset - size) {
+        return corrupted();
+      }
+      TF_RETURN_IF_ERROR(CheckChunkSize(columns_[i], num_rows, size));
+      row_group.chunks[i] = {offset, size};
+    }
+  }
+  return Status::OK();
+}
+
+Status ColumnarReader::CheckChunkSize(const ColumnarColumn& column,
+                                      uint64 num_rows, uint64 size) const {
+  std::vector<int64> dims = {static_cast<int64>(num_rows)};
+  for (int64 dim : column.shape.dim_sizes()) {
+    dims.push_back(dim);
+  }
+  TensorShape shape;
+  if (!TensorShapeUtils::MakeShape(dims, &shape).ok()) {
+    return errors::DataLoss("Row group of ", num_rows, " rows in ", filename_,
+                            " is too large for column ", column.name);
+  }
+  const uint64 num_elements = shape.num_elements();
+  bool valid;
+  if (column.dtype == DT_STRING) {
+    // A string value takes at least the one byte of its length.
+    valid = size >= num_elements;
+  } else {
+    const uint64 element_size = DataTypeSize(column.dtype);
+    valid = size % element_size == 0 && size / element_size == num_elements;
+  }
+  if (!valid) {
+    return errors::DataLoss("Chunk of column ", column.name, " in ",
+                            filename_, " has ", size, " bytes for ", num_rows,
+                            " rows");
+  }
+  return Status::OK();
+}
+
+Status ColumnarReader::LookupColumn(StringPiece name, int* index) const {
+  for (size_t i = 0; i < columns_.size(); ++i) {
+    if (columns_[i].name == name) {
+      *index = i;
+      return Status::OK();
+    }
+  }
+  return errors::NotFound("Column ", name, " not found in ", filename_);
+}
+
+Status ColumnarReader::ReadColumn(int64 row_group, int column,
+                                  Tensor* values) const {
+  const RowGroup& group = row_groups_[row_group];
+  const ColumnarColumn& spec = columns_[column];
+  const uint64 offset = group.chunks[column].first;
+  const uint64 size = group.chunks[column].second;
+  TensorShape shape({group.num_rows});
+  shape.AppendShape(spec.shape);
+  *values = Tensor(spec.dtype, shape);
+
+  // Numeric chunks are read straight into the tensor.
+  string scratch;
+  char* buffer;
+  if (spec.dtype == DT_STRING) {
+    scratch.resize(size);
+    buffer = &scratch[0];
+  } else {
+    if (size != values->TotalBytes()) {
+      return errors::DataLoss("Chunk of column ", spec.name, " in ",
+                              filename_, " has ", size, " bytes, expected ",
+                              values->TotalBytes());
+    }
+    buffer = const_cast<char*>(values->tensor_data().data());
+  }
+  StringPiece data;
+  TF_RETURN_IF_ERROR(file_->Read(offset, size, &data, buffer));
+  if (data.size() != size) {
+    return errors::DataLoss("Truncated chunk of column ", spec.name, " in ",
+                            filename_);
+  }
+  char crc_scratch[sizeof(uint32)];
+  StringPiece crc;
+  TF_RETURN_IF_ERROR(
+      file_->Read(offset + size, sizeof(uint32), &crc, crc_scratch));
+  if (crc.size() != sizeof(uint32) ||
+      crc32c::Unmask(core::DecodeFixed32(crc.data())) !=
+          crc32c::Value(data.data(), data.size())) {
+    return errors::DataLoss("Checksum mismatch in chunk of column ",
+                            spec.name, " in ", filename_);
+  }
+
+  if (spec.dtype != DT_STRING) {
+    if (data.data() != buffer && size > 0) {
+      std::memcpy(buffer, data.data(), size);
+    }
+    return Status::OK();
+  }
+  auto strings = values->flat<string>();
+  for (int64 i = 0; i < strings.size(); ++i) {
+    uint64 length;
+    if (!core::GetVarint64(&data, &length) || data.size() < length) {
+      return errors::DataLoss("Corrupted chunk of column ", spec.name, " in ",
+                              filename_);
+    }
+    strings(i).assign(data.data(), length);
+    data.remove_prefix(length);
+  }
+  return Status::OK();
+}
+
+}  // namespace tensorflow
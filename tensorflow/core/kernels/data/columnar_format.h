@@ -0,0 +1,140 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_KERNELS_DATA_COLUMNAR_FORMAT_H_
+#define TENSORFLOW_CORE_KERNELS_DATA_COLUMNAR_FORMAT_H_
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/file_system.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// A columnar file stores a table of rows, each with one fixed-shape tensor
+// per column. Rows are grouped into row groups, and within a row group the
+// values of each column are stored contiguously in a column chunk, so that a
+// reader can read and decode the columns it needs and skip the others.
+//
+// file       := chunk* footer footer_crc:fixed32 footer_length:fixed64
+//               magic:fixed64
+// chunk      := data chunk_crc:fixed32
+// footer     := num_columns:varint64 column* num_row_groups:varint64
+//               row_group*
+// column     := name_length:varint64 name dtype:varint64 rank:varint64
+//               dim:varint64*
+// row_group  := num_rows:varint64 (chunk_offset:varint64
+//               chunk_size:varint64){num_columns}
+//
+// The data of a chunk holds the values of `num_rows` rows. For numeric
+// columns it is the row-major little-endian encoding of the tensor of shape
+// [num_rows] + column shape; for string columns it is a varint64 length
+// followed by the bytes of each value. The crcs are masked crc32c checksums
+// of the chunk data and of the footer.
+struct ColumnarColumn {
+  string name;
+  DataType dtype;
+  // The shape of the value of the column in each row.
+  TensorShape shape;
+};
+
+// Writes a columnar file. Not thread-safe.
+class ColumnarWriter {
+ public:
+  // Writes to `file`, which must outlive this writer, and buffers up to
+  // `rows_per_group` rows in memory before writing them as a row group.
+  ColumnarWriter(WritableFile* file, std::vector<ColumnarColumn> columns,
+                 int64 rows_per_group);
+
+  // Adds a row, with one value for each column.
+  Status Add(const std::vector<Tensor>& values);
+
+  // Writes the buffered rows and the footer. The writer cannot be used
+  // afterwards. The caller is responsible for closing the file.
+  Status Finish();
+
+ private:
+  Status FlushRowGroup();
+  Status Append(StringPiece data);
+
+  WritableFile* const file_;  // Not owned.
+  const std::vector<ColumnarColumn> columns_;
+  const int64 rows_per_group_;
+  uint64 offset_ = 0;
+  bool finished_ = false;
+  // The encoded chunks of the buffered rows, one per column.
+  std::vector<string> chunks_;
+  int64 num_buffered_rows_ = 0;
+  // The encoded row groups of the footer.
+  string row_groups_;
+  int64 num_row_groups_ = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ColumnarWriter);
+};
+
+// Reads a columnar file. Thread-safe.
+class ColumnarReader {
+ public:
+  // Opens `filename` and reads its footer.
+  static Status Open(Env* env, const string& filename,
+                     std::unique_ptr<ColumnarReader>* reader);
+
+  const std::vector<ColumnarColumn>& columns() const { return columns_; }
+
+  // Sets `*index` to the index of the column named `name`.
+  Status LookupColumn(StringPiece name, int* index) const;
+
+  int64 num_row_groups() const { return row_groups_.size(); }
+  int64 num_rows(int64 row_group) const {
+    return row_groups_[row_group].num_rows;
+  }
+
+  // Reads and decodes only the chunk of `column` in `row_group` into
+  // `*values`, a tensor of shape [num_rows(row_group)] + column shape.
+  Status ReadColumn(int64 row_group, int column, Tensor* values) const;
+
+ private:
+  struct RowGroup {
+    int64 num_rows;
+    // The offset and size of the chunk of each column.
+    std::vector<std::pair<uint64, uint64>> chunks;
+  };
+
+  ColumnarReader(const string& filename, std::unique_ptr<RandomAccessFile> file)
+      : filename_(filename), file_(std::move(file)) {}
+
+  Status ReadFooter(uint64 file_size);
+  // Checks that a chunk of `size` bytes can hold `num_rows` rows of `column`.
+  Status CheckChunkSize(const ColumnarColumn& column, uint64 num_rows,
+                        uint64 size) const;
+
+  const string filename_;
+  const std::unique_ptr<RandomAccessFile> file_;
+  std::vector<ColumnarColumn> columns_;
+  std::vector<RowGroup> row_groups_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ColumnarReader);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_DATA_COLUMNAR_FORMAT_H_
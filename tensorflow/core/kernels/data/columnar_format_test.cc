@@ -0,0 +1,214 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/data/columnar_format.h"
+
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/coding.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/hash/crc32c.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+std::vector<ColumnarColumn> TestColumns() {
+  return {{"ids", DT_INT64, TensorShape({})},
+          {"values", DT_FLOAT, TensorShape({2})},
+          {"names", DT_STRING, TensorShape({})}};
+}
+
+// Writes `num_rows` rows where row `i` is {i, [i, -i], "name<i>"}.
+void WriteTestFile(const string& fname, int64 num_rows,
+                   int64 rows_per_group) {
+  std::unique_ptr<WritableFile> file;
+  TF_ASSERT_OK(Env::Default()->NewWritableFile(fname, &file));
+  ColumnarWriter writer(file.get(), TestColumns(), rows_per_group);
+  for (int64 i = 0; i < num_rows; ++i) {
+    Tensor values(DT_FLOAT, TensorShape({2}));
+    values.vec<float>()(0) = i;
+    values.vec<float>()(1) = -i;
+    Tensor name = test::AsScalar<string>(strings::StrCat("name", i));
+    TF_ASSERT_OK(writer.Add({test::AsScalar<int64>(i), values, name}));
+  }
+  TF_ASSERT_OK(writer.Finish());
+  TF_ASSERT_OK(file->Close());
+}
+
+TEST(ColumnarFormatTest, RoundTrip) {
+  const string fname = testing::TmpDir() + "/columnar_round_trip";
+  WriteTestFile(fname, 10, 4);
+
+  std::unique_ptr<ColumnarReader> reader;
+  TF_ASSERT_OK(ColumnarReader::Open(Env::Default(), fname, &reader));
+  ASSERT_EQ(3, reader->columns().size());
+  EXPECT_EQ("values", reader->columns()[1].name);
+  EXPECT_EQ(DT_FLOAT, reader->columns()[1].dtype);
+  EXPECT_EQ(TensorShape({2}), reader->columns()[1].shape);
+  ASSERT_EQ(3, reader->num_row_groups());
+  EXPECT_EQ(4, reader->num_rows(0));
+  EXPECT_EQ(4, reader->num_rows(1));
+  EXPECT_EQ(2, reader->num_rows(2));
+
+  int64 row = 0;
+  for (int64 g = 0; g < reader->num_row_groups(); ++g) {
+    Tensor ids, values, names;
+    TF_ASSERT_OK(reader->ReadColumn(g, 0, &ids));
+    TF_ASSERT_OK(reader->ReadColumn(g, 1, &values));
+    TF_ASSERT_OK(reader->ReadColumn(g, 2, &names));
+    EXPECT_EQ(TensorShape({reader->num_rows(g), 2}), values.shape());
+    for (int64 i = 0; i < reader->num_rows(g); ++i, ++row) {
+      EXPECT_EQ(row, ids.vec<int64>()(i));
+      EXPECT_EQ(row, values.matrix<float>()(i, 0));
+      EXPECT_EQ(-row, values.matrix<float>()(i, 1));
+      EXPECT_EQ(strings::StrCat("name", row), names.vec<string>()(i));
+    }
+  }
+  EXPECT_EQ(10, row);
+}
+
+TEST(ColumnarFormatTest, ReadSingleColumn) {
+  const string fname = testing::TmpDir() + "/columnar_single_column";
+  WriteTestFile(fname, 5, 100);
+
+  std::unique_ptr<ColumnarReader> reader;
+  TF_ASSERT_OK(ColumnarReader::Open(Env::Default(), fname, &reader));
+  int index;
+  TF_ASSERT_OK(reader->LookupColumn("names", &index));
+  EXPECT_EQ(2, index);
+  EXPECT_TRUE(errors::IsNotFound(reader->LookupColumn("missing", &index)));
+
+  ASSERT_EQ(1, reader->num_row_groups());
+  Tensor names;
+  TF_ASSERT_OK(reader->ReadColumn(0, index, &names));
+  test::ExpectTensorEqual<string>(
+      names, test::AsTensor<string>({"name0", "name1", "name2", "name3",
+                                     "name4"}));
+}
+
+TEST(ColumnarFormatTest, Empty) {
+  const string fname = testing::TmpDir() + "/columnar_empty";
+  WriteTestFile(fname, 0, 4);
+
+  std::unique_ptr<ColumnarReader> reader;
+  TF_ASSERT_OK(ColumnarReader::Open(Env::Default(), fname, &reader));
+  EXPECT_EQ(3, reader->columns().size());
+  EXPECT_EQ(0, reader->num_row_groups());
+}
+
+TEST(ColumnarFormatTest, InvalidRow) {
+  const string fname = testing::TmpDir() + "/columnar_invalid_row";
+  std::unique_ptr<WritableFile> file;
+  TF_ASSERT_OK(Env::Default()->NewWritableFile(fname, &file));
+  ColumnarWriter writer(file.get(), TestColumns(), 4);
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      writer.Add({test::AsScalar<int64>(0)})));
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      writer.Add({test::AsScalar<int64>(0), test::AsScalar<float>(0),
+                  test::AsScalar<string>("a")})));
+  TF_ASSERT_OK(writer.Finish());
+  EXPECT_TRUE(errors::IsFailedPrecondition(writer.Finish()));
+}
+
+TEST(ColumnarFormatTest, CorruptedChunk) {
+  const string fname = testing::TmpDir() + "/columnar_corrupted_chunk";
+  WriteTestFile(fname, 4, 4);
+  string contents;
+  TF_ASSERT_OK(ReadFileToString(Env::Default(), fname, &contents));
+  // The first chunk holds the ids.
+  contents[0] ^= 1;
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), fname, contents));
+
+  std::unique_ptr<ColumnarReader> reader;
+  TF_ASSERT_OK(ColumnarReader::Open(Env::Default(), fname, &reader));
+  Tensor values;
+  EXPECT_TRUE(errors::IsDataLoss(reader->ReadColumn(0, 0, &values)));
+  TF_EXPECT_OK(reader->ReadColumn(0, 1, &values));
+}
+
+TEST(ColumnarFormatTest, CorruptedFooter) {
+  const string fname = testing::TmpDir() + "/columnar_corrupted_footer";
+  WriteTestFile(fname, 4, 4);
+  string contents;
+  TF_ASSERT_OK(ReadFileToString(Env::Default(), fname, &contents));
+
+  string corrupted = contents;
+  corrupted[corrupted.size() - 21] ^= 1;
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), fname, corrupted));
+  std::unique_ptr<ColumnarReader> reader;
+  EXPECT_TRUE(
+      errors::IsDataLoss(ColumnarReader::Open(Env::Default(), fname, &reader)));
+
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), fname,
+                                 contents.substr(0, contents.size() - 1)));
+  EXPECT_TRUE(
+      errors::IsDataLoss(ColumnarReader::Open(Env::Default(), fname, &reader)));
+}
+
+// Writes a file with a single int64 column and one row group of `num_rows`
+// rows, whose footer points at a chunk of `chunk_size` bytes at
+// `chunk_offset`. The footer itself has a valid checksum.
+void WriteFileWithRowGroup(const string& fname, uint64 num_rows,
+                           uint64 chunk_offset, uint64 chunk_size) {
+  string contents;
+  core::PutFixed64(&contents, 7);
+  core::PutFixed32(&contents, crc32c::Mask(crc32c::Value(contents.data(),
+                                                         contents.size())));
+  string footer;
+  core::PutVarint64(&footer, 1);
+  core::PutVarint64(&footer, 3);
+  footer.append("ids");
+  core::PutVarint64(&footer, DT_INT64);
+  core::PutVarint64(&footer, 0);
+  core::PutVarint64(&footer, 1);
+  core::PutVarint64(&footer, num_rows);
+  core::PutVarint64(&footer, chunk_offset);
+  core::PutVarint64(&footer, chunk_size);
+  core::PutFixed32(&footer,
+                   crc32c::Mask(crc32c::Value(footer.data(), footer.size())));
+  core::PutFixed64(&footer, footer.size() - sizeof(uint32));
+  contents.append(footer);
+  core::PutFixed64(&contents, 0x4e4d554c4f43u);
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), fname, contents));
+}
+
+TEST(ColumnarFormatTest, CorruptedRowGroup) {
+  const string fname = testing::TmpDir() + "/columnar_corrupted_row_group";
+  std::unique_ptr<ColumnarReader> reader;
+
+  WriteFileWithRowGroup(fname, 1, 0, 8);
+  TF_ASSERT_OK(ColumnarReader::Open(Env::Default(), fname, &reader));
+  Tensor values;
+  TF_ASSERT_OK(reader->ReadColumn(0, 0, &values));
+  test::ExpectTensorEqual<int64>(test::AsTensor<int64>({7}), values);
+
+  // More rows than the chunk holds.
+  WriteFileWithRowGroup(fname, 2, 0, 8);
+  EXPECT_TRUE(
+      errors::IsDataLoss(ColumnarReader::Open(Env::Default(), fname, &reader)));
+  // A number of rows that overflows the shape of the column.
+  WriteFileWithRowGroup(fname, uint64{1} << 63, 0, 8);
+  EXPECT_TRUE(
+      errors::IsDataLoss(ColumnarReader::Open(Env::Default(), fname, &reader)));
+  // A chunk past the end of the file.
+  WriteFileWithRowGroup(fname, 1, 8, 8);
+  EXPECT_TRUE(
+      errors::IsDataLoss(ColumnarReader::Open(Env::Default(), fname, &reader)));
+}
+
+}  // namespace
+}  // namespace tensorflow
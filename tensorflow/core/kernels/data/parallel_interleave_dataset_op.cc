@@ -28,6 +28,10 @@ namespace tensorflow {
 
 namespace {
 
+// The largest per-worker buffer size that the model of the pipeline may
+// choose.
+constexpr int64 kMaxBufferSize = 64;
+
 // See documentation in ../ops/dataset_ops.cc for a high-level
 // description of the following op.
 
@@ -70,7 +74,9 @@ class ParallelInterleaveDatasetOp : public UnaryDatasetOpKernel {
     OP_REQUIRES_OK(ctx, ParseScalarArgument(ctx, "buffer_output_elements",
                                             &buffer_output_elements));
     OP_REQUIRES(
-        ctx, buffer_output_elements > 0,
+        ctx,
+        buffer_output_elements > 0 ||
+            buffer_output_elements == model::kAutoTune,
         errors::InvalidArgument("`buffer_output_elements` must be > 0"));
 
     int64 prefetch_input_elements = 0;
@@ -250,6 +256,27 @@ class ParallelInterleaveDatasetOp : public UnaryDatasetOpKernel {
       }
 
       Status Initialize(IteratorContext* ctx) override {
+        const int64 default_buffer_size = 2 * dataset()->block_length_;
+        if (dataset()->buffer_output_elements_ == model::kAutoTune) {
+          buffer_size_ = AddTunableParameter(
+              "buffer_size", std::min(default_buffer_size, kMaxBufferSize),
+              /*min=*/1, kMaxBufferSize);
+          if (!buffer_size_) {
+            // The pipeline is not modeled, so use the default of
+            // `tf.contrib.data.parallel_interleave()`.
+            fixed_buffer_size_ = default_buffer_size;
+          }
+        } else {
+          fixed_buffer_size_ = dataset()->buffer_output_elements_;
+        }
+        if (model_node()) {
+          // The cycle length determines the results, so it is not tuned.
+          model_node()->set_type(model::Node::Type::kAsyncInterleave);
+          model_node()->set_parameter("parallelism", dataset()->cycle_length_);
+          if (!buffer_size_) {
+            model_node()->set_parameter("buffer_size", fixed_buffer_size_);
+          }
+        }
         TF_RETURN_IF_ERROR(
             dataset()->input_->MakeIterator(ctx, prefix(), &input_impl_));
         return dataset()->captured_func_->Instantiate(ctx);
@@ -349,11 +376,13 @@ class ParallelInterleaveDatasetOp : public UnaryDatasetOpKernel {
 
           if (must_wait_for_input) {
             // Wait for elements to become available.
+            RecordWaitStart(ctx);
             if (dataset()->sloppy_) {
               sloppy_cond_var_.wait(l);
             } else {
               workers_[interleave_indices_[next_index_]].cond_var.wait(l);
             }
+            RecordWaitStop(ctx);
           }
         }
         return errors::Cancelled(
@@ -568,6 +597,12 @@ class ParallelInterleaveDatasetOp : public UnaryDatasetOpKernel {
         WorkerThreadState() : output_elem(Status::OK()) {}
       };
 
+      // Returns the number of elements each worker may buffer, which the
+      // model of the pipeline may change between calls.
+      int64 BufferOutputElements() {
+        return buffer_size_ ? buffer_size_->value() : fixed_buffer_size_;
+      }
+
       Status EnsureWorkerThreadsStarted(IteratorContext* ctx)
           EXCLUSIVE_LOCKS_REQUIRED(mu_) {
         if (worker_threads_.empty()) {
@@ -711,8 +746,8 @@ class ParallelInterleaveDatasetOp : public UnaryDatasetOpKernel {
           if (!iterator_creation_status.ok()) {
             mutex_lock l(mu_);
             // Wait for space in the prefetch queue.
-            while (!cancelled_ && workers_[thread_index].outputs.size() ==
-                                      dataset()->buffer_output_elements_) {
+            while (!cancelled_ && workers_[thread_index].outputs.size() >=
+                                      BufferOutputElements()) {
               workers_[thread_index].cond_var.wait(l);
             }
             if (cancelled_) return;
@@ -737,12 +772,14 @@ class ParallelInterleaveDatasetOp : public UnaryDatasetOpKernel {
                     worker_thread_states_[thread_index]
                         .output_elem.output.empty() &&
                     !worker_thread_states_[thread_index].end_of_sequence) {
+                  RecordStart(ctx.get());
                   worker_thread_states_[thread_index].output_elem.status =
                       worker_thread_states_[thread_index].iterator->GetNext(
                           ctx.get(),
                           &worker_thread_states_[thread_index]
                                .output_elem.output,
                           &worker_thread_states_[thread_index].end_of_sequence);
+                  RecordStop(ctx.get());
                   end_of_sequence =
                       worker_thread_states_[thread_index].end_of_sequence;
                 } else {
@@ -760,8 +797,8 @@ class ParallelInterleaveDatasetOp : public UnaryDatasetOpKernel {
                 mutex_lock l(mu_);
 
                 // Wait for space in the prefetch queue.
-                while (!cancelled_ && workers_[thread_index].outputs.size() ==
-                                          dataset()->buffer_output_elements_) {
+                while (!cancelled_ && workers_[thread_index].outputs.size() >=
+                                          BufferOutputElements()) {
                   workers_[thread_index].cond_var.wait(l);
                 }
                 if (cancelled_) return;
@@ -1016,6 +1053,11 @@ class ParallelInterleaveDatasetOp : public UnaryDatasetOpKernel {
       // `ckpt_mu_` in either shared or exclusive modes.
       mutex ckpt_mu_;
 
+      // The number of elements each worker buffers, or `buffer_size_` if set
+      // by the model of the pipeline.
+      int64 fixed_buffer_size_ = 0;
+      std::shared_ptr<model::Parameter> buffer_size_;
+
       // The iterator producing elements which are converted to datasets by
       // the dataset()->captured_func_ then interleaved together.
       // input_impl_ is reset when we have exhausted its input.
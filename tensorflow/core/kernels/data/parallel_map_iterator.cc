@@ -19,6 +19,8 @@ limitations under the License.
 #include <utility>
 #include <vector>
 
+#include "tensorflow/core/platform/cpu_info.h"
+
 namespace tensorflow {
 namespace {
 
@@ -52,6 +54,20 @@ class ParallelMapIterator : public DatasetBaseIterator {
   }
 
   Status Initialize(IteratorContext* ctx) override {
+    if (num_parallel_calls_ == model::kAutoTune) {
+      parallelism_ = AddTunableParameter("parallelism", /*initial_value=*/1,
+                                         /*min=*/1, port::NumSchedulableCPUs());
+      if (!parallelism_) {
+        // The pipeline is not modeled, so use all the cores.
+        num_parallel_calls_ = port::NumSchedulableCPUs();
+      }
+    }
+    if (model_node()) {
+      model_node()->set_type(model::Node::Type::kAsyncMap);
+      if (!parallelism_) {
+        model_node()->set_parameter("parallelism", num_parallel_calls_);
+      }
+    }
     TF_RETURN_IF_ERROR(
         input_dataset_->MakeIterator(ctx, prefix(), &input_impl_));
     if (init_func_) {
@@ -66,6 +82,7 @@ class ParallelMapIterator : public DatasetBaseIterator {
     {
       mutex_lock l(mu_);
       EnsureRunnerThreadStarted(ctx);
+      RecordWaitStart(ctx);
       while (invocation_results_.empty()) {
         cond_var_.wait(l);
       }
@@ -74,6 +91,7 @@ class ParallelMapIterator : public DatasetBaseIterator {
     }
     cond_var_.notify_all();
     result->notification.WaitForNotification();
+    RecordWaitStop(ctx);
     return ProcessResult(result, out_tensors, end_of_sequence);
   }
 
@@ -195,7 +213,11 @@ class ParallelMapIterator : public DatasetBaseIterator {
     // Call `func_(input_element)`, store the result in
     // `result->return_values`, and notify `result->notification` to unblock
     // a consumer.
-    auto done = [this, result](Status status) {
+    const int64 start_time = model_node() ? ctx->env()->NowNanos() : 0;
+    auto done = [this, ctx, result, start_time](Status status) {
+      if (model_node()) {
+        model_node()->add_processing_time(ctx->env()->NowNanos() - start_time);
+      }
       result->status.Update(status);
       CallCompleted(result);
     };
@@ -204,7 +226,13 @@ class ParallelMapIterator : public DatasetBaseIterator {
               std::move(done));
   }
 
-  int64 MaxInvocationResults() { return num_parallel_calls_; }
+  // Returns the current number of parallel calls, which the model of the
+  // pipeline may change at any time if it is tuned.
+  int64 NumParallelCalls() {
+    return parallelism_ ? parallelism_->value() : num_parallel_calls_;
+  }
+
+  int64 MaxInvocationResults() { return NumParallelCalls(); }
 
   Status ProcessResult(const std::shared_ptr<InvocationResult>& result,
                        std::vector<Tensor>* out_tensors,
@@ -226,19 +254,19 @@ class ParallelMapIterator : public DatasetBaseIterator {
 
   void RunnerThread(const std::shared_ptr<IteratorContext>& ctx) {
     std::vector<std::shared_ptr<InvocationResult>> new_calls;
-    new_calls.reserve(num_parallel_calls_);
+    new_calls.reserve(NumParallelCalls());
     while (true) {
       {
         mutex_lock l(mu_);
         while (!cancelled_ &&
-               (num_calls_ >= num_parallel_calls_ ||
+               (num_calls_ >= NumParallelCalls() ||
                 invocation_results_.size() >= MaxInvocationResults())) {
           cond_var_.wait(l);
         }
         if (cancelled_) {
           return;
         }
-        while (num_calls_ < num_parallel_calls_ &&
+        while (num_calls_ < NumParallelCalls() &&
                invocation_results_.size() < MaxInvocationResults()) {
           invocation_results_.emplace_back(new InvocationResult());
           new_calls.push_back(invocation_results_.back());
@@ -294,7 +322,10 @@ class ParallelMapIterator : public DatasetBaseIterator {
   const DatasetBase* const input_dataset_;  // Not owned.
   const std::function<Status(IteratorContext*)> init_func_;
   const ParallelMapIteratorFunction map_func_;
-  const int32 num_parallel_calls_;
+  // Either a positive number of parallel calls, or `model::kAutoTune` if
+  // `parallelism_` determines it.
+  int32 num_parallel_calls_;
+  std::shared_ptr<model::Parameter> parallelism_;
   // Used for coordination between the main thread and the runner thread.
   mutex mu_;
   // Used for coordination between the main thread and the runner thread. In
@@ -37,6 +37,10 @@ using ParallelMapIteratorFunction =
 // specified) will be executed when the iterator is initialized (see
 // `IteratorBase::Initialize()`) and enables the user to specify error checking
 // logic that can fail early.
+//
+// If `num_parallel_calls` is `model::kAutoTune`, the degree of parallelism is
+// tuned by the performance model of the pipeline, or is the number of
+// schedulable CPUs if the pipeline is not modeled.
 std::unique_ptr<IteratorBase> NewParallelMapIterator(
     const DatasetBaseIterator::BaseParams& params,
     const DatasetBase* input_dataset,
@@ -22,6 +22,13 @@ limitations under the License.
 
 namespace tensorflow {
 
+namespace {
+
+// The largest buffer size that the model of the pipeline may choose.
+constexpr int64 kMaxBufferSize = 64;
+
+}  // namespace
+
 // See documentation in ../ops/dataset_ops.cc for a high-level
 // description of the following op.
 
@@ -89,6 +96,16 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
     }
 
     Status Initialize(IteratorContext* ctx) override {
+      if (model_node()) {
+        model_node()->set_type(model::Node::Type::kPrefetch);
+        if (dataset()->buffer_size_ == PrefetchAutotuner::kAutoTune) {
+          // The model replaces `auto_tuner_`.
+          buffer_size_ = AddTunableParameter(
+              "buffer_size", /*initial_value=*/1, /*min=*/1, kMaxBufferSize);
+        } else {
+          model_node()->set_parameter("buffer_size", dataset()->buffer_size_);
+        }
+      }
       return dataset()->input_->MakeIterator(ctx, prefix(), &input_impl_);
     }
 
@@ -100,11 +117,13 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
         TF_RETURN_IF_ERROR(EnsurePrefetchThreadStarted(ctx));
         // Wait until the next element in the buffer has been
         // produced, or we are shutting down.
+        RecordWaitStart(ctx);
         while (!cancelled_ && buffer_.empty() && !prefetch_thread_finished_ &&
-               auto_tuner_.buffer_limit() != 0) {
+               BufferLimit() != 0) {
           auto_tuner_.RecordEmpty();
           cond_var_.wait(l);
         }
+        RecordWaitStop(ctx);
 
         if (cancelled_) {
           return errors::Cancelled(
@@ -120,7 +139,7 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
           return Status::OK();
         }
 
-        DCHECK_EQ(auto_tuner_.buffer_limit(), 0);
+        DCHECK_EQ(BufferLimit(), 0);
       }
 
       mutex_lock parent_l(parent_mu_);
@@ -200,6 +219,12 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
       std::vector<Tensor> value;
     };
 
+    // Returns the maximum number of elements to buffer, which the model of
+    // the pipeline or `auto_tuner_` may change between calls.
+    int64 BufferLimit() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      return buffer_size_ ? buffer_size_->value() : auto_tuner_.buffer_limit();
+    }
+
     Status Consume(std::vector<Tensor>* out_tensors, bool* end_of_sequence)
         EXCLUSIVE_LOCKS_REQUIRED(mu_) {
       // A new element is available. Forward the status from computing it, and
@@ -243,7 +268,7 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
         // 1. Wait for a slot in the buffer.
         {
           mutex_lock l(mu_);
-          while (!cancelled_ && buffer_.size() >= auto_tuner_.buffer_limit()) {
+          while (!cancelled_ && buffer_.size() >= BufferLimit()) {
             cond_var_.wait(l);
           }
 
@@ -325,6 +350,8 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
     std::unique_ptr<IteratorBase> input_impl_ GUARDED_BY(parent_mu_);
     condition_variable cond_var_;
     PrefetchAutotuner auto_tuner_ GUARDED_BY(mu_);
+    // Set if the buffer size is tuned by the model of the pipeline.
+    std::shared_ptr<model::Parameter> buffer_size_;
     std::deque<BufferElement> buffer_ GUARDED_BY(mu_);
     std::unique_ptr<Thread> prefetch_thread_ GUARDED_BY(mu_);
     bool cancelled_ GUARDED_BY(mu_) = false;
@@ -14,6 +14,7 @@ limitations under the License.
 ==============================================================================*/
 
 #include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/kernels/data/columnar_format.h"
 #include "tensorflow/core/kernels/data/dataset.h"
 #include "tensorflow/core/kernels/data/dataset_utils.h"
 #include "tensorflow/core/kernels/ops_util.h"
@@ -25,6 +26,18 @@ namespace tensorflow {
 
 namespace {
 
+template <typename T>
+Status ParseScalarArgument(OpKernelContext* ctx,
+                           const StringPiece& argument_name, T* output) {
+  const Tensor* argument_t;
+  TF_RETURN_IF_ERROR(ctx->input(argument_name, &argument_t));
+  if (!TensorShapeUtils::IsScalar(argument_t->shape())) {
+    return errors::InvalidArgument(argument_name, " must be a scalar");
+  }
+  *output = argument_t->scalar<T>()();
+  return Status::OK();
+}
+
 class ToTFRecordOp : public AsyncOpKernel {
  public:
   explicit ToTFRecordOp(OpKernelConstruction* ctx)
@@ -34,18 +47,6 @@ class ToTFRecordOp : public AsyncOpKernel {
             strings::StrCat("to_tf_record__op_", SanitizeThreadSuffix(name())),
             1 /* num_threads */, false /* low_latency_hint */)) {}
 
-  template <typename T>
-  Status ParseScalarArgument(OpKernelContext* ctx,
-                             const StringPiece& argument_name, T* output) {
-    const Tensor* argument_t;
-    TF_RETURN_IF_ERROR(ctx->input(argument_name, &argument_t));
-    if (!TensorShapeUtils::IsScalar(argument_t->shape())) {
-      return errors::InvalidArgument(argument_name, " must be a scalar");
-    }
-    *output = argument_t->scalar<T>()();
-    return Status::OK();
-  }
-
   void ComputeAsync(OpKernelContext* ctx, DoneCallback done) override {
     // The call to `iterator->GetNext()` may block and depend on an
     // inter-op thread pool thread, so we issue the call from the
@@ -103,5 +104,101 @@ class ToTFRecordOp : public AsyncOpKernel {
 REGISTER_KERNEL_BUILDER(Name("DatasetToTFRecord").Device(DEVICE_CPU),
                         ToTFRecordOp);
 
+class ToColumnarFileOp : public AsyncOpKernel {
+ public:
+  explicit ToColumnarFileOp(OpKernelConstruction* ctx)
+      : AsyncOpKernel(ctx),
+        thread_pool_(new thread::ThreadPool(
+            ctx->env(), ThreadOptions(),
+            strings::StrCat("to_columnar_file_op_",
+                            SanitizeThreadSuffix(name())),
+            1 /* num_threads */, false /* low_latency_hint */)) {}
+
+  void ComputeAsync(OpKernelContext* ctx, DoneCallback done) override {
+    // The call to `iterator->GetNext()` may block and depend on an
+    // inter-op thread pool thread, so we issue the call from the
+    // owned thread pool.
+    thread_pool_->Schedule([this, ctx, done]() {
+      string filename;
+      OP_REQUIRES_OK_ASYNC(
+          ctx, ParseScalarArgument<string>(ctx, "filename", &filename), done);
+      int64 rows_per_group;
+      OP_REQUIRES_OK_ASYNC(ctx,
+                           ParseScalarArgument<int64>(ctx, "rows_per_group",
+                                                      &rows_per_group),
+                           done);
+      OP_REQUIRES_ASYNC(
+          ctx, rows_per_group > 0,
+          errors::InvalidArgument("rows_per_group must be greater than zero."),
+          done);
+      const Tensor* column_names_t;
+      OP_REQUIRES_OK_ASYNC(ctx, ctx->input("column_names", &column_names_t),
+                           done);
+      OP_REQUIRES_ASYNC(
+          ctx, TensorShapeUtils::IsVector(column_names_t->shape()),
+          errors::InvalidArgument("column_names must be a vector"), done);
+
+      DatasetBase* dataset;
+      OP_REQUIRES_OK_ASYNC(
+          ctx, GetDatasetFromVariantTensor(ctx->input(0), &dataset), done);
+      const int64 num_columns = column_names_t->NumElements();
+      OP_REQUIRES_ASYNC(
+          ctx, num_columns == dataset->output_dtypes().size(),
+          errors::InvalidArgument("Expected ",
+                                  dataset->output_dtypes().size(),
+                                  " column names but got ", num_columns),
+          done);
+      std::vector<ColumnarColumn> columns(num_columns);
+      for (int64 i = 0; i < num_columns; ++i) {
+        columns[i].name = column_names_t->vec<string>()(i);
+        columns[i].dtype = dataset->output_dtypes()[i];
+        OP_REQUIRES_ASYNC(
+            ctx, dataset->output_shapes()[i].AsTensorShape(&columns[i].shape),
+            errors::InvalidArgument(
+                "Column ", columns[i].name,
+                " must have a fully defined shape but has shape ",
+                dataset->output_shapes()[i].DebugString()),
+            done);
+      }
+
+      std::unique_ptr<WritableFile> file;
+      OP_REQUIRES_OK_ASYNC(ctx, ctx->env()->NewWritableFile(filename, &file),
+                           done);
+      ColumnarWriter writer(file.get(), std::move(columns), rows_per_group);
+
+      std::unique_ptr<IteratorBase> iterator;
+      OP_REQUIRES_OK_ASYNC(
+          ctx,
+          dataset->MakeIterator(IteratorContext(ctx),
+                                "ToColumnarFileOpIterator", &iterator),
+          done);
+
+      std::vector<Tensor> components;
+      components.reserve(num_columns);
+      bool end_of_sequence;
+      do {
+        OP_REQUIRES_OK_ASYNC(ctx,
+                             iterator->GetNext(IteratorContext(ctx),
+                                               &components, &end_of_sequence),
+                             done);
+
+        if (!end_of_sequence) {
+          OP_REQUIRES_OK_ASYNC(ctx, writer.Add(components), done);
+        }
+        components.clear();
+      } while (!end_of_sequence);
+      OP_REQUIRES_OK_ASYNC(ctx, writer.Finish(), done);
+      OP_REQUIRES_OK_ASYNC(ctx, file->Close(), done);
+      done();
+    });
+  }
+
+ private:
+  std::unique_ptr<thread::ThreadPool> thread_pool_;
+};
+
+REGISTER_KERNEL_BUILDER(Name("DatasetToColumnarFile").Device(DEVICE_CPU),
+                        ToColumnarFileOp);
+
 }  // namespace
 }  // namespace tensorflow
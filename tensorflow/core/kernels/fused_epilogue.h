@@ -0,0 +1,185 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_FUSED_EPILOGUE_H_
+#define TENSORFLOW_CORE_KERNELS_FUSED_EPILOGUE_H_
+
+#include <cmath>
+#include <vector>
+
+#include "third_party/eigen3/Eigen/Core"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status.h"
+
+namespace tensorflow {
+
+// The elementwise ops that a contraction kernel (_FusedConv2D, _FusedMatMul)
+// applies to each tile of its output right after computing it, while the
+// tile is still in cache, instead of making a pass over the whole output per
+// op.
+//
+// The fused ops are given by the "fused_ops" attribute of the kernel: any
+// number of per-channel affine ops ("BiasAdd" and inference-mode
+// "FusedBatchNorm"), optionally followed by one activation ("Relu", "Relu6"
+// or "Elu"). Their arguments are the trailing inputs of the kernel: one
+// bias vector for "BiasAdd", and the scale, offset, mean and variance
+// vectors for "FusedBatchNorm", whose epsilon is the "epsilon" attribute.
+class FusedEpilogueSpec {
+ public:
+  enum class Op { kBiasAdd, kBatchNorm };
+  enum class Activation { kNone, kRelu, kRelu6, kElu };
+
+  Status Init(OpKernelConstruction* context) {
+    std::vector<string> fused_ops;
+    TF_RETURN_IF_ERROR(context->GetAttr("fused_ops", &fused_ops));
+    TF_RETURN_IF_ERROR(context->GetAttr("epsilon", &epsilon_));
+    int num_args;
+    TF_RETURN_IF_ERROR(context->GetAttr("num_args", &num_args));
+    for (const string& op : fused_ops) {
+      if (activation_ != Activation::kNone) {
+        return errors::InvalidArgument("Fused activation must be the last of ",
+                                       "the fused ops, but got ", op,
+                                       " after it");
+      }
+      if (op == "BiasAdd") {
+        ops_.push_back(Op::kBiasAdd);
+        num_args_ += 1;
+      } else if (op == "FusedBatchNorm") {
+        ops_.push_back(Op::kBatchNorm);
+        num_args_ += 4;
+      } else if (op == "Relu") {
+        activation_ = Activation::kRelu;
+      } else if (op == "Relu6") {
+        activation_ = Activation::kRelu6;
+      } else if (op == "Elu") {
+        activation_ = Activation::kElu;
+      } else {
+        return errors::Unimplemented("Unsupported fused op: ", op);
+      }
+    }
+    if (num_args != num_args_) {
+      return errors::InvalidArgument("Fused ops take ", num_args_,
+                                     " arguments, but num_args is ", num_args);
+    }
+    return Status::OK();
+  }
+
+  int num_args() const { return num_args_; }
+  const std::vector<Op>& ops() const { return ops_; }
+  Activation activation() const { return activation_; }
+  float epsilon() const { return epsilon_; }
+
+ private:
+  std::vector<Op> ops_;
+  Activation activation_ = Activation::kNone;
+  int num_args_ = 0;
+  float epsilon_ = 0.0f;
+};
+
+// The fused ops of one invocation of a kernel, with their affine ops folded
+// into one scale and offset per output channel.
+template <typename T>
+class FusedEpilogue {
+ public:
+  // Folds the arguments of the ops of `spec`, which are the inputs of
+  // `context` starting at `first_arg`, for `num_channels` channels.
+  Status Init(const FusedEpilogueSpec& spec, OpKernelContext* context,
+              int first_arg, int64 num_channels) {
+    num_channels_ = num_channels;
+    activation_ = spec.activation();
+    scale_.assign(num_channels, T(1));
+    offset_.assign(num_channels, T(0));
+    int arg = first_arg;
+    auto get_arg = [context, &arg, num_channels](const char* name,
+                                                 const T** values) -> Status {
+      const Tensor& t = context->input(arg++);
+      if (t.dims() != 1 || t.dim_size(0) != num_channels) {
+        return errors::InvalidArgument("Fused ", name, " must be a vector of ",
+                                       num_channels, " values, but has shape ",
+                                       t.shape().DebugString());
+      }
+      *values = t.flat<T>().data();
+      return Status::OK();
+    };
+    for (FusedEpilogueSpec::Op op : spec.ops()) {
+      if (op == FusedEpilogueSpec::Op::kBiasAdd) {
+        const T* bias;
+        TF_RETURN_IF_ERROR(get_arg("bias", &bias));
+        for (int64 c = 0; c < num_channels; ++c) offset_[c] += bias[c];
+        has_offset_ = true;
+      } else {
+        const T *scale, *offset, *mean, *variance;
+        TF_RETURN_IF_ERROR(get_arg("scale", &scale));
+        TF_RETURN_IF_ERROR(get_arg("offset", &offset));
+        TF_RETURN_IF_ERROR(get_arg("mean", &mean));
+        TF_RETURN_IF_ERROR(get_arg("variance", &variance));
+        // y = (x - mean) * scale / sqrt(variance + epsilon) + offset.
+        const T epsilon = static_cast<T>(spec.epsilon());
+        for (int64 c = 0; c < num_channels; ++c) {
+          const T factor = scale[c] / std::sqrt(variance[c] + epsilon);
+          scale_[c] *= factor;
+          offset_[c] = (offset_[c] - mean[c]) * factor + offset[c];
+        }
+        has_scale_ = has_offset_ = true;
+      }
+    }
+    return Status::OK();
+  }
+
+  // Applies the fused ops to `num_rows` rows of `num_channels` values,
+  // stored contiguously at `data`.
+  void Apply(T* data, int64 num_rows) const {
+    typedef Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> Array;
+    typedef Eigen::Array<T, Eigen::Dynamic, 1> Vector;
+    // Each column of `values` is one row of channels.
+    Eigen::Map<Array> values(data, num_channels_, num_rows);
+    if (has_scale_) {
+      values.colwise() *=
+          Eigen::Map<const Vector>(scale_.data(), num_channels_);
+    }
+    if (has_offset_) {
+      values.colwise() +=
+          Eigen::Map<const Vector>(offset_.data(), num_channels_);
+    }
+    switch (activation_) {
+      case FusedEpilogueSpec::Activation::kNone:
+        break;
+      case FusedEpilogueSpec::Activation::kRelu:
+        values = values.cwiseMax(T(0));
+        break;
+      case FusedEpilogueSpec::Activation::kRelu6:
+        values = values.cwiseMax(T(0)).cwiseMin(T(6));
+        break;
+      case FusedEpilogueSpec::Activation::kElu:
+        values = (values < T(0)).select(values.exp() - T(1), values);
+        break;
+    }
+  }
+
+ private:
+  int64 num_channels_ = 0;
+  FusedEpilogueSpec::Activation activation_ =
+      FusedEpilogueSpec::Activation::kNone;
+  bool has_scale_ = false;
+  bool has_offset_ = false;
+  std::vector<T> scale_;
+  std::vector<T> offset_;
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_FUSED_EPILOGUE_H_
@@ -0,0 +1,263 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_IMMUTABLE_HASH_MAP_H_
+#define TENSORFLOW_CORE_KERNELS_IMMUTABLE_HASH_MAP_H_
+
+#include <algorithm>
+#include <functional>
+#include <new>
+
+#include "tensorflow/core/lib/core/bits.h"
+#include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mem.h"
+#include "tensorflow/core/platform/prefetch.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace lookup {
+
+// Hash functor used by ImmutableHashMap. Integral keys are mixed so that the
+// low bits (used for tags) and the high bits (used for the group index) are
+// both well distributed.
+template <class K>
+struct ImmutableHashMapHash {
+  uint64 operator()(const K& key) const {
+    uint64 x = static_cast<uint64>(key);
+    // Finalizer of MurmurHash3.
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+  }
+};
+
+template <>
+struct ImmutableHashMapHash<string> {
+  uint64 operator()(const string& key) const { return Hash64(key); }
+};
+
+// ImmutableHashMap is an open-addressing hash map that is built once from a
+// set of distinct keys and is read-only afterwards, so any number of threads
+// may call the Find methods concurrently without synchronization.
+//
+// Slots are organized in groups of kGroupSize. Every group has a 64-bit
+// control word holding one tag byte per slot: kEmptyTag, or the low 7 bits
+// of the hash of the key in the slot. A probe loads one control word and
+// compares the tags of all slots in the group at once, so keys are only
+// compared for slots whose tag matches. The key array is cache-line aligned;
+// for 8-byte keys, the keys of a group fill exactly one cache line.
+//
+// FindBatch hashes a block of keys and prefetches the control words and
+// keys of their first groups before probing any of them, which overlaps the
+// cache misses of a large table.
+template <class K, class V, class Hash = ImmutableHashMapHash<K>>
+class ImmutableHashMap {
+ public:
+  ImmutableHashMap() {}
+  ~ImmutableHashMap() { Clear(); }
+
+  // Builds the map from "entries", a container of (key, value) pairs with
+  // distinct keys, e.g. a std::unordered_map<K, V>. Any previous contents
+  // are discarded.
+  template <class Container>
+  void Build(const Container& entries) {
+    Clear();
+    const int64 n = entries.size();
+    // Keep the load factor at most 7/8 so that every probe sequence ends
+    // at a group with an empty slot.
+    const int64 min_slots = n + n / 7 + 1;
+    num_groups_ = int64{1}
+                  << std::max(0, Log2Ceiling64((min_slots + kGroupSize - 1) /
+                                               kGroupSize));
+    group_mask_ = num_groups_ - 1;
+    const int64 num_slots = num_groups_ * kGroupSize;
+
+    ctrl_ = new uint64[num_groups_];
+    std::fill(ctrl_, ctrl_ + num_groups_, kEmptyGroup);
+    keys_ = NewArray<K>(num_slots);
+    values_ = NewArray<V>(num_slots);
+
+    for (const auto& entry : entries) {
+      const uint64 h = hash_(entry.first);
+      int64 group = GroupIndex(h);
+      for (int64 step = 1;; ++step) {
+        const uint64 empty = MatchEmpty(ctrl_[group]);
+        if (empty != 0) {
+          const int slot = LowestByte(empty);
+          ctrl_[group] = (ctrl_[group] & ~(uint64{0xFF} << (8 * slot))) |
+                         (uint64{Tag(h)} << (8 * slot));
+          keys_[group * kGroupSize + slot] = entry.first;
+          values_[group * kGroupSize + slot] = entry.second;
+          break;
+        }
+        group = (group + step) & group_mask_;
+      }
+    }
+    size_ = n;
+  }
+
+  // Returns a pointer to the value of "key", or nullptr if absent.
+  const V* Find(const K& key) const {
+    if (size_ == 0) return nullptr;
+    return FindWithHash(key, hash_(key));
+  }
+
+  // For i in [0, n): values[i] = value of keys[i], or default_value if
+  // keys[i] is absent.
+  void FindBatch(const K* keys, int64 n, V* values,
+                 const V& default_value) const {
+    if (size_ == 0) {
+      std::fill(values, values + n, default_value);
+      return;
+    }
+    uint64 hashes[kBatchSize];
+    for (int64 start = 0; start < n; start += kBatchSize) {
+      const int64 end = std::min(n, start + kBatchSize);
+      for (int64 i = start; i < end; ++i) {
+        const uint64 h = hash_(keys[i]);
+        hashes[i - start] = h;
+        const int64 group = GroupIndex(h);
+        port::prefetch<port::PREFETCH_HINT_T0>(&ctrl_[group]);
+        port::prefetch<port::PREFETCH_HINT_T0>(&keys_[group * kGroupSize]);
+      }
+      for (int64 i = start; i < end; ++i) {
+        const V* value = FindWithHash(keys[i], hashes[i - start]);
+        values[i] = value != nullptr ? *value : default_value;
+      }
+    }
+  }
+
+  // Calls f(key, value) for every entry, in unspecified order.
+  void ForEach(const std::function<void(const K&, const V&)>& f) const {
+    for (int64 group = 0; group < num_groups_; ++group) {
+      uint64 full = ~MatchEmpty(ctrl_[group]) & kMsbs;
+      while (full != 0) {
+        const int64 slot = group * kGroupSize + LowestByte(full);
+        f(keys_[slot], values_[slot]);
+        full &= full - 1;
+      }
+    }
+  }
+
+  int64 size() const { return size_; }
+
+  // Bytes used by the slot arrays (not counting memory owned by keys or
+  // values, such as string contents).
+  int64 MemoryUsed() const {
+    return num_groups_ *
+           (sizeof(uint64) + kGroupSize * (sizeof(K) + sizeof(V)));
+  }
+
+ private:
+  static constexpr int kGroupSize = 8;
+  static constexpr int kBatchSize = 16;
+  static constexpr int kCacheLineSize = 64;
+  static constexpr uint8 kEmptyTag = 0x80;
+  static constexpr uint64 kLsbs = 0x0101010101010101ULL;
+  static constexpr uint64 kMsbs = 0x8080808080808080ULL;
+  static constexpr uint64 kEmptyGroup = kLsbs * kEmptyTag;
+
+  static uint8 Tag(uint64 h) { return static_cast<uint8>(h & 0x7F); }
+  int64 GroupIndex(uint64 h) const { return (h >> 7) & group_mask_; }
+
+  // Returns a word with the high bit set in every byte of "ctrl" equal to
+  // "tag". May also set the high bit of bytes above a match, which is
+  // harmless because the keys of candidate slots are always compared.
+  static uint64 MatchTag(uint64 ctrl, uint8 tag) {
+    const uint64 x = ctrl ^ (kLsbs * tag);
+    return (x - kLsbs) & ~x & kMsbs;
+  }
+
+  // Only empty slots have the high bit of their tag set.
+  static uint64 MatchEmpty(uint64 ctrl) { return ctrl & kMsbs; }
+
+  // Index of the lowest byte with its high bit set in "mask" (non-zero).
+  static int LowestByte(uint64 mask) {
+    return Log2Floor64(mask & (~mask + 1)) >> 3;
+  }
+
+  const V* FindWithHash(const K& key, uint64 h) const {
+    const uint8 tag = Tag(h);
+    int64 group = GroupIndex(h);
+    for (int64 step = 1;; ++step) {
+      const uint64 ctrl = ctrl_[group];
+      uint64 match = MatchTag(ctrl, tag);
+      while (match != 0) {
+        const int64 slot = group * kGroupSize + LowestByte(match);
+        if (keys_[slot] == key) {
+          return &values_[slot];
+        }
+        match &= match - 1;
+      }
+      if (MatchEmpty(ctrl) != 0) {
+        return nullptr;
+      }
+      group = (group + step) & group_mask_;
+    }
+  }
+
+  template <class T>
+  T* NewArray(int64 n) {
+    T* array =
+        static_cast<T*>(port::AlignedMalloc(n * sizeof(T), kCacheLineSize));
+    CHECK(array != nullptr);
+    for (int64 i = 0; i < n; ++i) {
+      new (&array[i]) T();
+    }
+    return array;
+  }
+
+  template <class T>
+  void DeleteArray(T* array, int64 n) {
+    if (array == nullptr) return;
+    for (int64 i = 0; i < n; ++i) {
+      array[i].~T();
+    }
+    port::AlignedFree(array);
+  }
+
+  void Clear() {
+    const int64 num_slots = num_groups_ * kGroupSize;
+    DeleteArray(keys_, num_slots);
+    DeleteArray(values_, num_slots);
+    delete[] ctrl_;
+    ctrl_ = nullptr;
+    keys_ = nullptr;
+    values_ = nullptr;
+    num_groups_ = 0;
+    group_mask_ = 0;
+    size_ = 0;
+  }
+
+  Hash hash_;
+  uint64* ctrl_ = nullptr;
+  K* keys_ = nullptr;
+  V* values_ = nullptr;
+  int64 num_groups_ = 0;
+  int64 group_mask_ = 0;
+  int64 size_ = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ImmutableHashMap);
+};
+
+}  // namespace lookup
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_IMMUTABLE_HASH_MAP_H_
@@ -0,0 +1,173 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/immutable_hash_map.h"
+
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace lookup {
+namespace {
+
+TEST(ImmutableHashMapTest, Empty) {
+  ImmutableHashMap<int64, float> map;
+  EXPECT_EQ(0, map.size());
+  EXPECT_EQ(nullptr, map.Find(3));
+  map.Build(std::unordered_map<int64, float>());
+  EXPECT_EQ(0, map.size());
+  EXPECT_EQ(nullptr, map.Find(3));
+  float value = 0;
+  const int64 key = 3;
+  map.FindBatch(&key, 1, &value, -1.0f);
+  EXPECT_EQ(-1.0f, value);
+}
+
+TEST(ImmutableHashMapTest, Int64Keys) {
+  std::unordered_map<int64, int64> entries;
+  // Strided keys, so that many of them share their low bits.
+  for (int64 i = 0; i < 10000; ++i) {
+    entries[i * 1024] = i;
+  }
+  ImmutableHashMap<int64, int64> map;
+  map.Build(entries);
+  EXPECT_EQ(entries.size(), map.size());
+  for (const auto& entry : entries) {
+    const int64* value = map.Find(entry.first);
+    ASSERT_NE(nullptr, value);
+    EXPECT_EQ(entry.second, *value);
+  }
+  EXPECT_EQ(nullptr, map.Find(1));
+  EXPECT_EQ(nullptr, map.Find(-1024));
+  EXPECT_EQ(nullptr, map.Find(10000 * 1024));
+}
+
+TEST(ImmutableHashMapTest, StringKeys) {
+  std::unordered_map<string, int32> entries;
+  for (int32 i = 0; i < 1000; ++i) {
+    entries[strings::StrCat("key", i)] = i;
+  }
+  ImmutableHashMap<string, int32> map;
+  map.Build(entries);
+  EXPECT_EQ(1000, map.size());
+  for (int32 i = 0; i < 1000; ++i) {
+    const int32* value = map.Find(strings::StrCat("key", i));
+    ASSERT_NE(nullptr, value);
+    EXPECT_EQ(i, *value);
+  }
+  EXPECT_EQ(nullptr, map.Find("key1000"));
+  EXPECT_EQ(nullptr, map.Find(""));
+}
+
+TEST(ImmutableHashMapTest, FindBatch) {
+  std::unordered_map<int32, string> entries;
+  for (int32 i = 0; i < 100; ++i) {
+    entries[i * 2] = strings::StrCat("v", i * 2);
+  }
+  ImmutableHashMap<int32, string> map;
+  map.Build(entries);
+  // More keys than one prefetch block, half of them missing.
+  std::vector<int32> keys;
+  for (int32 i = 0; i < 200; ++i) {
+    keys.push_back(i);
+  }
+  std::vector<string> values(keys.size());
+  map.FindBatch(keys.data(), keys.size(), values.data(), "missing");
+  for (int32 i = 0; i < 200; ++i) {
+    EXPECT_EQ(i % 2 == 0 ? strings::StrCat("v", i) : "missing", values[i]);
+  }
+}
+
+TEST(ImmutableHashMapTest, ForEach) {
+  std::unordered_map<int64, int64> entries;
+  for (int64 i = 0; i < 500; ++i) {
+    entries[i] = -i;
+  }
+  ImmutableHashMap<int64, int64> map;
+  map.Build(entries);
+  std::unordered_map<int64, int64> visited;
+  map.ForEach([&visited](const int64& key, const int64& value) {
+    EXPECT_TRUE(visited.emplace(key, value).second);
+  });
+  EXPECT_EQ(entries, visited);
+}
+
+TEST(ImmutableHashMapTest, Rebuild) {
+  ImmutableHashMap<int64, int64> map;
+  map.Build(std::unordered_map<int64, int64>({{1, 10}, {2, 20}}));
+  map.Build(std::unordered_map<int64, int64>({{3, 30}}));
+  EXPECT_EQ(1, map.size());
+  EXPECT_EQ(nullptr, map.Find(1));
+  ASSERT_NE(nullptr, map.Find(3));
+  EXPECT_EQ(30, *map.Find(3));
+}
+
+template <class Lookup>
+static void BM_Lookup(int iters, int num_entries, Lookup lookup) {
+  testing::StopTiming();
+  std::vector<int64> keys(1024);
+  for (int i = 0; i < keys.size(); ++i) {
+    // Every other key is a miss.
+    keys[i] = (i * 7919LL) % (2 * num_entries);
+  }
+  std::vector<int64> values(keys.size());
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    lookup(keys, &values);
+  }
+  testing::ItemsProcessed(static_cast<int64>(iters) * keys.size());
+}
+
+static void BM_UnorderedMapFind(int iters, int num_entries) {
+  std::unordered_map<int64, int64> entries;
+  for (int64 i = 0; i < num_entries; ++i) {
+    entries[i] = i;
+  }
+  BM_Lookup(iters, num_entries,
+            [&entries](const std::vector<int64>& keys,
+                       std::vector<int64>* values) {
+              for (int i = 0; i < keys.size(); ++i) {
+                auto it = entries.find(keys[i]);
+                (*values)[i] = it == entries.end() ? -1 : it->second;
+              }
+            });
+}
+BENCHMARK(BM_UnorderedMapFind)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 22);
+
+static void BM_ImmutableHashMapFindBatch(int iters, int num_entries) {
+  std::unordered_map<int64, int64> entries;
+  for (int64 i = 0; i < num_entries; ++i) {
+    entries[i] = i;
+  }
+  ImmutableHashMap<int64, int64> map;
+  map.Build(entries);
+  BM_Lookup(iters, num_entries,
+            [&map](const std::vector<int64>& keys,
+                   std::vector<int64>* values) {
+              map.FindBatch(keys.data(), keys.size(), values->data(), -1);
+            });
+}
+BENCHMARK(BM_ImmutableHashMapFindBatch)
+    ->Arg(1 << 10)
+    ->Arg(1 << 16)
+    ->Arg(1 << 22);
+
+}  // namespace
+}  // namespace lookup
+}  // namespace tensorflow
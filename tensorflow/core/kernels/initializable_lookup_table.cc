@@ -58,6 +58,7 @@ Status InitializableLookupTable::Initialize(InitTableIterator& iter) {
   if (!errors::IsOutOfRange(iter.status())) {
     return iter.status();
   }
+  TF_RETURN_IF_ERROR(DoFinishInitialization());
 
   // Prevent compiler/memory reordering of is_initialized and
   // the initialization itself.
@@ -143,6 +143,11 @@ class InitializableLookupTable : public LookupInterface {
   // underlying data structure.
   virtual Status DoInsert(const Tensor& keys, const Tensor& values) = 0;
 
+  // Called once all the elements have been inserted, before the table is
+  // published as initialized. Derived implementations may use it to convert
+  // the underlying data structure into a read-optimized form.
+  virtual Status DoFinishInitialization() { return Status::OK(); }
+
   // Performs the batch find operation on the underlying data structure.
   virtual Status DoFind(const Tensor& keys, Tensor* values,
                         const Tensor& default_value) = 0;
@@ -22,6 +22,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/kernels/bounds_check.h"
+#include "tensorflow/core/kernels/immutable_hash_map.h"
 #include "tensorflow/core/kernels/lookup_util.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
@@ -177,7 +178,7 @@ class HashTable : public InitializableLookupTable {
       return 0;
     }
     std::atomic_thread_fence(std::memory_order_acquire);
-    return table_ ? table_->size() : 0;
+    return read_table_.size();
   }
 
   Status ExportValues(OpKernelContext* context) override {
@@ -185,7 +186,8 @@ class HashTable : public InitializableLookupTable {
       return errors::Aborted("HashTable is not initialized.");
     }
 
-    const int64 size = table_->size();
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const int64 size = read_table_.size();
 
     Tensor* keys;
     Tensor* values;
@@ -197,10 +199,12 @@ class HashTable : public InitializableLookupTable {
     auto keys_data = keys->flat<K>();
     auto values_data = values->flat<V>();
     int64 i = 0;
-    for (auto it = table_->begin(); it != table_->end(); ++it, ++i) {
-      keys_data(i) = it->first;
-      values_data(i) = it->second;
-    }
+    read_table_.ForEach([&keys_data, &values_data, &i](const K& key,
+                                                       const V& value) {
+      keys_data(i) = key;
+      values_data(i) = value;
+      ++i;
+    });
     return Status::OK();
   }
 
@@ -245,16 +249,26 @@ class HashTable : public InitializableLookupTable {
     return Status::OK();
   }
 
+  // Moves the elements into the flat, read-only layout used by DoFind and
+  // frees the insertion map.
+  Status DoFinishInitialization() override {
+    if (table_) {
+      read_table_.Build(*table_);
+      table_.reset();
+    }
+    return Status::OK();
+  }
+
+  // Only called once the table is initialized, so it can read read_table_
+  // without taking mu_.
   Status DoFind(const Tensor& key, Tensor* value,
                 const Tensor& default_value) override {
     const V default_val = default_value.flat<V>()(0);
     const auto key_values = key.flat<K>();
     auto value_values = value->flat<V>();
 
-    for (int64 i = 0; i < key_values.size(); ++i) {
-      value_values(i) = gtl::FindWithDefault(
-          *table_, SubtleMustCopyIfIntegral(key_values(i)), default_val);
-    }
+    read_table_.FindBatch(key_values.data(), key_values.size(),
+                          value_values.data(), default_val);
     return Status::OK();
   }
 
@@ -263,12 +277,15 @@ class HashTable : public InitializableLookupTable {
       const int64 num_elements = table_->size();
       return num_elements * (sizeof(K) + sizeof(V));
     } else {
-      return 0;
+      return read_table_.MemoryUsed();
     }
   }
 
  private:
+  // Holds the elements while the table is being initialized.
   std::unique_ptr<std::unordered_map<K, V>> table_;
+  // Holds the elements once the table is initialized.
+  ImmutableHashMap<K, V> read_table_;
 };
 
 }  // namespace lookup
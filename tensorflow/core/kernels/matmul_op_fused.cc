@@ -0,0 +1,148 @@
+/* Copyright 2018 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Implements matrix multiplication with a bias add and activation baked into
+// the processing. See docs in ../ops/math_ops.cc.
+
+#define EIGEN_USE_THREADS
+
+#include <algorithm>
+
+#include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/register_types.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/kernels/fused_epilogue.h"
+#include "tensorflow/core/util/work_sharder.h"
+
+namespace tensorflow {
+
+typedef Eigen::ThreadPoolDevice CPUDevice;
+
+namespace {
+
+// The output is computed in tiles of whole rows of at most this many bytes,
+// so that a tile is still in cache when the fused ops are applied to it.
+const int64 kMaxFusedTileSize = 128 * 1024;
+
+}  // namespace
+
+template <typename T>
+class FusedMatMulOp : public OpKernel {
+ public:
+  explicit FusedMatMulOp(OpKernelConstruction* ctx) : OpKernel(ctx) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("transpose_a", &transpose_a_));
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("transpose_b", &transpose_b_));
+    OP_REQUIRES_OK(ctx, spec_.Init(ctx));
+  }
+
+  void Compute(OpKernelContext* ctx) override {
+    const Tensor& a = ctx->input(0);
+    const Tensor& b = ctx->input(1);
+
+    // Check that the dimensions of the two matrices are valid.
+    OP_REQUIRES(
+        ctx, TensorShapeUtils::IsMatrix(a.shape()),
+        errors::InvalidArgument("In[0] is not a matrix. Instead it has shape ",
+                                a.shape().DebugString()));
+    OP_REQUIRES(
+        ctx, TensorShapeUtils::IsMatrix(b.shape()),
+        errors::InvalidArgument("In[1] is not a matrix. Instead it has shape ",
+                                b.shape().DebugString()));
+    Eigen::array<Eigen::IndexPair<Eigen::DenseIndex>, 1> dim_pair;
+    dim_pair[0].first = transpose_a_ ? 0 : 1;
+    dim_pair[0].second = transpose_b_ ? 1 : 0;
+
+    OP_REQUIRES(
+        ctx, a.dim_size(dim_pair[0].first) == b.dim_size(dim_pair[0].second),
+        errors::InvalidArgument(
+            "Matrix size-incompatible: In[0]: ", a.shape().DebugString(),
+            ", In[1]: ", b.shape().DebugString()));
+    const int64 m = a.dim_size(1 - dim_pair[0].first);
+    const int64 k = a.dim_size(dim_pair[0].first);
+    const int64 n = b.dim_size(1 - dim_pair[0].second);
+
+    FusedEpilogue<T> epilogue;
+    OP_REQUIRES_OK(ctx, epilogue.Init(spec_, ctx, 2, n));
+
+    Tensor* out = nullptr;
+    OP_REQUIRES_OK(ctx, ctx->allocate_output(0, TensorShape({m, n}), &out));
+    if (out->NumElements() == 0) return;
+
+    auto a_matrix = a.matrix<T>();
+    auto b_matrix = b.matrix<T>();
+    auto out_matrix = out->matrix<T>();
+    const int64 rows_per_tile =
+        std::max<int64>(1, kMaxFusedTileSize / (n * sizeof(T)));
+    const int64 num_tiles = (m + rows_per_tile - 1) / rows_per_tile;
+    auto compute_tile = [&](int64 tile, bool on_device) {
+      const int64 row_begin = tile * rows_per_tile;
+      const int64 rows = std::min(m - row_begin, rows_per_tile);
+      Eigen::DSizes<Eigen::DenseIndex, 2> out_offsets(row_begin, 0);
+      Eigen::DSizes<Eigen::DenseIndex, 2> out_sizes(rows, n);
+      auto out_tile = out_matrix.slice(out_offsets, out_sizes);
+      if (k == 0) {
+        out_tile.setZero();
+      } else {
+        Eigen::DSizes<Eigen::DenseIndex, 2> a_offsets(0, 0);
+        Eigen::DSizes<Eigen::DenseIndex, 2> a_sizes(k, k);
+        a_offsets[1 - dim_pair[0].first] = row_begin;
+        a_sizes[1 - dim_pair[0].first] = rows;
+        auto product =
+            a_matrix.slice(a_offsets, a_sizes).contract(b_matrix, dim_pair);
+        if (on_device) {
+          out_tile.device(ctx->eigen_device<CPUDevice>()) = product;
+        } else {
+          out_tile = product;
+        }
+      }
+      epilogue.Apply(out_matrix.data() + row_begin * n, rows);
+    };
+    auto worker_threads = *(ctx->device()->tensorflow_cpu_worker_threads());
+    if (num_tiles < worker_threads.num_threads) {
+      // Too few tiles to keep the intra-op threads busy, e.g. for a batch of
+      // one, so each contraction is parallelized instead.
+      for (int64 tile = 0; tile < num_tiles; ++tile) {
+        compute_tile(tile, true);
+      }
+      return;
+    }
+    Shard(worker_threads.num_threads, worker_threads.workers, num_tiles,
+          rows_per_tile * k * n, [&](int64 begin, int64 end) {
+            for (int64 tile = begin; tile < end; ++tile) {
+              compute_tile(tile, false);
+            }
+          });
+  }
+
+ private:
+  bool transpose_a_;
+  bool transpose_b_;
+  FusedEpilogueSpec spec_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(FusedMatMulOp);
+};
+
+#define REGISTER_CPU(T)                                                 \
+  REGISTER_KERNEL_BUILDER(                                              \
+      Name("_FusedMatMul").Device(DEVICE_CPU).TypeConstraint<T>("T"),   \
+      FusedMatMulOp<T>);
+
+TF_CALL_float(REGISTER_CPU);
+TF_CALL_double(REGISTER_CPU);
+
+#undef REGISTER_CPU
+
+}  // namespace tensorflow
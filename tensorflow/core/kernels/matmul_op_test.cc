@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/graph/node_builder.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
 
@@ -127,4 +128,51 @@ BM_Matmul(2000, 1, 2000, true, false);
 BM_Matmul(2000, 1, 2000, false, true);
 BM_Matmul(2000, 1, 2000, true, true);
 
+// Returns a graph of MatMul, BiasAdd and Relu, or of the _FusedMatMul that
+// the remapper replaces them with.
+static Graph* MatmulBiasAddRelu(int m, int k, int n, bool fused) {
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor in0(DT_FLOAT, TensorShape({m, k}));
+  in0.flat<float>().setRandom();
+  Tensor in1(DT_FLOAT, TensorShape({k, n}));
+  in1.flat<float>().setRandom();
+  Tensor bias(DT_FLOAT, TensorShape({n}));
+  bias.flat<float>().setRandom();
+  Node* a = test::graph::Constant(g, in0);
+  Node* b = test::graph::Constant(g, in1);
+  Node* c = test::graph::Constant(g, bias);
+  if (fused) {
+    TF_CHECK_OK(NodeBuilder(g->NewName("n"), "_FusedMatMul")
+                    .Input(a)
+                    .Input(b)
+                    .Input(std::vector<NodeBuilder::NodeOut>({c}))
+                    .Attr("T", DT_FLOAT)
+                    .Attr("num_args", 1)
+                    .Attr("fused_ops", {"BiasAdd", "Relu"})
+                    .Finalize(g, nullptr));
+  } else {
+    test::graph::Relu(
+        g, test::graph::BiasAdd(g, test::graph::Matmul(g, a, b, false, false),
+                                c));
+  }
+  return g;
+}
+
+#define BM_MatmulBiasAddRelu(M, K, N, FUSED)                               \
+  static void BM_MatmulBiasAddRelu##_##M##_##K##_##N##_##FUSED(int iters) { \
+    testing::UseRealTime();                                                 \
+    testing::ItemsProcessed(static_cast<int64>(iters) * M * K * N * 2);     \
+    test::Benchmark("cpu", MatmulBiasAddRelu(M, K, N, FUSED)).Run(iters);   \
+  }                                                                         \
+  BENCHMARK(BM_MatmulBiasAddRelu##_##M##_##K##_##N##_##FUSED);
+
+// Small batches, whose few output tiles can't keep the intra-op threads
+// busy on their own.
+BM_MatmulBiasAddRelu(1, 1024, 1024, false);
+BM_MatmulBiasAddRelu(1, 1024, 1024, true);
+BM_MatmulBiasAddRelu(32, 1024, 1024, false);
+BM_MatmulBiasAddRelu(32, 1024, 1024, true);
+BM_MatmulBiasAddRelu(256, 1024, 1024, false);
+BM_MatmulBiasAddRelu(256, 1024, 1024, true);
+
 }  // end namespace tensorflow
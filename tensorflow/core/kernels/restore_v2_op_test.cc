@@ -13,6 +13,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <stdlib.h>
 #include <complex>
 #include <functional>
 #include <memory>
@@ -30,7 +31,9 @@ limitations under the License.
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/util/tensor_bundle/naming.h"
 
 namespace tensorflow {
 namespace {
@@ -353,5 +356,19 @@ TEST_F(RestoreV2OpTest, RestoreAfterSaveV2) { RunTest("SaveV2"); }
 TEST_F(RestoreV2OpTest, RestoreAfterSaveSlicesV1) { RunTest("SaveSlices"); }
 TEST_F(RestoreV2OpTest, RestoreAfterSaveV1) { RunTest("Save"); }
 
+TEST_F(RestoreV2OpTest, RestoreAfterShardedSaveV2) {
+  setenv("TF_SAVE_V2_NUM_SHARDS", "3", 1);
+  setenv("TF_RESTORE_V2_NUM_THREADS", "4", 1);
+  setenv("TF_RESTORE_USE_MMAP", "true", 1);
+  RunTest("SaveV2");
+  unsetenv("TF_SAVE_V2_NUM_SHARDS");
+  unsetenv("TF_RESTORE_V2_NUM_THREADS");
+  unsetenv("TF_RESTORE_USE_MMAP");
+
+  // The tensors were written to three data files.
+  const string prefix = io::JoinPath(testing::TmpDir(), "tensor_simple-SaveV2");
+  TF_EXPECT_OK(Env::Default()->FileExists(DataFilename(prefix, 2, 3)));
+}
+
 }  // namespace
 }  // namespace tensorflow
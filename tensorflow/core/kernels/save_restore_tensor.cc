@@ -14,6 +14,7 @@ limitations under the License.
 ==============================================================================*/
 
 #include "tensorflow/core/kernels/save_restore_tensor.h"
+#include <algorithm>
 #include <numeric>
 #include <unordered_map>
 #include <utility>
@@ -30,6 +31,7 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 #include "tensorflow/core/util/tensor_slice_reader.h"
 #include "tensorflow/core/util/tensor_slice_reader_cache.h"
@@ -253,7 +255,7 @@ struct RestoreOp {
 
   // Run this restore operation using a new BundleReader.
   void run_with_new_reader() {
-    BundleReader reader(Env::Default(), reader_prefix);
+    BundleReader reader(Env::Default(), reader_prefix, reader_options);
     if (!reader.status().ok()) {
       status = reader.status();
       return;
@@ -270,7 +272,13 @@ struct RestoreOp {
     VLOG(1) << "Restoring tensor " << idx << " : " << tensor_name << " : "
             << restored_full_shape.num_elements();
     Tensor* restored_tensor;
-    if (shape_and_slice.empty()) {
+    if (shape_and_slice.empty() && reader_options.use_mmap) {
+      // Lookup the full tensor, letting the reader alias it to the mapped
+      // data file.
+      Tensor restored;
+      TF_RETURN_IF_ERROR(reader->Lookup(tensor_name, &restored));
+      context->set_output(idx, restored);
+    } else if (shape_and_slice.empty()) {
       // Lookup the full tensor.
       TF_RETURN_IF_ERROR(
           context->allocate_output(idx, restored_full_shape, &restored_tensor));
@@ -305,6 +313,7 @@ struct RestoreOp {
   string tensor_name;
   string shape_and_slice;
   string reader_prefix;
+  BundleReader::Options reader_options;
 
   ::tensorflow::Status status;
 };
@@ -331,7 +340,13 @@ Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
   std::vector<std::unique_ptr<RestoreOp> > pool_restore_ops;
   std::vector<std::unique_ptr<RestoreOp> > direct_restore_ops;
 
-  BundleReader default_reader(Env::Default(), prefix_string);
+  // Memory-mapped restore keeps checkpoint data in the page cache, shared
+  // by all processes restoring the same checkpoint, instead of reading it
+  // into intermediate buffers.
+  BundleReader::Options reader_options;
+  TF_RETURN_IF_ERROR(ReadBoolFromEnvVar("TF_RESTORE_USE_MMAP", false,
+                                        &reader_options.use_mmap));
+  BundleReader default_reader(Env::Default(), prefix_string, reader_options);
   TF_RETURN_IF_ERROR(default_reader.status());
 
   std::vector<string> mismatched_errors;
@@ -357,8 +372,9 @@ Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
   for (auto i : sorted_name_idx) {
     const string& tensor_name = tensor_names_flat(i);
     const string& shape_and_slice = shape_and_slices_flat(i);
-    auto op =
-        new RestoreOp{context, i, tensor_name, shape_and_slice, prefix_string};
+    auto op = new RestoreOp{context,       i,
+                            tensor_name,   shape_and_slice,
+                            prefix_string, reader_options};
     if (op->should_run_in_pool(&default_reader)) {
       pool_restore_ops.emplace_back(op);
     } else {
@@ -366,22 +382,54 @@ Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
     }
   }
 
+  // With TF_RESTORE_V2_NUM_THREADS = N > 1, the small tensors are split into
+  // up to N batches of neighbouring keys. The first batch is read from the op
+  // thread, the others from the thread pool, each with its own BundleReader.
+  int64 num_restore_threads;
+  TF_RETURN_IF_ERROR(ReadInt64FromEnvVar("TF_RESTORE_V2_NUM_THREADS", 1,
+                                         &num_restore_threads));
+  const size_t num_direct_ops = direct_restore_ops.size();
+  const size_t num_batches = std::max<size_t>(
+      1, std::min<size_t>(std::max<int64>(num_restore_threads, 1),
+                          num_direct_ops));
+  auto run_batch = [&direct_restore_ops, num_direct_ops, num_batches](
+                       size_t batch, BundleReader* reader) -> Status {
+    const size_t begin = batch * num_direct_ops / num_batches;
+    const size_t end = (batch + 1) * num_direct_ops / num_batches;
+    for (size_t i = begin; i < end; ++i) {
+      TF_RETURN_IF_ERROR(direct_restore_ops[i]->run(reader));
+    }
+    return Status::OK();
+  };
+  std::vector<Status> batch_statuses(num_batches);
+
   {
     // Schedule any threaded operations first, skipping thread pool creation if
     // we don't have any expensive operations.
     std::unique_ptr<thread::ThreadPool> reader_pool;
-    if (!pool_restore_ops.empty()) {
-      reader_pool.reset(
-          new thread::ThreadPool(Env::Default(), "restore_tensors", 8));
+    if (!pool_restore_ops.empty() || num_batches > 1) {
+      reader_pool.reset(new thread::ThreadPool(
+          Env::Default(), "restore_tensors",
+          std::max<int64>(8, num_restore_threads)));
       for (auto& op : pool_restore_ops) {
         reader_pool->Schedule([&op]() { op->run_with_new_reader(); });
       }
+      for (size_t batch = 1; batch < num_batches; ++batch) {
+        reader_pool->Schedule([&, batch]() {
+          BundleReader reader(Env::Default(), prefix_string, reader_options);
+          batch_statuses[batch] = reader.status().ok()
+                                      ? run_batch(batch, &reader)
+                                      : reader.status();
+        });
+      }
     }
 
     // Read small tensors from the op thread
-    for (auto& op : direct_restore_ops) {
-      TF_RETURN_IF_ERROR(op->run(&default_reader));
-    }
+    batch_statuses[0] = run_batch(0, &default_reader);
+  }
+
+  for (const Status& status : batch_statuses) {
+    TF_RETURN_IF_ERROR(status);
   }
 
   // Check status of pool ops; this must come after the pool shuts down.
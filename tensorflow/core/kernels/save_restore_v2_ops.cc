@@ -15,6 +15,8 @@ limitations under the License.
 
 // See docs in ../ops/io_ops.cc.
 
+#include <algorithm>
+#include <numeric>
 #include <string>
 #include <vector>
 
@@ -25,10 +27,13 @@ limitations under the License.
 #include "tensorflow/core/kernels/bounds_check.h"
 #include "tensorflow/core/kernels/save_restore_tensor.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/saved_tensor_slice_util.h"
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 #include "tensorflow/core/util/tensor_slice_reader.h"
@@ -85,12 +90,59 @@ void ValidateInputs(bool is_save_op, OpKernelContext* context,
   }
 }
 
+// Adds input tensor "i" of a SaveV2 op to "writer".
+Status AddTensorToBundle(OpKernelContext* context, int i,
+                         BundleWriter* writer) {
+  const int kFixedInputs = 3;  // Prefix, tensor names, shape_and_slices.
+  const string& tensor_name = context->input(1).flat<string>()(i);
+  const string& shape_spec = context->input(2).flat<string>()(i);
+  const Tensor& tensor = context->input(i + kFixedInputs);
+
+  if (!shape_spec.empty()) {
+    TensorShape shape;
+    TensorSlice slice(tensor.dims());
+    TensorShape slice_shape;
+
+    TF_RETURN_IF_ERROR(checkpoint::ParseShapeAndSlice(shape_spec, &shape,
+                                                      &slice, &slice_shape));
+    if (!slice_shape.IsSameSize(tensor.shape())) {
+      return errors::InvalidArgument(
+          "Slice in shape_and_slice "
+          "specification does not match the "
+          "shape of the tensor to  save: ",
+          shape_spec, ", tensor: ", tensor.shape().DebugString());
+    }
+    return writer->AddSlice(tensor_name, shape, slice, tensor);
+  }
+  return writer->Add(tensor_name, tensor);
+}
+
+// Writes the input tensors "indices" of a SaveV2 op as a bundle at "prefix".
+Status WriteBundle(OpKernelContext* context, const string& prefix,
+                   const std::vector<int>& indices) {
+  BundleWriter writer(Env::Default(), prefix);
+  TF_RETURN_IF_ERROR(writer.status());
+  VLOG(1) << "BundleWriter, prefix_string: " << prefix;
+  for (int i : indices) {
+    TF_RETURN_IF_ERROR(AddTensorToBundle(context, i, &writer));
+  }
+  return writer.Finish();
+}
+
 }  // namespace
 
 // Saves a list of named tensors using the tensor bundle library.
+//
+// If the environment variable TF_SAVE_V2_NUM_SHARDS is set to N > 1, the
+// tensors are spread over up to N bundles, balanced by size, which are written
+// concurrently (each to its own data file) and then merged into a single
+// bundle at the requested prefix.
 class SaveV2 : public OpKernel {
  public:
-  explicit SaveV2(OpKernelConstruction* context) : OpKernel(context) {}
+  explicit SaveV2(OpKernelConstruction* context) : OpKernel(context) {
+    OP_REQUIRES_OK(context, ReadInt64FromEnvVar("TF_SAVE_V2_NUM_SHARDS", 1,
+                                                &num_shards_));
+  }
 
   void Compute(OpKernelContext* context) override {
     const Tensor& prefix = context->input(0);
@@ -102,40 +154,56 @@ class SaveV2 : public OpKernel {
     const int kFixedInputs = 3;  // Prefix, tensor names, shape_and_slices.
     const int num_tensors = static_cast<int>(tensor_names.NumElements());
     const string& prefix_string = prefix.scalar<string>()();
-    const auto& tensor_names_flat = tensor_names.flat<string>();
-    const auto& shape_and_slices_flat = shape_and_slices.flat<string>();
-
-    BundleWriter writer(Env::Default(), prefix_string);
-    OP_REQUIRES_OK(context, writer.status());
-    VLOG(1) << "BundleWriter, prefix_string: " << prefix_string;
-
-    for (int i = 0; i < num_tensors; ++i) {
-      const string& tensor_name = tensor_names_flat(i);
-      const Tensor& tensor = context->input(i + kFixedInputs);
-
-      if (!shape_and_slices_flat(i).empty()) {
-        const string& shape_spec = shape_and_slices_flat(i);
-        TensorShape shape;
-        TensorSlice slice(tensor.dims());
-        TensorShape slice_shape;
-
-        OP_REQUIRES_OK(context, checkpoint::ParseShapeAndSlice(
-                                    shape_spec, &shape, &slice, &slice_shape));
-        OP_REQUIRES(context, slice_shape.IsSameSize(tensor.shape()),
-                    errors::InvalidArgument("Slice in shape_and_slice "
-                                            "specification does not match the "
-                                            "shape of the tensor to  save: ",
-                                            shape_spec, ", tensor: ",
-                                            tensor.shape().DebugString()));
-
-        OP_REQUIRES_OK(context,
-                       writer.AddSlice(tensor_name, shape, slice, tensor));
-      } else {
-        OP_REQUIRES_OK(context, writer.Add(tensor_name, tensor));
+
+    const int num_shards =
+        static_cast<int>(std::min<int64>(num_shards_, num_tensors));
+    if (num_shards <= 1) {
+      std::vector<int> indices(num_tensors);
+      std::iota(indices.begin(), indices.end(), 0);
+      OP_REQUIRES_OK(context, WriteBundle(context, prefix_string, indices));
+      return;
+    }
+
+    // Assigns the tensors to shards, largest first to the least loaded one.
+    std::vector<int> order(num_tensors);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [context](int a, int b) {
+      return context->input(a + kFixedInputs).TotalBytes() >
+             context->input(b + kFixedInputs).TotalBytes();
+    });
+    std::vector<std::vector<int>> shard_indices(num_shards);
+    std::vector<int64> shard_bytes(num_shards, 0);
+    for (int i : order) {
+      const int shard =
+          std::min_element(shard_bytes.begin(), shard_bytes.end()) -
+          shard_bytes.begin();
+      shard_indices[shard].push_back(i);
+      shard_bytes[shard] += context->input(i + kFixedInputs).TotalBytes();
+    }
+
+    std::vector<string> shard_prefixes(num_shards);
+    std::vector<Status> shard_statuses(num_shards);
+    {
+      thread::ThreadPool pool(Env::Default(), "save_tensors", num_shards);
+      for (int shard = 0; shard < num_shards; ++shard) {
+        shard_prefixes[shard] =
+            strings::StrCat(prefix_string, "_temp_part-", shard);
+        pool.Schedule([context, shard, &shard_prefixes, &shard_indices,
+                       &shard_statuses]() {
+          shard_statuses[shard] = WriteBundle(context, shard_prefixes[shard],
+                                              shard_indices[shard]);
+        });
       }
     }
-    OP_REQUIRES_OK(context, writer.Finish());
+    for (const Status& status : shard_statuses) {
+      OP_REQUIRES_OK(context, status);
+    }
+    OP_REQUIRES_OK(context, MergeBundles(Env::Default(), shard_prefixes,
+                                         prefix_string));
   }
+
+ private:
+  int64 num_shards_;
 };
 REGISTER_KERNEL_BUILDER(Name("SaveV2").Device(DEVICE_CPU), SaveV2);
 
@@ -17,17 +17,24 @@ limitations under the License.
 
 #define EIGEN_USE_THREADS
 
+#include <algorithm>
+
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/kernels/cwise_ops.h"
 #include "tensorflow/core/kernels/cwise_ops_common.h"
 #include "tensorflow/core/kernels/relu_op_functor.h"
+#include "tensorflow/core/util/bcast.h"
 
 namespace tensorflow {
 
 template <typename T>
 class UnaryOpsComposition;  // forward declare kernel
 
+template <typename T>
+class ElementwiseOpsComposition;  // forward declare kernel
+
 template <typename T>
 struct UnaryOpsCompositionSupport;
 
@@ -55,6 +62,7 @@ struct UnaryOpsCompositionBase {
 
  private:
   friend class UnaryOpsComposition<T>;
+  friend class ElementwiseOpsComposition<T>;
 
   Status ExportComputeFns(const std::vector<string>& op_names,
                           std::vector<ComputeFn>* fns, int* cost) {
@@ -417,11 +425,541 @@ struct UnaryOpsCompositionSupport<double> : UnaryOpsCompositionBase<double> {
   // clang-format on
 };
 
+// Computes a DAG of elementwise ops in one pass: the output is computed in
+// blocks that fit in cache, and all ops are applied to a block before moving
+// to the next one, so that each element of the inputs is loaded once and each
+// element of the output is stored once. Inputs may be broadcast to the shape
+// of the output if they are scalars or rows (their shape is a suffix of the
+// output shape).
+template <typename T>
+class ElementwiseOpsComposition : public OpKernel {
+ public:
+  using Packet = typename Eigen::internal::packet_traits<T>::type;
+
+  using Support = UnaryOpsCompositionSupport<T>;
+
+  using InputBuffer = typename Support::InputBuffer;
+  using OutputBuffer = typename Support::OutputBuffer;
+  using BoolInputBuffer = typename TTypes<bool>::ConstFlat;
+  using BoolOutputBuffer = typename TTypes<bool>::Flat;
+
+  using UnaryFn = typename Support::ComputeFn;
+  using BinaryFn = void (*)(const InputBuffer&, const InputBuffer&,
+                            OutputBuffer*);
+  using CompareFn = void (*)(const InputBuffer&, const InputBuffer&,
+                             BoolOutputBuffer*);
+  using LogicalFn = void (*)(const BoolInputBuffer&, const BoolInputBuffer&,
+                             BoolOutputBuffer*);
+
+  explicit ElementwiseOpsComposition(OpKernelConstruction* context)
+      : OpKernel(context) {
+    std::vector<string> op_names;
+    std::vector<int32> operands;
+    OP_REQUIRES_OK(context, context->GetAttr("Tin", &input_types_));
+    OP_REQUIRES_OK(context, context->GetAttr("op_names", &op_names));
+    OP_REQUIRES_OK(context, context->GetAttr("operands", &operands));
+    OP_REQUIRES(context, !op_names.empty(),
+                errors::InvalidArgument(
+                    "Elementwise op composition must have at least one op"));
+
+    const DataType dtype = DataTypeToEnum<T>::value;
+    for (DataType input_type : input_types_) {
+      OP_REQUIRES(context,
+                  input_type == dtype || input_type == DT_BOOL ||
+                      IsConvertibleInputType(input_type),
+                  errors::InvalidArgument("Unsupported input type: ",
+                                          DataTypeString(input_type)));
+      // Inputs of other types are converted to T when they are loaded.
+      value_is_bool_.push_back(input_type == DT_BOOL);
+    }
+
+    int next_operand = 0;
+    for (const string& op_name : op_names) {
+      Instruction inst;
+      int cost = 0;
+      // The operands of the op must be of type T, unless they are listed in
+      // `bool_operands`.
+      int num_operands = 1;
+      std::vector<bool> bool_operands = {false, false, false};
+      bool bool_result = false;
+      if (op_name == "Select") {
+        inst.kind = Kind::kSelect;
+        num_operands = 3;
+        bool_operands[0] = true;
+        cost = 1;
+      } else if (op_name == "Cast") {
+        inst.kind = Kind::kCast;
+        cost = 1;
+      } else if (op_name == "LogicalNot") {
+        inst.kind = Kind::kLogicalNot;
+        bool_operands[0] = true;
+        bool_result = true;
+        cost = 1;
+      } else if (GetLogicalFn(op_name, &inst.logical_fn, &cost)) {
+        inst.kind = Kind::kLogical;
+        num_operands = 2;
+        bool_operands = {true, true, false};
+        bool_result = true;
+      } else if (GetCompareFn(op_name, &inst.compare_fn, &cost)) {
+        inst.kind = Kind::kCompare;
+        num_operands = 2;
+        bool_result = true;
+      } else if (GetBinaryFn(op_name, &inst.binary_fn, &cost)) {
+        inst.kind = Kind::kBinary;
+        num_operands = 2;
+      } else {
+        std::vector<UnaryFn> fns;
+        OP_REQUIRES_OK(context,
+                       support_.ExportComputeFns({op_name}, &fns, &cost));
+        inst.kind = Kind::kUnary;
+        inst.unary_fn = fns[0];
+      }
+
+      const int num_values = value_is_bool_.size();
+      for (int i = 0; i < num_operands; ++i) {
+        OP_REQUIRES(
+            context, next_operand < operands.size(),
+            errors::InvalidArgument("Not enough operands for op ", op_name));
+        const int value = operands[next_operand++];
+        OP_REQUIRES(context, value >= 0 && value < num_values,
+                    errors::InvalidArgument("Operand ", value, " of op ",
+                                            op_name, " is not defined"));
+        // Cast converts either type of value to T.
+        if (inst.kind == Kind::kCast) {
+          if (value_is_bool_[value]) inst.kind = Kind::kCastBool;
+        } else {
+          OP_REQUIRES(context, value_is_bool_[value] == bool_operands[i],
+                      errors::InvalidArgument("Operand ", i, " of op ",
+                                              op_name, " has the wrong type"));
+        }
+        inst.args[i] = value;
+      }
+      inst.result = num_values;
+      value_is_bool_.push_back(bool_result);
+      instructions_.push_back(inst);
+      cost_ += cost;
+    }
+    OP_REQUIRES(
+        context, next_operand == operands.size(),
+        errors::InvalidArgument("Expected ", next_operand,
+                                " operands, but got ", operands.size()));
+    OP_REQUIRES(context, !value_is_bool_.back(),
+                errors::InvalidArgument("The last op must return a value of ",
+                                        "type ", DataTypeString(dtype)));
+    AssignScratchSlots();
+
+    VLOG(2) << "Composed elementwise op: [" << str_util::Join(op_names, ", ")
+            << "]; cost=" << cost_;
+  }
+
+  void Compute(OpKernelContext* ctx) override {
+    const int num_inputs = ctx->num_inputs();
+    TensorShape out_shape = ctx->input(0).shape();
+    for (int i = 1; i < num_inputs; ++i) {
+      const TensorShape& shape = ctx->input(i).shape();
+      BCast bcast(BCast::FromShape(out_shape), BCast::FromShape(shape));
+      OP_REQUIRES(ctx, bcast.IsValid(),
+                  errors::InvalidArgument("Incompatible shapes: ",
+                                          out_shape.DebugString(), " vs. ",
+                                          shape.DebugString()));
+      out_shape = BCast::ToShape(bcast.output_shape());
+    }
+
+    std::vector<Broadcast> broadcasts(num_inputs);
+    gtl::InlinedVector<int, 4> forwardable;
+    for (int i = 0; i < num_inputs; ++i) {
+      const TensorShape& shape = ctx->input(i).shape();
+      OP_REQUIRES(ctx, GetBroadcast(shape, out_shape, &broadcasts[i]),
+                  errors::Unimplemented(
+                      "Only scalar and row broadcasting is supported, but ",
+                      "input ", i, " has shape ", shape.DebugString(),
+                      " and the output has shape ", out_shape.DebugString()));
+      if (broadcasts[i] == Broadcast::kNone &&
+          input_types_[i] == DataTypeToEnum<T>::value) {
+        forwardable.push_back(i);
+      }
+    }
+    // Select picks whole rows for a vector condition, which is not the same
+    // as broadcasting it.
+    for (const Instruction& inst : instructions_) {
+      OP_REQUIRES(ctx,
+                  inst.kind != Kind::kSelect || inst.args[0] >= num_inputs ||
+                      broadcasts[inst.args[0]] != Broadcast::kRow,
+                  errors::InvalidArgument(
+                      "The condition of Select must be a scalar or have the ",
+                      "shape of its output"));
+    }
+
+    Tensor* out = nullptr;
+    OP_REQUIRES_OK(ctx, ctx->forward_input_or_allocate_output(
+                            forwardable, 0, out_shape, &out));
+    if (out->NumElements() == 0) return;
+    T* out_data = out->flat<T>().data();
+
+    auto compute_fn = [this, ctx, num_inputs, &broadcasts, out_data](
+                          int64 begin, int64 end) {
+      std::vector<T, Eigen::aligned_allocator<T>> scratch(num_slots_ *
+                                                          kBlockSize);
+      // A temporary tensor, so that the bool slots are aligned like the
+      // others.
+      Tensor bool_scratch;
+      const int64 bool_scratch_size = int64{num_bool_slots_} * kBlockSize;
+      OP_REQUIRES_OK(ctx, ctx->allocate_temp(DT_BOOL,
+                                             TensorShape({bool_scratch_size}),
+                                             &bool_scratch));
+      bool* bool_data = bool_scratch.flat<bool>().data();
+      std::vector<const void*> values(value_is_bool_.size());
+      auto slot = [this, &scratch, bool_data](int value) -> void* {
+        if (value_is_bool_[value]) {
+          return bool_data + value_slots_[value] * kBlockSize;
+        }
+        return scratch.data() + value_slots_[value] * kBlockSize;
+      };
+
+      for (int64 block = begin; block < end; block += kBlockSize) {
+        const int64 len = std::min<int64>(end - block, int64{kBlockSize});
+        for (int i = 0; i < num_inputs; ++i) {
+          values[i] = LoadInput(ctx->input(i), input_types_[i], broadcasts[i],
+                                block, len, slot(i));
+        }
+        for (size_t j = 0; j < instructions_.size(); ++j) {
+          const Instruction& inst = instructions_[j];
+          void* result = j + 1 == instructions_.size()
+                             ? static_cast<void*>(out_data + block)
+                             : slot(inst.result);
+          Run(inst, values, len, result);
+          values[inst.result] = result;
+        }
+      }
+    };
+
+    const CPUDevice& device = ctx->eigen_device<CPUDevice>();
+    const int kOverheadCycles = static_cast<int>(instructions_.size()) * 10;
+    Eigen::TensorOpCost cost(/*bytes_loaded=*/sizeof(T) * num_inputs,
+                             /*bytes_stored=*/sizeof(T),
+                             kOverheadCycles + cost_);
+    device.parallelFor(out->NumElements(), cost, AlignBlockSize,
+                       std::move(compute_fn));
+  }
+
+ private:
+  // The number of elements of a block. Must be a multiple of the packet size,
+  // so that all blocks are aligned.
+  static constexpr int kBlockSize = 512;
+
+  static const int kPacketSize = Eigen::internal::unpacket_traits<Packet>::size;
+
+  enum class Kind {
+    kUnary,
+    kBinary,
+    kCompare,
+    kLogical,
+    kLogicalNot,
+    kSelect,
+    kCast,
+    kCastBool,
+  };
+
+  // How an input is broadcast to the shape of the output.
+  enum class Broadcast { kNone, kScalar, kRow };
+
+  struct Instruction {
+    Kind kind;
+    UnaryFn unary_fn = nullptr;
+    BinaryFn binary_fn = nullptr;
+    CompareFn compare_fn = nullptr;
+    LogicalFn logical_fn = nullptr;
+    // The values of the operands and of the result. The first values are the
+    // inputs of the kernel, followed by the results of the instructions.
+    int args[3] = {-1, -1, -1};
+    int result = -1;
+  };
+
+  static inline int64 AlignBlockSize(int64 block_size) {
+    return (block_size + kBlockSize - 1) / kBlockSize * kBlockSize;
+  }
+
+  static bool IsConvertibleInputType(DataType dtype) {
+    switch (dtype) {
+      case DT_HALF:
+      case DT_FLOAT:
+      case DT_DOUBLE:
+      case DT_INT8:
+      case DT_INT16:
+      case DT_INT32:
+      case DT_INT64:
+      case DT_UINT8:
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  // Returns how an input of `shape` is broadcast to `out_shape`, or false if
+  // it is broadcast in another way.
+  static bool GetBroadcast(const TensorShape& shape,
+                           const TensorShape& out_shape,
+                           Broadcast* broadcast) {
+    if (shape.num_elements() == out_shape.num_elements()) {
+      *broadcast = Broadcast::kNone;
+      return true;
+    }
+    if (shape.num_elements() == 1) {
+      *broadcast = Broadcast::kScalar;
+      return true;
+    }
+    int first = 0;
+    while (first < shape.dims() && shape.dim_size(first) == 1) ++first;
+    const int offset = out_shape.dims() - shape.dims();
+    for (int d = first; d < shape.dims(); ++d) {
+      if (shape.dim_size(d) != out_shape.dim_size(offset + d)) return false;
+    }
+    *broadcast = Broadcast::kRow;
+    return true;
+  }
+
+  template <typename Functor>
+  static void ComputeBinary(const InputBuffer& x, const InputBuffer& y,
+                            OutputBuffer* out) {
+    *out = x.binaryExpr(y, typename Functor::func());
+  }
+
+  template <typename Functor>
+  static void ComputeCompare(const InputBuffer& x, const InputBuffer& y,
+                             BoolOutputBuffer* out) {
+    *out = x.binaryExpr(y, typename Functor::func());
+  }
+
+  template <typename Functor>
+  static void ComputeLogical(const BoolInputBuffer& x,
+                             const BoolInputBuffer& y, BoolOutputBuffer* out) {
+    *out = x.binaryExpr(y, typename Functor::func());
+  }
+
+  template <typename Functor>
+  static int Cost() {
+    return Eigen::internal::functor_traits<typename Functor::func>::Cost;
+  }
+
+  static bool GetBinaryFn(const string& op_name, BinaryFn* fn, int* cost) {
+#define BINARY_FN(name, functor)    \
+  if (op_name == name) {            \
+    *fn = ComputeBinary<functor>;   \
+    *cost = Cost<functor>();        \
+    return true;                    \
+  }
+    BINARY_FN("Add", functor::add<T>);
+    BINARY_FN("AddV2", functor::add<T>);
+    BINARY_FN("Sub", functor::sub<T>);
+    BINARY_FN("Mul", functor::mul<T>);
+    BINARY_FN("Div", functor::div<T>);
+    BINARY_FN("RealDiv", functor::div<T>);
+    BINARY_FN("Maximum", functor::maximum<T>);
+    BINARY_FN("Minimum", functor::minimum<T>);
+    BINARY_FN("SquaredDifference", functor::squared_difference<T>);
+#undef BINARY_FN
+    return false;
+  }
+
+  static bool GetCompareFn(const string& op_name, CompareFn* fn, int* cost) {
+#define COMPARE_FN(name, functor)   \
+  if (op_name == name) {            \
+    *fn = ComputeCompare<functor>;  \
+    *cost = Cost<functor>();        \
+    return true;                    \
+  }
+    COMPARE_FN("Less", functor::less<T>);
+    COMPARE_FN("LessEqual", functor::less_equal<T>);
+    COMPARE_FN("Greater", functor::greater<T>);
+    COMPARE_FN("GreaterEqual", functor::greater_equal<T>);
+    COMPARE_FN("Equal", functor::equal_to<T>);
+    COMPARE_FN("NotEqual", functor::not_equal_to<T>);
+#undef COMPARE_FN
+    return false;
+  }
+
+  static bool GetLogicalFn(const string& op_name, LogicalFn* fn, int* cost) {
+    if (op_name == "LogicalAnd") {
+      *fn = ComputeLogical<functor::logical_and>;
+    } else if (op_name == "LogicalOr") {
+      *fn = ComputeLogical<functor::logical_or>;
+    } else {
+      return false;
+    }
+    *cost = 1;
+    return true;
+  }
+
+  // Assigns a scratch slot of kBlockSize elements to every value but the
+  // result of the last instruction, which is written to the output. Values
+  // share a slot if their lifetimes do not overlap.
+  void AssignScratchSlots() {
+    const int num_values = value_is_bool_.size();
+    const int num_inputs = input_types_.size();
+    std::vector<int> last_use(num_values, -1);
+    for (int j = 0; j < instructions_.size(); ++j) {
+      for (int arg : instructions_[j].args) {
+        if (arg >= 0) last_use[arg] = j;
+      }
+    }
+    value_slots_.assign(num_values, -1);
+    std::vector<int> free_slots[2];
+    int* num_slots[2] = {&num_slots_, &num_bool_slots_};
+    auto allocate = [&](int value) {
+      std::vector<int>& free = free_slots[value_is_bool_[value]];
+      if (free.empty()) {
+        value_slots_[value] = (*num_slots[value_is_bool_[value]])++;
+      } else {
+        value_slots_[value] = free.back();
+        free.pop_back();
+      }
+    };
+    // Inputs are loaded at the start of each block.
+    for (int i = 0; i < num_inputs; ++i) allocate(i);
+    for (int j = 0; j + 1 < instructions_.size(); ++j) {
+      // Elementwise ops may write their result over their operands.
+      for (int arg : instructions_[j].args) {
+        if (arg >= 0 && last_use[arg] == j && value_slots_[arg] >= 0) {
+          free_slots[value_is_bool_[arg]].push_back(value_slots_[arg]);
+          value_slots_[arg] = -value_slots_[arg] - 2;  // Released.
+        }
+      }
+      allocate(instructions_[j].result);
+    }
+    // Restore the slots of released values.
+    for (int& slot : value_slots_) {
+      if (slot < -1) slot = -slot - 2;
+    }
+  }
+
+  template <typename Src, typename Dst>
+  static void LoadBlock(const Src* data, Broadcast broadcast, int64 period,
+                        int64 begin, int64 len, Dst* dst) {
+    switch (broadcast) {
+      case Broadcast::kNone:
+        for (int64 i = 0; i < len; ++i) {
+          dst[i] = static_cast<Dst>(data[begin + i]);
+        }
+        break;
+      case Broadcast::kScalar:
+        std::fill_n(dst, len, static_cast<Dst>(data[0]));
+        break;
+      case Broadcast::kRow: {
+        int64 pos = begin % period;
+        for (int64 i = 0; i < len; ++i) {
+          dst[i] = static_cast<Dst>(data[pos]);
+          if (++pos == period) pos = 0;
+        }
+        break;
+      }
+    }
+  }
+
+  // Returns the elements [begin, begin + len) of `input` broadcast to the
+  // output and converted to T (or bool), in `slot` unless they can be read
+  // in place.
+  static const void* LoadInput(const Tensor& input, DataType dtype,
+                               Broadcast broadcast, int64 begin, int64 len,
+                               void* slot) {
+    const int64 period = input.NumElements();
+    if (dtype == DT_BOOL) {
+      const bool* data = input.flat<bool>().data();
+      if (broadcast == Broadcast::kNone) return data + begin;
+      LoadBlock(data, broadcast, period, begin, len, static_cast<bool*>(slot));
+      return slot;
+    }
+    if (dtype == DataTypeToEnum<T>::value && broadcast == Broadcast::kNone) {
+      return input.flat<T>().data() + begin;
+    }
+    switch (dtype) {
+#define LOAD_CASE(Src)                                                    \
+  case DataTypeToEnum<Src>::value:                                       \
+    LoadBlock(input.flat<Src>().data(), broadcast, period, begin, len,   \
+              static_cast<T*>(slot));                                    \
+    break;
+      TF_CALL_half(LOAD_CASE);
+      TF_CALL_float(LOAD_CASE);
+      TF_CALL_double(LOAD_CASE);
+      TF_CALL_int8(LOAD_CASE);
+      TF_CALL_int16(LOAD_CASE);
+      TF_CALL_int32(LOAD_CASE);
+      TF_CALL_int64(LOAD_CASE);
+      TF_CALL_uint8(LOAD_CASE);
+#undef LOAD_CASE
+      default:
+        LOG(FATAL) << "Unexpected input type " << DataTypeString(dtype);
+    }
+    return slot;
+  }
+
+  static void Run(const Instruction& inst,
+                  const std::vector<const void*>& values, int64 len,
+                  void* result) {
+    auto arg = [&inst, &values, len](int i) {
+      return InputBuffer(static_cast<const T*>(values[inst.args[i]]), len);
+    };
+    auto bool_arg = [&inst, &values, len](int i) {
+      return BoolInputBuffer(static_cast<const bool*>(values[inst.args[i]]),
+                             len);
+    };
+    OutputBuffer out(static_cast<T*>(result), len);
+    BoolOutputBuffer bool_out(static_cast<bool*>(result), len);
+    switch (inst.kind) {
+      case Kind::kUnary:
+        inst.unary_fn(arg(0), &out);
+        break;
+      case Kind::kBinary:
+        inst.binary_fn(arg(0), arg(1), &out);
+        break;
+      case Kind::kCompare:
+        inst.compare_fn(arg(0), arg(1), &bool_out);
+        break;
+      case Kind::kLogical:
+        inst.logical_fn(bool_arg(0), bool_arg(1), &bool_out);
+        break;
+      case Kind::kLogicalNot:
+        bool_out = bool_arg(0).unaryExpr(functor::logical_not::func());
+        break;
+      case Kind::kSelect:
+        out = bool_arg(0).select(arg(1), arg(2));
+        break;
+      case Kind::kCast:
+        if (result != values[inst.args[0]]) {
+          std::copy_n(static_cast<const T*>(values[inst.args[0]]), len,
+                      static_cast<T*>(result));
+        }
+        break;
+      case Kind::kCastBool: {
+        const bool* in = static_cast<const bool*>(values[inst.args[0]]);
+        T* dst = static_cast<T*>(result);
+        for (int64 i = 0; i < len; ++i) dst[i] = static_cast<T>(in[i]);
+        break;
+      }
+    }
+  }
+
+  Support support_;
+
+  std::vector<DataType> input_types_;
+  std::vector<Instruction> instructions_;
+  // Whether each value is a bool, rather than a T.
+  std::vector<bool> value_is_bool_;
+  // The scratch slot of each value, in the slots of its type.
+  std::vector<int> value_slots_;
+  int num_slots_ = 0;
+  int num_bool_slots_ = 0;
+  int cost_ = 0;
+};
+
 // Register the CPU kernels.
 #define REGISTER_CPU(T)                                                       \
   REGISTER_KERNEL_BUILDER(                                                    \
       Name("_UnaryOpsComposition").Device(DEVICE_CPU).TypeConstraint<T>("T"), \
-      UnaryOpsComposition<T>);
+      UnaryOpsComposition<T>);                                                \
+  REGISTER_KERNEL_BUILDER(Name("_ElementwiseOpsComposition")                  \
+                              .Device(DEVICE_CPU)                             \
+                              .TypeConstraint<T>("T"),                        \
+                          ElementwiseOpsComposition<T>);
 
 REGISTER_CPU(float);
 REGISTER_CPU(Eigen::half);
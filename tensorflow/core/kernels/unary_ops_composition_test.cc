@@ -79,6 +79,69 @@ TEST_F(UnaryOpsCompositionTest, Compose_Tanh_Relu6_F) {
   RunComposedOp<float>({"Relu6"}, 11.0f, 6.0f);
 }
 
+class ElementwiseOpsCompositionTest : public OpsTestBase {};
+
+// y = Select(mask, x * row, Cast(i)), over more elements than one block.
+TEST_F(ElementwiseOpsCompositionTest, SelectMulCast) {
+  TF_ASSERT_OK(
+      NodeDefBuilder("elementwise_ops_composition",
+                     "_ElementwiseOpsComposition")
+          .Input(FakeInput({DT_FLOAT, DT_FLOAT, DT_BOOL, DT_INT32}))
+          .Attr("T", DT_FLOAT)
+          .Attr("op_names", {"Mul", "Cast", "Select"})
+          .Attr("operands", {0, 1, 3, 2, 4, 5})
+          .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+
+  const int rows = 3;
+  const int cols = 700;
+  AddInput<float>(TensorShape({rows, cols}),
+                  [](int i) -> float { return i * 0.5f; });
+  AddInput<float>(TensorShape({cols}), [](int i) -> float { return i; });
+  AddInput<bool>(TensorShape({rows, cols}),
+                 [](int i) -> bool { return i % 3 != 0; });
+  AddInput<int32>(TensorShape({rows, cols}), [](int i) -> int32 { return -i; });
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({rows, cols}));
+  test::FillFn<float>(&expected, [cols](int i) -> float {
+    return i % 3 != 0 ? i * 0.5f * (i % cols) : -i;
+  });
+  test::ExpectClose(expected, *GetOutput(0));
+}
+
+TEST_F(ElementwiseOpsCompositionTest, ScalarAndComparison) {
+  TF_ASSERT_OK(
+      NodeDefBuilder("elementwise_ops_composition",
+                     "_ElementwiseOpsComposition")
+          .Input(FakeInput({DT_DOUBLE, DT_DOUBLE}))
+          .Attr("T", DT_DOUBLE)
+          .Attr("op_names", {"Greater", "Sub", "Neg", "Select"})
+          // Select(x > c, x - c, -c)
+          .Attr("operands", {0, 1, 0, 1, 1, 2, 3, 4})
+          .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+
+  AddInputFromArray<double>(TensorShape({5}), {1, 2, 3, 4, 5});
+  AddInputFromArray<double>(TensorShape({}), {3});
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected(allocator(), DT_DOUBLE, TensorShape({5}));
+  test::FillValues<double>(&expected, {-3, -3, -3, 1, 2});
+  test::ExpectClose(expected, *GetOutput(0));
+}
+
+TEST_F(ElementwiseOpsCompositionTest, RejectsOperandsOfTheWrongType) {
+  TF_ASSERT_OK(NodeDefBuilder("elementwise_ops_composition",
+                              "_ElementwiseOpsComposition")
+                   .Input(FakeInput({DT_FLOAT, DT_BOOL}))
+                   .Attr("T", DT_FLOAT)
+                   .Attr("op_names", {"Add"})
+                   .Attr("operands", {0, 1})
+                   .Finalize(node_def()));
+  EXPECT_FALSE(InitOp().ok());
+}
+
 // Performance benchmarks below.
 
 string Function(int i) {
@@ -13,9 +13,11 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <algorithm>
 #include <functional>
-#include <unordered_map>
+#include <numeric>
 #include <utility>
+#include <vector>
 
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
@@ -23,12 +25,38 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/kernels/bounds_check.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/gtl/flatmap.h"
 #include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 
 typedef Eigen::ThreadPoolDevice CPUDevice;
 
+namespace {
+
+// Inputs of the single-element path with at least this many elements are
+// deduplicated in parallel when the device has more than one worker thread.
+constexpr int64 kParallelUniqueThreshold = 1 << 20;
+
+// The shard of an element is stored in a uint8.
+constexpr int kMaxUniqueShards = 256;
+
+// Rough per-element costs (in cycles) used to shard the parallel path.
+constexpr int64 kHashCost = 20;
+constexpr int64 kInsertCost = 100;
+
+// Maps an element to one of "num_shards" disjoint key sets. The bits are
+// taken from the high half of a multiplicative hash because gtl::FlatMap
+// uses the low bits of the same hash to place the element.
+template <typename T>
+inline int UniqueShard(const T& value, int num_shards) {
+  const uint64 h = static_cast<uint64>(hash<T>{}(value));
+  return ((h * 0x9E3779B97F4A7C15ULL) >> 32) % num_shards;
+}
+
+}  // namespace
+
 template <typename T, typename TIndex>
 class UniqueOp : public OpKernel {
  public:
@@ -106,8 +134,17 @@ class UniqueOp : public OpKernel {
       auto Tin = input.flat<T>();
       const int64 N = static_cast<int64>(Tin.size());
 
-      std::unordered_map<T, TIndex> uniq;
-      uniq.reserve(2 * N);
+      const int num_shards = std::min(
+          kMaxUniqueShards,
+          context->device()->tensorflow_cpu_worker_threads()->num_threads);
+      if (N >= kParallelUniqueThreshold && num_shards > 1) {
+        OP_REQUIRES_OK(context, ComputeSharded(context, input, axis,
+                                               num_shards, idx_vec,
+                                               &uniq_size));
+        return;
+      }
+
+      gtl::FlatMap<T, TIndex> uniq(N);
       for (int64 i = 0, j = 0; i < N; ++i) {
         auto it = uniq.insert(std::make_pair(Tin(i), j));
         idx_vec(i) = it.first->second;
@@ -124,7 +161,7 @@ class UniqueOp : public OpKernel {
                      context->allocate_output(0, output_shape, &output));
       auto Tout = output->flat<T>();
 
-      for (auto it : uniq) {
+      for (const auto& it : uniq) {
         Tout(it.second) = it.first;
       }
     } else {
@@ -152,10 +189,8 @@ class UniqueOp : public OpKernel {
         return true;
       };
 
-      std::unordered_map<int64, int64, decltype(hash_fn), decltype(equal_to_fn)>
-          uniq(0, hash_fn, equal_to_fn);
-
-      uniq.reserve(2 * Tin.dimension(1));
+      gtl::FlatMap<int64, int64, decltype(hash_fn), decltype(equal_to_fn)>
+          uniq(Tin.dimension(1), hash_fn, equal_to_fn);
 
       for (int64 i = 0, j = 0; i < Tin.dimension(1); ++i) {
         auto it = uniq.insert(std::make_pair(i, j));
@@ -174,7 +209,7 @@ class UniqueOp : public OpKernel {
                      context->allocate_output(0, output_shape, &output));
       auto Tout = output->shaped<T, 3>(new_sizes);
 
-      for (auto it : uniq) {
+      for (const auto& it : uniq) {
         Tout.chip(it.second, 1) = Tin.chip(it.first, 1);
       }
     }
@@ -191,6 +226,168 @@ class UniqueOp : public OpKernel {
       }
     }
   }
+
+ private:
+  struct FirstOccurrence {
+    TIndex position;
+    TIndex count;
+  };
+
+  // Parallel version of the single-element path, which produces the same
+  // outputs. The elements are partitioned by hash into "num_shards"
+  // disjoint key sets in one pass, each set is deduplicated by one task, and
+  // the unique elements are then numbered in order of first occurrence by a
+  // parallel prefix count. The total work stays linear in the input size.
+  Status ComputeSharded(OpKernelContext* context, const Tensor& input,
+                        int64 axis, int num_shards,
+                        typename TTypes<TIndex>::Vec idx_vec,
+                        int64* uniq_size) {
+    auto Tin = input.flat<T>();
+    const int64 N = static_cast<int64>(Tin.size());
+    const DeviceBase::CpuWorkerThreads& worker_threads =
+        *context->device()->tensorflow_cpu_worker_threads();
+    const int max_parallelism = worker_threads.num_threads;
+    thread::ThreadPool* workers = worker_threads.workers;
+
+    // Partition the positions by shard in one pass, like a counting sort:
+    // count the elements of each shard in each block of positions, then
+    // scatter the positions so that those of each shard are contiguous and
+    // in increasing order.
+    const int64 num_partition_blocks =
+        std::min<int64>(N, 4 * max_parallelism);
+    const int64 partition_block_size =
+        (N + num_partition_blocks - 1) / num_partition_blocks;
+    std::vector<uint8> shard_of(N);
+    // shard_counts[b * num_shards + s] is the number of elements of shard s in
+    // block b, and then the position in 'positions' of the next one.
+    std::vector<int64> shard_counts(num_partition_blocks * num_shards, 0);
+    Shard(max_parallelism, workers, num_partition_blocks,
+          partition_block_size * kHashCost,
+          [&Tin, &shard_of, &shard_counts, partition_block_size, num_shards,
+           N](int64 start, int64 limit) {
+            for (int64 b = start; b < limit; ++b) {
+              int64* counts = &shard_counts[b * num_shards];
+              const int64 end = std::min(N, (b + 1) * partition_block_size);
+              for (int64 i = b * partition_block_size; i < end; ++i) {
+                const int s = UniqueShard(Tin(i), num_shards);
+                shard_of[i] = s;
+                ++counts[s];
+              }
+            }
+          });
+    std::vector<int64> shard_begin(num_shards + 1, 0);
+    int64 offset = 0;
+    for (int s = 0; s < num_shards; ++s) {
+      shard_begin[s] = offset;
+      for (int64 b = 0; b < num_partition_blocks; ++b) {
+        const int64 count = shard_counts[b * num_shards + s];
+        shard_counts[b * num_shards + s] = offset;
+        offset += count;
+      }
+    }
+    shard_begin[num_shards] = offset;
+    std::vector<TIndex> positions(N);
+    Shard(max_parallelism, workers, num_partition_blocks, partition_block_size,
+          [&shard_of, &shard_counts, &positions, partition_block_size,
+           num_shards, N](int64 start, int64 limit) {
+            for (int64 b = start; b < limit; ++b) {
+              int64* next = &shard_counts[b * num_shards];
+              const int64 end = std::min(N, (b + 1) * partition_block_size);
+              for (int64 i = b * partition_block_size; i < end; ++i) {
+                positions[next[shard_of[i]]++] = static_cast<TIndex>(i);
+              }
+            }
+          });
+    std::vector<uint8>().swap(shard_of);
+    std::vector<int64>().swap(shard_counts);
+
+    // Afterwards idx_vec(i) temporarily holds the position of the first
+    // occurrence of Tin(i). Each shard visits its positions in increasing
+    // order, so the first one inserted for a key is its first occurrence.
+    std::vector<gtl::FlatMap<T, FirstOccurrence>> uniqs(num_shards);
+    Shard(max_parallelism, workers, num_shards, N / num_shards * kInsertCost,
+          [&Tin, &positions, &shard_begin, &uniqs, &idx_vec](int64 start,
+                                                             int64 limit) {
+            for (int64 s = start; s < limit; ++s) {
+              gtl::FlatMap<T, FirstOccurrence>& uniq = uniqs[s];
+              uniq.reserve(shard_begin[s + 1] - shard_begin[s]);
+              for (int64 p = shard_begin[s]; p < shard_begin[s + 1]; ++p) {
+                const TIndex i = positions[p];
+                const FirstOccurrence first = {i, 0};
+                auto it = uniq.insert(std::make_pair(Tin(i), first));
+                ++it.first->second.count;
+                idx_vec(i) = it.first->second.position;
+              }
+            }
+          });
+    std::vector<TIndex>().swap(positions);
+
+    // Count the first occurrences in each block of positions.
+    const int64 num_blocks = std::min<int64>(N, 4 * max_parallelism);
+    const int64 block_size = (N + num_blocks - 1) / num_blocks;
+    std::vector<int64> block_offsets(num_blocks + 1, 0);
+    Shard(max_parallelism, workers, num_blocks, block_size,
+          [&idx_vec, &block_offsets, block_size, N](int64 start,
+                                                    int64 limit) {
+            for (int64 b = start; b < limit; ++b) {
+              const int64 end = std::min(N, (b + 1) * block_size);
+              int64 count = 0;
+              for (int64 i = b * block_size; i < end; ++i) {
+                if (idx_vec(i) == i) ++count;
+              }
+              block_offsets[b + 1] = count;
+            }
+          });
+    std::partial_sum(block_offsets.begin(), block_offsets.end(),
+                     block_offsets.begin());
+    *uniq_size = block_offsets[num_blocks];
+
+    TensorShape output_shape(input.shape());
+    output_shape.set_dim(axis, *uniq_size);
+    Tensor* output = nullptr;
+    TF_RETURN_IF_ERROR(context->allocate_output(0, output_shape, &output));
+    auto Tout = output->flat<T>();
+
+    // ids[p] is the output index of the element first occurring at p.
+    std::vector<TIndex> ids(N);
+    Shard(max_parallelism, workers, num_blocks, block_size,
+          [&Tin, &Tout, &idx_vec, &block_offsets, &ids, block_size, N](
+              int64 start, int64 limit) {
+            for (int64 b = start; b < limit; ++b) {
+              const int64 end = std::min(N, (b + 1) * block_size);
+              TIndex next = block_offsets[b];
+              for (int64 i = b * block_size; i < end; ++i) {
+                if (idx_vec(i) == i) {
+                  ids[i] = next;
+                  Tout(next) = Tin(i);
+                  ++next;
+                }
+              }
+            }
+          });
+    Shard(max_parallelism, workers, N, 1,
+          [&idx_vec, &ids](int64 start, int64 limit) {
+            for (int64 i = start; i < limit; ++i) {
+              idx_vec(i) = ids[idx_vec(i)];
+            }
+          });
+
+    if (num_outputs() > 2) {
+      Tensor* count_output = nullptr;
+      TF_RETURN_IF_ERROR(context->allocate_output(
+          2, TensorShape({*uniq_size}), &count_output));
+      auto count_output_vec = count_output->template vec<TIndex>();
+      Shard(max_parallelism, workers, num_shards, N / num_shards,
+            [&uniqs, &ids, &count_output_vec](int64 start, int64 limit) {
+              for (int64 s = start; s < limit; ++s) {
+                for (const auto& it : uniqs[s]) {
+                  count_output_vec(ids[it.second.position]) = it.second.count;
+                }
+              }
+            });
+    }
+    return Status::OK();
+  }
 };
 
 #define REGISTER_UNIQUE(type)                                    \
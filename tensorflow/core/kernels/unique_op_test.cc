@@ -15,6 +15,7 @@ limitations under the License.
 
 #include <functional>
 #include <memory>
+#include <unordered_map>
 
 #include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
 #include "tensorflow/core/framework/tensor.h"
@@ -26,6 +27,8 @@ limitations under the License.
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/kernels/ops_util.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/public/session_options.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
 
@@ -102,6 +105,73 @@ static void BM_Unique_INT32_Repeat(int iters, int dim, int max_int) {
   test::Benchmark("cpu", g).Run(iters);
 }
 
+// Returns `dim` embedding-id-like int64s, each repeated about 4 times.
+Tensor GetRandomIdsTensor(int dim) {
+  Tensor input(DT_INT64, TensorShape({dim}));
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  auto input_flat = input.flat<int64>();
+  for (int i = 0; i < dim; ++i) {
+    input_flat(i) = rnd.Uniform64(dim / 4);
+  }
+  return input;
+}
+
+// Compares the serial path (num_threads = 1) against the parallel path of
+// the single-element case on embedding-id-like int64 inputs.
+static void BM_Unique_INT64_Threads(int iters, int dim, int num_threads) {
+  testing::StopTiming();
+  Graph* g = new Graph(OpRegistry::Global());
+
+  Tensor input = GetRandomIdsTensor(dim);
+
+  Node* node;
+  TF_CHECK_OK(NodeBuilder(g->NewName("n"), "Unique")
+                  .Input(test::graph::Constant(g, input))
+                  .Attr("T", DT_INT64)
+                  .Finalize(g, &node));
+
+  SessionOptions options;
+  options.config.set_intra_op_parallelism_threads(num_threads);
+  testing::BytesProcessed(static_cast<int64>(iters) * dim * sizeof(int64));
+  testing::UseRealTime();
+  testing::StartTiming();
+  test::Benchmark("cpu", g, &options).Run(iters);
+}
+
+// The single-element path of UniqueOp before it used gtl::FlatMap and
+// sharding, on the inputs of BM_Unique_INT64_Threads. It runs the loop
+// directly, without the overhead of running a graph, so it is an upper bound
+// on the throughput of the original kernel.
+static void BM_Unique_INT64_Baseline(int iters, int dim) {
+  testing::StopTiming();
+  const Tensor input = GetRandomIdsTensor(dim);
+  const auto Tin = input.flat<int64>();
+  const int64 N = Tin.size();
+
+  testing::BytesProcessed(static_cast<int64>(iters) * dim * sizeof(int64));
+  testing::UseRealTime();
+  testing::StartTiming();
+  for (int iter = 0; iter < iters; ++iter) {
+    Tensor idx(DT_INT32, TensorShape({dim}));
+    auto idx_vec = idx.vec<int32>();
+    std::unordered_map<int64, int32> uniq;
+    uniq.reserve(2 * N);
+    for (int64 i = 0, j = 0; i < N; ++i) {
+      auto it = uniq.insert(std::make_pair(Tin(i), j));
+      idx_vec(i) = it.first->second;
+      if (it.second) {
+        ++j;
+      }
+    }
+    Tensor output(DT_INT64, TensorShape({static_cast<int64>(uniq.size())}));
+    auto Tout = output.flat<int64>();
+    for (auto it : uniq) {
+      Tout(it.second) = it.first;
+    }
+  }
+}
+
 TensorProto GetRandomStringsTensorProto(int dim, int max_str_len) {
   TensorProto tensor_proto;
   tensor_proto.set_dtype(DT_STRING);
@@ -180,6 +250,16 @@ BENCHMARK(BM_Unique_INT32_Repeat)
     ->ArgPair(64 * 1024, 64 * 1024 * 1024)
     ->ArgPair(1024 * 1024, 64 * 1024 * 1024);
 
+BENCHMARK(BM_Unique_INT64_Threads)
+    ->ArgPair(1024 * 1024, 1)
+    ->ArgPair(1024 * 1024, 8)
+    ->ArgPair(1024 * 1024, 32)
+    ->ArgPair(10 * 1024 * 1024, 1)
+    ->ArgPair(10 * 1024 * 1024, 8)
+    ->ArgPair(10 * 1024 * 1024, 32);
+
+BENCHMARK(BM_Unique_INT64_Baseline)->Arg(1024 * 1024)->Arg(10 * 1024 * 1024);
+
 BENCHMARK(BM_Unique_STRING)
     ->Arg(32)
     ->Arg(256)
@@ -454,6 +454,28 @@ REGISTER_OP("FusedPadConv2D")
       return CommonFusedConvCalculations(c, false /* has_resize */);
     });
 
+// Conv2D followed by the ops in `fused_ops`, which the remapper creates from
+// Conv2D, BiasAdd, FusedBatchNorm and Relu/Relu6/Elu nodes. `args` are the
+// arguments of the fused ops. Only NHWC is implemented, and only on CPU.
+REGISTER_OP("_FusedConv2D")
+    .Input("input: T")
+    .Input("filter: T")
+    .Input("args: num_args * T")
+    .Output("output: T")
+    .Attr("T: {float, double}")
+    .Attr("num_args: int >= 0")
+    .Attr("strides: list(int)")
+    .Attr(GetPaddingAttrString())
+    .Attr(GetConvnetDataFormatAttrString())
+    .Attr("dilations: list(int) = [1, 1, 1, 1]")
+    .Attr("fused_ops: list(string) = []")
+    .Attr("epsilon: float = 0.0001")
+    .SetShapeFn(shape_inference::Conv2DShape)
+    .Doc(R"doc(
+*NOTE*: Do not invoke this operator directly in Python. Grappler is
+expected to create these operators.
+)doc");
+
 // --------------------------------------------------------------------------
 
 REGISTER_OP("DepthwiseConv2dNative")
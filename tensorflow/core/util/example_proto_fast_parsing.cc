@@ -14,6 +14,7 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/util/example_proto_fast_parsing.h"
 
+#include <cstring>
 #include <vector>
 
 #include "tensorflow/core/example/example.pb.h"
@@ -24,9 +25,11 @@ limitations under the License.
 #include "tensorflow/core/lib/core/blocking_counter.h"
 #include "tensorflow/core/lib/core/casts.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/raw_coding.h"
 #include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/monitoring/counter.h"
+#include "tensorflow/core/platform/byte_order.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/util/presized_cuckoo_map.h"
@@ -60,6 +63,132 @@ constexpr uint8 kVarintTag(uint32 tag) { return (tag << 3) | 0; }
 constexpr uint8 kDelimitedTag(uint32 tag) { return (tag << 3) | 2; }
 constexpr uint8 kFixed32Tag(uint32 tag) { return (tag << 3) | 5; }
 
+template <typename T>
+class LimitedArraySlice {
+ public:
+  LimitedArraySlice(T* begin, size_t num_elements)
+      : current_(begin), end_(begin + num_elements) {}
+
+  // May return negative if there were push_back calls after slice was filled.
+  int64 EndDistance() const { return end_ - current_; }
+
+  // Attempts to push value to the back of this. If the slice has
+  // already been filled, this method has no effect on the underlying data, but
+  // it changes the number returned by EndDistance into negative values.
+  void push_back(T&& value) {
+    if (EndDistance() > 0) *current_ = std::move(value);
+    ++current_;
+  }
+
+  // Appends `n` elements to this, and returns a pointer to them for the
+  // caller to fill. If they do not fit, returns nullptr; as with push_back,
+  // EndDistance then returns a negative value.
+  T* Grow(size_t n) {
+    T* begin = current_;
+    current_ += n;
+    return EndDistance() >= 0 ? begin : nullptr;
+  }
+
+ private:
+  T* current_;
+  T* end_;
+};
+
+template <typename T>
+T* Grow(SmallVector<T>* list, size_t n) {
+  const size_t size = list->size();
+  list->resize(size + n);
+  return list->data() + size;
+}
+
+template <typename T>
+T* Grow(LimitedArraySlice<T>* list, size_t n) {
+  return list->Grow(n);
+}
+
+// Packed float and int64 lists are decoded straight from the serialized
+// bytes rather than one element at a time through CodedInputStream, whose
+// per-element overhead dominates the parsing of numeric features.
+
+// Points `*data` at the next `length` bytes of `stream` and skips them.
+bool ReadPackedBytes(protobuf::io::CodedInputStream* stream, uint32 length,
+                     const uint8** data) {
+  *data = nullptr;
+  if (length == 0) return true;
+  const void* ptr;
+  int size;
+  if (!stream->GetDirectBufferPointer(&ptr, &size) ||
+      static_cast<uint32>(size) < length) {
+    return false;
+  }
+  *data = static_cast<const uint8*>(ptr);
+  return stream->Skip(length);
+}
+
+// Copies `n` little-endian floats from `data` to `out`.
+void CopyPackedFloats(const uint8* data, size_t n, float* out) {
+  if (port::kLittleEndian) {
+    if (n > 0) std::memcpy(out, data, n * sizeof(float));
+    return;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = bit_cast<float>(
+        core::DecodeFixed32(reinterpret_cast<const char*>(data) + 4 * i));
+  }
+}
+
+// Returns the number of varints in `data[0, size)`, which is the number of
+// bytes without the continuation bit. The loop is simple enough for the
+// compiler to vectorize.
+size_t CountPackedVarints(const uint8* data, size_t size) {
+  size_t n = 0;
+  for (size_t i = 0; i < size; ++i) {
+    n += data[i] < 0x80;
+  }
+  return n;
+}
+
+// Decodes the varints in `data[0, size)` to `out`, which must have room for
+// CountPackedVarints(data, size) values. If `out` is null, only validates
+// them. Returns false if the varints are malformed.
+bool DecodePackedVarints(const uint8* data, size_t size, int64* out) {
+  if (size == 0) return true;
+  const uint8* p = data;
+  const uint8* const end = data + size;
+  // Every varint, including the last one, ends within `data`.
+  if (end[-1] >= 0x80) return false;
+  while (p != end) {
+    // Fast path for eight one-byte varints, which are common in lists of
+    // small ids and counts.
+    if (end - p >= 8) {
+      uint64 word;
+      std::memcpy(&word, p, sizeof(word));
+      if ((word & 0x8080808080808080ULL) == 0) {
+        if (out != nullptr) {
+          for (int i = 0; i < 8; ++i) {
+            out[i] = p[i];
+          }
+          out += 8;
+        }
+        p += 8;
+        continue;
+      }
+    }
+    uint64 value = 0;
+    for (int shift = 0;; shift += 7) {
+      // A varint has at most 10 bytes.
+      if (shift > 63) return false;
+      const uint8 byte = *p++;
+      value |= static_cast<uint64>(byte & 0x7F) << shift;
+      if (byte < 0x80) break;
+    }
+    if (out != nullptr) {
+      *out++ = static_cast<int64>(value);
+    }
+  }
+  return true;
+}
+
 namespace parsed {
 
 // ParseDataType has to be called first, then appropriate ParseZzzzList.
@@ -159,15 +288,14 @@ class Feature {
         if (!stream.ExpectTag(kDelimitedTag(1))) return false;  // packed tag
         uint32 packed_length;
         if (!stream.ReadVarint32(&packed_length)) return false;
-        auto packed_limit = stream.PushLimit(packed_length);
-
-        while (!stream.ExpectAtEnd()) {
-          uint32 buffer32;
-          if (!stream.ReadLittleEndian32(&buffer32)) return false;
-          float_list->push_back(bit_cast<float>(buffer32));
+        if (packed_length % sizeof(float) != 0) return false;
+        const uint8* data;
+        if (!ReadPackedBytes(&stream, packed_length, &data)) return false;
+        const size_t n = packed_length / sizeof(float);
+        float* out = Grow(float_list, n);
+        if (out != nullptr) {
+          CopyPackedFloats(data, n, out);
         }
-
-        stream.PopLimit(packed_limit);
       } else {  // non-packed
         while (!stream.ExpectAtEnd()) {
           if (!stream.ExpectTag(kFixed32Tag(1))) return false;
@@ -201,15 +329,12 @@ class Feature {
         if (!stream.ExpectTag(kDelimitedTag(1))) return false;  // packed tag
         uint32 packed_length;
         if (!stream.ReadVarint32(&packed_length)) return false;
-        auto packed_limit = stream.PushLimit(packed_length);
-
-        while (!stream.ExpectAtEnd()) {
-          protobuf_uint64 n;  // There is no API for int64
-          if (!stream.ReadVarint64(&n)) return false;
-          int64_list->push_back(static_cast<int64>(n));
+        const uint8* data;
+        if (!ReadPackedBytes(&stream, packed_length, &data)) return false;
+        const size_t n = CountPackedVarints(data, packed_length);
+        if (!DecodePackedVarints(data, packed_length, Grow(int64_list, n))) {
+          return false;
         }
-
-        stream.PopLimit(packed_limit);
       } else {  // non-packed
         while (!stream.ExpectAtEnd()) {
           if (!stream.ExpectTag(kVarintTag(1))) return false;
@@ -445,28 +570,6 @@ struct SeededHasher {
   uint64 seed{0xDECAFCAFFE};
 };
 
-template <typename T>
-class LimitedArraySlice {
- public:
-  LimitedArraySlice(T* begin, size_t num_elements)
-      : current_(begin), end_(begin + num_elements) {}
-
-  // May return negative if there were push_back calls after slice was filled.
-  int64 EndDistance() const { return end_ - current_; }
-
-  // Attempts to push value to the back of this. If the slice has
-  // already been filled, this method has no effect on the underlying data, but
-  // it changes the number returned by EndDistance into negative values.
-  void push_back(T&& value) {
-    if (EndDistance() > 0) *current_ = std::move(value);
-    ++current_;
-  }
-
- private:
-  T* current_;
-  T* end_;
-};
-
 void LogDenseFeatureDataLoss(StringPiece feature_name) {
   LOG(WARNING) << "Data loss! Feature '" << feature_name
                << "' is present in multiple concatenated "
@@ -1593,18 +1696,15 @@ inline int ParseFloatFeature(protobuf::io::CodedInputStream* stream,
           !stream->ReadVarint32(&packed_length)) {
         return -1;
       }
-      auto packed_limit = stream->PushLimit(packed_length);
-      while (!stream->ExpectAtEnd()) {
-        uint32 buffer32;
-        if (!stream->ReadLittleEndian32(&buffer32)) {
-          return -1;
-        }
-        if (out != nullptr) {
-          *out++ = bit_cast<float>(buffer32);
-        }
-        num_elements++;
+      const uint8* data;
+      if (packed_length % sizeof(float) != 0 ||
+          !ReadPackedBytes(stream, packed_length, &data)) {
+        return -1;
+      }
+      num_elements = packed_length / sizeof(float);
+      if (out != nullptr) {
+        CopyPackedFloats(data, num_elements, out);
       }
-      stream->PopLimit(packed_limit);
     } else if (peek_tag == kFixed32Tag(1)) {
       while (!stream->ExpectAtEnd()) {
         uint32 buffer32;
@@ -1644,18 +1744,12 @@ inline int ParseInt64Feature(protobuf::io::CodedInputStream* stream,
           !stream->ReadVarint32(&packed_length)) {
         return -1;
       }
-      auto packed_limit = stream->PushLimit(packed_length);
-      while (!stream->ExpectAtEnd()) {
-        protobuf_uint64 n;  // There is no API for int64
-        if (!stream->ReadVarint64(&n)) {
-          return -1;
-        }
-        if (out != nullptr) {
-          *out++ = n;
-        }
-        num_elements++;
+      const uint8* data;
+      if (!ReadPackedBytes(stream, packed_length, &data) ||
+          !DecodePackedVarints(data, packed_length, out)) {
+        return -1;
       }
-      stream->PopLimit(packed_limit);
+      num_elements = CountPackedVarints(data, packed_length);
     } else if (peek_tag == kVarintTag(1)) {
       while (!stream->ExpectAtEnd()) {
         protobuf_uint64 n;  // There is no API for int64
@@ -422,6 +422,125 @@ TEST(TestFastParseExample, Empty) {
   EXPECT_TRUE(status.ok()) << status;
 }
 
+TEST(FastParse, PackedLists) {
+  Example example;
+  auto& features = *example.mutable_features()->mutable_feature();
+  Int64List* int64_list = features["int64_list"].mutable_int64_list();
+  FloatList* float_list = features["float_list"].mutable_float_list();
+  // Mixes runs of one-byte varints with longer and negative values.
+  for (int64 i = 0; i < 100; ++i) {
+    int64_list->add_value(i % 20 == 0 ? -i * 1000003 : i);
+    float_list->add_value(i * 0.5f);
+  }
+  int64_list->add_value(kint64max);
+  int64_list->add_value(kint64min);
+  TestCorrectness(Serialize(example));
+}
+
+TEST(FastParse, TruncatedPackedInt64List) {
+  // The packed list of the NonPacked test, with the continuation bit set in
+  // its last byte.
+  Example example;
+  EXPECT_FALSE(TestFastParse(
+      "\x0a\x0e\x0a\x0c\x0a\x03\x61\x67\x65\x12\x05\x1a\x03\x0a\x01"
+      "\x8d",
+      &example));
+}
+
+// Benchmarks FastParseExample on batches of Examples resembling those of
+// ranking and vision models.
+enum class BenchmarkFeatures {
+  // 20 sparse int64 features of 10 ids each, half of them hashed to 64 bits.
+  kSparseIds,
+  // 4 dense float features of 256 values each.
+  kDenseFloats,
+  // 10 sparse int64 features of 10 small ids each, 2 dense float features of
+  // 64 values each, and 2 scalar string features.
+  kMixed,
+};
+
+static void BM_FastParseExample(int iters, int features_arg) {
+  testing::StopTiming();
+  const auto features = static_cast<BenchmarkFeatures>(features_arg);
+  random::PhiloxRandom philox(42);
+  random::SimplePhilox rng(&philox);
+  const int num_sparse_int64 =
+      features == BenchmarkFeatures::kSparseIds
+          ? 20
+          : features == BenchmarkFeatures::kMixed ? 10 : 0;
+  const int num_dense_float =
+      features == BenchmarkFeatures::kDenseFloats
+          ? 4
+          : features == BenchmarkFeatures::kMixed ? 2 : 0;
+  const int dense_float_size =
+      features == BenchmarkFeatures::kDenseFloats ? 256 : 64;
+  const int num_string = features == BenchmarkFeatures::kMixed ? 2 : 0;
+
+  FastParseExampleConfig config;
+  std::vector<string> names;
+  for (int i = 0; i < num_sparse_int64; ++i) {
+    names.push_back(strings::StrCat("ids_", i));
+    AddSparseFeature(names.back().c_str(), DT_INT64, &config);
+  }
+  for (int i = 0; i < num_dense_float; ++i) {
+    names.push_back(strings::StrCat("floats_", i));
+  }
+  for (int i = 0; i < num_string; ++i) {
+    names.push_back(strings::StrCat("string_", i));
+  }
+  // `names` is complete, so the pointers into it stay valid.
+  for (int i = 0; i < num_dense_float; ++i) {
+    AddDenseFeature(names[num_sparse_int64 + i].c_str(), DT_FLOAT,
+                    {dense_float_size}, false, dense_float_size, &config);
+  }
+  for (int i = 0; i < num_string; ++i) {
+    AddDenseFeature(names[num_sparse_int64 + num_dense_float + i].c_str(),
+                    DT_STRING, {}, false, 1, &config);
+  }
+
+  const int kBatchSize = 128;
+  std::vector<string> serialized;
+  int64 num_bytes = 0;
+  for (int b = 0; b < kBatchSize; ++b) {
+    Example example;
+    auto& feature_map = *example.mutable_features()->mutable_feature();
+    for (int i = 0; i < num_sparse_int64; ++i) {
+      Int64List* list = feature_map[names[i]].mutable_int64_list();
+      for (int j = 0; j < 10; ++j) {
+        const bool hashed =
+            features == BenchmarkFeatures::kSparseIds && i % 2 == 1;
+        list->add_value(hashed ? static_cast<int64>(rng.Rand64() >> 1)
+                               : rng.Uniform(100));
+      }
+    }
+    for (int i = 0; i < num_dense_float; ++i) {
+      FloatList* list =
+          feature_map[names[num_sparse_int64 + i]].mutable_float_list();
+      for (int j = 0; j < dense_float_size; ++j) {
+        list->add_value(rng.RandFloat());
+      }
+    }
+    for (int i = 0; i < num_string; ++i) {
+      feature_map[names[num_sparse_int64 + num_dense_float + i]]
+          .mutable_bytes_list()
+          ->add_value(RandStr(&rng));
+    }
+    serialized.push_back(Serialize(example));
+    num_bytes += serialized.back().size();
+  }
+
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    Result result;
+    TF_CHECK_OK(FastParseExample(config, serialized, {}, nullptr, &result));
+  }
+  testing::BytesProcessed(static_cast<int64>(iters) * num_bytes);
+}
+BENCHMARK(BM_FastParseExample)
+    ->Arg(static_cast<int>(BenchmarkFeatures::kSparseIds))
+    ->Arg(static_cast<int>(BenchmarkFeatures::kDenseFloats))
+    ->Arg(static_cast<int>(BenchmarkFeatures::kMixed));
+
 }  // namespace
 }  // namespace example
 }  // namespace tensorflow
@@ -64,6 +64,7 @@ limitations under the License.
 #include "tensorflow/core/protobuf/tensor_bundle.pb.h"
 
 #include <map>
+#include <memory>
 #include <string>
 #include <unordered_map>
 
@@ -181,7 +182,18 @@ Status MergeBundles(Env* env, gtl::ArraySlice<string> prefixes,
 // All threads accessing the same BundleReader must synchronize.
 class BundleReader {
  public:
+  struct Options {
+    // If true, data files are memory-mapped (when the file system supports
+    // it) and a lookup into an empty "val" of a numeric tensor whose data is
+    // aligned to EIGEN_MAX_ALIGN_BYTES in the file returns a read-only tensor
+    // that aliases the mapped pages instead of a copy. The mapping stays
+    // alive as long as such a tensor does, even after the reader is
+    // destroyed. Bundles written with BundleWriter::Options::data_alignment
+    // a multiple of EIGEN_MAX_ALIGN_BYTES have all such tensors aligned.
+    bool use_mmap = false;
+  };
   BundleReader(Env* const env, StringPiece prefix);
+  BundleReader(Env* const env, StringPiece prefix, const Options& options);
   ~BundleReader();
 
   // Is ok() iff the reader construction is successful (completed the read of
@@ -210,6 +222,8 @@ class BundleReader {
   // Caller must make sure "val" has the same shape and dtype as the
   // corresponding contents, so that its buffer can be filled without needing
   // extra allocation.  These can be queried via "LookupDtypeAndShape()".
+  // Alternatively, "val" may be empty, in which case the reader allocates it
+  // (or, with Options::use_mmap, may alias it to the mapped data file).
   //
   // On error, "val" may contain nonsense data.  Returns a NotFound error if
   // tensor keyed by "key" does not exist in this bundle.
@@ -274,6 +288,13 @@ class BundleReader {
   Status GetValue(const BundleEntryProto& entry,
                   Tensor* val) TF_MUST_USE_RESULT;
 
+  // If data file "entry.shard_id()" can be memory-mapped and the data of
+  // "entry" is suitably aligned in it, sets "*val" to a tensor aliasing the
+  // mapped data and "*aliased" to true. Otherwise sets "*aliased" to false
+  // and leaves "val" untouched.
+  Status GetMappedValue(const BundleEntryProto& entry, Tensor* val,
+                        bool* aliased) TF_MUST_USE_RESULT;
+
   // Reads the slice described by "slice_spec".  The corresponding full tensor
   // has key "ful_tensor_key" and metadata proto "full_tensor_entry".
   // REQUIRES: full_tensor_entry.slices_size() > 0
@@ -284,6 +305,7 @@ class BundleReader {
 
   Env* env_;  // Not owned.
   const string prefix_;
+  const Options options_;
 
   Status status_;
   RandomAccessFile* metadata_;  // Owned.
@@ -291,6 +313,11 @@ class BundleReader {
   table::Iterator* iter_;
   // Owned the InputBuffer objects and their underlying RandomAccessFile's.
   std::unordered_map<int32, io::InputBuffer*> data_;
+  // Memory-mapped data files, shared with the tensors aliasing them. Holds
+  // nullptr for files that could not be mapped. Only used with
+  // Options::use_mmap.
+  std::unordered_map<int32, std::shared_ptr<ReadOnlyMemoryRegion>>
+      mapped_data_;
 
   // Maps each partitioned tensor's key to its stored slices (represented in a
   // TensorSliceSet).  Populated on-demand.
@@ -671,6 +671,74 @@ TEST(TensorBundleTest, Checksum) {
   }
 }
 
+TEST(TensorBundleTest, MemoryMappedLookup) {
+  {
+    BundleWriter::Options opts;
+    opts.data_alignment = 64;
+    BundleWriter writer(Env::Default(), Prefix("mmap"), opts);
+    TF_EXPECT_OK(writer.Add("bool", Constant(true, TensorShape({3}))));
+    TF_EXPECT_OK(writer.Add("float", Constant_2x3<float>(1.5f)));
+    TF_EXPECT_OK(writer.Add("string", test::AsTensor<string>({"a", "b"})));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  BundleReader::Options options;
+  options.use_mmap = true;
+  Tensor float_val;
+  {
+    BundleReader reader(Env::Default(), Prefix("mmap"), options);
+    TF_ASSERT_OK(reader.status());
+    TF_ASSERT_OK(reader.Lookup("float", &float_val));
+    test::ExpectTensorEqual<float>(float_val, Constant_2x3<float>(1.5f));
+
+    // Empty tensors are aliased to the mapped data.
+    Tensor aliased;
+    TF_ASSERT_OK(reader.Lookup("float", &aliased));
+    EXPECT_EQ(float_val.tensor_data().data(), aliased.tensor_data().data());
+
+    // Pre-allocated tensors are still filled with a copy.
+    Tensor copied(DT_FLOAT, TensorShape({2, 3}));
+    TF_ASSERT_OK(reader.Lookup("float", &copied));
+    EXPECT_NE(float_val.tensor_data().data(), copied.tensor_data().data());
+    test::ExpectTensorEqual<float>(copied, float_val);
+
+    Tensor bool_val;
+    TF_ASSERT_OK(reader.Lookup("bool", &bool_val));
+    test::ExpectTensorEqual<bool>(bool_val, Constant(true, TensorShape({3})));
+
+    // String tensors are read as usual.
+    Tensor string_val;
+    TF_ASSERT_OK(reader.Lookup("string", &string_val));
+    test::ExpectTensorEqual<string>(string_val,
+                                    test::AsTensor<string>({"a", "b"}));
+  }
+  // The mapping outlives the reader.
+  test::ExpectTensorEqual<float>(float_val, Constant_2x3<float>(1.5f));
+}
+
+TEST(TensorBundleTest, MemoryMappedLookupChecksum) {
+  {
+    BundleWriter::Options opts;
+    opts.data_alignment = 64;
+    BundleWriter writer(Env::Default(), Prefix("mmap_corrupt"), opts);
+    TF_EXPECT_OK(writer.Add("foo", Constant_2x3<float>(1.f)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  const string datafile = DataFilename(Prefix("mmap_corrupt"), 0, 1);
+  string data;
+  TF_ASSERT_OK(ReadFileToString(Env::Default(), datafile, &data));
+  data[0] = ~data[0];
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), datafile, data));
+
+  BundleReader::Options options;
+  options.use_mmap = true;
+  BundleReader reader(Env::Default(), Prefix("mmap_corrupt"), options);
+  TF_ASSERT_OK(reader.status());
+  Tensor val;
+  Status status = reader.Lookup("foo", &val);
+  EXPECT_TRUE(errors::IsDataLoss(status));
+  EXPECT_TRUE(str_util::StrContains(status.ToString(), "Checksum"));
+}
+
 TEST(TensorBundleTest, Endianness) {
   BundleWriter writer(Env::Default(), Prefix("end"));
   TF_EXPECT_OK(writer.Add("key", Constant_2x3<float>(1.0)));
@@ -852,6 +920,39 @@ static void BM_BundleAlignmentByteOff(int iters, int alignment,
   }                                                            \
   BENCHMARK(BM_BundleAlignment_##ALIGN##_##SIZE)
 
+static void BM_BundleLookup(int iters, int tensor_size, bool use_mmap) {
+  testing::StopTiming();
+  {
+    BundleWriter::Options opts;
+    opts.data_alignment = 64;
+    BundleWriter writer(Env::Default(), Prefix("lookup"), opts);
+    TF_CHECK_OK(writer.Add("big", Constant(32.1f, TensorShape({tensor_size}))));
+    TF_CHECK_OK(writer.Finish());
+  }
+  BundleReader::Options options;
+  options.use_mmap = use_mmap;
+  BundleReader reader(Env::Default(), Prefix("lookup"), options);
+  TF_CHECK_OK(reader.status());
+  testing::BytesProcessed(static_cast<int64>(iters) * tensor_size *
+                          sizeof(float));
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    Tensor t;
+    TF_CHECK_OK(reader.Lookup("big", &t));
+  }
+  testing::StopTiming();
+}
+
+static void BM_BundleLookupRead(int iters, int tensor_size) {
+  BM_BundleLookup(iters, tensor_size, false);
+}
+BENCHMARK(BM_BundleLookupRead)->Arg(4096)->Arg(1048576)->Arg(16777216);
+
+static void BM_BundleLookupMmap(int iters, int tensor_size) {
+  BM_BundleLookup(iters, tensor_size, true);
+}
+BENCHMARK(BM_BundleLookupMmap)->Arg(4096)->Arg(1048576)->Arg(16777216);
+
 BM_BundleAlignment(1, 512);
 BM_BundleAlignment(1, 4096);
 BM_BundleAlignment(1, 1048576);
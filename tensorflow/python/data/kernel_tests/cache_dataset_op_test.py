@@ -17,6 +17,7 @@ from __future__ import absolute_import
 from __future__ import division
 from __future__ import print_function
 
+import os
 from os import path
 import shutil
 import tempfile
@@ -312,6 +313,36 @@ class MemoryCacheDatasetTest(test.TestCase):
       with self.assertRaises(errors.OutOfRangeError):
         sess.run(itr.get_next())
 
+  def testCacheSpillsToDisk(self):
+    spill_dir = tempfile.mkdtemp()
+    env = {
+        "TF_DATA_CACHE_MEMORY_BUDGET_BYTES": "1000",
+        "TF_DATA_CACHE_SPILL_SHARD_BYTES": "512",
+        "TF_DATA_CACHE_SPILL_DIR": spill_dir,
+    }
+    try:
+      os.environ.update(env)
+      dataset = dataset_ops.Dataset.range(100).map(
+          lambda x: (x, array_ops.fill([16], x))).cache().repeat(2)
+      get_next = dataset.make_one_shot_iterator().get_next()
+
+      with self.test_session() as sess:
+        for i in range(100):
+          self.assertEqual((i, [i] * 16), tuple(
+              v.tolist() for v in sess.run(get_next)))
+        # Most of the elements exceed the memory budget and were spilled to
+        # several shards.
+        self.assertGreater(len(os.listdir(spill_dir)), 1)
+        for i in range(100):
+          self.assertEqual((i, [i] * 16), tuple(
+              v.tolist() for v in sess.run(get_next)))
+        with self.assertRaises(errors.OutOfRangeError):
+          sess.run(get_next)
+    finally:
+      for name in env:
+        del os.environ[name]
+      shutil.rmtree(spill_dir, ignore_errors=True)
+
 
 if __name__ == "__main__":
   test.main()
@@ -88,6 +88,18 @@ class UniqueTest(test.TestCase):
     for i in range(len(x)):
       self.assertEqual(x[i], tf_y[tf_idx[i]])
 
+  def testInt64Large(self):
+    # Large enough to take the parallel path of the kernel.
+    x = np.random.randint(0, high=100000, size=(1 << 21)).astype(np.int64)
+    _, first = np.unique(x, return_index=True)
+    with self.test_session() as sess:
+      y, idx = array_ops.unique(x)
+      tf_y, tf_idx = sess.run([y, idx])
+
+    # Unique elements are in order of first occurrence.
+    self.assertAllEqual(x[np.sort(first)], tf_y)
+    self.assertAllEqual(x, tf_y[tf_idx])
+
 
 class UniqueWithCountsTest(test.TestCase):
 
@@ -166,6 +178,19 @@ class UniqueWithCountsTest(test.TestCase):
     for value, count in zip(tf_y, tf_count):
       self.assertEqual(count, np.sum(x == value))
 
+  def testInt64Large(self):
+    # Large enough to take the parallel path of the kernel.
+    x = np.random.randint(0, high=100000, size=(1 << 21)).astype(np.int64)
+    _, first, counts = np.unique(x, return_index=True, return_counts=True)
+    order = np.argsort(first)
+    with self.test_session() as sess:
+      y, idx, count = array_ops.unique_with_counts(x)
+      tf_y, tf_idx, tf_count = sess.run([y, idx, count])
+
+    self.assertAllEqual(x[first[order]], tf_y)
+    self.assertAllEqual(x, tf_y[tf_idx])
+    self.assertAllEqual(counts[order], tf_count)
+
 
 if __name__ == '__main__':
   test.main()